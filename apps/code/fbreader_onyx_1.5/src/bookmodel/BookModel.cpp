@@ -22,6 +22,7 @@
 
 #include "BookModel.h"
 #include "BookReader.h"
+#include "BookModelCache.h"
 
 #include "../formats/FormatPlugin.h"
 #include "../database/booksdb/BooksDBUtil.h"
@@ -31,8 +32,9 @@ BookModel::BookModel(const fb::shared_ptr<DBBook> book) : myBook(book) {
 	myContentsModel = new ContentsModel();
 	ZLFile file(book->fileName());
 	FormatPlugin *plugin = PluginCollection::instance().plugin(file, false);
-	if (plugin != 0) {
+	if ((plugin != 0) && !BookModelCache::load(*this, *plugin)) {
 		plugin->readModel(*book, *this);
+		BookModelCache::save(*this, *plugin);
 	}
 }
 
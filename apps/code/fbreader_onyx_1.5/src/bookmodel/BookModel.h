@@ -73,6 +73,7 @@ private:
 	std::map<std::string,Label> myInternalHyperlinks;
 
 friend class BookReader;
+friend class BookModelCache;
 };
 
 inline fb::shared_ptr<ZLTextModel> BookModel::bookTextModel() const { return myBookTextModel; }
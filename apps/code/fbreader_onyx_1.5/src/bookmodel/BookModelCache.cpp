@@ -0,0 +1,484 @@
+/*
+ * Copyright (C) 2004-2009 Geometer Plus <contact@geometerplus.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#ifndef _WINDOWS
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+#include <map>
+#include <vector>
+
+#include <ZLibrary.h>
+#include <ZLFile.h>
+#include <ZLDir.h>
+#include <ZLOutputStream.h>
+#include <ZLStringUtil.h>
+#include <ZLImage.h>
+#include <ZLFileImage.h>
+
+#include "BookModelCache.h"
+#include "BookModel.h"
+
+#include "../formats/FormatPlugin.h"
+#include "../database/sqldb/DataBase.h"
+
+// The models are written with the memory layout of this build, a cache
+// written by another build is never read, see the header check below.
+static const char CACHE_MAGIC[4] = { 'F', 'B', 'M', 'C' };
+static const unsigned int CACHE_VERSION = 1;
+static const std::string MODELS_DIR_NAME = "models";
+
+// Keeps the mapped cache file alive while a model uses its paragraphs.
+class BookModelCacheStorage : public ZLTextModelStorage {
+
+public:
+	BookModelCacheStorage(void *address, size_t size);
+	~BookModelCacheStorage();
+
+private:
+	void *myAddress;
+	size_t mySize;
+};
+
+BookModelCacheStorage::BookModelCacheStorage(void *address, size_t size) : myAddress(address), mySize(size) {
+}
+
+BookModelCacheStorage::~BookModelCacheStorage() {
+#ifndef _WINDOWS
+	munmap(myAddress, mySize);
+#endif
+}
+
+class BookModelCacheWriter {
+
+public:
+	BookModelCacheWriter(ZLOutputStream &stream);
+
+	void write(const char *data, size_t size);
+	void writeNumber(size_t number);
+	void writeInt(int number);
+	void writeString(const std::string &str);
+
+private:
+	ZLOutputStream &myStream;
+};
+
+BookModelCacheWriter::BookModelCacheWriter(ZLOutputStream &stream) : myStream(stream) {
+}
+
+void BookModelCacheWriter::write(const char *data, size_t size) {
+	myStream.write(data, size);
+}
+
+void BookModelCacheWriter::writeNumber(size_t number) {
+	write((const char*)&number, sizeof(size_t));
+}
+
+void BookModelCacheWriter::writeInt(int number) {
+	write((const char*)&number, sizeof(int));
+}
+
+void BookModelCacheWriter::writeString(const std::string &str) {
+	writeNumber(str.length());
+	write(str.data(), str.length());
+}
+
+class BookModelCacheReader {
+
+public:
+	BookModelCacheReader(char *data, const char *end);
+
+	char *&data();
+	const char *end() const;
+	bool read(void *value, size_t size);
+	bool readNumber(size_t &number);
+	bool readInt(int &number);
+	bool readString(std::string &str);
+	bool skip(size_t size);
+
+private:
+	char *myData;
+	const char *myEnd;
+};
+
+BookModelCacheReader::BookModelCacheReader(char *data, const char *end) : myData(data), myEnd(end) {
+}
+
+char *&BookModelCacheReader::data() {
+	return myData;
+}
+
+const char *BookModelCacheReader::end() const {
+	return myEnd;
+}
+
+bool BookModelCacheReader::read(void *value, size_t size) {
+	if ((myData == 0) || ((size_t)(myEnd - myData) < size)) {
+		return false;
+	}
+	memcpy(value, myData, size);
+	myData += size;
+	return true;
+}
+
+bool BookModelCacheReader::readNumber(size_t &number) {
+	return read(&number, sizeof(size_t));
+}
+
+bool BookModelCacheReader::readInt(int &number) {
+	return read(&number, sizeof(int));
+}
+
+bool BookModelCacheReader::readString(std::string &str) {
+	size_t length = 0;
+	if (!readNumber(length) || ((size_t)(myEnd - myData) < length)) {
+		return false;
+	}
+	str.assign(myData, length);
+	myData += length;
+	return true;
+}
+
+bool BookModelCacheReader::skip(size_t size) {
+	if ((size_t)(myEnd - myData) < size) {
+		return false;
+	}
+	myData += size;
+	return true;
+}
+
+// HTML and plain text models depend on the text format options, so only
+// the formats with a fixed markup are cached. Books without an id are
+// opened outside of the library and not worth a cache file.
+bool BookModelCache::isCacheable(const BookModel &model, const FormatPlugin &plugin) {
+#ifndef _WINDOWS
+	if (model.book()->bookId() == 0) {
+		return false;
+	}
+	const std::string &name = plugin.iconName();
+	return (name == "oeb") || (name == "fb2");
+#else
+	return false;
+#endif
+}
+
+std::string BookModelCache::fileName(const BookModel &model) {
+	ZLFile modelsDir(DataBase::databaseDirName() + ZLibrary::FileNameDelimiter + MODELS_DIR_NAME);
+	modelsDir.directory(true);
+	std::string name = modelsDir.path() + ZLibrary::FileNameDelimiter;
+	ZLStringUtil::appendNumber(name, model.book()->bookId());
+	return name;
+}
+
+// Everything the parsed model depends on; a book file replaced under the
+// same name gets another size or modification time, a changed reader
+// another plugin model version.
+std::string BookModelCache::key(const BookModel &model, const FormatPlugin &plugin) {
+	const DBBook &book = *model.book();
+	struct stat fileStat;
+	if (stat(ZLFile(book.fileName()).physicalFilePath().c_str(), &fileStat) != 0) {
+		return std::string();
+	}
+
+	std::string key = plugin.iconName();
+	key += ':';
+	ZLStringUtil::appendNumber(key, plugin.modelVersion());
+	key += ':';
+	key += book.fileName();
+	key += ':';
+	ZLStringUtil::appendNumber(key, (unsigned int)fileStat.st_size);
+	key += ':';
+	ZLStringUtil::appendNumber(key, (unsigned int)fileStat.st_mtime);
+	key += ':';
+	key += book.encoding();
+	key += ':';
+	key += book.language();
+	return key;
+}
+
+// File layout: header and key, images, footnote ids, labels, contents
+// references, then the paragraphs of the book text, the contents and the
+// footnotes. Images that are not a part of some file, like the base64
+// data of fb2 books, are stored in the cache file itself.
+void BookModelCache::save(const BookModel &model, const FormatPlugin &plugin) {
+	if (!isCacheable(model, plugin)) {
+		return;
+	}
+	const std::string modelKey = key(model, plugin);
+	if (modelKey.empty()) {
+		return;
+	}
+
+	for (ZLImageMap::const_iterator it = model.myImages.begin(); it != model.myImages.end(); ++it) {
+		if (it->second.isNull() || !it->second->isSingle()) {
+			return;
+		}
+	}
+
+	// Labels refer to the models by their position in the file.
+	std::map<const ZLTextModel*,int> modelIndices;
+	modelIndices[&*model.myBookTextModel] = 0;
+	int index = 1;
+	for (std::map<std::string,fb::shared_ptr<ZLTextModel> >::const_iterator it = model.myFootnotes.begin(); it != model.myFootnotes.end(); ++it) {
+		modelIndices[&*it->second] = index++;
+	}
+	std::vector<int> labelModels;
+	for (std::map<std::string,BookModel::Label>::const_iterator it = model.myInternalHyperlinks.begin(); it != model.myInternalHyperlinks.end(); ++it) {
+		if (it->second.Model.isNull()) {
+			labelModels.push_back(-1);
+			continue;
+		}
+		std::map<const ZLTextModel*,int>::const_iterator jt = modelIndices.find(&*it->second.Model);
+		if (jt == modelIndices.end()) {
+			return;
+		}
+		labelModels.push_back(jt->second);
+	}
+
+	const std::string name = fileName(model);
+	fb::shared_ptr<ZLOutputStream> stream = ZLFile(name).outputStream();
+	if (stream.isNull() || !stream->open()) {
+		return;
+	}
+	BookModelCacheWriter writer(*stream);
+
+	writer.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+	writer.write((const char*)&CACHE_VERSION, sizeof(CACHE_VERSION));
+	writer.writeInt(sizeof(size_t));
+	writer.writeInt(sizeof(void*));
+	writer.writeString(modelKey);
+
+	writer.writeNumber(model.myImages.size());
+	for (ZLImageMap::const_iterator it = model.myImages.begin(); it != model.myImages.end(); ++it) {
+		const ZLSingleImage &image = (const ZLSingleImage&)*it->second;
+		writer.writeString(it->first);
+		writer.writeString(image.mimeType());
+		std::string path;
+		size_t offset = 0;
+		size_t size = 0;
+		if (image.fileLocation(path, offset, size)) {
+			writer.writeInt(0);
+			writer.writeString(path);
+			writer.writeNumber(offset);
+			writer.writeNumber(size);
+		} else {
+			fb::shared_ptr<std::string> data = image.stringData();
+			const std::string empty;
+			const std::string &bytes = data.isNull() ? empty : *data;
+			writer.writeInt(1);
+			writer.writeNumber(bytes.length());
+			writer.write(bytes.data(), bytes.length());
+		}
+	}
+
+	writer.writeNumber(model.myFootnotes.size());
+	for (std::map<std::string,fb::shared_ptr<ZLTextModel> >::const_iterator it = model.myFootnotes.begin(); it != model.myFootnotes.end(); ++it) {
+		writer.writeString(it->first);
+	}
+
+	writer.writeNumber(labelModels.size());
+	std::vector<int>::const_iterator jt = labelModels.begin();
+	for (std::map<std::string,BookModel::Label>::const_iterator it = model.myInternalHyperlinks.begin(); it != model.myInternalHyperlinks.end(); ++it, ++jt) {
+		writer.writeString(it->first);
+		writer.writeInt(*jt);
+		writer.writeInt(it->second.ParagraphNumber);
+	}
+
+	const ContentsModel &contents = (const ContentsModel&)*model.myContentsModel;
+	const size_t contentsSize = contents.paragraphsNumber();
+	writer.writeNumber(contentsSize);
+	for (size_t i = 0; i < contentsSize; ++i) {
+		writer.writeInt(contents.reference((const ZLTextTreeParagraph*)contents[i]));
+	}
+
+	model.myBookTextModel->writeParagraphs(*stream);
+	model.myContentsModel->writeParagraphs(*stream);
+	for (std::map<std::string,fb::shared_ptr<ZLTextModel> >::const_iterator it = model.myFootnotes.begin(); it != model.myFootnotes.end(); ++it) {
+		it->second->writeParagraphs(*stream);
+	}
+	stream->close();
+}
+
+// The paragraphs are used right in the mapped file. It is mapped private
+// and writable, the image map addresses are patched in the pages of this
+// process only. The model is changed only if the whole file is good.
+bool BookModelCache::load(BookModel &model, const FormatPlugin &plugin) {
+#ifndef _WINDOWS
+	if (!isCacheable(model, plugin)) {
+		return false;
+	}
+	const std::string modelKey = key(model, plugin);
+	if (modelKey.empty()) {
+		return false;
+	}
+
+	const std::string name = fileName(model);
+	const int fd = open(name.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat fileStat;
+	if ((fstat(fd, &fileStat) != 0) || (fileStat.st_size == 0)) {
+		close(fd);
+		return false;
+	}
+	const size_t fileSize = fileStat.st_size;
+	void *address = mmap(0, fileSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (address == MAP_FAILED) {
+		return false;
+	}
+	fb::shared_ptr<ZLTextModelStorage> storage = new BookModelCacheStorage(address, fileSize);
+
+	char *start = (char*)address;
+	BookModelCacheReader reader(start, start + fileSize);
+
+	char magic[sizeof(CACHE_MAGIC)];
+	unsigned int version = 0;
+	int sizeOfSize = 0;
+	int sizeOfPointer = 0;
+	std::string cachedKey;
+	if (!reader.read(magic, sizeof(magic)) ||
+			(memcmp(magic, CACHE_MAGIC, sizeof(magic)) != 0) ||
+			!reader.read(&version, sizeof(version)) || (version != CACHE_VERSION) ||
+			!reader.readInt(sizeOfSize) || (sizeOfSize != sizeof(size_t)) ||
+			!reader.readInt(sizeOfPointer) || (sizeOfPointer != sizeof(void*)) ||
+			!reader.readString(cachedKey) || (cachedKey != modelKey)) {
+		return false;
+	}
+
+	ZLImageMap images;
+	size_t imagesNumber = 0;
+	if (!reader.readNumber(imagesNumber)) {
+		return false;
+	}
+	for (size_t i = 0; i < imagesNumber; ++i) {
+		std::string id;
+		std::string mimeType;
+		int embedded = 0;
+		std::string path;
+		size_t offset = 0;
+		size_t size = 0;
+		if (!reader.readString(id) || !reader.readString(mimeType) || !reader.readInt(embedded)) {
+			return false;
+		}
+		if (embedded == 0) {
+			if (!reader.readString(path) || !reader.readNumber(offset) || !reader.readNumber(size)) {
+				return false;
+			}
+		} else {
+			if (!reader.readNumber(size)) {
+				return false;
+			}
+			path = name;
+			offset = reader.data() - start;
+			if (!reader.skip(size)) {
+				return false;
+			}
+		}
+		images[id] = new ZLFileImage(mimeType, path, offset, size);
+	}
+
+	std::vector<std::string> footnoteIds;
+	size_t footnotesNumber = 0;
+	if (!reader.readNumber(footnotesNumber)) {
+		return false;
+	}
+	for (size_t i = 0; i < footnotesNumber; ++i) {
+		std::string id;
+		if (!reader.readString(id)) {
+			return false;
+		}
+		footnoteIds.push_back(id);
+	}
+
+	std::vector<fb::shared_ptr<ZLTextModel> > models;
+	models.push_back(new ZLTextPlainModel(102400));
+	for (size_t i = 0; i < footnotesNumber; ++i) {
+		models.push_back(new ZLTextPlainModel(8192));
+	}
+
+	std::map<std::string,BookModel::Label> labels;
+	size_t labelsNumber = 0;
+	if (!reader.readNumber(labelsNumber)) {
+		return false;
+	}
+	for (size_t i = 0; i < labelsNumber; ++i) {
+		std::string id;
+		int modelIndex = -1;
+		int paragraphNumber = -1;
+		if (!reader.readString(id) || !reader.readInt(modelIndex) || !reader.readInt(paragraphNumber) ||
+				(modelIndex < -1) || (modelIndex >= (int)models.size())) {
+			return false;
+		}
+		labels.insert(std::pair<std::string,BookModel::Label>(
+			id, BookModel::Label((modelIndex >= 0) ? models[modelIndex] : fb::shared_ptr<ZLTextModel>(), paragraphNumber)
+		));
+	}
+
+	std::vector<int> references;
+	size_t referencesNumber = 0;
+	if (!reader.readNumber(referencesNumber)) {
+		return false;
+	}
+	for (size_t i = 0; i < referencesNumber; ++i) {
+		int reference = -1;
+		if (!reader.readInt(reference)) {
+			return false;
+		}
+		references.push_back(reference);
+	}
+
+	ContentsModel *contents = new ContentsModel();
+	fb::shared_ptr<ZLTextModel> contentsModel = contents;
+	char *&data = reader.data();
+	data = models[0]->readParagraphs(data, reader.end(), model.myImages, storage);
+	if (data != 0) {
+		data = contents->readParagraphs(data, reader.end(), model.myImages, storage);
+	}
+	for (size_t i = 1; (i < models.size()) && (data != 0); ++i) {
+		data = models[i]->readParagraphs(data, reader.end(), model.myImages, storage);
+	}
+	if ((data != reader.end()) || (contents->paragraphsNumber() != referencesNumber)) {
+		return false;
+	}
+	for (size_t i = 0; i < referencesNumber; ++i) {
+		if (references[i] != -1) {
+			contents->setReference((const ZLTextTreeParagraph*)(*contents)[i], references[i]);
+		}
+	}
+
+	model.myImages.swap(images);
+	model.myBookTextModel = models[0];
+	model.myContentsModel = contentsModel;
+	model.myFootnotes.clear();
+	for (size_t i = 0; i < footnotesNumber; ++i) {
+		model.myFootnotes.insert(std::pair<std::string,fb::shared_ptr<ZLTextModel> >(footnoteIds[i], models[i + 1]));
+	}
+	model.myInternalHyperlinks.swap(labels);
+	return true;
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2004-2009 Geometer Plus <contact@geometerplus.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef __BOOKMODELCACHE_H__
+#define __BOOKMODELCACHE_H__
+
+#include <string>
+
+class BookModel;
+class FormatPlugin;
+
+// Keeps the parsed model of a book in a file, so the next opening maps
+// the text instead of running the format plugin again.
+class BookModelCache {
+
+public:
+	static bool load(BookModel &model, const FormatPlugin &plugin);
+	static void save(const BookModel &model, const FormatPlugin &plugin);
+
+private:
+	static bool isCacheable(const BookModel &model, const FormatPlugin &plugin);
+	static std::string fileName(const BookModel &model);
+	static std::string key(const BookModel &model, const FormatPlugin &plugin);
+
+private:
+	// instance creation is disabled
+	BookModelCache();
+};
+
+#endif /* __BOOKMODELCACHE_H__ */
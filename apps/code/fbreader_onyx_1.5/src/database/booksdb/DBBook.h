@@ -32,6 +32,8 @@ class DBBook {
 
 friend class BooksDB;
 friend class BooksDBUtil;
+friend class BookTextView;
+friend class BookModelCache;
 
 friend class SaveTableBookRunnable;
 friend class SaveAuthorsRunnable;
@@ -17,6 +17,8 @@
  * 02110-1301, USA.
  */
 
+#include <ZLibrary.h>
+#include <ZLFile.h>
 #include <ZLOptions.h>
 #include <ZLDialogManager.h>
 #include <ZLStringUtil.h>
@@ -38,6 +40,7 @@ static const std::string LAST_STATE_GROUP = "LastState";
 static const std::string PARAGRAPH_OPTION_NAME = "Paragraph";
 static const std::string WORD_OPTION_NAME = "Word";
 static const std::string CHAR_OPTION_NAME = "Char";
+static const std::string PAGES_DIR_NAME = "pages";
 static const std::string BUFFER_SIZE = "UndoBufferSize";
 static const std::string POSITION_IN_BUFFER = "PositionInBuffer";
 static const std::string STATE_VALID = "Valid";
@@ -103,6 +106,13 @@ void BookTextView::setModel(fb::shared_ptr<ZLTextModel> model, const std::string
 	if (book.isNull()) {
 		return;
 	}
+	if (book->bookId() != 0) {
+		ZLFile pagesDir(DataBase::databaseDirName() + ZLibrary::FileNameDelimiter + PAGES_DIR_NAME);
+		pagesDir.directory(true);
+		std::string pagesFile = pagesDir.path() + ZLibrary::FileNameDelimiter;
+		ZLStringUtil::appendNumber(pagesFile, book->bookId());
+		setPaginationFile(pagesFile);
+	}
 	readBookState(*book);
 	myPositionStack.clear();
 	myCurrentPointInStack = 0;
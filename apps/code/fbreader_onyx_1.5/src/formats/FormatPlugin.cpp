@@ -85,6 +85,10 @@ void FormatPlugin::detectLanguage(DBBook &book, ZLInputStream &stream) {
 	book.setLanguage(language);
 }
 
+unsigned int FormatPlugin::modelVersion() const {
+	return 0;
+}
+
 const std::string &FormatPlugin::tryOpen(const std::string&) const {
 	static const std::string EMPTY = "";
 	return EMPTY;
@@ -58,6 +58,9 @@ public:
 	virtual const std::string &tryOpen(const std::string &path) const;
 	virtual bool readDescription(const std::string &path, DBBook &book) const = 0;
 	virtual bool readModel(const DBBook &book, BookModel &model) const = 0;
+	// Version of the model built by readModel. A plugin whose models are
+	// cached must change it whenever its reader builds a different model.
+	virtual unsigned int modelVersion() const;
 
 protected:
 	static void detectEncodingAndLanguage(DBBook &book, ZLInputStream &stream);
@@ -47,6 +47,11 @@ bool FB2Plugin::readModel(const DBBook &book, BookModel &model) const {
 	return FB2BookReader(model).readBook(book.fileName());
 }
 
+// Change it with FB2BookReader or FB2Reader.
+unsigned int FB2Plugin::modelVersion() const {
+	return 1;
+}
+
 const std::string &FB2Plugin::iconName() const {
 	static const std::string ICON_NAME = "fb2";
 	return ICON_NAME;
@@ -32,6 +32,7 @@ public:
 	bool readDescription(const std::string &path, DBBook &book) const;
 	bool readModel(const DBBook &book, BookModel &model) const;
 	const std::string &iconName() const;
+	unsigned int modelVersion() const;
 };
 
 inline FB2Plugin::FB2Plugin() {}
@@ -96,6 +96,11 @@ bool OEBPlugin::readModel(const DBBook &book, BookModel &model) const {
 	return OEBBookReader(model).readBook(opfFileName(book.fileName()));
 }
 
+// Change it with OEBBookReader, XHTMLReader or NCXReader.
+unsigned int OEBPlugin::modelVersion() const {
+	return 1;
+}
+
 const std::string &OEBPlugin::iconName() const {
 	static const std::string ICON_NAME = "oeb";
 	return ICON_NAME;
@@ -34,6 +34,7 @@ public:
 	bool readDescription(const std::string &path, DBBook &book) const;
 	bool readModel(const DBBook &book, BookModel &model) const;
 	const std::string &iconName() const;
+	unsigned int modelVersion() const;
 };
 
 #endif /* __OEBPLUGIN_H__ */
@@ -73,6 +73,9 @@ PlainTextInfoPage::~PlainTextInfoPage() {
 }
 
 const int BUFFER_SIZE = 4096;
+// The format is guessed from the start of the file, a large book would
+// be read twice before its first page otherwise.
+const int SAMPLE_SIZE = 1048576;
 
 void PlainTextFormatDetector::detect(ZLInputStream &stream, PlainTextFormat &format) {
 	if (!stream.open()) {
@@ -95,9 +98,11 @@ void PlainTextFormatDetector::detect(ZLInputStream &stream, PlainTextFormat &for
 	
 	char *buffer = new char[BUFFER_SIZE];
 	int length;
+	int sampleLength = 0;
 	char previous = 0;
 	do {
 		length = stream.read(buffer, BUFFER_SIZE);
+		sampleLength += length;
 		const char *end = buffer + length;
 		for (const char *ptr = buffer; ptr != end; ++ptr) {
 			++currentLineLength;
@@ -137,8 +142,9 @@ void PlainTextFormatDetector::detect(ZLInputStream &stream, PlainTextFormat &for
 			}
 			previous = *ptr;
 		}
-	} while (length == BUFFER_SIZE);
+	} while ((length == BUFFER_SIZE) && (sampleLength < SAMPLE_SIZE));
 	delete[] buffer;
+	stream.close();
 
 	unsigned int nonEmptyLineCounter = lineCounter - emptyLineCounter;
 
@@ -0,0 +1,466 @@
+/*
+ * Copyright (C) 2004-2009 Geometer Plus <contact@geometerplus.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#ifndef _WINDOWS
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+#include <algorithm>
+
+#include <ZLFile.h>
+#include <ZLStringUtil.h>
+#include <ZLTime.h>
+#include <ZLRunnable.h>
+#include <ZLUnicodeUtil.h>
+
+#include <ZLTextParagraph.h>
+
+#include "TxtParagraphSource.h"
+#include "PlainTextFormat.h"
+
+#include "../../bookmodel/BookModel.h"
+#include "../../bookmodel/FBTextKind.h"
+
+#include "onyx/base/device.h"
+
+// Smaller files are read by TxtBookReader in a moment.
+static const size_t MIN_FILE_SIZE = 2097152;
+// Indexed before the first page is shown.
+static const size_t FIRST_INDEX_SIZE = 262144;
+static const size_t INDEX_STEP = 65536;
+static const int INDEX_INTERVAL = 20;
+static const int INDEX_SLICE = 50;
+// TxtReader reads the file in blocks of this size.
+static const size_t READER_BLOCK_SIZE = 2048;
+static const size_t SAMPLE_SIZE = 65536;
+// Files on removable media are read in windows of this size; the bytes
+// asked for at a time must fit.
+static const size_t WINDOW_SIZE = 65536;
+
+class TxtParagraphIndexer : public ZLRunnable {
+
+public:
+	TxtParagraphIndexer(TxtParagraphSource &source);
+
+private:
+	void run();
+
+private:
+	TxtParagraphSource &mySource;
+};
+
+TxtParagraphIndexer::TxtParagraphIndexer(TxtParagraphSource &source) : mySource(source) {
+}
+
+void TxtParagraphIndexer::run() {
+	mySource.indexSlice();
+}
+
+// The paragraph breaks are found in the bytes of the file, so the
+// encoding must keep the ascii line ends and spaces as they are.
+static bool isByteEncoding(const std::string &encoding) {
+	std::string name;
+	for (std::string::const_iterator it = encoding.begin(); it != encoding.end(); ++it) {
+		if (isalnum((unsigned char)*it)) {
+			name += tolower((unsigned char)*it);
+		}
+	}
+	return
+		(name.compare(0, 5, "utf16") != 0) &&
+		(name.compare(0, 5, "utf32") != 0) &&
+		(name.compare(0, 3, "ucs") != 0);
+}
+
+#ifndef _WINDOWS
+static bool isUnder(const std::string &path, const std::string &directory) {
+	return (path == directory) || ZLStringUtil::stringStartsWith(path, directory + "/");
+}
+
+// The pages of a mapped file are gone when its card is removed and the
+// next access kills the reader with SIGBUS. Files on removable media are
+// read in windows instead.
+static bool isOnRemovableMedia(const std::string &fileName) {
+	char *realPath = realpath(fileName.c_str(), 0);
+	if (realPath == 0) {
+		return true;
+	}
+	const std::string path = realPath;
+	free(realPath);
+	return isUnder(path, SDMMC_ROOT) || isUnder(path, USB_ROOT);
+}
+#endif
+
+fb::shared_ptr<ZLTextParagraphSource> TxtParagraphSource::create(const std::string &fileName, const PlainTextFormat &format, const std::string &encoding, fb::shared_ptr<ZLTextModel> contentsModel) {
+#ifndef _WINDOWS
+	ZLFile file(fileName);
+	if (file.isCompressed() || (file.physicalFilePath() != file.path()) || !isByteEncoding(encoding)) {
+		return 0;
+	}
+	const int fd = open(file.path().c_str(), O_RDONLY);
+	if (fd < 0) {
+		return 0;
+	}
+	struct stat fileStat;
+	if ((fstat(fd, &fileStat) != 0) || ((size_t)fileStat.st_size < MIN_FILE_SIZE)) {
+		close(fd);
+		return 0;
+	}
+	const size_t size = fileStat.st_size;
+	TxtParagraphSource *source;
+	if (isOnRemovableMedia(file.path())) {
+		source = new TxtParagraphSource(fd, 0, size, format, encoding, contentsModel);
+	} else {
+		void *address = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+		close(fd);
+		if (address == MAP_FAILED) {
+			return 0;
+		}
+		source = new TxtParagraphSource(-1, (const char*)address, size, format, encoding, contentsModel);
+	}
+	fb::shared_ptr<ZLTextParagraphSource> sourcePtr = source;
+	source->index(FIRST_INDEX_SIZE);
+	source->findParagraphs(1);
+	if (!source->isComplete()) {
+		ZLTimeManager::instance().addTask(source->myIndexer, INDEX_INTERVAL);
+	}
+	return sourcePtr;
+#else
+	return 0;
+#endif
+}
+
+TxtParagraphSource::TxtParagraphSource(int file, const char *data, size_t size, const PlainTextFormat &format, const std::string &encoding, fb::shared_ptr<ZLTextModel> contentsModel) :
+	EncodedTextReader(encoding),
+	myFile(file),
+	myData(data),
+	mySize(size),
+	myWindow(data),
+	myWindowStart(0),
+	myWindowSize((data != 0) ? size : 0),
+	myBreakType(format.breakType()),
+	myIgnoredIndent(format.ignoredIndent()),
+	myEmptyLinesBeforeNewSection(format.emptyLinesBeforeNewSection()),
+	myCreateContentsTable(format.createContentsTable()),
+	myIndexedSize(0),
+	myLineFeedCounter(0),
+	myInsideContentsParagraph(false),
+	myInsideTitle(true),
+	myLastLineIsEmpty(true),
+	mySectionContainsRegularContents(false),
+	myContentsStart(0),
+	myContentsModel(contentsModel) {
+	myIndexer = new TxtParagraphIndexer(*this);
+	if (myData == 0) {
+		myBuffer.resize(WINDOW_SIZE);
+	}
+
+	std::string sample;
+	const size_t sampleSize = std::min(mySize, SAMPLE_SIZE);
+	const char *sampleData = bytes(0, sampleSize);
+	myConverter->convert(sample, sampleData, sampleData + sampleSize);
+	myConverter->reset();
+	myCharactersPerByte = (double)ZLUnicodeUtil::utf8Length(sample) / sampleSize;
+
+	beginParagraph(REGULAR_PARAGRAPH, 0);
+}
+
+TxtParagraphSource::~TxtParagraphSource() {
+	if (!isComplete()) {
+		ZLTimeManager::instance().removeTask(myIndexer);
+	}
+#ifndef _WINDOWS
+	if (myData != 0) {
+		munmap((void*)myData, mySize);
+	} else {
+		close(myFile);
+	}
+#endif
+}
+
+// Reads the bytes from offset on. The ones which cannot be read, after the
+// card has been removed, are zeros.
+void TxtParagraphSource::readWindow(size_t offset, size_t length) const {
+	myWindow = &myBuffer[0];
+	myWindowStart = offset;
+	myWindowSize = std::min(std::max(length, WINDOW_SIZE), mySize - offset);
+	size_t done = 0;
+#ifndef _WINDOWS
+	while (done < myWindowSize) {
+		const ssize_t result = pread(myFile, &myBuffer[done], myWindowSize - done, offset + done);
+		if (result > 0) {
+			done += result;
+		} else if ((result == 0) || (errno != EINTR)) {
+			break;
+		}
+	}
+#endif
+	std::fill(myBuffer.begin() + done, myBuffer.begin() + myWindowSize, '\0');
+}
+
+size_t TxtParagraphSource::paragraphsNumber() const {
+	return myOffsets.size() - 1;
+}
+
+bool TxtParagraphSource::isComplete() const {
+	return myOffsets.size() > myKinds.size();
+}
+
+void TxtParagraphSource::findParagraphs(size_t number) {
+	while ((paragraphsNumber() < number) && index(INDEX_STEP)) {
+	}
+}
+
+ZLTextParagraph::Kind TxtParagraphSource::paragraphKind(size_t index) const {
+	return (myKinds[index] == END_OF_SECTION_PARAGRAPH) ?
+		ZLTextParagraph::END_OF_SECTION_PARAGRAPH : ZLTextParagraph::TEXT_PARAGRAPH;
+}
+
+size_t TxtParagraphSource::characterNumber(size_t index) const {
+	return (size_t)((myOffsets[index + 1] - myOffsets[index]) * myCharactersPerByte);
+}
+
+void TxtParagraphSource::readParagraphs(size_t start, size_t end, ZLTextPlainModel &model) const {
+	std::string text;
+	for (size_t i = start; i < end; ++i) {
+		if (myKinds[i] == END_OF_SECTION_PARAGRAPH) {
+			model.createParagraph(ZLTextParagraph::END_OF_SECTION_PARAGRAPH);
+			continue;
+		}
+		model.createParagraph(ZLTextParagraph::TEXT_PARAGRAPH);
+		model.addControl(REGULAR, true);
+		if (myKinds[i] == TITLE_PARAGRAPH) {
+			model.addControl(SECTION_TITLE, true);
+		}
+		readText(myOffsets[i], myOffsets[i + 1], text);
+		if (!text.empty()) {
+			model.addText(text);
+		}
+	}
+}
+
+void TxtParagraphSource::indexSlice() {
+	const ZLTime start;
+	while (index(INDEX_STEP)) {
+		if (ZLTime().millisecondsFrom(start) >= INDEX_SLICE) {
+			return;
+		}
+	}
+}
+
+// Indexes the lines in the next length bytes at least. Returns false
+// when the whole file is indexed.
+bool TxtParagraphSource::index(size_t length) {
+	if (isComplete()) {
+		return false;
+	}
+	const size_t limit = std::min(mySize, myIndexedSize + length);
+	while (myIndexedSize < limit) {
+		size_t next;
+		const size_t end = lineEnd(myIndexedSize, next);
+		processLine(myIndexedSize, end, next);
+		myIndexedSize = next;
+	}
+	if (myIndexedSize < mySize) {
+		return true;
+	}
+
+	internalEndParagraph();
+	myOffsets.push_back(mySize);
+	ZLTimeManager::instance().removeTask(myIndexer);
+	return false;
+}
+
+// Lines end at '\n', '\r' or "\r\n" like in TxtReader. It takes a '\r'
+// at the end of a block and the '\n' after it for two line ends, so the
+// same is done here, the paragraph numbers must not change.
+size_t TxtParagraphSource::lineEnd(size_t offset, size_t &next) const {
+	size_t textEnd = offset;
+	while (textEnd < mySize) {
+		const size_t length = std::min(mySize - textEnd, WINDOW_SIZE);
+		const char *start = bytes(textEnd, length);
+		const char *end = start + length;
+		const char *ptr = start;
+		for (; ptr != end; ++ptr) {
+			if ((*ptr == '\n') || (*ptr == '\r')) {
+				break;
+			}
+		}
+		textEnd += ptr - start;
+		if (ptr != end) {
+			break;
+		}
+	}
+	if (textEnd == mySize) {
+		next = mySize;
+		return textEnd;
+	}
+	next = textEnd + 1;
+	if ((byteAt(textEnd) == '\r') && (next < mySize) && (byteAt(next) == '\n') && (next % READER_BLOCK_SIZE != 0)) {
+		++next;
+	}
+	return textEnd;
+}
+
+// The line handlers of TxtBookReader; the text is read later.
+void TxtParagraphSource::processLine(size_t start, size_t end, size_t next) {
+	size_t textStart = start;
+	int spaceCounter = 0;
+	for (; textStart != end; ++textStart) {
+		const char c = byteAt(textStart);
+		if (!isspace((unsigned char)c)) {
+			break;
+		}
+		spaceCounter += (c != '\t') ? 1 : myIgnoredIndent + 1;
+	}
+	if (textStart != end) {
+		myLastLineIsEmpty = false;
+		if ((myBreakType & PlainTextFormat::BREAK_PARAGRAPH_AT_LINE_WITH_INDENT) && (spaceCounter > myIgnoredIndent)) {
+			internalEndParagraph();
+			beginParagraph(myInsideContentsParagraph ? TITLE_PARAGRAPH : REGULAR_PARAGRAPH, start);
+			// TxtBookReader gets a line cut at the end of a block in pieces,
+			// the letters of the next pieces make the line not empty again
+			for (size_t offset = (textStart / READER_BLOCK_SIZE + 1) * READER_BLOCK_SIZE; offset < end; ++offset) {
+				if (!isspace((unsigned char)byteAt(offset))) {
+					myLastLineIsEmpty = false;
+					break;
+				}
+			}
+		}
+		if (!myInsideTitle) {
+			mySectionContainsRegularContents = true;
+		}
+	}
+	if (end == mySize) {
+		return;
+	}
+
+	if (!myLastLineIsEmpty) {
+		myLineFeedCounter = -1;
+	}
+	myLastLineIsEmpty = true;
+	++myLineFeedCounter;
+	bool paragraphBreak =
+		(myBreakType & PlainTextFormat::BREAK_PARAGRAPH_AT_NEW_LINE) ||
+		((myBreakType & PlainTextFormat::BREAK_PARAGRAPH_AT_EMPTY_LINE) && (myLineFeedCounter > 0));
+
+	if (myCreateContentsTable) {
+		if (!myInsideContentsParagraph && (myLineFeedCounter == myEmptyLinesBeforeNewSection + 1)) {
+			myInsideContentsParagraph = true;
+			internalEndParagraph();
+			if (mySectionContainsRegularContents) {
+				beginParagraph(END_OF_SECTION_PARAGRAPH, next);
+				mySectionContainsRegularContents = false;
+			}
+			beginContentsEntry(next);
+			myInsideTitle = true;
+			beginParagraph(TITLE_PARAGRAPH, next);
+			paragraphBreak = false;
+		}
+		if (myInsideContentsParagraph && (myLineFeedCounter == 1)) {
+			myInsideTitle = false;
+			endContentsEntry(next);
+			myInsideContentsParagraph = false;
+			paragraphBreak = true;
+		}
+	}
+
+	if (paragraphBreak) {
+		internalEndParagraph();
+		beginParagraph(myInsideContentsParagraph ? TITLE_PARAGRAPH : REGULAR_PARAGRAPH, next);
+	}
+}
+
+void TxtParagraphSource::internalEndParagraph() {
+	if (!myLastLineIsEmpty) {
+		myLineFeedCounter = 0;
+	}
+	myLastLineIsEmpty = true;
+}
+
+void TxtParagraphSource::beginParagraph(ParagraphKind kind, size_t offset) {
+	myOffsets.push_back(offset);
+	myKinds.push_back(kind);
+}
+
+// The entry refers to the title paragraph begun next; its text is added
+// when the title ends, a title the file ends with has no text.
+void TxtParagraphSource::beginContentsEntry(size_t offset) {
+	myContentsStart = offset;
+	if (myContentsModel.isNull()) {
+		return;
+	}
+	ContentsModel &contentsModel = (ContentsModel&)*myContentsModel;
+	ZLTextTreeParagraph *paragraph = contentsModel.createParagraph();
+	contentsModel.addControl(CONTENTS_TABLE_ENTRY, true);
+	contentsModel.setReference(paragraph, myOffsets.size());
+}
+
+void TxtParagraphSource::endContentsEntry(size_t end) {
+	if (myContentsModel.isNull()) {
+		return;
+	}
+	std::string text;
+	readText(myContentsStart, end, text);
+	myContentsModel->addText(text.empty() ? std::string("...") : text);
+}
+
+// The text TxtReader gives to TxtBookReader: the line is cut at the ends
+// of its blocks, the pieces with some letters are kept with the end of
+// the line and the spaces other than tabs made blanks.
+void TxtParagraphSource::readText(size_t start, size_t end, std::string &text) const {
+	text.erase();
+	myConverter->reset();
+	std::string data;
+	std::string str;
+	for (size_t offset = start; offset < end;) {
+		size_t next;
+		const size_t textEnd = lineEnd(offset, next);
+		const size_t dataEnd = std::min(textEnd + 1, mySize);
+		while (offset < dataEnd) {
+			const size_t pieceEnd = std::min(dataEnd, (offset / READER_BLOCK_SIZE + 1) * READER_BLOCK_SIZE);
+			data.assign(bytes(offset, pieceEnd - offset), pieceEnd - offset);
+			for (std::string::iterator it = data.begin(); it != data.end(); ++it) {
+				if (*it == '\r') {
+					if (next == textEnd + 2) {
+						*it = '\n';
+					}
+				} else if ((*it != '\n') && (*it != '\t') && isspace((unsigned char)*it)) {
+					*it = ' ';
+				}
+			}
+			str.erase();
+			myConverter->convert(str, data.data(), data.data() + data.length());
+			for (std::string::const_iterator it = str.begin(); it != str.end(); ++it) {
+				if (!isspace((unsigned char)*it)) {
+					text += str;
+					break;
+				}
+			}
+			offset = pieceEnd;
+		}
+		offset = next;
+	}
+}
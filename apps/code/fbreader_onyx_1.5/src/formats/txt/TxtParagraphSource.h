@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2004-2009 Geometer Plus <contact@geometerplus.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef __TXTPARAGRAPHSOURCE_H__
+#define __TXTPARAGRAPHSOURCE_H__
+
+#include <string>
+#include <vector>
+
+#include <ZLTextModel.h>
+
+#include "../EncodedTextReader.h"
+
+class ZLRunnable;
+class PlainTextFormat;
+
+// Paragraphs of a large plain text file. The file is mapped, or read in
+// windows when it is on removable media, the offsets of the paragraphs
+// are found on the gui thread in short slices and the text of a paragraph
+// is converted only when the model reads it. The paragraphs are the ones
+// TxtBookReader makes of the same file.
+class TxtParagraphSource : public ZLTextParagraphSource, public EncodedTextReader {
+
+public:
+	// Returns 0 if the file is better read by TxtBookReader: a small
+	// file, a file in an archive or in an encoding with wide characters.
+	static fb::shared_ptr<ZLTextParagraphSource> create(const std::string &fileName, const PlainTextFormat &format, const std::string &encoding, fb::shared_ptr<ZLTextModel> contentsModel);
+
+	~TxtParagraphSource();
+
+	size_t paragraphsNumber() const;
+	bool isComplete() const;
+	void findParagraphs(size_t number);
+
+	ZLTextParagraph::Kind paragraphKind(size_t index) const;
+	size_t characterNumber(size_t index) const;
+	void readParagraphs(size_t start, size_t end, ZLTextPlainModel &model) const;
+
+private:
+	enum ParagraphKind {
+		REGULAR_PARAGRAPH,
+		TITLE_PARAGRAPH,
+		END_OF_SECTION_PARAGRAPH,
+	};
+
+	TxtParagraphSource(int file, const char *data, size_t size, const PlainTextFormat &format, const std::string &encoding, fb::shared_ptr<ZLTextModel> contentsModel);
+
+	const char *bytes(size_t offset, size_t length) const;
+	char byteAt(size_t offset) const;
+	void readWindow(size_t offset, size_t length) const;
+
+	void indexSlice();
+	bool index(size_t length);
+	size_t lineEnd(size_t offset, size_t &next) const;
+	void processLine(size_t start, size_t end, size_t next);
+	void internalEndParagraph();
+	void beginParagraph(ParagraphKind kind, size_t offset);
+	void beginContentsEntry(size_t offset);
+	void endContentsEntry(size_t end);
+	void readText(size_t start, size_t end, std::string &text) const;
+
+private:
+	// the file read in windows, -1 when it is mapped
+	const int myFile;
+	const char *myData;
+	const size_t mySize;
+	// the bytes from myWindowStart on, the whole file when it is mapped
+	mutable const char *myWindow;
+	mutable size_t myWindowStart;
+	mutable size_t myWindowSize;
+	mutable std::vector<char> myBuffer;
+
+	const int myBreakType;
+	const int myIgnoredIndent;
+	const int myEmptyLinesBeforeNewSection;
+	const bool myCreateContentsTable;
+	double myCharactersPerByte;
+
+	// the start of every paragraph and of the one being indexed; the end
+	// of the file is added when the whole file is indexed
+	std::vector<size_t> myOffsets;
+	std::vector<unsigned char> myKinds;
+	size_t myIndexedSize;
+
+	int myLineFeedCounter;
+	bool myInsideContentsParagraph;
+	bool myInsideTitle;
+	bool myLastLineIsEmpty;
+	bool mySectionContainsRegularContents;
+	size_t myContentsStart;
+	fb::shared_ptr<ZLTextModel> myContentsModel;
+
+	fb::shared_ptr<ZLRunnable> myIndexer;
+
+friend class TxtParagraphIndexer;
+};
+
+inline const char *TxtParagraphSource::bytes(size_t offset, size_t length) const {
+	if ((offset < myWindowStart) || (offset + length > myWindowStart + myWindowSize)) {
+		readWindow(offset, length);
+	}
+	return myWindow + (offset - myWindowStart);
+}
+
+inline char TxtParagraphSource::byteAt(size_t offset) const {
+	return *bytes(offset, 1);
+}
+
+#endif /* __TXTPARAGRAPHSOURCE_H__ */
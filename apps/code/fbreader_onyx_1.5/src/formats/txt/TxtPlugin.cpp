@@ -22,8 +22,10 @@
 
 #include "TxtPlugin.h"
 #include "TxtBookReader.h"
+#include "TxtParagraphSource.h"
 #include "PlainTextFormat.h"
 
+#include "../../bookmodel/BookModel.h"
 #include "../../database/booksdb/DBBook.h"
 
 TxtPlugin::~TxtPlugin() {
@@ -64,6 +66,13 @@ bool TxtPlugin::readModel(const DBBook &book, BookModel &model) const {
 		detector.detect(*stream, format);
 	}
 
+	fb::shared_ptr<ZLTextParagraphSource> source =
+		TxtParagraphSource::create(book.fileName(), format, book.encoding(), model.contentsModel());
+	if (!source.isNull()) {
+		model.bookTextModel()->setParagraphSource(source);
+		return true;
+	}
+
 	TxtBookReader(model, format, book.encoding()).readDocument(*stream);
 	return true;
 }
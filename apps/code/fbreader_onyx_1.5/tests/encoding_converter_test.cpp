@@ -0,0 +1,318 @@
+// Converts generated text with the encoding converters of
+// MyEncodingConverter.cpp and with the converters they replaced, checks
+// that both give the same text and prints the throughput of both.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QTime>
+
+#include "gtest/gtest.h"
+
+#include <ZLEncodingConverter.h>
+#include <ZLUnicodeUtil.h>
+
+#include "../zlibrary/core/src/encoding/MyEncodingConverter.h"
+#include "../zlibrary/ui/src/qt4/filesystem/ZLQtFSManager.h"
+
+namespace {
+
+// The converters read the descriptions themselves, the reference ones
+// read the same files here.
+const std::string ENCODINGS = ENCODINGS_DIR;
+
+const char *const ONE_BYTE_ENCODINGS[] = { "windows-1251", "windows-1252", "KOI8-R", "ISO-8859-1", "ISO-8859-5", "IBM866" };
+const char *const TWO_BYTES_ENCODINGS[] = { "GBK", "Big5" };
+
+// TxtReader converts the text in blocks of this size.
+const size_t BLOCK_SIZE = 2048;
+const size_t BENCHMARK_SIZE = 2000000;
+const int BENCHMARK_PASSES = 10;
+
+class ZLibraryEnvironment : public testing::Environment {
+
+public:
+	void SetUp() {
+		static int argc = 1;
+		static char name[] = "encoding_converter_test";
+		static char *argv[] = { name, 0 };
+		new QCoreApplication(argc, argv);
+		ZLQtFSManager::createInstance();
+	}
+};
+
+testing::Environment *const environment = testing::AddGlobalTestEnvironment(new ZLibraryEnvironment());
+
+// The utf-8 forms of the characters of a description, by the index the
+// converters use: the byte, or the pair of bytes less 0x8000.
+char **readMap(const std::string &encoding, int &bytesNumber) {
+	FILE *file = fopen((ENCODINGS + "/" + encoding).c_str(), "r");
+	if (file == 0) {
+		return 0;
+	}
+	char **map = 0;
+	bytesNumber = 1;
+	char line[512];
+	while (fgets(line, sizeof(line), file) != 0) {
+		if (strstr(line, "<encoding") != 0) {
+			bytesNumber = (strstr(line, "bytes=\"2\"") != 0) ? 2 : 1;
+			const int length = (bytesNumber == 1) ? 256 : 32768;
+			map = new char*[length];
+			memset(map, 0, length * sizeof(char*));
+		}
+		const char *code = strstr(line, "code=\"");
+		const char *ucs2 = strstr(line, "ucs2=\"");
+		if ((map == 0) || (code == 0) || (ucs2 == 0)) {
+			continue;
+		}
+		int index = strtol(code + 6, 0, 16);
+		if (bytesNumber == 2) {
+			index -= 32768;
+		}
+		if ((index < 0) || (index >= ((bytesNumber == 1) ? 256 : 32768))) {
+			continue;
+		}
+		char buffer[4];
+		const int length = ZLUnicodeUtil::ucs4ToUtf8(buffer, strtol(ucs2 + 6, 0, 16));
+		delete[] map[index];
+		map[index] = new char[length + 1];
+		memcpy(map[index], buffer, length);
+		map[index][length] = '\0';
+	}
+	fclose(file);
+	return map;
+}
+
+void deleteMap(char **map, int length) {
+	for (int i = 0; i < length; ++i) {
+		delete[] map[i];
+	}
+	delete[] map;
+}
+
+// The one-byte converter before the flat maps: a byte gives the
+// characters of its entry up to the first '\0'.
+class ReferenceOneByteConverter {
+
+public:
+	ReferenceOneByteConverter(char **encodingMap) {
+		memset(myEncodingMap, '\0', sizeof(myEncodingMap));
+		for (int i = 0; i < 256; ++i) {
+			ZLUnicodeUtil::ucs4ToUtf8(myEncodingMap + 4 * i, i);
+			if (encodingMap[i] != 0) {
+				strcpy(myEncodingMap + 4 * i, encodingMap[i]);
+			}
+		}
+	}
+
+	void convert(std::string &dst, const char *srcStart, const char *srcEnd) {
+		for (const char *ptr = srcStart; ptr != srcEnd; ++ptr) {
+			for (const char *p = myEncodingMap + 4 * (unsigned char)*ptr; *p != '\0'; ++p) {
+				dst += *p;
+			}
+		}
+	}
+
+	void reset() {
+	}
+
+private:
+	char myEncodingMap[1024];
+};
+
+// The two-byte converter before the flat maps.
+class ReferenceTwoBytesConverter {
+
+public:
+	ReferenceTwoBytesConverter(char **encodingMap) : myEncodingMap(encodingMap), myLastCharIsNotProcessed(false) {
+	}
+
+	void convert(std::string &dst, const char *srcStart, const char *srcEnd) {
+		if (srcStart == srcEnd) {
+			return;
+		}
+		if (myLastCharIsNotProcessed) {
+			const char *utf8 = myEncodingMap[0x100 * (myLastChar & 0x7F) + (unsigned char)*srcStart];
+			if (utf8 != 0) {
+				dst += utf8;
+			}
+			++srcStart;
+			myLastCharIsNotProcessed = false;
+		}
+		for (const char *ptr = srcStart; ptr != srcEnd; ++ptr) {
+			if (((*ptr) & 0x80) == 0) {
+				dst += *ptr;
+			} else if (ptr + 1 == srcEnd) {
+				myLastChar = *ptr;
+				myLastCharIsNotProcessed = true;
+			} else {
+				const char *utf8 = myEncodingMap[0x100 * ((*ptr) & 0x7F) + (unsigned char)*(ptr + 1)];
+				if (utf8 != 0) {
+					dst += utf8;
+				}
+				++ptr;
+			}
+		}
+	}
+
+	void reset() {
+		myLastCharIsNotProcessed = false;
+	}
+
+private:
+	char **myEncodingMap;
+	char myLastChar;
+	bool myLastCharIsNotProcessed;
+};
+
+// Runs of ascii and of other bytes; the share of the other bytes grows
+// with mix from 0 to 3. Some '\0' and line ends are mixed in.
+std::string makeText(size_t size, int mix, unsigned int seed) {
+	std::string text;
+	while (text.size() < size) {
+		seed = seed * 1103515245 + 12345;
+		const int run = (seed >> 16) % ((mix == 0) ? 200 : (mix == 1) ? 20 : 4) + 1;
+		seed = seed * 1103515245 + 12345;
+		const bool high = (int)((seed >> 16) % 4) < mix;
+		for (int i = 0; i < run; ++i) {
+			seed = seed * 1103515245 + 12345;
+			const unsigned int value = seed >> 16;
+			if (high) {
+				text += (char)(0x80 | value);
+			} else if (value % 500 == 0) {
+				text += '\0';
+			} else if (value % 300 == 1) {
+				text += '\n';
+			} else {
+				text += (char)(0x20 + value % 0x5F);
+			}
+		}
+	}
+	text.resize(size);
+	return text;
+}
+
+// Converts the text in pieces of random length, some of them empty, and
+// resets the converter at the start.
+template <class Converter>
+std::string convert(Converter &converter, const std::string &text, unsigned int seed) {
+	std::string result;
+	converter.reset();
+	for (size_t offset = 0; offset < text.size();) {
+		seed = seed * 1103515245 + 12345;
+		size_t length = (seed >> 16) % 100;
+		if ((seed >> 8) % 10 == 0) {
+			length = (seed >> 16) % 5000;
+		}
+		length = std::min(length, text.size() - offset);
+		converter.convert(result, text.data() + offset, text.data() + offset + length);
+		offset += length;
+	}
+	return result;
+}
+
+template <class Converter>
+double megabytesPerSecond(Converter &converter, const std::string &text) {
+	std::string result;
+	QTime timer;
+	timer.start();
+	for (int pass = 0; pass < BENCHMARK_PASSES; ++pass) {
+		converter.reset();
+		for (size_t offset = 0; offset < text.size(); offset += BLOCK_SIZE) {
+			if (result.size() > 1000000) {
+				result.erase();
+			}
+			const size_t length = std::min(BLOCK_SIZE, text.size() - offset);
+			converter.convert(result, text.data() + offset, text.data() + offset + length);
+		}
+	}
+	return BENCHMARK_PASSES * text.size() / 1000.0 / std::max(timer.elapsed(), 1);
+}
+
+template <class Reference>
+void compareConverters(const char *encoding) {
+	int bytesNumber = 0;
+	char **map = readMap(encoding, bytesNumber);
+	ASSERT_TRUE(map != 0) << encoding;
+	Reference reference(map);
+
+	MyEncodingConverterProvider provider(ENCODINGS);
+	ASSERT_TRUE(provider.providesConverter(encoding)) << encoding;
+	fb::shared_ptr<ZLEncodingConverter> converter = provider.createConverter(encoding);
+	ASSERT_FALSE(converter.isNull()) << encoding;
+
+	for (int mix = 0; mix < 4; ++mix) {
+		const std::string text = makeText(200000, mix, mix + 1);
+		EXPECT_EQ(convert(reference, text, mix), convert(*converter, text, mix)) << encoding << ", mix " << mix;
+	}
+	deleteMap(map, (bytesNumber == 1) ? 256 : 32768);
+}
+
+template <class Reference>
+void measureConverters(const char *encoding) {
+	int bytesNumber = 0;
+	char **map = readMap(encoding, bytesNumber);
+	ASSERT_TRUE(map != 0) << encoding;
+	Reference reference(map);
+	fb::shared_ptr<ZLEncodingConverter> converter = MyEncodingConverterProvider(ENCODINGS).createConverter(encoding);
+	ASSERT_FALSE(converter.isNull()) << encoding;
+
+	for (int mix = 0; mix < 4; ++mix) {
+		const std::string text = makeText(BENCHMARK_SIZE, mix, mix + 1);
+		const double before = megabytesPerSecond(reference, text);
+		const double after = megabytesPerSecond(*converter, text);
+		printf("%-12s mix %d: %7.1f MB/s before, %7.1f MB/s now\n", encoding, mix, before, after);
+	}
+	deleteMap(map, (bytesNumber == 1) ? 256 : 32768);
+}
+
+}
+
+TEST(EncodingConverterTest, OneByteMatchesReference) {
+	for (size_t i = 0; i < sizeof(ONE_BYTE_ENCODINGS) / sizeof(ONE_BYTE_ENCODINGS[0]); ++i) {
+		compareConverters<ReferenceOneByteConverter>(ONE_BYTE_ENCODINGS[i]);
+	}
+}
+
+TEST(EncodingConverterTest, TwoBytesMatchesReference) {
+	for (size_t i = 0; i < sizeof(TWO_BYTES_ENCODINGS) / sizeof(TWO_BYTES_ENCODINGS[0]); ++i) {
+		compareConverters<ReferenceTwoBytesConverter>(TWO_BYTES_ENCODINGS[i]);
+	}
+}
+
+// A pair split between two calls and a reset between them.
+TEST(EncodingConverterTest, TwoBytesSplitPair) {
+	fb::shared_ptr<ZLEncodingConverter> converter = MyEncodingConverterProvider(ENCODINGS).createConverter("GBK");
+	ASSERT_FALSE(converter.isNull());
+	const char text[] = "a\xc4\xe3" "b";
+
+	std::string whole;
+	converter->convert(whole, text, text + 4);
+
+	std::string split;
+	converter->convert(split, text, text + 2);
+	converter->convert(split, text + 2, text + 4);
+	EXPECT_EQ(whole, split);
+	EXPECT_EQ("a\xe4\xbd\xa0" "b", whole);
+
+	std::string reset;
+	converter->convert(reset, text, text + 2);
+	converter->reset();
+	converter->convert(reset, text + 3, text + 4);
+	EXPECT_EQ("ab", reset);
+}
+
+// Not a pass or fail check: prints the throughput in the blocks TxtReader
+// converts, from mostly ascii (mix 0) to mostly other characters (mix 3).
+TEST(EncodingConverterTest, Benchmark) {
+	for (size_t i = 0; i < sizeof(ONE_BYTE_ENCODINGS) / sizeof(ONE_BYTE_ENCODINGS[0]); ++i) {
+		measureConverters<ReferenceOneByteConverter>(ONE_BYTE_ENCODINGS[i]);
+	}
+	for (size_t i = 0; i < sizeof(TWO_BYTES_ENCODINGS) / sizeof(TWO_BYTES_ENCODINGS[0]); ++i) {
+		measureConverters<ReferenceTwoBytesConverter>(TWO_BYTES_ENCODINGS[i]);
+	}
+}
@@ -0,0 +1,184 @@
+// Checks the word widths cached by ZLQtPaintContext against QFontMetrics
+// and times breaking a text into lines with and without the cache.
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <QtCore/QTime>
+#include <QtGui/QApplication>
+#include <QtGui/QFont>
+#include <QtGui/QPainter>
+#include <QtGui/QPixmap>
+
+#include "gtest/gtest.h"
+
+#include "../zlibrary/ui/src/qt4/view/ZLQtPaintContext.h"
+
+namespace {
+
+const std::string FAMILY = "Helvetica";
+const int FONT_SIZE = 20;
+const int LINE_WIDTH = 560;
+// More words than the cache has slots, so words replace each other.
+const size_t WORD_COUNT = 20000;
+const int LAYOUT_PASSES = 20;
+
+class QtEnvironment : public testing::Environment {
+
+public:
+	void SetUp() {
+		static int argc = 1;
+		static char name[] = "paint_context_benchmark";
+		static char *argv[] = { name, 0 };
+		new QApplication(argc, argv);
+	}
+};
+
+testing::Environment *const environment = testing::AddGlobalTestEnvironment(new QtEnvironment());
+
+// Words of 1 to 12 letters, every fourth one in Cyrillic, and some
+// punctuation.
+std::vector<std::string> makeWords(size_t count) {
+	static const char *CYRILLIC[] = { "\xd0\xb0", "\xd0\xb1", "\xd0\xb2", "\xd0\xb3", "\xd0\xb4", "\xd0\xb5", "\xd0\xb6" };
+	static const char PUNCTUATION[] = ",.;:!?-";
+	std::vector<std::string> words;
+	unsigned int seed = 12345;
+	for (size_t i = 0; i < count; ++i) {
+		seed = seed * 1103515245 + 12345;
+		const size_t length = 1 + (seed >> 16) % 12;
+		std::string word;
+		for (size_t j = 0; j < length; ++j) {
+			seed = seed * 1103515245 + 12345;
+			const unsigned int letter = (seed >> 16) % 26;
+			if (i % 4 == 3) {
+				word += CYRILLIC[letter % 7];
+			} else {
+				word += (char)((j == 0 && i % 3 == 0) ? 'A' + letter : 'a' + letter);
+			}
+		}
+		words.push_back(word);
+		if (i % 9 == 0) {
+			words.push_back(std::string(1, PUNCTUATION[i % 7]));
+		}
+	}
+	return words;
+}
+
+// Measures with a painter set up the way ZLQtPaintContext::setFont does.
+class ReferencePainter {
+
+public:
+	ReferencePainter(bool bold) : myPixmap(LINE_WIDTH, 100) {
+		myPainter.begin(&myPixmap);
+		QFont font = myPainter.font();
+		font.setFamily(FAMILY.c_str());
+		font.setPointSize(FONT_SIZE);
+		font.setWeight(bold ? QFont::Bold : QFont::Normal);
+		font.setItalic(false);
+		myPainter.setFont(font);
+	}
+
+	int width(const std::string &word) const {
+		return myPainter.fontMetrics().width(QString::fromUtf8(word.data(), word.size()));
+	}
+
+private:
+	QPixmap myPixmap;
+	QPainter myPainter;
+};
+
+// Breaks the words into lines as the text view does and returns the sum
+// of the measured widths.
+template <class Measure>
+long layout(const std::vector<std::string> &words, const Measure &measure, int spaceWidth) {
+	long total = 0;
+	int line = 0;
+	for (std::vector<std::string>::const_iterator it = words.begin(); it != words.end(); ++it) {
+		const int width = measure(*it);
+		total += width;
+		if (line + spaceWidth + width > LINE_WIDTH) {
+			line = width;
+		} else {
+			line += spaceWidth + width;
+		}
+	}
+	return total;
+}
+
+struct ContextMeasure {
+	ZLQtPaintContext &Context;
+	ContextMeasure(ZLQtPaintContext &context) : Context(context) {}
+	int operator()(const std::string &word) const {
+		return Context.stringWidth(word.data(), word.size(), false);
+	}
+};
+
+struct ReferenceMeasure {
+	const ReferencePainter &Painter;
+	ReferenceMeasure(const ReferencePainter &painter) : Painter(painter) {}
+	int operator()(const std::string &word) const {
+		return Painter.width(word);
+	}
+};
+
+}
+
+// Every width equals the measured one, also when words replace each
+// other in the cache, after a font switch and after the painter has been
+// begun again on a new pixmap.
+TEST(PaintContextTest, CachedWidthsMatchFontMetrics) {
+	const std::vector<std::string> words = makeWords(WORD_COUNT);
+	const ReferencePainter regular(false);
+	const ReferencePainter bold(true);
+
+	ZLQtPaintContext context;
+	context.setSize(LINE_WIDTH, 800);
+	context.setFont(FAMILY, FONT_SIZE, false, false);
+	for (int pass = 0; pass < 2; ++pass) {
+		for (size_t i = 0; i < words.size(); ++i) {
+			ASSERT_EQ(regular.width(words[i]), context.stringWidth(words[i].data(), words[i].size(), false)) << words[i];
+		}
+	}
+
+	context.setFont(FAMILY, FONT_SIZE, true, false);
+	for (size_t i = 0; i < words.size(); i += 7) {
+		ASSERT_EQ(bold.width(words[i]), context.stringWidth(words[i].data(), words[i].size(), false)) << words[i];
+	}
+
+	context.setSize(LINE_WIDTH / 2, 400);
+	context.setFont(FAMILY, FONT_SIZE, false, false);
+	for (size_t i = 0; i < words.size(); i += 7) {
+		ASSERT_EQ(regular.width(words[i]), context.stringWidth(words[i].data(), words[i].size(), false)) << words[i];
+	}
+}
+
+// Not a pass or fail check: prints the time of laying out the text with
+// the cached widths and with a QFontMetrics call per word.
+TEST(PaintContextTest, LayoutBenchmark) {
+	const std::vector<std::string> words = makeWords(WORD_COUNT);
+	const ReferencePainter reference(false);
+	ZLQtPaintContext context;
+	context.setSize(LINE_WIDTH, 800);
+	context.setFont(FAMILY, FONT_SIZE, false, false);
+	const int spaceWidth = context.spaceWidth();
+
+	QTime timer;
+	timer.start();
+	long expected = 0;
+	for (int pass = 0; pass < LAYOUT_PASSES; ++pass) {
+		expected = layout(words, ReferenceMeasure(reference), spaceWidth);
+	}
+	const int uncached = timer.elapsed();
+
+	timer.start();
+	long actual = 0;
+	for (int pass = 0; pass < LAYOUT_PASSES; ++pass) {
+		actual = layout(words, ContextMeasure(context), spaceWidth);
+	}
+	const int cached = timer.elapsed();
+
+	EXPECT_EQ(expected, actual);
+	printf("%d layouts of %u words: QFontMetrics %d ms, ZLQtPaintContext %d ms\n",
+		LAYOUT_PASSES, (unsigned int)words.size(), uncached, cached);
+}
@@ -0,0 +1,231 @@
+// Reads generated plain text files with TxtBookReader and through
+// TxtParagraphSource and compares the paragraphs and the contents tables.
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDir>
+
+#include "gtest/gtest.h"
+
+#include <ZLFile.h>
+#include <ZLInputStream.h>
+#include <ZLOptions.h>
+#include <ZLStringUtil.h>
+#include <ZLTextModel.h>
+#include <ZLTextParagraph.h>
+
+#include "../zlibrary/core/src/unix/xmlconfig/XMLConfig.h"
+#include "../zlibrary/ui/src/qt4/filesystem/ZLQtFSManager.h"
+#include "../zlibrary/ui/src/qt4/time/ZLQtTime.h"
+
+#include "../src/bookmodel/BookModel.h"
+#include "../src/database/booksdb/DBBook.h"
+#include "../src/formats/txt/PlainTextFormat.h"
+#include "../src/formats/txt/TxtBookReader.h"
+#include "../src/formats/txt/TxtParagraphSource.h"
+#include "../src/options/FBOptions.h"
+
+namespace {
+
+// TxtParagraphSource takes files from 2MB on, TxtReader reads blocks of
+// 2048 bytes.
+const size_t FIXTURE_SIZE = 2200000;
+const size_t BLOCK_SIZE = 2048;
+const std::string ENCODING = "UTF-8";
+
+// The managers the readers use; the configuration is kept in a home
+// directory of the test.
+class ZLibraryEnvironment : public testing::Environment {
+
+public:
+	void SetUp() {
+		static int argc = 1;
+		static char name[] = "txt_paragraph_source_test";
+		static char *argv[] = { name, 0 };
+		new QCoreApplication(argc, argv);
+
+		const QString home = QDir::temp().absoluteFilePath("txt_paragraph_source_test");
+		QDir().mkpath(home);
+		setenv("HOME", home.toLocal8Bit().constData(), 1);
+
+		XMLConfigManager::createInstance();
+		ZLQtTimeManager::createInstance();
+		ZLQtFSManager::createInstance();
+	}
+};
+
+testing::Environment *const environment = testing::AddGlobalTestEnvironment(new ZLibraryEnvironment());
+
+// A book of a file no plugin reads, DBBook::loadFromFile takes none.
+class FixtureBook : public DBBook {
+
+public:
+	FixtureBook(const std::string &fileName) : DBBook(fileName) {}
+};
+
+// Text without line ends, cut at offset.
+void fill(std::string &text, size_t offset) {
+	static const std::string WORDS = "Lorem ipsum dolor sit amet, consectetur adipiscing elit. ";
+	while (text.size() < offset) {
+		text += WORDS[text.size() % WORDS.size()];
+	}
+}
+
+void setFormat(const std::string &fileName, int breakType, int ignoredIndent, int emptyLinesBeforeNewSection, bool createContentsTable) {
+	ZLBooleanOption(FBCategoryKey::BOOKS, fileName, "Initialized", false).setValue(true);
+	ZLIntegerOption(FBCategoryKey::BOOKS, fileName, "BreakType", 1).setValue(breakType);
+	ZLIntegerRangeOption(FBCategoryKey::BOOKS, fileName, "IgnoredIndent", 1, 100, 1).setValue(ignoredIndent);
+	ZLIntegerRangeOption(FBCategoryKey::BOOKS, fileName, "EmptyLinesBeforeNewSection", 1, 100, 1).setValue(emptyLinesBeforeNewSection);
+	ZLBooleanOption(FBCategoryKey::BOOKS, fileName, "CreateContentsTable", false).setValue(createContentsTable);
+}
+
+// The kind and the entries of a paragraph, adjacent texts joined.
+std::string dump(const ZLTextParagraph &paragraph) {
+	std::string result;
+	ZLStringUtil::appendNumber(result, paragraph.kind());
+	result += ':';
+	for (ZLTextParagraph::Iterator it(paragraph); !it.isEnd(); it.next()) {
+		switch (it.entryKind()) {
+			case ZLTextParagraphEntry::TEXT_ENTRY:
+				result.append(it.textData(), it.textDataLength());
+				break;
+			case ZLTextParagraphEntry::CONTROL_ENTRY:
+			{
+				const ZLTextControlEntry &control = (const ZLTextControlEntry&)*it.entry();
+				result += control.isStart() ? "<" : "</";
+				ZLStringUtil::appendNumber(result, control.kind());
+				result += '>';
+				break;
+			}
+			default:
+				result += "<?>";
+				break;
+		}
+	}
+	return result;
+}
+
+// Writes text to a file which no format plugin takes, so BookModel does
+// not read it, and checks that both readers make the same book of it.
+void compareReaders(const std::string &text, int breakType, int ignoredIndent, int emptyLinesBeforeNewSection, bool createContentsTable) {
+	const std::string fileName = QDir::temp().absoluteFilePath("txt_paragraph_source_test.fixture").toLocal8Bit().constData();
+	FILE *file = fopen(fileName.c_str(), "wb");
+	ASSERT_TRUE(file != 0);
+	ASSERT_EQ(text.size(), fwrite(text.data(), 1, text.size(), file));
+	fclose(file);
+
+	setFormat(fileName, breakType, ignoredIndent, emptyLinesBeforeNewSection, createContentsTable);
+	PlainTextFormat format(fileName);
+	fb::shared_ptr<DBBook> book = new FixtureBook(fileName);
+
+	BookModel expected(book);
+	fb::shared_ptr<ZLInputStream> stream = ZLFile(fileName).inputStream();
+	ASSERT_FALSE(stream.isNull());
+	TxtBookReader(expected, format, ENCODING).readDocument(*stream);
+
+	BookModel actual(book);
+	fb::shared_ptr<ZLTextParagraphSource> source = TxtParagraphSource::create(fileName, format, ENCODING, actual.contentsModel());
+	ASSERT_FALSE(source.isNull());
+	fb::shared_ptr<ZLTextModel> actualText = actual.bookTextModel();
+	actualText->setParagraphSource(source);
+	while (!actualText->isComplete()) {
+		actualText->updateParagraphs(actualText->paragraphsNumber() + 1000);
+	}
+
+	const ZLTextModel &expectedText = *expected.bookTextModel();
+	ASSERT_EQ(expectedText.paragraphsNumber(), actualText->paragraphsNumber());
+	for (size_t i = 0; i < expectedText.paragraphsNumber(); ++i) {
+		ASSERT_EQ(dump(*expectedText[i]), dump(*(*actualText)[i])) << "paragraph " << i;
+		ASSERT_EQ(expectedText.paragraphKind(i), actualText->paragraphKind(i)) << "paragraph " << i;
+	}
+
+	const ContentsModel &expectedContents = (const ContentsModel&)*expected.contentsModel();
+	const ContentsModel &actualContents = (const ContentsModel&)*actual.contentsModel();
+	ASSERT_EQ(expectedContents.paragraphsNumber(), actualContents.paragraphsNumber());
+	for (size_t i = 0; i < expectedContents.paragraphsNumber(); ++i) {
+		const ZLTextTreeParagraph *expectedEntry = (const ZLTextTreeParagraph*)expectedContents[i];
+		const ZLTextTreeParagraph *actualEntry = (const ZLTextTreeParagraph*)actualContents[i];
+		EXPECT_EQ(dump(*expectedEntry), dump(*actualEntry)) << "contents entry " << i;
+		EXPECT_EQ(expectedContents.reference(expectedEntry), actualContents.reference(actualEntry)) << "contents entry " << i;
+	}
+
+	remove(fileName.c_str());
+}
+
+}
+
+// "\r\n" ending a line right before, across and right after the edge of a
+// read block, with lines ending in a lone '\r' or '\n' in between.
+TEST(TxtParagraphSourceTest, CrLfAtBlockEdges) {
+	static const char *LINE_ENDS[] = { "\r\n", "\n", "\r", "\r\n\r\n" };
+	std::string text;
+	for (size_t shift = 0; text.size() < FIXTURE_SIZE; ++shift) {
+		const size_t edge = (text.size() / BLOCK_SIZE + 1) * BLOCK_SIZE;
+		const size_t middle = edge - BLOCK_SIZE / 2;
+		if (text.size() < middle) {
+			fill(text, middle);
+			text += LINE_ENDS[shift % 4];
+		}
+		fill(text, edge - 2 + shift % 3);
+		text += "\r\n";
+	}
+	compareReaders(text, PlainTextFormat::BREAK_PARAGRAPH_AT_NEW_LINE, 1, 1, false);
+	compareReaders(text, PlainTextFormat::BREAK_PARAGRAPH_AT_EMPTY_LINE, 1, 1, false);
+}
+
+// Indents of spaces and tabs, deeper and not deeper than the ignored one,
+// and lines whose indent or text runs across the edge of a read block.
+TEST(TxtParagraphSourceTest, IndentedBreaks) {
+	static const char *INDENTS[] = { "", " ", "  ", "\t", " \t", "    ", "\t\t" };
+	std::string text;
+	for (size_t line = 0; text.size() < FIXTURE_SIZE; ++line) {
+		const size_t edge = (text.size() / BLOCK_SIZE + 1) * BLOCK_SIZE;
+		if (line % 5 == 0) {
+			// spaces up to the edge, text or nothing after it
+			fill(text, edge - 8);
+			text += '\n';
+			text.append(7 + line % 3, ' ');
+			if (line % 2 == 0) {
+				text += "after the edge";
+			}
+			text += '\n';
+			continue;
+		}
+		text += INDENTS[line % 7];
+		fill(text, text.size() + 20 + (line * 37) % 300);
+		text += (line % 4 == 0) ? "\r\n" : "\n";
+	}
+	compareReaders(text, PlainTextFormat::BREAK_PARAGRAPH_AT_LINE_WITH_INDENT, 1, 1, false);
+	compareReaders(text, PlainTextFormat::BREAK_PARAGRAPH_AT_LINE_WITH_INDENT | PlainTextFormat::BREAK_PARAGRAPH_AT_EMPTY_LINE, 2, 1, false);
+}
+
+// Sections begun by runs of empty lines: titles, titles of a section with
+// no text, lines of spaces only, and a title the file ends with.
+TEST(TxtParagraphSourceTest, EmptyLineSections) {
+	std::string text;
+	for (size_t section = 0; text.size() < FIXTURE_SIZE; ++section) {
+		text += "\n\n\n";
+		text += "Chapter ";
+		ZLStringUtil::appendNumber(text, section);
+		text += (section % 3 == 0) ? "\r\n" : "\n";
+		if (section % 7 == 3) {
+			continue;
+		}
+		text += "\n";
+		for (size_t paragraph = 0; paragraph < 1 + section % 6; ++paragraph) {
+			fill(text, text.size() + 100 + (section * 53 + paragraph * 131) % 900);
+			text += "\n";
+			if (paragraph % 2 == 1) {
+				text += "  \t \n";
+			} else {
+				text += "\n";
+			}
+		}
+	}
+	text += "\n\n\nThe end";
+	compareReaders(text, PlainTextFormat::BREAK_PARAGRAPH_AT_EMPTY_LINE, 1, 2, true);
+	compareReaders(text, PlainTextFormat::BREAK_PARAGRAPH_AT_NEW_LINE, 1, 1, true);
+}
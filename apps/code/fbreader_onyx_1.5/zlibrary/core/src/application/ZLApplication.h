@@ -185,6 +185,7 @@ public:
 
     void refreshWindow(bool process = true);
     void presentWindow();
+    void onSearchFinished();
 
     const std::string &lastCaller() const;
     void resetLastCaller();
@@ -20,6 +20,12 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 #include <ZLUnicodeUtil.h>
 #include <ZLibrary.h>
 #include <ZLFile.h>
@@ -31,7 +37,7 @@
 class MyOneByteEncodingConverter : public ZLEncodingConverter {
 
 private:
-	MyOneByteEncodingConverter(const std::string &encoding, char **encodingMap);
+	MyOneByteEncodingConverter(const std::string &filePath, char **encodingMap);
 
 public:
 	~MyOneByteEncodingConverter();
@@ -40,8 +46,9 @@ public:
 	bool fillTable(int *map);
 
 private:
-	const std::string myEncoding;
+	const std::string myFilePath;
 	char *myEncodingMap;
+	bool myAsciiIsPlain;
 
 friend class MyEncodingConverterProvider;
 };
@@ -58,7 +65,7 @@ public:
 	bool fillTable(int *map);
 
 private:
-	char **myEncodingMap;
+	char *myEncodingMap;
 	
 	char myLastChar;
 	bool myLastCharIsNotProcessed;
@@ -69,7 +76,7 @@ friend class MyEncodingConverterProvider;
 class EncodingReader : public ZLXMLReader {
 
 protected:
-	EncodingReader(const std::string &encoding);
+	EncodingReader(const std::string &filePath);
 
 public:
 	virtual ~EncodingReader();
@@ -86,7 +93,7 @@ protected:
 class EncodingIntReader : public EncodingReader {
 
 public:
-	EncodingIntReader(const std::string &encoding);
+	EncodingIntReader(const std::string &filePath);
 	~EncodingIntReader();
 	bool fillTable(int *map);
 
@@ -100,7 +107,7 @@ private:
 class EncodingCharReader : public EncodingReader {
 
 public:
-	EncodingCharReader(const std::string &encoding);
+	EncodingCharReader(const std::string &filePath);
 	~EncodingCharReader();
 	char **createTable();
 
@@ -112,9 +119,16 @@ private:
 	char myBuffer[3];
 };
 
-MyEncodingConverterProvider::MyEncodingConverterProvider() {
-	fb::shared_ptr<ZLDir> dir =
-		ZLFile(ZLEncodingCollection::encodingDescriptionPath()).directory();
+MyEncodingConverterProvider::MyEncodingConverterProvider() : myDescriptionPath(ZLEncodingCollection::encodingDescriptionPath()) {
+	collectEncodings();
+}
+
+MyEncodingConverterProvider::MyEncodingConverterProvider(const std::string &descriptionPath) : myDescriptionPath(descriptionPath) {
+	collectEncodings();
+}
+
+void MyEncodingConverterProvider::collectEncodings() {
+	fb::shared_ptr<ZLDir> dir = ZLFile(myDescriptionPath).directory();
 	if (!dir.isNull()) {
 		std::vector<std::string> files;
 		dir->collectFiles(files, false);
@@ -127,11 +141,12 @@ bool MyEncodingConverterProvider::providesConverter(const std::string &encoding)
 }
 
 fb::shared_ptr<ZLEncodingConverter> MyEncodingConverterProvider::createConverter(const std::string &encoding) {
-	EncodingCharReader er(encoding);
+	const std::string filePath = myDescriptionPath + ZLibrary::FileNameDelimiter + encoding;
+	EncodingCharReader er(filePath);
 	char **encodingMap = er.createTable();
 	if (encodingMap != 0) {
 		if (er.bytesNumber() == 1) {
-			return new MyOneByteEncodingConverter(encoding, encodingMap);
+			return new MyOneByteEncodingConverter(filePath, encodingMap);
 		} else if (er.bytesNumber() == 2) {
 			return new MyTwoBytesEncodingConverter(encodingMap);
 		}
@@ -139,18 +154,87 @@ fb::shared_ptr<ZLEncodingConverter> MyEncodingConverterProvider::createConverter
 	return 0;
 }
 
-MyOneByteEncodingConverter::MyOneByteEncodingConverter(const std::string &encoding, char **encodingMap) : myEncoding(encoding) {
+// The maps of the converters keep 4 bytes for every character: its utf-8
+// form and, in the last byte, the length of the form. A character is
+// copied with its 4 bytes at once, so the output needs 1 spare byte.
+// A form longer than 3 bytes does not fit and leaves the entry as it is;
+// the descriptions give ucs2 values only.
+static void setMapEntry(char *entry, const char *utf8) {
+	const size_t length = strlen(utf8);
+	if (length > 3) {
+		return;
+	}
+	memcpy(entry, utf8, length);
+	entry[3] = (char)length;
+}
+
+static inline bool isAsciiChar(char ch) {
+	return (ch != '\0') && ((ch & 0x80) == 0);
+}
+
+// Returns the length of the run of ascii characters other than '\0' the
+// text starts with. The run is checked 16 bytes or a word at a time.
+static size_t asciiLength(const char *start, const char *end) {
+	const char *ptr = start;
+#if defined(__SSE2__)
+	const __m128i zero = _mm_setzero_si128();
+	for (; end - ptr >= 16; ptr += 16) {
+		const __m128i bytes = _mm_loadu_si128((const __m128i*)ptr);
+		if (_mm_movemask_epi8(_mm_or_si128(bytes, _mm_cmpeq_epi8(bytes, zero))) != 0) {
+			break;
+		}
+	}
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+	for (; end - ptr >= 16; ptr += 16) {
+		const uint8x16_t bytes = vld1q_u8((const uint8_t*)ptr);
+		const uint8x16_t marks = vorrq_u8(bytes, vceqq_u8(bytes, vdupq_n_u8(0)));
+		const uint8x8_t halves = vorr_u8(vget_low_u8(marks), vget_high_u8(marks));
+		if ((vget_lane_u64(vreinterpret_u64_u8(halves), 0) & 0x8080808080808080ULL) != 0) {
+			break;
+		}
+	}
+#endif
+	// a byte is 0 or not ascii if its high bit is set in word or in the
+	// mask of the zero bytes
+	const unsigned long ones = ~0UL / 0xFF;
+	const unsigned long highBits = ones * 0x80;
+	unsigned long word;
+	for (; end - ptr >= (int)sizeof(word); ptr += sizeof(word)) {
+		memcpy(&word, ptr, sizeof(word));
+		if (((word | ((word - ones) & ~word)) & highBits) != 0) {
+			break;
+		}
+	}
+	while ((ptr != end) && isAsciiChar(*ptr)) {
+		++ptr;
+	}
+	return ptr - start;
+}
+
+MyOneByteEncodingConverter::MyOneByteEncodingConverter(const std::string &filePath, char **encodingMap) : myFilePath(filePath) {
 	myEncodingMap = new char[1024];
 	memset(myEncodingMap, '\0', 1024);
+	char buffer[4];
 	for (int i = 0; i < 256; ++i) {
-		ZLUnicodeUtil::ucs4ToUtf8(myEncodingMap + 4 * i, i);
+		const int length = ZLUnicodeUtil::ucs4ToUtf8(buffer, i);
+		buffer[length] = '\0';
+		setMapEntry(myEncodingMap + 4 * i, buffer);
 	}
 	if (encodingMap != 0) {
 		for (int i = 0; i < 256; ++i) {
 			if (encodingMap[i] != 0) {
-				strcpy(myEncodingMap + 4 * i, encodingMap[i]);
+				setMapEntry(myEncodingMap + 4 * i, encodingMap[i]);
+				delete[] encodingMap[i];
 			}
 		}
+		delete[] encodingMap;
+	}
+	myAsciiIsPlain = true;
+	for (int i = 1; i < 128; ++i) {
+		if ((myEncodingMap[4 * i + 3] != 1) || (myEncodingMap[4 * i] != i)) {
+			myAsciiIsPlain = false;
+			break;
+		}
 	}
 }
 
@@ -160,13 +244,20 @@ MyOneByteEncodingConverter::~MyOneByteEncodingConverter() {
 
 void MyOneByteEncodingConverter::convert(std::string &dst, const char *srcStart, const char *srcEnd) {
 	size_t oldLength = dst.length();
-	dst.append(3 * (srcEnd - srcStart), '\0');
+	dst.append(3 * (srcEnd - srcStart) + 1, '\0');
 	char *dstStartPtr = (char*)dst.data() + oldLength;
 	char *dstPtr = dstStartPtr;
-	const char *p;
-	for (const char *ptr = srcStart; ptr != srcEnd; ++ptr) {
-		for (p = myEncodingMap + 4 * (unsigned char)*ptr; *p != '\0'; ++p) {
-			*(dstPtr++) = *p;
+	for (const char *ptr = srcStart; ptr != srcEnd;) {
+		if (myAsciiIsPlain) {
+			const size_t length = asciiLength(ptr, srcEnd);
+			memcpy(dstPtr, ptr, length);
+			dstPtr += length;
+			ptr += length;
+		}
+		for (; (ptr != srcEnd) && (!myAsciiIsPlain || !isAsciiChar(*ptr)); ++ptr) {
+			const char *entry = myEncodingMap + 4 * (unsigned char)*ptr;
+			memcpy(dstPtr, entry, 4);
+			dstPtr += entry[3];
 		}
 	}
 	dst.erase(dstPtr - dstStartPtr + oldLength);
@@ -176,18 +267,22 @@ void MyOneByteEncodingConverter::reset() {
 }
 
 bool MyOneByteEncodingConverter::fillTable(int *map) {
-	return EncodingIntReader(myEncoding).fillTable(map);
-}
-
-MyTwoBytesEncodingConverter::MyTwoBytesEncodingConverter(char **encodingMap) : myEncodingMap(encodingMap), myLastCharIsNotProcessed(false) {
+	return EncodingIntReader(myFilePath).fillTable(map);
 }
 
-MyTwoBytesEncodingConverter::~MyTwoBytesEncodingConverter() {
+MyTwoBytesEncodingConverter::MyTwoBytesEncodingConverter(char **encodingMap) : myLastCharIsNotProcessed(false) {
+	myEncodingMap = new char[4 * 32768];
+	memset(myEncodingMap, '\0', 4 * 32768);
 	for (int i = 0; i < 32768; ++i) {
-		if (myEncodingMap[i] != 0) {
-			delete[] myEncodingMap[i];
+		if (encodingMap[i] != 0) {
+			setMapEntry(myEncodingMap + 4 * i, encodingMap[i]);
+			delete[] encodingMap[i];
 		}
 	}
+	delete[] encodingMap;
+}
+
+MyTwoBytesEncodingConverter::~MyTwoBytesEncodingConverter() {
 	delete[] myEncodingMap;
 }
 
@@ -196,29 +291,40 @@ void MyTwoBytesEncodingConverter::convert(std::string &dst, const char *srcStart
 		return;
 	}
 
-	dst.reserve(dst.length() + 3 * (srcEnd - srcStart) / 2);
+	// an ascii byte gives 1 byte, a pair of bytes 3 at most; the pair
+	// begun in the last call gives 3 bytes for 1
+	size_t oldLength = dst.length();
+	dst.append(3 * (srcEnd - srcStart) / 2 + 4, '\0');
+	char *dstStartPtr = (char*)dst.data() + oldLength;
+	char *dstPtr = dstStartPtr;
+	const char *entry;
 	if (myLastCharIsNotProcessed) {
-		const char *utf8 = myEncodingMap[0x100 * (myLastChar & 0x7F) + (unsigned char)*srcStart];
-		if (utf8 != 0) {
-			dst += utf8;
-		}
+		entry = myEncodingMap + 4 * (0x100 * (myLastChar & 0x7F) + (unsigned char)*srcStart);
+		memcpy(dstPtr, entry, 4);
+		dstPtr += entry[3];
 		++srcStart;
 		myLastCharIsNotProcessed = false;
 	}
-	for (const char *ptr = srcStart; ptr != srcEnd; ++ptr) {
-		if (((*ptr) & 0x80) == 0) {
-			dst += *ptr;
-		} else if (ptr + 1 == srcEnd) {
-			myLastChar = *ptr;
-			myLastCharIsNotProcessed = true;
-		} else {
-			const char *utf8 = myEncodingMap[0x100 * ((*ptr) & 0x7F) + (unsigned char)*(ptr + 1)];
-			if (utf8 != 0) {
-				dst += utf8;
+	for (const char *ptr = srcStart; ptr != srcEnd;) {
+		const size_t length = asciiLength(ptr, srcEnd);
+		memcpy(dstPtr, ptr, length);
+		dstPtr += length;
+		ptr += length;
+		while ((ptr != srcEnd) && !isAsciiChar(*ptr)) {
+			if (((*ptr) & 0x80) == 0) {
+				*(dstPtr++) = *(ptr++);
+			} else if (ptr + 1 == srcEnd) {
+				myLastChar = *(ptr++);
+				myLastCharIsNotProcessed = true;
+			} else {
+				entry = myEncodingMap + 4 * (0x100 * ((*ptr) & 0x7F) + (unsigned char)*(ptr + 1));
+				memcpy(dstPtr, entry, 4);
+				dstPtr += entry[3];
+				ptr += 2;
 			}
-			++ptr;
 		}
 	}
+	dst.erase(dstPtr - dstStartPtr + oldLength);
 }
 
 void MyTwoBytesEncodingConverter::reset() {
@@ -229,7 +335,7 @@ bool MyTwoBytesEncodingConverter::fillTable(int*) {
 	return false;
 }
 
-EncodingReader::EncodingReader(const std::string &encoding) : myFilePath(ZLEncodingCollection::encodingDescriptionPath() + ZLibrary::FileNameDelimiter + encoding) {
+EncodingReader::EncodingReader(const std::string &filePath) : myFilePath(filePath) {
 }
 
 EncodingReader::~EncodingReader() {
@@ -249,7 +355,7 @@ void EncodingReader::startElementHandler(const char *tag, const char **attribute
 	}
 }
 
-EncodingIntReader::EncodingIntReader(const std::string &encoding) : EncodingReader(encoding) {
+EncodingIntReader::EncodingIntReader(const std::string &filePath) : EncodingReader(filePath) {
 }
 
 EncodingIntReader::~EncodingIntReader() {
@@ -271,7 +377,7 @@ void EncodingIntReader::startElementHandler(const char *tag, const char **attrib
 	}
 }
 
-EncodingCharReader::EncodingCharReader(const std::string &encoding) : EncodingReader(encoding) {
+EncodingCharReader::EncodingCharReader(const std::string &filePath) : EncodingReader(filePath) {
 }
 
 EncodingCharReader::~EncodingCharReader() {
@@ -314,6 +420,10 @@ void EncodingCharReader::startElementHandler(const char *tag, const char **attri
 			}
 		}
 		int value = strtol(attributes[3], &ptr, 16);
+		// ucs2 values, the buffer holds 3 bytes of utf-8
+		if ((value < 0) || (value > 0xFFFF)) {
+			return;
+		}
 		int len = ZLUnicodeUtil::ucs4ToUtf8(myBuffer, value);
 		myMap[index] = new char[len + 1];
 		memcpy(myMap[index], myBuffer, len);
@@ -29,10 +29,16 @@ class MyEncodingConverterProvider : public ZLEncodingConverterProvider {
 
 public:
 	MyEncodingConverterProvider();
+	// Reads the encoding descriptions from another directory.
+	MyEncodingConverterProvider(const std::string &descriptionPath);
 	bool providesConverter(const std::string &encoding);
 	fb::shared_ptr<ZLEncodingConverter> createConverter(const std::string &encoding);
 
 private:
+	void collectEncodings();
+
+private:
+	const std::string myDescriptionPath;
 	std::set<std::string> myProvidedEncodings;
 };
 
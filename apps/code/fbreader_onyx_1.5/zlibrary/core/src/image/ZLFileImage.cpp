@@ -24,3 +24,10 @@
 fb::shared_ptr<ZLInputStream> ZLFileImage::inputStream() const {
 	return ZLFile(myPath).inputStream();
 }
+
+bool ZLFileImage::fileLocation(std::string &path, size_t &offset, size_t &size) const {
+	path = myPath;
+	offset = this->offset();
+	size = this->size();
+	return true;
+}
@@ -26,6 +26,7 @@ class ZLFileImage : public ZLStreamImage {
 
 public:
 	ZLFileImage(const std::string &mimeType, const std::string &path, size_t offset, size_t size = 0);
+	bool fileLocation(std::string &path, size_t &offset, size_t &size) const;
 
 protected:
 	fb::shared_ptr<ZLInputStream> inputStream() const;
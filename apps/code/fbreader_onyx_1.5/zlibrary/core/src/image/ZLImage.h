@@ -44,6 +44,7 @@ public:
 	bool isSingle() const { return true; }
 	const std::string &mimeType() const;
     virtual const fb::shared_ptr<std::string> stringData() const = 0;
+	virtual bool fileLocation(std::string &path, size_t &offset, size_t &size) const;
 	
 private:
 	std::string myMimeType;
@@ -68,6 +69,7 @@ inline ZLImage::~ZLImage() {}
 inline ZLSingleImage::ZLSingleImage(const std::string &mimeType) : myMimeType(mimeType) {}
 inline ZLSingleImage::~ZLSingleImage() {}
 inline const std::string &ZLSingleImage::mimeType() const { return myMimeType; }
+inline bool ZLSingleImage::fileLocation(std::string&, size_t&, size_t&) const { return false; }
 
 inline ZLMultiImage::ZLMultiImage() : ZLImage() {}
 inline ZLMultiImage::~ZLMultiImage() {}
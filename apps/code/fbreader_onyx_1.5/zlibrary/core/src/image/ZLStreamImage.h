@@ -31,6 +31,10 @@ public:
 	ZLStreamImage(const std::string &mimeType, size_t offset, size_t size = 0);
 	const fb::shared_ptr<std::string> stringData() const;
 
+protected:
+	size_t offset() const;
+	size_t size() const;
+
 private:
 	virtual fb::shared_ptr<ZLInputStream> inputStream() const = 0;
 
@@ -40,5 +44,7 @@ private:
 };
 
 inline ZLStreamImage::ZLStreamImage(const std::string &mimeType, size_t offset, size_t size) : ZLSingleImage(mimeType), myOffset(offset), mySize(size) {}
+inline size_t ZLStreamImage::offset() const { return myOffset; }
+inline size_t ZLStreamImage::size() const { return mySize; }
 
 #endif /* __ZLSTREAMIMAGE_H__ */
@@ -52,6 +52,9 @@ public:
 	void onScrollbarStep(ZLView::Direction direction, int steps);
 	void onScrollbarPageStep(ZLView::Direction direction, int steps);
 
+	// Called when a text search running in the background has finished.
+	virtual void onSearchFinished();
+
 private:
 	void correctDirection(ZLView::Direction &direction, bool &invert);
 
@@ -67,6 +70,7 @@ friend class ZLApplication;
 
 inline ZLViewWidget::ZLViewWidget(ZLView::Angle initialAngle) : myView(0), myRotation(initialAngle) {}
 inline ZLViewWidget::~ZLViewWidget() {}
+inline void ZLViewWidget::onSearchFinished() {}
 inline fb::shared_ptr<ZLView> ZLViewWidget::view() const { return myView; }
 
 #endif /* __ZLVIEWWIDGET_H__ */
@@ -17,11 +17,21 @@
  * 02110-1301, USA.
  */
 
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#ifndef _WINDOWS
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
 #include <algorithm>
 #include <vector>
 
 #include <ZLStringUtil.h>
 #include <ZLFile.h>
+#include <ZLOutputStream.h>
 #include <ZLDir.h>
 #include <ZLibrary.h>
 #include <ZLResource.h>
@@ -108,40 +118,88 @@ bool ZLTextTeXPatternComparator::operator() (const ZLTextTeXHyphenationPattern *
 	return firstIsShorter;
 }
 
-static std::vector<unsigned char> values;
-static ZLTextTeXPatternComparator comparator = ZLTextTeXPatternComparator();
+static const char TRIE_MAGIC[4] = { 'Z', 'L', 'H', 'Y' };
+static const unsigned int TRIE_VERSION = 1;
+static const size_t MAX_CACHED_MASKS = 2048;
+static const std::string HYPHENATION_DIR_NAME = "hyphenation";
+static const std::string TRIE_POSTFIX = ".trie";
+
+static void appendNumber(std::string &buffer, unsigned int number) {
+	buffer.append((const char*)&number, sizeof(number));
+}
+
+static bool readNumber(const char *&data, const char *end, unsigned int &number) {
+	if ((size_t)(end - data) < sizeof(number)) {
+		return false;
+	}
+	memcpy(&number, data, sizeof(number));
+	data += sizeof(number);
+	return true;
+}
+
+ZLTextTeXHyphenator::ZLTextTeXHyphenator() : myMappedTrie(0), myMappedTrieSize(0), myNodes(0), myEdges(0), myValues(0) {
+}
+
+const ZLTextTeXHyphenator::TrieNode *ZLTextTeXHyphenator::child(const TrieNode &node, ZLUnicodeUtil::Ucs4Char symbol) const {
+	const TrieEdge *left = myEdges + node.FirstEdge;
+	const TrieEdge *right = left + node.EdgeNumber;
+	while (left < right) {
+		const TrieEdge *middle = left + (right - left) / 2;
+		if (middle->Symbol < symbol) {
+			left = middle + 1;
+		} else {
+			right = middle;
+		}
+	}
+	return ((left != myEdges + node.FirstEdge + node.EdgeNumber) && (left->Symbol == symbol)) ? myNodes + left->Node : 0;
+}
 
+// Every pattern that matches a substring is found by one walk down the
+// trie from each start position. Results of frequent words are kept.
 void ZLTextTeXHyphenator::hyphenate(ZLUnicodeUtil::Ucs4String &ucs4String, std::vector<unsigned char> &mask, int length) const {
-	if (myPatternTable.empty()) {
+	if ((myNodes == 0) || (myNodes->EdgeNumber == 0)) {
 		for (int i = 0; i < length - 1; ++i) {
 			mask[i] = false;
 		}
 		return;
 	}
-	
-	values.assign(length + 1, 0);
-	
+
+	std::map<ZLUnicodeUtil::Ucs4String,MaskList::iterator>::iterator it = myMaskIndex.find(ucs4String);
+	if (it != myMaskIndex.end()) {
+		myMasks.splice(myMasks.begin(), myMasks, it->second);
+		const std::vector<unsigned char> &cached = it->second->second;
+		std::copy(cached.begin(), cached.end(), mask.begin());
+		return;
+	}
+
+	myPatternValues.assign(length + 1, 0);
 	for (int j = 0; j < length - 2; ++j) {
-		ZLTextTeXHyphenator::PatternIterator dictionaryPattern = myPatternTable.begin();
-		for (int k = 1; k <= length - j; ++k) {
-			ZLTextTeXHyphenationPattern pattern(&ucs4String[j], k);
-			if (comparator(&pattern, *dictionaryPattern)) {
-				continue;
-			}
-			dictionaryPattern =
-				std::lower_bound(myPatternTable.begin(), myPatternTable.end(), &pattern, comparator);
-			if (dictionaryPattern == myPatternTable.end()) {
+		const TrieNode *node = myNodes;
+		unsigned char *values = &myPatternValues[j];
+		for (int k = j; k < length; ++k) {
+			node = child(*node, ucs4String[k]);
+			if (node == 0) {
 				break;
 			}
-			if (!comparator(&pattern, *dictionaryPattern)) {
-				(*dictionaryPattern)->apply(&values[j]);
+			const unsigned char *patternValues = myValues + node->Values;
+			for (unsigned int i = 0; i < node->ValueNumber; ++i) {
+				if (values[i] < patternValues[i]) {
+					values[i] = patternValues[i];
+				}
 			}
 		}
 	}
 
 	for (int i = 0; i < length - 1; ++i) {
-		mask[i] = values[i + 1] % 2 == 1;
+		mask[i] = myPatternValues[i + 1] % 2 == 1;
 	}
+
+	if (myMasks.size() >= MAX_CACHED_MASKS) {
+		myMaskIndex.erase(myMasks.back().first);
+		myMasks.pop_back();
+	}
+	myMasks.push_front(std::make_pair(ucs4String, std::vector<unsigned char>(mask.begin(), mask.begin() + length - 1)));
+	myMaskIndex[ucs4String] = myMasks.begin();
 }
 
 ZLTextTeXHyphenator::~ZLTextTeXHyphenator() {
@@ -156,9 +214,20 @@ void ZLTextTeXHyphenator::load(const std::string &language) {
 	
 	unload();
 
+	const std::string key = trieKey(language);
+	const std::string fileName = trieFileName(language);
+	if (!key.empty() && mapTrie(fileName, key)) {
+		return;
+	}
+
 	ZLTextHyphenationReader(this).readDocument(PatternZip() + ":" + language + POSTFIX);
 	
 	std::sort(myPatternTable.begin(), myPatternTable.end(), ZLTextTeXPatternComparator());
+
+	compileTrie(key);
+	if (!key.empty()) {
+		saveTrie(fileName);
+	}
 }
 
 void ZLTextTeXHyphenator::unload() {
@@ -166,8 +235,197 @@ void ZLTextTeXHyphenator::unload() {
 		delete *it;
 	}
 	myPatternTable.clear();
+
+	myNodes = 0;
+	myEdges = 0;
+	myValues = 0;
+	myTrieBuffer.erase();
+#ifndef _WINDOWS
+	if (myMappedTrie != 0) {
+		munmap(myMappedTrie, myMappedTrieSize);
+	}
+#endif
+	myMappedTrie = 0;
+	myMappedTrieSize = 0;
+	myMasks.clear();
+	myMaskIndex.clear();
 }
 
 const std::string &ZLTextTeXHyphenator::language() const {
 	return myLanguage;
 }
+
+// A compiled trie is valid as long as the pattern archive is not replaced.
+std::string ZLTextTeXHyphenator::trieKey(const std::string &language) const {
+	struct stat fileStat;
+	if (stat(PatternZip().c_str(), &fileStat) != 0) {
+		return std::string();
+	}
+	std::string key = language;
+	key += ':';
+	ZLStringUtil::appendNumber(key, (unsigned int)fileStat.st_size);
+	key += ':';
+	ZLStringUtil::appendNumber(key, (unsigned int)fileStat.st_mtime);
+	return key;
+}
+
+std::string ZLTextTeXHyphenator::trieFileName(const std::string &language) const {
+	ZLFile dir("~" + ZLibrary::FileNameDelimiter + ZLibrary::ApplicationName() + ZLibrary::FileNameDelimiter + HYPHENATION_DIR_NAME);
+	dir.directory(true);
+	return dir.path() + ZLibrary::FileNameDelimiter + language + TRIE_POSTFIX;
+}
+
+bool ZLTextTeXHyphenator::mapTrie(const std::string &fileName, const std::string &key) {
+#ifndef _WINDOWS
+	const int fd = open(fileName.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat fileStat;
+	if ((fstat(fd, &fileStat) != 0) || (fileStat.st_size == 0)) {
+		close(fd);
+		return false;
+	}
+	void *address = mmap(0, fileStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (address == MAP_FAILED) {
+		return false;
+	}
+	if (!setTrie((const char*)address, fileStat.st_size, key)) {
+		munmap(address, fileStat.st_size);
+		return false;
+	}
+	myMappedTrie = address;
+	myMappedTrieSize = fileStat.st_size;
+	return true;
+#else
+	return false;
+#endif
+}
+
+// File layout: magic, version, key, then the numbers of nodes, edges and
+// values followed by the three arrays. The key is padded, so the arrays
+// are aligned in the mapped file.
+void ZLTextTeXHyphenator::compileTrie(const std::string &key) {
+	std::vector<std::map<ZLUnicodeUtil::Ucs4Char,unsigned int> > children(1);
+	std::vector<const ZLTextTeXHyphenationPattern*> patterns(1, (const ZLTextTeXHyphenationPattern*)0);
+	for (PatternIterator it = myPatternTable.begin(); it != myPatternTable.end(); ++it) {
+		const ZLTextTeXHyphenationPattern &pattern = **it;
+		unsigned int node = 0;
+		for (int i = 0; i < pattern.myLength; ++i) {
+			std::map<ZLUnicodeUtil::Ucs4Char,unsigned int>::const_iterator jt = children[node].find(pattern.mySymbols[i]);
+			if (jt != children[node].end()) {
+				node = jt->second;
+			} else {
+				const unsigned int next = children.size();
+				children[node][pattern.mySymbols[i]] = next;
+				children.push_back(std::map<ZLUnicodeUtil::Ucs4Char,unsigned int>());
+				patterns.push_back(0);
+				node = next;
+			}
+		}
+		if (patterns[node] == 0) {
+			patterns[node] = &pattern;
+		}
+	}
+
+	std::vector<TrieNode> nodes(children.size());
+	std::vector<TrieEdge> edges;
+	std::string values;
+	for (size_t i = 0; i < children.size(); ++i) {
+		TrieNode &node = nodes[i];
+		node.FirstEdge = edges.size();
+		node.EdgeNumber = children[i].size();
+		for (std::map<ZLUnicodeUtil::Ucs4Char,unsigned int>::const_iterator it = children[i].begin(); it != children[i].end(); ++it) {
+			TrieEdge edge;
+			edge.Symbol = it->first;
+			edge.Node = it->second;
+			edges.push_back(edge);
+		}
+		node.Values = values.length();
+		node.ValueNumber = 0;
+		if (patterns[i] != 0) {
+			node.ValueNumber = patterns[i]->myLength + 1;
+			values.append((const char*)patterns[i]->myValues, node.ValueNumber);
+		}
+	}
+
+	myTrieBuffer.erase();
+	myTrieBuffer.append(TRIE_MAGIC, sizeof(TRIE_MAGIC));
+	appendNumber(myTrieBuffer, TRIE_VERSION);
+	appendNumber(myTrieBuffer, key.length());
+	myTrieBuffer.append(key);
+	myTrieBuffer.append((4 - key.length() % 4) % 4, '\0');
+	appendNumber(myTrieBuffer, nodes.size());
+	appendNumber(myTrieBuffer, edges.size());
+	appendNumber(myTrieBuffer, values.length());
+	myTrieBuffer.append((const char*)&nodes.front(), nodes.size() * sizeof(TrieNode));
+	if (!edges.empty()) {
+		myTrieBuffer.append((const char*)&edges.front(), edges.size() * sizeof(TrieEdge));
+	}
+	myTrieBuffer.append(values);
+
+	for (PatternIterator it = myPatternTable.begin(); it != myPatternTable.end(); ++it) {
+		delete *it;
+	}
+	myPatternTable.clear();
+
+	setTrie(myTrieBuffer.data(), myTrieBuffer.length(), key);
+}
+
+void ZLTextTeXHyphenator::saveTrie(const std::string &fileName) const {
+	fb::shared_ptr<ZLOutputStream> stream = ZLFile(fileName).outputStream();
+	if (stream.isNull() || !stream->open()) {
+		return;
+	}
+	stream->write(myTrieBuffer);
+	stream->close();
+}
+
+// Checks the header and that every offset stays inside the data, a broken
+// file is dropped and compiled again.
+bool ZLTextTeXHyphenator::setTrie(const char *data, size_t size, const std::string &key) {
+	const char *end = data + size;
+	unsigned int version = 0;
+	unsigned int keyLength = 0;
+	if ((size < sizeof(TRIE_MAGIC)) || (memcmp(data, TRIE_MAGIC, sizeof(TRIE_MAGIC)) != 0)) {
+		return false;
+	}
+	data += sizeof(TRIE_MAGIC);
+	if (!readNumber(data, end, version) || (version != TRIE_VERSION) ||
+			!readNumber(data, end, keyLength) || (keyLength != key.length()) ||
+			((size_t)(end - data) < keyLength + (4 - keyLength % 4) % 4) ||
+			(key.compare(0, keyLength, data, keyLength) != 0)) {
+		return false;
+	}
+	data += keyLength + (4 - keyLength % 4) % 4;
+
+	unsigned int nodeNumber = 0;
+	unsigned int edgeNumber = 0;
+	unsigned int valueNumber = 0;
+	if (!readNumber(data, end, nodeNumber) || (nodeNumber == 0) ||
+			!readNumber(data, end, edgeNumber) ||
+			!readNumber(data, end, valueNumber) ||
+			((size_t)(end - data) != nodeNumber * sizeof(TrieNode) + edgeNumber * sizeof(TrieEdge) + valueNumber)) {
+		return false;
+	}
+
+	const TrieNode *nodes = (const TrieNode*)data;
+	const TrieEdge *edges = (const TrieEdge*)(data + nodeNumber * sizeof(TrieNode));
+	for (unsigned int i = 0; i < nodeNumber; ++i) {
+		if ((nodes[i].FirstEdge > edgeNumber) || (nodes[i].EdgeNumber > edgeNumber - nodes[i].FirstEdge) ||
+				(nodes[i].Values > valueNumber) || (nodes[i].ValueNumber > valueNumber - nodes[i].Values)) {
+			return false;
+		}
+	}
+	for (unsigned int i = 0; i < edgeNumber; ++i) {
+		if (edges[i].Node >= nodeNumber) {
+			return false;
+		}
+	}
+
+	myNodes = nodes;
+	myEdges = edges;
+	myValues = (const unsigned char*)(data + nodeNumber * sizeof(TrieNode) + edgeNumber * sizeof(TrieEdge));
+	return true;
+}
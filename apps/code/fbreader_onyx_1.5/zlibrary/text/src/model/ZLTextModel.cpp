@@ -20,43 +20,98 @@
 #include <string.h>
 
 #include <algorithm>
+#include <map>
 
 #include <ZLSearchUtil.h>
+#include <ZLOutputStream.h>
 
 #include "ZLTextModel.h"
 #include "ZLTextParagraph.h"
 
-ZLTextModel::ZLTextModel(const size_t rowSize) : myAllocator(rowSize), myLastEntryStart(0) {
+ZLTextModel::ZLTextModel(const size_t rowSize) : myAllocator(rowSize), myLastEntryStart(0), mySearchStart(0), mySearchEnd(0), mySearchOrigin(0), mySearchIndex(0), mySearchWrapped(false), myMarkInsertIndex(0) {
 }
 
 ZLTextModel::~ZLTextModel() {
+	if (!mySource.isNull()) {
+		return;
+	}
 	for (std::vector<ZLTextParagraph*>::const_iterator it = myParagraphs.begin(); it != myParagraphs.end(); ++it) {
 		delete *it;
 	}
 }
 
 void ZLTextModel::search(const std::string &text, size_t startIndex, size_t endIndex, bool ignoreCase) const {
-	ZLSearchPattern pattern(text, ignoreCase);
+	startSearch(text, startIndex, endIndex, startIndex, ignoreCase);
+	while (searchParagraphs(1024)) {
+	}
+}
+
+// The paragraphs from originIndex to endIndex are searched first, then the
+// ones from startIndex to originIndex. The marks are kept sorted all the
+// time, so the ones found so far can be used while the search goes on.
+void ZLTextModel::startSearch(const std::string &text, size_t startIndex, size_t endIndex, size_t originIndex, bool ignoreCase) const {
+	myMarks.clear();
+	mySearchPattern = new ZLSearchPattern(text, ignoreCase);
+	mySearchEnd = std::min(endIndex, myParagraphs.size());
+	mySearchStart = std::min(startIndex, mySearchEnd);
+	mySearchOrigin = std::max(mySearchStart, std::min(originIndex, mySearchEnd));
+	mySearchIndex = mySearchOrigin;
+	mySearchWrapped = false;
+	myMarkInsertIndex = 0;
+}
+
+// Searches at most number paragraphs. Returns false when the search is
+// finished or has been stopped.
+bool ZLTextModel::searchParagraphs(size_t number) const {
+	if (mySearchPattern.isNull()) {
+		return false;
+	}
+	for (; number > 0; --number) {
+		if (!mySearchWrapped && (mySearchIndex >= mySearchEnd)) {
+			mySearchWrapped = true;
+			mySearchIndex = mySearchStart;
+		}
+		if (mySearchWrapped && (mySearchIndex >= mySearchOrigin)) {
+			mySearchPattern = 0;
+			return false;
+		}
+		searchParagraph(mySearchIndex++);
+	}
+	return true;
+}
+
+void ZLTextModel::stopSearch() const {
+	mySearchPattern = 0;
+}
+
+void ZLTextModel::removeAllMarks() {
+	stopSearch();
 	myMarks.clear();
+}
 
-	std::vector<ZLTextParagraph*>::const_iterator start =
-		(startIndex < myParagraphs.size()) ? myParagraphs.begin() + startIndex : myParagraphs.end();
-	std::vector<ZLTextParagraph*>::const_iterator end =
-		(endIndex < myParagraphs.size()) ? myParagraphs.begin() + endIndex : myParagraphs.end();
-	for (std::vector<ZLTextParagraph*>::const_iterator it = start; it < end; ++it) {
-		int offset = 0;
-		for (ZLTextParagraph::Iterator jt = **it; !jt.isEnd(); jt.next()) {
-			if (jt.entryKind() == ZLTextParagraphEntry::TEXT_ENTRY) {
-				const ZLTextEntry& textEntry = (ZLTextEntry&)*jt.entry();
-				const char *str = textEntry.data();
-				const size_t len = textEntry.dataLength();
-				for (int pos = ZLSearchUtil::find(str, len, pattern); pos != -1; pos = ZLSearchUtil::find(str, len, pattern, pos + 1)) {
-					myMarks.push_back(ZLTextMark(it - myParagraphs.begin(), offset + pos, pattern.length()));
-				}
-				offset += len;
+void ZLTextModel::searchParagraph(size_t index) const {
+	const ZLSearchPattern &pattern = *mySearchPattern;
+	std::vector<ZLTextMark> marks;
+	int offset = 0;
+	for (ZLTextParagraph::Iterator it = *(*this)[index]; !it.isEnd(); it.next()) {
+		if (it.entryKind() == ZLTextParagraphEntry::TEXT_ENTRY) {
+			const char *str = it.textData();
+			const size_t len = it.textDataLength();
+			for (int pos = ZLSearchUtil::find(str, len, pattern); pos != -1; pos = ZLSearchUtil::find(str, len, pattern, pos + 1)) {
+				marks.push_back(ZLTextMark(index, offset + pos, pattern.length()));
 			}
+			offset += len;
 		}
 	}
+	if (marks.empty()) {
+		return;
+	}
+	if (mySearchWrapped) {
+		myMarks.insert(myMarks.begin() + myMarkInsertIndex, marks.begin(), marks.end());
+		myMarkInsertIndex += marks.size();
+	} else {
+		myMarks.insert(myMarks.end(), marks.begin(), marks.end());
+	}
 }
 
 void ZLTextModel::selectParagraph(size_t index) const {
@@ -277,3 +332,224 @@ void ZLTextModel::addBidiReset() {
 	*myLastEntryStart = ZLTextParagraphEntry::RESET_BIDI_ENTRY;
 	myParagraphs.back()->addEntry(myLastEntryStart);
 }
+
+static const char *nextEntry(const char *address, size_t size) {
+	address += size;
+	if (*address == 0) {
+		memcpy(&address, address + 1, sizeof(char*));
+	}
+	return address;
+}
+
+// The entries of every paragraph are written in one piece, the links
+// between the allocator rows are dropped. The image map address is only
+// valid in this process, it is replaced when the paragraphs are read.
+void ZLTextModel::writeParagraphs(ZLOutputStream &stream) const {
+	const bool isTree = kind() == TREE_MODEL;
+	std::map<const ZLTextParagraph*,int> indices;
+	const char *noImageMap[1] = { 0 };
+
+	const size_t number = myParagraphs.size();
+	stream.write((const char*)&number, sizeof(size_t));
+	for (size_t i = 0; i < number; ++i) {
+		const ZLTextParagraph &paragraph = *(*this)[i];
+		const char kind = paragraph.kind();
+		stream.write(&kind, 1);
+		if (isTree) {
+			std::map<const ZLTextParagraph*,int>::const_iterator it = indices.find(((const ZLTextTreeParagraph&)paragraph).parent());
+			const int parentIndex = (it != indices.end()) ? it->second : -1;
+			stream.write((const char*)&parentIndex, sizeof(int));
+			indices[&paragraph] = i;
+		}
+
+		const size_t entryNumber = paragraph.myEntryNumber;
+		size_t size = 0;
+		const char *address = paragraph.myFirstEntryAddress;
+		for (size_t j = 0; j < entryNumber; ++j) {
+			const size_t entrySize = ZLTextParagraph::entrySize(address);
+			size += entrySize;
+			if (j + 1 < entryNumber) {
+				address = nextEntry(address, entrySize);
+			}
+		}
+		stream.write((const char*)&entryNumber, sizeof(size_t));
+		stream.write((const char*)&size, sizeof(size_t));
+
+		address = paragraph.myFirstEntryAddress;
+		for (size_t j = 0; j < entryNumber; ++j) {
+			const size_t entrySize = ZLTextParagraph::entrySize(address);
+			if (*address == ZLTextParagraphEntry::IMAGE_ENTRY) {
+				stream.write(address, 1);
+				stream.write((const char*)noImageMap, sizeof(const ZLImageMap*));
+				stream.write(address + 1 + sizeof(const ZLImageMap*), entrySize - 1 - sizeof(const ZLImageMap*));
+			} else {
+				stream.write(address, entrySize);
+			}
+			if (j + 1 < entryNumber) {
+				address = nextEntry(address, entrySize);
+			}
+		}
+	}
+}
+
+static bool readValue(char *&data, const char *end, void *value, size_t size) {
+	if (data + size > end) {
+		return false;
+	}
+	memcpy(value, data, size);
+	data += size;
+	return true;
+}
+
+// Reads paragraphs written by writeParagraphs. The entries are used in
+// place, so data must stay valid as long as the model exists; storage is
+// kept for that. Returns the end of the paragraphs or 0 if data is broken.
+char *ZLTextModel::readParagraphs(char *data, const char *end, const ZLImageMap &imageMap, fb::shared_ptr<ZLTextModelStorage> storage) {
+	const bool isTree = kind() == TREE_MODEL;
+	const ZLImageMap *imageMapAddress = &imageMap;
+
+	size_t number = 0;
+	if (!readValue(data, end, &number, sizeof(size_t))) {
+		return 0;
+	}
+	myParagraphs.reserve(myParagraphs.size() + number);
+	for (size_t i = 0; i < number; ++i) {
+		char kind = 0;
+		int parentIndex = -1;
+		size_t entryNumber = 0;
+		size_t size = 0;
+		if (!readValue(data, end, &kind, 1) ||
+				(isTree && !readValue(data, end, &parentIndex, sizeof(int))) ||
+				!readValue(data, end, &entryNumber, sizeof(size_t)) ||
+				!readValue(data, end, &size, sizeof(size_t)) ||
+				(data + size > end)) {
+			return 0;
+		}
+
+		if (isTree) {
+			ZLTextTreeParagraph *parent =
+				((parentIndex >= 0) && (parentIndex < (int)i)) ? (ZLTextTreeParagraph*)myParagraphs[parentIndex] : 0;
+			((ZLTextTreeModel*)this)->createParagraph(parent);
+		} else {
+			((ZLTextPlainModel*)this)->createParagraph((ZLTextParagraph::Kind)kind);
+		}
+
+		char *address = data;
+		for (size_t j = 0; j < entryNumber; ++j) {
+			if ((address >= data + size) || (*address == 0)) {
+				return 0;
+			}
+			if (*address == ZLTextParagraphEntry::IMAGE_ENTRY) {
+				memcpy(address + 1, &imageMapAddress, sizeof(const ZLImageMap*));
+			}
+			address += ZLTextParagraph::entrySize(address);
+		}
+		if (address != data + size) {
+			return 0;
+		}
+		if (entryNumber > 0) {
+			ZLTextParagraph &paragraph = *myParagraphs.back();
+			paragraph.myFirstEntryAddress = data;
+			paragraph.myEntryNumber = entryNumber;
+		}
+		data += size;
+	}
+
+	myStorage = storage;
+	return data;
+}
+
+// Paragraphs of a source are read in blocks. A block owns its paragraphs
+// and their entries; a paragraph cursor keeps the block of its paragraph,
+// so a block the model has dropped lives as long as it is shown.
+static const size_t PARAGRAPH_BLOCK_SIZE = 64;
+static const size_t MAX_LOADED_BLOCKS = 32;
+
+class ZLTextParagraphBlock : public ZLTextModelStorage {
+
+public:
+	ZLTextParagraphBlock();
+
+	ZLTextPlainModel Model;
+};
+
+ZLTextParagraphBlock::ZLTextParagraphBlock() : Model(8192) {
+}
+
+// The model must be empty. Paragraphs the source finds later are added
+// by updateParagraphs.
+void ZLTextModel::setParagraphSource(fb::shared_ptr<ZLTextParagraphSource> source) {
+	mySource = source;
+	myBlocks.clear();
+	myParagraphs.assign(source.isNull() ? 0 : source->paragraphsNumber(), 0);
+}
+
+bool ZLTextModel::isComplete() const {
+	return mySource.isNull() || (mySource->isComplete() && (myParagraphs.size() == mySource->paragraphsNumber()));
+}
+
+// Adds the paragraphs the source has found since the last call, after
+// asking it for number paragraphs. Returns true if there are new ones.
+bool ZLTextModel::updateParagraphs(size_t number) {
+	if (mySource.isNull()) {
+		return false;
+	}
+	if (number > mySource->paragraphsNumber()) {
+		mySource->findParagraphs(number);
+	}
+	const size_t size = mySource->paragraphsNumber();
+	if (size == myParagraphs.size()) {
+		return false;
+	}
+	myParagraphs.resize(size, 0);
+	return true;
+}
+
+size_t ZLTextModel::characterNumber(size_t index) const {
+	return mySource.isNull() ? (*this)[index]->characterNumber() : mySource->characterNumber(index);
+}
+
+ZLTextParagraph::Kind ZLTextModel::paragraphKind(size_t index) const {
+	return mySource.isNull() ? (*this)[index]->kind() : mySource->paragraphKind(index);
+}
+
+fb::shared_ptr<ZLTextModelStorage> ZLTextModel::paragraphStorage(size_t index) const {
+	if (mySource.isNull()) {
+		return 0;
+	}
+	std::map<size_t,fb::shared_ptr<ZLTextModelStorage> >::const_iterator it = myBlocks.find(index / PARAGRAPH_BLOCK_SIZE);
+	return (it != myBlocks.end()) ? it->second : 0;
+}
+
+// Reads the block of the paragraph. When too many blocks are loaded, the
+// one farthest from it is dropped, so the loaded blocks follow the reader.
+ZLTextParagraph *ZLTextModel::loadParagraph(size_t index) const {
+	const size_t blockIndex = index / PARAGRAPH_BLOCK_SIZE;
+	const size_t start = blockIndex * PARAGRAPH_BLOCK_SIZE;
+	const size_t end = std::min(start + PARAGRAPH_BLOCK_SIZE, myParagraphs.size());
+
+	ZLTextParagraphBlock *block = new ZLTextParagraphBlock();
+	myBlocks[blockIndex] = block;
+	mySource->readParagraphs(start, end, block->Model);
+	while (block->Model.paragraphsNumber() < end - start) {
+		block->Model.createParagraph(ZLTextParagraph::TEXT_PARAGRAPH);
+	}
+	for (size_t i = start; i < end; ++i) {
+		myParagraphs[i] = block->Model[i - start];
+	}
+
+	if (myBlocks.size() > MAX_LOADED_BLOCKS) {
+		std::map<size_t,fb::shared_ptr<ZLTextModelStorage> >::iterator farthest = myBlocks.begin();
+		std::map<size_t,fb::shared_ptr<ZLTextModelStorage> >::iterator last = myBlocks.end();
+		--last;
+		if (blockIndex - farthest->first < last->first - blockIndex) {
+			farthest = last;
+		}
+		const size_t farthestEnd = std::min((farthest->first + 1) * PARAGRAPH_BLOCK_SIZE, myParagraphs.size());
+		for (size_t i = farthest->first * PARAGRAPH_BLOCK_SIZE; i < farthestEnd; ++i) {
+			myParagraphs[i] = 0;
+		}
+		myBlocks.erase(farthest);
+	}
+	return myParagraphs[index];
+}
@@ -21,6 +21,7 @@
 #define __ZLTEXTMODEL_H__
 
 #include <vector>
+#include <map>
 #include <string>
 #include <algorithm>
 
@@ -31,6 +32,37 @@
 
 class ZLTextParagraph;
 class ZLTextTreeParagraph;
+class ZLOutputStream;
+class ZLSearchPattern;
+
+class ZLTextModelStorage {
+
+public:
+	virtual ~ZLTextModelStorage();
+};
+
+class ZLTextPlainModel;
+
+// Paragraphs of a text too large to be kept in memory. The source finds
+// the paragraphs step by step, the model reads only the ones in use.
+class ZLTextParagraphSource {
+
+public:
+	virtual ~ZLTextParagraphSource();
+
+	// The number of paragraphs found so far, it grows until the source
+	// is complete.
+	virtual size_t paragraphsNumber() const = 0;
+	virtual bool isComplete() const = 0;
+	// Finds at least number paragraphs right away if the text has them.
+	virtual void findParagraphs(size_t number) = 0;
+
+	virtual ZLTextParagraph::Kind paragraphKind(size_t index) const = 0;
+	// May be estimated, it is used for the position of the text only.
+	virtual size_t characterNumber(size_t index) const = 0;
+	// Creates the paragraphs from start to end, end not included.
+	virtual void readParagraphs(size_t start, size_t end, ZLTextPlainModel &model) const = 0;
+};
 
 class ZLTextModel {
 	
@@ -50,9 +82,15 @@ public:
 	size_t paragraphsNumber() const;
 	ZLTextParagraph *operator[] (size_t index);
 	const ZLTextParagraph *operator[] (size_t index) const;
+	size_t characterNumber(size_t index) const;
+	ZLTextParagraph::Kind paragraphKind(size_t index) const;
 	const std::vector<ZLTextMark> &marks() const;
 
 	virtual void search(const std::string &text, size_t startIndex, size_t endIndex, bool ignoreCase) const;
+	void startSearch(const std::string &text, size_t startIndex, size_t endIndex, size_t originIndex, bool ignoreCase) const;
+	bool searchParagraphs(size_t number) const;
+	bool isSearchFinished() const;
+	void stopSearch() const;
 	virtual void selectParagraph(size_t index) const;
 	void removeAllMarks();
 
@@ -70,17 +108,42 @@ public:
 	void addFixedHSpace(unsigned char length);
 	void addBidiReset();
 
+	void writeParagraphs(ZLOutputStream &stream) const;
+	char *readParagraphs(char *data, const char *end, const ZLImageMap &imageMap, fb::shared_ptr<ZLTextModelStorage> storage);
+
+	void setParagraphSource(fb::shared_ptr<ZLTextParagraphSource> source);
+	bool isComplete() const;
+	bool updateParagraphs(size_t number = 0);
+	fb::shared_ptr<ZLTextModelStorage> paragraphStorage(size_t index) const;
+
 protected:
 	void addParagraphInternal(ZLTextParagraph *paragraph);
 	void removeParagraphInternal(int index);
 	
 private:
-	std::vector<ZLTextParagraph*> myParagraphs;
+	void searchParagraph(size_t index) const;
+	ZLTextParagraph *loadParagraph(size_t index) const;
+
+private:
+	mutable std::vector<ZLTextParagraph*> myParagraphs;
 	mutable std::vector<ZLTextMark> myMarks;
 	mutable ZLTextRowMemoryAllocator myAllocator;
 
 	char *myLastEntryStart;
 
+	fb::shared_ptr<ZLTextModelStorage> myStorage;
+
+	fb::shared_ptr<ZLTextParagraphSource> mySource;
+	mutable std::map<size_t,fb::shared_ptr<ZLTextModelStorage> > myBlocks;
+
+	mutable fb::shared_ptr<ZLSearchPattern> mySearchPattern;
+	mutable size_t mySearchStart;
+	mutable size_t mySearchEnd;
+	mutable size_t mySearchOrigin;
+	mutable size_t mySearchIndex;
+	mutable bool mySearchWrapped;
+	mutable size_t myMarkInsertIndex;
+
 private:
 	ZLTextModel(const ZLTextModel&);
 	const ZLTextModel &operator = (const ZLTextModel&);
@@ -112,16 +175,24 @@ private:
 	ZLTextTreeParagraph *myRoot;
 };
 
+inline ZLTextModelStorage::~ZLTextModelStorage() {}
+
+inline ZLTextParagraphSource::~ZLTextParagraphSource() {}
+
 inline size_t ZLTextModel::paragraphsNumber() const { return myParagraphs.size(); }
 inline const std::vector<ZLTextMark> &ZLTextModel::marks() const { return myMarks; }
-inline void ZLTextModel::removeAllMarks() { myMarks.clear(); }
+inline bool ZLTextModel::isSearchFinished() const { return mySearchPattern.isNull(); }
 
 inline ZLTextParagraph *ZLTextModel::operator[] (size_t index) {
-	return myParagraphs[std::min(myParagraphs.size() - 1, index)];
+	index = std::min(myParagraphs.size() - 1, index);
+	ZLTextParagraph *paragraph = myParagraphs[index];
+	return (paragraph != 0) ? paragraph : loadParagraph(index);
 }
 
 inline const ZLTextParagraph *ZLTextModel::operator[] (size_t index) const {
-	return myParagraphs[std::min(myParagraphs.size() - 1, index)];
+	index = std::min(myParagraphs.size() - 1, index);
+	const ZLTextParagraph *paragraph = myParagraphs[index];
+	return (paragraph != 0) ? paragraph : loadParagraph(index);
 }
 
 inline ZLTextModel::Kind ZLTextPlainModel::kind() const { return PLAIN_TEXT_MODEL; }
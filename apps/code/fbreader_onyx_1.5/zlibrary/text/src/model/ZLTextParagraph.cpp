@@ -75,6 +75,13 @@ ZLTextStyleEntry::ZLTextStyleEntry(char *address) {
 	}
 }
 
+// The text of a text entry without creating the entry object.
+size_t ZLTextParagraph::Iterator::textDataLength() const {
+	size_t len;
+	memcpy(&len, myPointer + 1, sizeof(size_t));
+	return len;
+}
+
 const fb::shared_ptr<ZLTextParagraphEntry> ZLTextParagraph::Iterator::entry() const {
 	if (myEntry.isNull()) {
 		switch (*myPointer) {
@@ -113,60 +120,66 @@ const fb::shared_ptr<ZLTextParagraphEntry> ZLTextParagraph::Iterator::entry() co
 	return myEntry;
 }
 
-void ZLTextParagraph::Iterator::next() {
-	++myIndex;
-	myEntry = 0;
-	if (myIndex != myEndIndex) {
-		switch (*myPointer) {
-			case ZLTextParagraphEntry::TEXT_ENTRY:
-			{
-				size_t len;
-				memcpy(&len, myPointer + 1, sizeof(size_t));
-				myPointer += len + sizeof(size_t) + 1;
-				break;
+size_t ZLTextParagraph::entrySize(const char *address) {
+	const char *ptr = address;
+	switch (*ptr) {
+		case ZLTextParagraphEntry::TEXT_ENTRY:
+		{
+			size_t len;
+			memcpy(&len, ptr + 1, sizeof(size_t));
+			ptr += len + sizeof(size_t) + 1;
+			break;
+		}
+		case ZLTextParagraphEntry::CONTROL_ENTRY:
+			ptr += 2;
+			break;
+		case ZLTextParagraphEntry::HYPERLINK_CONTROL_ENTRY:
+			ptr += 2;
+			while (*ptr != '\0') {
+				++ptr;
 			}
-			case ZLTextParagraphEntry::CONTROL_ENTRY:
-				myPointer += 2;
-				break;
-			case ZLTextParagraphEntry::HYPERLINK_CONTROL_ENTRY:
-				myPointer += 2;
-				while (*myPointer != '\0') {
-					++myPointer;
-				}
-				++myPointer;
-				while (*myPointer != '\0') {
-					++myPointer;
-				}
-				++myPointer;
-				break;
-			case ZLTextParagraphEntry::IMAGE_ENTRY:
-				myPointer += sizeof(const ZLImageMap*) + sizeof(short) + 1;
-				while (*myPointer != '\0') {
-					++myPointer;
-				}
-				++myPointer;
-				break;
-			case ZLTextParagraphEntry::STYLE_ENTRY:
-			{
-				int mask;
-				memcpy(&mask, myPointer + 1, sizeof(int));
-				bool withFontFamily = mask & ZLTextStyleEntry::SUPPORT_FONT_FAMILY;
-				myPointer += sizeof(int) + ZLTextStyleEntry::NUMBER_OF_LENGTHS * (sizeof(short) + 1) + 4;
-				if (withFontFamily) {
-					while (*myPointer != '\0') {
-						++myPointer;
-					}
-					++myPointer;
+			++ptr;
+			while (*ptr != '\0') {
+				++ptr;
+			}
+			++ptr;
+			break;
+		case ZLTextParagraphEntry::IMAGE_ENTRY:
+			ptr += sizeof(const ZLImageMap*) + sizeof(short) + 1;
+			while (*ptr != '\0') {
+				++ptr;
+			}
+			++ptr;
+			break;
+		case ZLTextParagraphEntry::STYLE_ENTRY:
+		{
+			int mask;
+			memcpy(&mask, ptr + 1, sizeof(int));
+			bool withFontFamily = mask & ZLTextStyleEntry::SUPPORT_FONT_FAMILY;
+			ptr += sizeof(int) + ZLTextStyleEntry::NUMBER_OF_LENGTHS * (sizeof(short) + 1) + 4;
+			if (withFontFamily) {
+				while (*ptr != '\0') {
+					++ptr;
 				}
-				break;
+				++ptr;
 			}
-			case ZLTextParagraphEntry::FIXED_HSPACE_ENTRY:
-				myPointer += 2;
-				break;
-			case ZLTextParagraphEntry::RESET_BIDI_ENTRY:
-				++myPointer;
-				break;
+			break;
 		}
+		case ZLTextParagraphEntry::FIXED_HSPACE_ENTRY:
+			ptr += 2;
+			break;
+		case ZLTextParagraphEntry::RESET_BIDI_ENTRY:
+			++ptr;
+			break;
+	}
+	return ptr - address;
+}
+
+void ZLTextParagraph::Iterator::next() {
+	++myIndex;
+	myEntry = 0;
+	if (myIndex != myEndIndex) {
+		myPointer += entrySize(myPointer);
 		if (*myPointer == 0) {
 			memcpy(&myPointer, myPointer + 1, sizeof(char*));
 		}
@@ -158,6 +158,15 @@ ZLTextWordCursor ZLTextView::findPercentFromStart(unsigned int percent) const {
 }
 
 void ZLTextView::preparePaintInfo() {
+	// A model read from its source gets the paragraphs found meanwhile,
+	// and at least the one the next page starts with.
+	if (!myModel.isNull()) {
+		if (!myModel->isComplete()) {
+			myModel->updateParagraphs(myEndCursor.isNull() ? 0 : myEndCursor.paragraphCursor().index() + 2);
+		}
+		updateTextSize();
+	}
+
 	int newWidth = viewWidth();
 	int newHeight = textAreaHeight();
 	if ((newWidth != myOldWidth) || (newHeight != myOldHeight)) {
@@ -269,6 +278,8 @@ void ZLTextView::preparePaintInfo() {
 	}
 	myPaintState = READY;
 	myLineInfoCache.clear();
+
+	checkPagination();
 }
 
 ZLTextWordCursor ZLTextView::findStart(const ZLTextWordCursor &end, SizeUnit unit, int size) {
@@ -306,7 +317,11 @@ ZLTextWordCursor ZLTextView::findStart(const ZLTextWordCursor &end, SizeUnit uni
 }
 
 ZLTextWordCursor ZLTextView::buildInfos(const ZLTextWordCursor &start) {
-	myLineInfos.clear();
+	return buildInfos(start, myLineInfos);
+}
+
+ZLTextWordCursor ZLTextView::buildInfos(const ZLTextWordCursor &start, std::vector<ZLTextLineInfoPtr> &infos) {
+	infos.clear();
 
 	ZLTextWordCursor cursor = start;
 	int textAreaHeight = this->textAreaHeight();
@@ -329,7 +344,7 @@ ZLTextWordCursor ZLTextView::buildInfos(const ZLTextWordCursor &start) {
 			}
 			textAreaHeight -= infoPtr->VSpaceAfter;
 			cursor = infoPtr->End;
-			myLineInfos.push_back(infoPtr);
+			infos.push_back(infoPtr);
 			if (textAreaHeight < 0) {
 				break;
 			}
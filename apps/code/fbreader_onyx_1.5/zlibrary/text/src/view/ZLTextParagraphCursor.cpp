@@ -27,7 +27,7 @@
 
 ZLTextElementPool ZLTextElementPool::Pool;
 
-std::map<const ZLTextParagraph*, fb::weak_ptr<ZLTextParagraphCursor> > ZLTextParagraphCursorCache::ourCache;
+std::map<ZLTextParagraphCursorCache::Key, fb::weak_ptr<ZLTextParagraphCursor> > ZLTextParagraphCursorCache::ourCache;
 ZLTextParagraphCursorPtr ZLTextParagraphCursorCache::ourLastAdded;
 
 ZLTextElementVector::~ZLTextElementVector() {
@@ -78,14 +78,15 @@ ZLTextElementPool::~ZLTextElementPool() {
 }
 
 ZLTextParagraphCursorPtr ZLTextParagraphCursor::cursor(const ZLTextModel &model, const std::string &language, size_t index) {
-	ZLTextParagraphCursorPtr result = ZLTextParagraphCursorCache::get(model[index]);
+	index = std::min(index, model.paragraphsNumber() - 1);
+	ZLTextParagraphCursorPtr result = ZLTextParagraphCursorCache::get(model, index);
 	if (result.isNull()) {
 		if (model.kind() == ZLTextModel::TREE_MODEL) {
 			result = new ZLTextTreeParagraphCursor((const ZLTextTreeModel&)model, language, index);
 		} else {
 			result = new ZLTextPlainParagraphCursor((const ZLTextPlainModel&)model, language, index);
 		}
-		ZLTextParagraphCursorCache::put(model[index], result);
+		ZLTextParagraphCursorCache::put(model, index, result);
 	}
 	return result;
 }
@@ -213,6 +214,7 @@ void ZLTextParagraphCursor::processControlParagraph(const ZLTextParagraph &parag
 
 void ZLTextParagraphCursor::fill() {
 	const ZLTextParagraph &paragraph = *myModel[myIndex];
+	myStorage = myModel.paragraphStorage(myIndex);
 	switch (paragraph.kind()) {
 		case ZLTextParagraph::TEXT_PARAGRAPH:
 		case ZLTextParagraph::TREE_PARAGRAPH:
@@ -243,13 +245,13 @@ void ZLTextParagraphCursor::clear() {
 	myElements.clear();
 }
 
-void ZLTextParagraphCursorCache::put(const ZLTextParagraph *paragraph, ZLTextParagraphCursorPtr cursor) {
-	ourCache[paragraph] = cursor;
+void ZLTextParagraphCursorCache::put(const ZLTextModel &model, size_t index, ZLTextParagraphCursorPtr cursor) {
+	ourCache[Key(&model, index)] = cursor;
 	ourLastAdded = cursor;
 }
 
-ZLTextParagraphCursorPtr ZLTextParagraphCursorCache::get(const ZLTextParagraph *paragraph) {
-	return ourCache[paragraph];
+ZLTextParagraphCursorPtr ZLTextParagraphCursorCache::get(const ZLTextModel &model, size_t index) {
+	return ourCache[Key(&model, index)];
 }
 
 void ZLTextParagraphCursorCache::clear() {
@@ -258,8 +260,8 @@ void ZLTextParagraphCursorCache::clear() {
 }
 
 void ZLTextParagraphCursorCache::cleanup() {
-	std::map<const ZLTextParagraph*, fb::weak_ptr<ZLTextParagraphCursor> > cleanedCache;
-	for (std::map<const ZLTextParagraph*, fb::weak_ptr<ZLTextParagraphCursor> >::iterator it = ourCache.begin(); it != ourCache.end(); ++it) {
+	std::map<Key, fb::weak_ptr<ZLTextParagraphCursor> > cleanedCache;
+	for (std::map<Key, fb::weak_ptr<ZLTextParagraphCursor> >::iterator it = ourCache.begin(); it != ourCache.end(); ++it) {
 		if (!it->second.isNull()) {
 			cleanedCache.insert(*it);
 		}
@@ -111,21 +111,27 @@ protected:
 	const std::string &myLanguage;
 	size_t myIndex;
 	ZLTextElementVector myElements;
+	// the words point into the entries of the paragraph
+	fb::shared_ptr<ZLTextModelStorage> myStorage;
 
 friend class ZLTextWordCursor;
 };
 
+// The cursors are kept by the index of their paragraph: the paragraphs of
+// a model with a paragraph source are deleted with their block and may be
+// read again at the address of another one.
 class ZLTextParagraphCursorCache {
 
 public:
-	static void put(const ZLTextParagraph *paragraph, ZLTextParagraphCursorPtr cursor);
-	static ZLTextParagraphCursorPtr get(const ZLTextParagraph *paragraph);
+	static void put(const ZLTextModel &model, size_t index, ZLTextParagraphCursorPtr cursor);
+	static ZLTextParagraphCursorPtr get(const ZLTextModel &model, size_t index);
 
 	static void clear();
 	static void cleanup();
 
 private:
-    static std::map<const ZLTextParagraph*, fb::weak_ptr<ZLTextParagraphCursor> > ourCache;
+	typedef std::pair<const ZLTextModel*,size_t> Key;
+	static std::map<Key, fb::weak_ptr<ZLTextParagraphCursor> > ourCache;
 	static ZLTextParagraphCursorPtr ourLastAdded;
 
 private:
@@ -33,7 +33,7 @@
 #include "ZLTextWord.h"
 #include "ZLTextSelectionModel.h"
 
-ZLTextView::ZLTextView(ZLApplication &application, fb::shared_ptr<ZLPaintContext> context) : ZLView(application, context), myPaintState(NOTHING_TO_PAINT), myOldWidth(-1), myOldHeight(-1), myStyle(context), mySelectionModel(*this, application), myTreeStateIsFrozen(false), myDoUpdateScrollbar(false) {
+ZLTextView::ZLTextView(ZLApplication &application, fb::shared_ptr<ZLPaintContext> context) : ZLView(application, context), myPaintState(NOTHING_TO_PAINT), myOldWidth(-1), myOldHeight(-1), myStyle(context), mySelectionModel(*this, application), myTreeStateIsFrozen(false), myDoUpdateScrollbar(false), myPaginationFinished(false), myPaginationChanged(false), mySearchGoal(SEARCH_GOAL_NONE), myVisibleMarkNumber(0) {
 }
 
 ZLTextView::~ZLTextView() {
@@ -48,6 +48,14 @@ void ZLTextView::setPaintContext(fb::shared_ptr<ZLPaintContext> context) {
 void ZLTextView::clear() {
 	mySelectionModel.clear();
 
+	stopSearch();
+
+	stopPagination();
+	myPaginationFile.erase();
+	myPaginationKey.erase();
+	myPageStarts.clear();
+	myPaginationFinished = false;
+
 	myStartCursor = 0;
 	myEndCursor = 0;
 	myLineInfos.clear();
@@ -68,29 +76,39 @@ void ZLTextView::setModel(fb::shared_ptr<ZLTextModel> model, const std::string &
 	myLanguage = language.empty() ? ZLibrary::Language() : language;
 	myStyle.setBaseBidiLevel(ZLLanguageUtil::isRTLLanguage(myLanguage) ? 1 : 0);
 
-	if (!myModel.isNull() && (myModel->paragraphsNumber() != 0)) {
-		setStartCursor(ZLTextParagraphCursor::cursor(*myModel, myLanguage));
+	if (!myModel.isNull()) {
+		updateTextSize();
+	}
+}
 
-		size_t size = myModel->paragraphsNumber();
-		myTextSize.reserve(size + 1);
+// The sizes are taken from the model without reading the paragraphs. A
+// model that grows while it is shown, like one read from its source or
+// the contents of such a model, gets the sizes of the new paragraphs.
+void ZLTextView::updateTextSize() {
+	const size_t size = myModel->paragraphsNumber();
+	if (myTextSize.empty()) {
+		if (size == 0) {
+			return;
+		}
+		setStartCursor(ZLTextParagraphCursor::cursor(*myModel, myLanguage));
 		myTextSize.push_back(0);
-		size_t currentSize = 0;
-		for (size_t i= 0; i < size; ++i) {
-			const ZLTextParagraph &para = *(*myModel)[i];
-			currentSize += para.characterNumber();
-			switch (para.kind()) {
-				case ZLTextParagraph::END_OF_TEXT_PARAGRAPH:
-					myTextBreaks.push_back(i);
-					currentSize = ((currentSize - 1) / 2048 + 1) * 2048;
-					break;
-				case ZLTextParagraph::END_OF_SECTION_PARAGRAPH:
-					currentSize = ((currentSize - 1) / 2048 + 1) * 2048;
-					break;
-				default:
-					break;
-			}
-			myTextSize.push_back(currentSize);
+	}
+	myTextSize.reserve(size + 1);
+	size_t currentSize = myTextSize.back();
+	for (size_t i = myTextSize.size() - 1; i < size; ++i) {
+		currentSize += myModel->characterNumber(i);
+		switch (myModel->paragraphKind(i)) {
+			case ZLTextParagraph::END_OF_TEXT_PARAGRAPH:
+				myTextBreaks.push_back(i);
+				currentSize = ((currentSize - 1) / 2048 + 1) * 2048;
+				break;
+			case ZLTextParagraph::END_OF_SECTION_PARAGRAPH:
+				currentSize = ((currentSize - 1) / 2048 + 1) * 2048;
+				break;
+			default:
+				break;
 		}
+		myTextSize.push_back(currentSize);
 	}
 }
 
@@ -238,6 +256,10 @@ void ZLTextView::gotoParagraph(int num, bool end) {
 		return;
 	}
 
+	if ((num >= (int)myModel->paragraphsNumber()) && myModel->updateParagraphs(num + 1)) {
+		updateTextSize();
+	}
+
 	if (!startCursor().isNull() &&
 			startCursor().isStartOfParagraph() &&
 			startCursor().paragraphCursor().isFirst() &&
@@ -298,10 +320,43 @@ bool ZLTextView::hasMultiSectionModel() const {
 	return !myTextBreaks.empty();
 }
 
+// The book is searched in slices on the gui thread, like the pagination;
+// the paragraph texts live in the model allocator that is not shared with
+// other threads. The first slice runs right away, so a hit near the
+// current position is shown without waiting for the rest of the book.
+static const int SEARCH_INTERVAL = 20;
+static const int SEARCH_SLICE = 50;
+static const size_t SEARCH_STEP = 16;
+
+class ZLTextSearcher : public ZLRunnable {
+
+public:
+	ZLTextSearcher(ZLTextView &view);
+
+private:
+	void run();
+
+private:
+	ZLTextView &myView;
+};
+
+ZLTextSearcher::ZLTextSearcher(ZLTextView &view) : myView(view) {
+}
+
+// The search is over when a slice finds no more paragraphs to search;
+// the application is told so only then, not when a search is stopped.
+void ZLTextSearcher::run() {
+	myView.continueSearch();
+	if (myView.isSearchFinished()) {
+		myView.application().onSearchFinished();
+	}
+}
+
 void ZLTextView::search(const std::string &text, bool ignoreCase, bool wholeText, bool backward, bool thisSectionOnly) {
 	if (text.empty()) {
 		return;
 	}
+	stopSearch();
 
 	size_t startIndex = 0;
 	size_t endIndex = myModel->paragraphsNumber();
@@ -315,15 +370,115 @@ void ZLTextView::search(const std::string &text, bool ignoreCase, bool wholeText
 		}
 	}
 
-	myModel->search(text, startIndex, endIndex, ignoreCase);
-	if (!startCursor().isNull()) {
+	// Found paragraphs of a tree are opened by the tree model search.
+	if ((myModel->kind() == ZLTextModel::TREE_MODEL) || startCursor().isNull()) {
+		myModel->search(text, startIndex, endIndex, ignoreCase);
+		if (!startCursor().isNull()) {
+			rebuildPaintInfo(true);
+			ZLTextMark position = startCursor().position();
+			gotoMark(wholeText ?
+								(backward ? myModel->lastMark() : myModel->firstMark()) :
+								(backward ? myModel->previousMark(position) : myModel->nextMark(position)));
+			application().refreshWindow();
+		}
+		return;
+	}
+
+	mySearchPosition = startCursor().position();
+	if (wholeText) {
+		mySearchGoal = backward ? SEARCH_GOAL_LAST : SEARCH_GOAL_FIRST;
+	} else {
+		mySearchGoal = backward ? SEARCH_GOAL_PREVIOUS : SEARCH_GOAL_NEXT;
+	}
+	const size_t originIndex = (mySearchGoal == SEARCH_GOAL_NEXT) ? mySearchPosition.ParagraphIndex : startIndex;
+	myModel->startSearch(text, startIndex, endIndex, originIndex, ignoreCase);
+
+	continueSearch();
+	if (!myModel->isSearchFinished()) {
+		if (mySearcher.isNull()) {
+			mySearcher = new ZLTextSearcher(*this);
+		}
+		ZLTimeManager::instance().addTask(mySearcher, SEARCH_INTERVAL);
+	}
+}
+
+// Moves to the wanted mark as soon as it is known. The page is repainted
+// once more at the end only if marks have been added to it since, every
+// repaint costs an e-ink refresh.
+void ZLTextView::continueSearch() {
+	if (myModel.isNull()) {
+		stopSearch();
+		return;
+	}
+
+	bool searching = true;
+	const ZLTime start;
+	do {
+		searching = myModel->searchParagraphs(SEARCH_STEP);
+	} while (searching && (ZLTime().millisecondsFrom(start) < SEARCH_SLICE));
+
+	if (mySearchGoal != SEARCH_GOAL_NONE) {
+		ZLTextMark mark;
+		bool found = !searching;
+		switch (mySearchGoal) {
+			case SEARCH_GOAL_FIRST:
+				mark = myModel->firstMark();
+				found = found || (mark.ParagraphIndex > -1);
+				break;
+			case SEARCH_GOAL_NEXT:
+				mark = myModel->nextMark(mySearchPosition);
+				found = found || (mark.ParagraphIndex > -1);
+				break;
+			case SEARCH_GOAL_LAST:
+				mark = myModel->lastMark();
+				break;
+			case SEARCH_GOAL_PREVIOUS:
+				mark = myModel->previousMark(mySearchPosition);
+				break;
+			default:
+				break;
+		}
+		if (found) {
+			mySearchGoal = SEARCH_GOAL_NONE;
+			rebuildPaintInfo(true);
+			gotoMark(mark);
+			preparePaintInfo();
+			myVisibleMarkNumber = visibleMarkNumber();
+			application().refreshWindow();
+		}
+	} else if (!searching && (visibleMarkNumber() != myVisibleMarkNumber)) {
 		rebuildPaintInfo(true);
-		ZLTextMark position = startCursor().position();
-		gotoMark(wholeText ?
-							(backward ? myModel->lastMark() : myModel->firstMark()) :
-							(backward ? myModel->previousMark(position) : myModel->nextMark(position)));
 		application().refreshWindow();
 	}
+
+	if (!searching) {
+		stopSearch();
+	}
+}
+
+size_t ZLTextView::visibleMarkNumber() const {
+	if (startCursor().isNull() || endCursor().isNull()) {
+		return 0;
+	}
+	const std::vector<ZLTextMark> &marks = myModel->marks();
+	const ZLTextMark from(startCursor().paragraphCursor().index(), 0, 0);
+	const ZLTextMark to(endCursor().paragraphCursor().index() + 1, 0, 0);
+	return std::lower_bound(marks.begin(), marks.end(), to) - std::lower_bound(marks.begin(), marks.end(), from);
+}
+
+// Stops a running search, the marks found so far are kept.
+void ZLTextView::stopSearch() {
+	if (!mySearcher.isNull()) {
+		ZLTimeManager::instance().removeTask(mySearcher);
+	}
+	if (!myModel.isNull()) {
+		myModel->stopSearch();
+	}
+	mySearchGoal = SEARCH_GOAL_NONE;
+}
+
+bool ZLTextView::isSearchFinished() const {
+	return myModel.isNull() || myModel->isSearchFinished();
 }
 
 bool ZLTextView::canFindNext() const {
@@ -644,6 +799,11 @@ void ZLTextView::gotoCharIndex(size_t charIndex) {
 }
 
 void ZLTextView::gotoPage(size_t index) {
+	if (hasExactPages()) {
+		gotoExactPage(index);
+		return;
+	}
+
 	size_t charIndex = (index - 1) * 2048;
 	std::vector<size_t>::const_iterator it = std::lower_bound(myTextSize.begin(), myTextSize.end(), charIndex);
 	const int paraIndex = it - myTextSize.begin();
@@ -663,6 +823,9 @@ size_t ZLTextView::pageIndex() {
 	if (empty() || positionIndicator().isNull() || endCursor().isNull()) {
 		return 0;
 	}
+	if (hasExactPages()) {
+		return exactPageIndex();
+	}
 	return positionIndicator()->sizeOfTextBeforeCursor(endCursor()) / 2048 + 1;
 }
 
@@ -670,6 +833,10 @@ size_t ZLTextView::pageNumber() const {
 	if (empty()) {
 		return 0;
 	}
+	size_t from, to;
+	if (exactPageRange(from, to)) {
+		return to - from;
+	}
 	std::vector<size_t>::const_iterator i = nextBreakIterator();
 	const size_t startIndex = (i != myTextBreaks.begin()) ? *(i - 1) : 0;
 	const size_t endIndex = (i != myTextBreaks.end()) ? *i : myModel->paragraphsNumber();
@@ -28,12 +28,48 @@
 #include "ZLQtPaintContext.h"
 #include "../image/ZLQtImageManager.h"
 
+// Slots of a word width cache, a power of two.
+static const size_t MAX_CACHED_WORDS = 4096;
+// Fonts with a width cache; all caches are dropped when there are more.
+static const size_t MAX_CACHED_FONTS = 16;
+
+ZLQtPaintContext::WidthCache::WidthCache(const std::string &family, int size, bool bold, bool italic) :
+	Family(family), Size(size), Bold(bold), Italic(italic),
+	Words(MAX_CACHED_WORDS), Widths(MAX_CACHED_WORDS, -1) {
+	for (int i = 0; i < 128; ++i) {
+		CharWidths[i] = -1;
+	}
+}
+
+// FNV-1a
+static size_t wordHash(const char *str, int len) {
+	size_t hash = 2166136261U;
+	for (const char *end = str + len; str < end; ++str) {
+		hash = (hash ^ (unsigned char)*str) * 16777619U;
+	}
+	return hash;
+}
+
+static bool isAscii(const char *str, int len) {
+	for (const char *end = str + len; str < end; ++str) {
+		if ((unsigned char)*str >= 128) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static QString qString(const char *str, int len) {
+	return isAscii(str, len) ? QString::fromLatin1(str, len) : QString::fromUtf8(str, len);
+}
+
 ZLQtPaintContext::ZLQtPaintContext() {
 	myPainter = new QPainter();
 	myPixmap = 0;
 	mySpaceWidth = -1;
 	myDescent = 0;
 	myFontIsStored = false;
+	myWidthCache = 0;
 }
 
 ZLQtPaintContext::~ZLQtPaintContext() {
@@ -42,6 +78,9 @@ ZLQtPaintContext::~ZLQtPaintContext() {
 		delete myPixmap;
 	}
 	delete myPainter;
+	for (std::vector<WidthCache*>::const_iterator it = myWidthCaches.begin(); it != myWidthCaches.end(); ++it) {
+		delete *it;
+	}
 }
 
 void ZLQtPaintContext::setSize(int w, int h) {
@@ -55,6 +94,10 @@ void ZLQtPaintContext::setSize(int w, int h) {
 	if ((myPixmap == 0) && (w > 0) && (h > 0)) {
 		myPixmap = new QPixmap(w, h);
 		myPainter->begin(myPixmap);
+		// begin() resets the font, the widths of the old one do not apply
+		myWidthCache = 0;
+		mySpaceWidth = -1;
+		myDescent = myPainter->fontMetrics().descent();
 		if (myFontIsStored) {
 			myFontIsStored = false;
 			setFont(myStoredFamily, myStoredSize, myStoredBold, myStoredItalic);
@@ -125,9 +168,32 @@ void ZLQtPaintContext::setFont(const std::string &family, int size, bool bold, b
 			mySpaceWidth = -1;
 			myDescent = myPainter->fontMetrics().descent();
 		}
+		if (fontChanged || myWidthCache == 0) {
+			selectWidthCache(family, size, bold, italic);
+		}
 	}
 }
 
+void ZLQtPaintContext::selectWidthCache(const std::string &family, int size, bool bold, bool italic) {
+	// a page uses a few fonts, they are compared in place instead of
+	// building a key string for every setFont()
+	for (std::vector<WidthCache*>::const_iterator it = myWidthCaches.begin(); it != myWidthCaches.end(); ++it) {
+		WidthCache *cache = *it;
+		if ((cache->Size == size) && (cache->Bold == bold) && (cache->Italic == italic) && (cache->Family == family)) {
+			myWidthCache = cache;
+			return;
+		}
+	}
+	if (myWidthCaches.size() >= MAX_CACHED_FONTS) {
+		for (std::vector<WidthCache*>::const_iterator it = myWidthCaches.begin(); it != myWidthCaches.end(); ++it) {
+			delete *it;
+		}
+		myWidthCaches.clear();
+	}
+	myWidthCache = new WidthCache(family, size, bold, italic);
+	myWidthCaches.push_back(myWidthCache);
+}
+
 void ZLQtPaintContext::setColor(ZLColor color, LineStyle style) {
 	myPainter->setPen(QPen(
 		QColor(color.Red, color.Green, color.Blue),
@@ -144,7 +210,33 @@ void ZLQtPaintContext::setFillColor(ZLColor color, FillStyle style) {
 }
 
 int ZLQtPaintContext::stringWidth(const char *str, int len, bool) const {
-	return myPainter->fontMetrics().width(QString::fromUtf8(str, len));
+	if (myWidthCache == 0) {
+		return myPainter->fontMetrics().width(qString(str, len));
+	}
+
+	// a single character has no kerning, punctuation and digits are
+	// looked up in a table
+	if ((len == 1) && ((unsigned char)*str < 128)) {
+		int &width = myWidthCache->CharWidths[(unsigned char)*str];
+		if (width == -1) {
+			width = myPainter->fontMetrics().width(QString::fromLatin1(str, 1));
+		}
+		return width;
+	}
+	return wordWidth(str, len);
+}
+
+int ZLQtPaintContext::wordWidth(const char *str, int len) const {
+	const size_t slot = wordHash(str, len) & (MAX_CACHED_WORDS - 1);
+	std::string &word = myWidthCache->Words[slot];
+	int &width = myWidthCache->Widths[slot];
+	if ((width != -1) && (word.size() == (size_t)len) && (word.compare(0, len, str, len) == 0)) {
+		return width;
+	}
+	// the slot keeps its buffer, so replacing the word rarely allocates
+	word.assign(str, len);
+	width = myPainter->fontMetrics().width(qString(str, len));
+	return width;
 }
 
 int ZLQtPaintContext::spaceWidth() const {
@@ -163,9 +255,11 @@ int ZLQtPaintContext::stringHeight() const {
 }
 
 void ZLQtPaintContext::drawString(int x, int y, const char *str, int len, bool rtl) {
-	QString qStr = QString::fromUtf8(str, len);
-	myPainter->setLayoutDirection(rtl ? Qt::RightToLeft : Qt::LeftToRight);
-	myPainter->drawText(x, y, qStr);
+	const Qt::LayoutDirection direction = rtl ? Qt::RightToLeft : Qt::LeftToRight;
+	if (myPainter->layoutDirection() != direction) {
+		myPainter->setLayoutDirection(direction);
+	}
+	myPainter->drawText(x, y, qString(str, len));
 }
 
 void ZLQtPaintContext::drawImage(int x, int y, const ZLImageData &image) {
@@ -20,6 +20,9 @@
 #ifndef __ZLQTPAINTCONTEXT_H__
 #define __ZLQTPAINTCONTEXT_H__
 
+#include <string>
+#include <vector>
+
 #include <ZLPaintContext.h>
 
 class QPainter;
@@ -62,12 +65,38 @@ public:
 	void fillRectangle(int x0, int y0, int x1, int y1);
 	void drawFilledCircle(int x, int y, int r);
 
+private:
+	// Word widths measured with one font. Line breaking measures every
+	// word several times, so the widths are kept for all fonts used on a
+	// page. Whole words are measured, so kerning is taken into account.
+	// A word hashes to one slot and replaces the word kept there, so a
+	// lookup does not allocate.
+	struct WidthCache {
+		WidthCache(const std::string &family, int size, bool bold, bool italic);
+
+		std::string Family;
+		int Size;
+		bool Bold;
+		bool Italic;
+
+		std::vector<std::string> Words;
+		std::vector<int> Widths;
+		// Single ASCII characters, -1 until measured.
+		int CharWidths[128];
+	};
+
+	void selectWidthCache(const std::string &family, int size, bool bold, bool italic);
+	int wordWidth(const char *str, int len) const;
+
 private:
 	QPainter *myPainter;
 	QPixmap *myPixmap;
 	mutable int mySpaceWidth;
 	int myDescent;
 
+	std::vector<WidthCache*> myWidthCaches;
+	WidthCache *myWidthCache;
+
 	bool myFontIsStored;
 	std::string myStoredFamily;
 	int myStoredSize;
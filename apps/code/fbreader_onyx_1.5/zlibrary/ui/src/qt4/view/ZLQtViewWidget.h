@@ -83,6 +83,7 @@ public Q_SLOTS:
     void onSearch(BaseSearchContext&);
     bool updateSearchWidget();
     void onSearchClosed();
+    void onSearchFinished();
 
     void lookup();
     void onDictClosed();
@@ -106,6 +107,7 @@ private:
     void stopDictLookup();
 
     void showSearchWidget();
+    bool isSearchFinished();
     bool updateSearchCriteria();
 
     bool addBookmark();
@@ -172,6 +174,7 @@ private:
 
     BaseSearchContext search_context_;
     scoped_ptr<SearchWidget> search_widget_;
+    bool find_pending_;
 
     ZLApplication *myApplication;
     bool conf_stored_;
@@ -73,6 +73,8 @@ ImageApplication::ImageApplication(int argc, char **argv)
     : QApplication(argc, argv)
     , main_window_(this)
     , app_type_(IMAGE_APP)
+    , pooled_(false)
+    , connected_(false)
 {
     int args_num = QCoreApplication::arguments().size();
     if (args_num >= 1)
@@ -106,6 +108,18 @@ ImageApplication::ImageApplication(int argc, char **argv)
             main_window_.setContentMargins(10, 0, 10, 0);
         }
 
+        // Explorer keeps a reader in standby, so the image can be opened
+        // without paying for process start and view construction. Notes
+        // are always started cold.
+        if (path_ == "--standby")
+        {
+            path_.clear();
+            pooled_ = true;
+            main_window_.attachModel(&model_);
+            activateImage();
+            return;
+        }
+
         if (open(path_))
         {
             main_window_.attachModel(&model_);
@@ -150,14 +164,28 @@ BaseView* ImageApplication::activateImage()
     assert(image_view != 0);
 
     // connect the signals of view
-    SysStatus & sys_status = SysStatus::instance();
-    connect(&sys_status, SIGNAL(wakeup()), image_view, SLOT(onWakeUp()));
-    connect(image_view, SIGNAL(rotateScreen()), this, SLOT(onRotateScreen()));
+    if (!connected_)
+    {
+        SysStatus & sys_status = SysStatus::instance();
+        connect(&sys_status, SIGNAL(wakeup()), image_view, SLOT(onWakeUp()));
+        connect(image_view, SIGNAL(rotateScreen()), this, SLOT(onRotateScreen()));
+    }
     return image_view;
 }
 
 bool ImageApplication::open(const QString & path)
 {
+    if (pooled_)
+    {
+        if (!model_.initPath().isEmpty())
+        {
+            // the pooled reader is asked to open another image
+            model_.save();
+            model_.close();
+        }
+        path_ = path;
+    }
+
     main_window_.show();
     BaseView *view = 0;
     QString data_path = path_;
@@ -178,19 +206,25 @@ bool ImageApplication::open(const QString & path)
         return false;
     }
 
-    // connect the signals with sys_state_
-    SysStatus & sys_status = SysStatus::instance();
-    connect( &sys_status, SIGNAL( sdCardChangedSignal( bool ) ), this, SLOT( onSDCardChangedSignal( bool ) ) );
-    connect( &sys_status, SIGNAL( aboutToShutdown() ), this, SLOT( onAboutToShutDown() ) );
-    connect( &sys_status, SIGNAL( wakeup() ), this, SLOT( onWakeUp() ) );
+    if (!connected_)
+    {
+        connected_ = true;
+
+        // connect the signals with sys_state_
+        SysStatus & sys_status = SysStatus::instance();
+        connect( &sys_status, SIGNAL( sdCardChangedSignal( bool ) ), this, SLOT( onSDCardChangedSignal( bool ) ) );
+        connect( &sys_status, SIGNAL( aboutToShutdown() ), this, SLOT( onAboutToShutDown() ) );
+        connect( &sys_status, SIGNAL( wakeup() ), this, SLOT( onWakeUp() ) );
 
 #ifdef Q_WS_QWS
-    connect(qApp->desktop(), SIGNAL(resized(int)), this, SLOT(onScreenSizeChanged(int)), Qt::QueuedConnection);
+        connect(qApp->desktop(), SIGNAL(resized(int)), this, SLOT(onScreenSizeChanged(int)), Qt::QueuedConnection);
 #endif
+    }
 
     view->attachModel(&model_);
     if (model_.open(data_path, path))
     {
+        emit documentOpened(path);
         return true;
     }
 
@@ -209,6 +243,17 @@ bool ImageApplication::close()
     return model_.close();
 }
 
+/// Release the image and go back to standby instead of exiting. The
+/// view is kept, so the next image opens with a warm process.
+void ImageApplication::park()
+{
+    model_.save();
+    model_.close();
+    main_window_.hide();
+    emit documentClosed(path_);
+    path_.clear();
+}
+
 bool ImageApplication::suspend()
 {
     // save all of the options for waking up
@@ -246,6 +291,7 @@ void ImageApplication::onUSBSignal(bool inserted)
 void ImageApplication::onAboutToShutDown()
 {
     qDebug("System is about to shut down");
+    pooled_ = false;
     model_.close();
     qApp->exit();
 }
@@ -18,6 +18,13 @@ public:
     ImageApplication(int argc, char** argv);
     virtual ~ImageApplication();
 
+    bool isPooled() { return pooled_; }
+    void park();
+
+Q_SIGNALS:
+    void documentOpened(const QString & path);
+    void documentClosed(const QString & path);
+
 public Q_SLOTS:
     bool open(const QString & path);
     bool close();
@@ -48,6 +55,8 @@ private:
     ImageModel      model_;        // image model instance
     QString         path_;         // path of the document
     ApplicationType app_type_;     // type of the application: image or notes
+    bool            pooled_;       // started by explorer in standby mode
+    bool            connected_;    // signals of view and system connected
 
     NO_COPY_AND_ASSIGN(ImageApplication);
 };
@@ -66,8 +75,13 @@ public:
             registerService("com.onyx.service.images");
         QDBusConnection::systemBus().
             registerObject("/com/onyx/object/images", app_);
+        setAutoRelaySignals(true);
     }
 
+Q_SIGNALS:
+    void documentOpened(const QString & path);
+    void documentClosed(const QString & path);
+
 public Q_SLOTS:
     bool open(const QString & path) { return app_->open(path); }
     bool close(const QString & path) { return app_->close(); }
@@ -0,0 +1,90 @@
+#include "image_decoder.h"
+
+#include <math.h>
+
+namespace image
+{
+
+QSize ImageDecoder::imageSize(const QString &path)
+{
+    QImageReader reader(path);
+    return reader.size();
+}
+
+bool ImageDecoder::decode(const QString &path,
+                          const QSize &size,
+                          QImage &result)
+{
+    QImageReader reader(path);
+    QSize source = reader.size();
+    if (size.isValid() && source.isValid() && size != source &&
+        reader.supportsOption(QImageIOHandler::ScaledSize))
+    {
+        reader.setScaledSize(size);
+    }
+
+    if (!reader.read(&result))
+    {
+        qWarning("Cannot decode %s: %s", qPrintable(path),
+                 qPrintable(reader.errorString()));
+        return false;
+    }
+
+    // The handler does not support scaling.
+    if (size.isValid() && result.size() != size)
+    {
+        result = result.scaled(size);
+    }
+    return true;
+}
+
+bool ImageDecoder::decodeRegion(const QString &path,
+                                const QSize &scaled_size,
+                                const QRect &region,
+                                QImage &result)
+{
+    QImageReader reader(path);
+    QSize source = reader.size();
+    if (!source.isValid() || scaled_size.isEmpty() || region.isEmpty())
+    {
+        return false;
+    }
+
+    // Map the region back to the source and round outwards, the rest is
+    // left to the scaling of the handler.
+    double sx = static_cast<double>(source.width()) / scaled_size.width();
+    double sy = static_cast<double>(source.height()) / scaled_size.height();
+    int left = static_cast<int>(floor(region.left() * sx));
+    int top = static_cast<int>(floor(region.top() * sy));
+    int right = static_cast<int>(ceil((region.right() + 1) * sx));
+    int bottom = static_cast<int>(ceil((region.bottom() + 1) * sy));
+    QRect clip = QRect(left, top, right - left, bottom - top) &
+                 QRect(QPoint(), source);
+    if (clip.isEmpty())
+    {
+        return false;
+    }
+
+    reader.setClipRect(clip);
+    reader.setScaledSize(region.size());
+    if (!reader.read(&result))
+    {
+        qWarning("Cannot decode region of %s: %s", qPrintable(path),
+                 qPrintable(reader.errorString()));
+        return false;
+    }
+    if (result.size() != region.size())
+    {
+        result = result.scaled(region.size());
+    }
+    return true;
+}
+
+bool ImageDecoder::canDecodeRegion(const QString &path)
+{
+    QImageReader reader(path);
+    return reader.supportsOption(QImageIOHandler::ClipRect) &&
+           reader.supportsOption(QImageIOHandler::ScaledSize);
+}
+
+}
@@ -0,0 +1,41 @@
+#ifndef IMAGE_DECODER_H_
+#define IMAGE_DECODER_H_
+
+#include "image_utils.h"
+
+namespace image
+{
+
+/// Decode images at the size they are displayed instead of decoding the
+/// full bitmap and scaling it afterwards. The scaling is done by the
+/// image handler where it is supported; the jpeg handler scales in the
+/// DCT domain, so a 20 megapixel photo never exists at full size in
+/// memory.
+class ImageDecoder
+{
+public:
+    /// Size of the image, only the header is read.
+    static QSize imageSize(const QString &path);
+
+    /// Decode the whole image scaled to size.
+    static bool decode(const QString &path,
+                       const QSize &size,
+                       QImage &result);
+
+    /// Decode the region of the image as if it was scaled to
+    /// scaled_size. Only the part of the file covering region is
+    /// decoded when the handler supports clipping.
+    static bool decodeRegion(const QString &path,
+                             const QSize &scaled_size,
+                             const QRect &region,
+                             QImage &result);
+
+    /// Whether decodeRegion can avoid decoding the whole image.
+    static bool canDecodeRegion(const QString &path);
+
+private:
+    ImageDecoder();
+};
+
+};
+#endif
@@ -6,6 +6,7 @@
 
 #include "floyd_steinberg_grayscale.h"
 #include "floyd_steinberg_dithering.h"
+#include "image_decoder.h"
 #include "image_model.h"
 #include "image_global_settings.h"
 #include "image_render_policy.h"
@@ -15,6 +16,12 @@ namespace image
 {
 
 static const double RELOAD_THRESHOLD = 2.0f;
+
+/// Images rendered larger than this are decoded tile by tile.
+static const int MAX_DECODE_PIXELS = 2048 * 2048;
+static const int TILE_SIZE = 512;
+static const int TILE_CACHE_SIZE = 12 * 1024 * 1024;
+static const int PREVIEW_SIZE = 800;
 scoped_ptr<DitheringStrategy> ImageItem::dithering_strategy_;
 
 unsigned int tryCalcImageLength(const int width,
@@ -67,6 +74,10 @@ ImageItem::ImageItem(const ImageKey &k)
     , file_size_(0)
     , render_status_(IMAGE_STATUS_WAIT)
     , data_(0)
+    , tiled_(false)
+    , tiles_(TILE_CACHE_SIZE)
+    , requested_tiles_()
+    , tile_generation_(0)
     , dirty_(false)
 {
     if (dithering_strategy_ == 0)
@@ -85,13 +96,16 @@ int ImageItem::length()
     if (renderStatus() == IMAGE_STATUS_DONE)
     {
         assert(data_);
-        return data_->numBytes();
+        QMutexLocker locker(&tiles_mutex_);
+        return data_->numBytes() + tiles_.totalCost();
     }
     return 0;
 }
 
 void ImageItem::setRenderSetting(const RenderSetting &setting)
 {
+    // the view takes the setting of a tile request under the same lock
+    QMutexLocker locker(&tiles_mutex_);
     renderSetting() = setting;
 }
 
@@ -127,12 +141,13 @@ void ImageItem::saveAccessRecord(ImageModel *model)
     }
 }
 
+/// Reload the image information. Only the header of an image file is
+/// read here, the bitmap is decoded by render() at the rendered size.
 bool ImageItem::reload()
 {
     // destroy the old image instance
     clearPage();
 
-    //qDebug("Begin Load Image %s!\n", name().toStdString().c_str());
     // Reconstruct the image by key
     if (name() == EMPTY_BACKGROUND)
     {
@@ -141,22 +156,22 @@ bool ImageItem::reload()
                                QImage::Format_ARGB32));
         QColor white(255, 255, 255);
         data_->fill(white.rgba());
+        actualSize() = data_->size();
     }
     else
     {
-        data_.reset(new QImage(name()));
+        actualSize() = ImageDecoder::imageSize(name());
     }
-    //qDebug("End Load Image! %s\n", name().toStdString().c_str());
 
-    if (data_->isNull())
+    if (!actualSize().isValid())
     {
         // if the image is broken, display the warning map
-        data_->load(":/images/invalid.png");
+        data_.reset(new QImage(":/images/invalid.png"));
+        actualSize() = data_->size();
     }
 
     private_info_.reset();
     dirty_    = false;
-    actualSize() = data_->size();
 
     // reset the render setting
     // TODO. Use default rotation value
@@ -171,6 +186,8 @@ void ImageItem::clearPage()
 {
     setRenderStatus(IMAGE_STATUS_WAIT);
     data_.reset();
+    clearTiles();
+    tiled_ = false;
 }
 
 bool ImageItem::needReload(const RenderSetting &setting)
@@ -181,6 +198,18 @@ bool ImageItem::needReload(const RenderSetting &setting)
         return true;
     }
 
+    // the tiles depend on every render setting
+    if (tiled_ && !(setting == renderSetting()))
+    {
+        return true;
+    }
+
+    // too large to be scaled in memory, decode it by tiles
+    if (setting.contentArea().width() * setting.contentArea().height() > MAX_DECODE_PIXELS)
+    {
+        return !(setting == renderSetting());
+    }
+
     // check wether current image is dirty or not
     if (dirty_)
     {
@@ -216,17 +245,32 @@ ImageStatus ImageItem::renderThumbnail(const QRect &bounding_rect,
         }
     }
 
-    // if there is no data being loaded, reload the image
-    scoped_ptr<QImage> cur_data;
+    // if there is no data being loaded, read the image size
     if (data_ == 0)
     {
         reload();
     }
-    cur_data.reset(new QImage(*data_));
 
     if (!display_area.isValid())
     {
-        getThumbnailRectangle(bounding_rect, cur_data->size(), &display_area);
+        QSize size = (data_ != 0 && !tiled_) ? data_->size() : actualSize();
+        getThumbnailRectangle(bounding_rect, size, &display_area);
+    }
+
+    // Use the rendered data when there is any, otherwise decode the
+    // image at the size of the thumbnail.
+    scoped_ptr<QImage> cur_data;
+    if (data_ != 0 && !tiled_)
+    {
+        cur_data.reset(new QImage(*data_));
+    }
+    else
+    {
+        cur_data.reset(new QImage);
+        if (!decode(display_area.size(), *cur_data))
+        {
+            return IMAGE_STATUS_FAIL;
+        }
     }
 
     if (model->getThumbsMgr().makeEnoughMemory(tryCalcImageLength(
@@ -279,11 +323,13 @@ ImageStatus ImageItem::render(const RenderSetting &setting, ImageModel *model)
     setRenderStatus(IMAGE_STATUS_WAIT);
     qDebug("Render Image:%s!!! \n", name().toStdString().c_str());
 
+    // a tiled image never needs more than the tile cache
+    unsigned int length = tryCalcImageLength(setting.contentArea().width(),
+                                             setting.contentArea().height(),
+                                             QImage::Format_Indexed8);
+    length = qMin(length, static_cast<unsigned int>(TILE_CACHE_SIZE));
     if (!(renderSetting() == setting) &&
-        !model->getImagesMgr().makeEnoughMemory(tryCalcImageLength(
-                                                setting.contentArea().width(),
-                                                setting.contentArea().height(),
-                                                QImage::Format_Indexed8),
+        !model->getImagesMgr().makeEnoughMemory(length,
                                                 name(),
                                                 model->renderPolicy()))
     {
@@ -301,7 +347,15 @@ ImageStatus ImageItem::render(const RenderSetting &setting, ImageModel *model)
 
     if (data_ == 0)
     {
-        setRenderStatus(IMAGE_STATUS_ABORT);
+        // nothing decoded yet, decode at the wanted size
+        if (!load(setting))
+        {
+            setRenderStatus(IMAGE_STATUS_ABORT);
+            return renderStatus();
+        }
+        quantize();
+        setRenderSetting(setting);
+        setRenderStatus(IMAGE_STATUS_DONE);
         return renderStatus();
     }
 
@@ -339,9 +393,260 @@ ImageStatus ImageItem::render(const RenderSetting &setting, ImageModel *model)
     return renderStatus();
 }
 
+/// Decode the image at the size of setting. When that is too large, only
+/// a preview is decoded and the view draws the image with drawTiles().
+bool ImageItem::load(const RenderSetting &setting)
+{
+    // the image is decoded unrotated and rotated afterwards
+    QSize size = setting.contentArea().size();
+    int orient = getRealOrientation(setting.rotation());
+    if (orient == 90 || orient == 270)
+    {
+        size.transpose();
+    }
+
+    QImage image;
+    bool tiled = (size.width() * size.height() > MAX_DECODE_PIXELS &&
+                  ImageDecoder::canDecodeRegion(name()));
+    if (tiled)
+    {
+        QSize preview = size;
+        preview.scale(PREVIEW_SIZE, PREVIEW_SIZE, Qt::KeepAspectRatio);
+        if (!decode(preview, image))
+        {
+            return false;
+        }
+    }
+    else if (!decode(size, image))
+    {
+        return false;
+    }
+
+    resetData(image);
+    clearTiles();
+    tiled_ = tiled;
+    private_info_.reset();
+    dirty_ = (!tiled_ && size.width() * size.height() <
+              actualSize().width() * actualSize().height());
+    if (orient != 0)
+    {
+        rotate(setting.rotation());
+    }
+    return true;
+}
+
+bool ImageItem::decode(const QSize &size, QImage &result)
+{
+    if (name() == EMPTY_BACKGROUND)
+    {
+        result = QImage(size, QImage::Format_ARGB32);
+        result.fill(QColor(255, 255, 255).rgba());
+        return true;
+    }
+    if (!ImageDecoder::decode(name(), size, result))
+    {
+        // if the image is broken, display the warning map
+        result = QImage(":/images/invalid.png").scaled(size);
+    }
+    return !result.isNull();
+}
+
+QRect ImageItem::tileRect(const RenderSetting &setting, int row, int column)
+{
+    return QRect(column * TILE_SIZE, row * TILE_SIZE, TILE_SIZE, TILE_SIZE) &
+           QRect(QPoint(), setting.contentArea().size());
+}
+
+/// \param pos The position of the image in the painter.
+/// \param visible The visible part of the painter.
+/// \return The part of the image whose tiles are not decoded yet, in
+/// image coordinates. It is drawn from the preview until decodeTiles()
+/// has run.
+QRect ImageItem::drawTiles(QPainter &painter, const QPoint &pos, const QRect &visible)
+{
+    RenderSetting setting;
+    {
+        QMutexLocker locker(&tiles_mutex_);
+        setting = renderSetting();
+    }
+    const QSize &display = setting.contentArea().size();
+    QRect area = visible.translated(-pos) & QRect(QPoint(), display);
+    QRect missing;
+    if (area.isEmpty())
+    {
+        return missing;
+    }
+
+    for (int row = area.top() / TILE_SIZE; row <= area.bottom() / TILE_SIZE; ++row)
+    {
+        for (int column = area.left() / TILE_SIZE; column <= area.right() / TILE_SIZE; ++column)
+        {
+            QRect rect = tileRect(setting, row, column);
+            QImage image;
+            {
+                // copy the tile, the task thread may evict it meanwhile
+                QMutexLocker locker(&tiles_mutex_);
+                QImage *cached = tiles_.object(TileKey(setting, row, column));
+                if (cached != 0)
+                {
+                    image = *cached;
+                }
+            }
+
+            if (!image.isNull())
+            {
+                painter.drawImage(pos + rect.topLeft(), image);
+            }
+            else
+            {
+                missing |= rect;
+                if (data_ != 0 && !display.isEmpty())
+                {
+                    double sx = static_cast<double>(data_->width()) / display.width();
+                    double sy = static_cast<double>(data_->height()) / display.height();
+                    QRectF source(rect.left() * sx, rect.top() * sy,
+                                  rect.width() * sx, rect.height() * sy);
+                    painter.drawImage(QRectF(pos + rect.topLeft(), rect.size()), *data_, source);
+                }
+            }
+        }
+    }
+    return missing;
+}
+
+/// Ask for the tiles of area to be decoded. Returns false when a
+/// pending request covers them already. Otherwise request is filled in
+/// with the current setting and has to be passed to decodeTiles() or
+/// cancelTiles().
+bool ImageItem::requestTiles(const QRect &area, TileRequest &request)
+{
+    QMutexLocker locker(&tiles_mutex_);
+    for (int i = 0; i < requested_tiles_.size(); ++i)
+    {
+        const TileRequest &pending = requested_tiles_.at(i);
+        if (pending.generation == tile_generation_ &&
+            pending.setting == renderSetting() &&
+            pending.area.contains(area))
+        {
+            return false;
+        }
+    }
+    request.area = area;
+    request.setting = renderSetting();
+    request.generation = tile_generation_;
+    requested_tiles_.append(request);
+    return true;
+}
+
+/// Drop a request that is not going to be decoded, so its tiles can be
+/// requested again.
+void ImageItem::cancelTiles(const TileRequest &request)
+{
+    QMutexLocker locker(&tiles_mutex_);
+    requested_tiles_.removeOne(request);
+}
+
+/// Decode the missing tiles covering the area of request. They are
+/// decoded as one region, so the file is opened and decoded once for all
+/// of them instead of once per tile. Runs on the task thread, so only the
+/// setting of the request is used. Tiles cleared meanwhile are not filled
+/// with the outdated result.
+bool ImageItem::decodeTiles(const TileRequest &request)
+{
+    const RenderSetting &setting = request.setting;
+    const QSize display = setting.contentArea().size();
+    QRect clipped = request.area & QRect(QPoint(), display);
+    QRect region;
+    {
+        QMutexLocker locker(&tiles_mutex_);
+        if (tiled_ && request.generation == tile_generation_ && !clipped.isEmpty())
+        {
+            for (int row = clipped.top() / TILE_SIZE; row <= clipped.bottom() / TILE_SIZE; ++row)
+            {
+                for (int column = clipped.left() / TILE_SIZE; column <= clipped.right() / TILE_SIZE; ++column)
+                {
+                    if (!tiles_.contains(TileKey(setting, row, column)))
+                    {
+                        region |= tileRect(setting, row, column);
+                    }
+                }
+            }
+        }
+        if (region.isEmpty())
+        {
+            requested_tiles_.removeOne(request);
+            return false;
+        }
+    }
+
+    // map the region back to the unrotated image, decode it there and
+    // rotate the result
+    int orient = getRealOrientation(setting.rotation());
+    QSize size = display;
+    if (orient == 90 || orient == 270)
+    {
+        size.transpose();
+    }
+    QMatrix matrix;
+    matrix.rotate(static_cast<qreal>(orient));
+    QMatrix to_display = QImage::trueMatrix(matrix, size.width(), size.height());
+
+    QImage result;
+    bool ok = ImageDecoder::decodeRegion(name(), size, to_display.inverted().mapRect(region), result);
+    if (ok)
+    {
+        if (orient != 0)
+        {
+            result = result.transformed(matrix);
+        }
+
+        // dither the region as a whole, so there are no seams at the
+        // tile borders
+        ImageGlobalSettings &settings = ImageGlobalSettings::instance();
+        if (settings.needConvert())
+        {
+            result = result.convertToFormat(settings.convertFormat());
+        }
+        if (settings.needDither())
+        {
+            dithering_strategy_->dither(&result);
+        }
+    }
+
+    QMutexLocker locker(&tiles_mutex_);
+    requested_tiles_.removeOne(request);
+    if (!ok || request.generation != tile_generation_)
+    {
+        return false;
+    }
+    for (int row = region.top() / TILE_SIZE; row <= region.bottom() / TILE_SIZE; ++row)
+    {
+        for (int column = region.left() / TILE_SIZE; column <= region.right() / TILE_SIZE; ++column)
+        {
+            TileKey key(setting, row, column);
+            if (!tiles_.contains(key))
+            {
+                QImage *image = new QImage(result.copy(tileRect(setting, row, column).translated(-region.topLeft())));
+                tiles_.insert(key, image, image->numBytes());
+            }
+        }
+    }
+    return true;
+}
+
+/// Drop the tiles and the pending requests. Requests being decoded
+/// belong to an older generation then and their results are discarded.
+void ImageItem::clearTiles()
+{
+    QMutexLocker locker(&tiles_mutex_);
+    tiles_.clear();
+    requested_tiles_.clear();
+    ++tile_generation_;
+}
+
 void ImageItem::resetData(const QImage &new_data)
 {
-    clearPage();
+    setRenderStatus(IMAGE_STATUS_WAIT);
     data_.reset(new QImage(new_data));
 }
 
@@ -110,6 +110,54 @@ struct ConfigData
         , conf() {}
 };
 
+/// Key of a decoded tile. The tiles depend on the whole render setting,
+/// so a tile decoded for another setting never matches.
+struct TileKey
+{
+    QSize size;
+    int   rotation;
+    int   row;
+    int   column;
+
+    TileKey(const RenderSetting &setting, int r, int c)
+        : size(setting.contentArea().size())
+        , rotation(setting.rotation())
+        , row(r)
+        , column(c) {}
+
+    bool operator==(const TileKey &right) const
+    {
+        return (size == right.size && rotation == right.rotation &&
+                row == right.row && column == right.column);
+    }
+};
+
+inline uint qHash(const TileKey &key)
+{
+    return ((key.row * 31 + key.column) * 31 + key.size.width()) * 31 +
+           key.size.height() + key.rotation;
+}
+
+/// A part of a tiled image queued for decoding. It keeps the render
+/// setting and the tile generation of the time it was requested, the
+/// task thread must not read the current ones.
+struct TileRequest
+{
+    QRect         area;
+    RenderSetting setting;
+    int           generation;
+
+    TileRequest()
+        : area()
+        , setting()
+        , generation(0) {}
+
+    bool operator==(const TileRequest &right) const
+    {
+        return (area == right.area && generation == right.generation);
+    }
+};
+
 
 class ImageModel;
 class DitheringStrategy;
@@ -142,9 +190,17 @@ public:
                                 shared_ptr<ImageThumbnail> thumbnail,
                                 ImageModel *model);
 
-    /// Get data
+    /// Get data. For a tiled image it is a small preview.
     const QImage* image() const { return data_.get(); }
 
+    /// A tiled image is too large to be kept in memory at the rendered
+    /// size. Only the tiles that are drawn are decoded, by a task.
+    bool tiled() const { return tiled_; }
+    QRect drawTiles(QPainter &painter, const QPoint &pos, const QRect &visible);
+    bool requestTiles(const QRect &area, TileRequest &request);
+    void cancelTiles(const TileRequest &request);
+    bool decodeTiles(const TileRequest &request);
+
     /// Get some private data
     bool dithered() const { return private_info_.dithered; }
     bool converted() const { return private_info_.converted; }
@@ -207,6 +263,14 @@ private:
     // quantize the image
     void quantize();
 
+    // decode the image at the rendered size
+    bool load(const RenderSetting &setting);
+    bool decode(const QSize &size, QImage &result);
+
+    // tiles of a tiled image
+    static QRect tileRect(const RenderSetting &setting, int row, int column);
+    void clearTiles();
+
 private:
     RenderSetting       render_setting_; ///< render setting
     PrivateInfo         private_info_;   ///< private information
@@ -217,6 +281,11 @@ private:
     unsigned int        file_size_;      ///< size of the file
     ImageStatus         render_status_;  ///< status of rendering
     scoped_ptr<QImage>  data_;           ///< instance of the QImage
+    bool                tiled_;          ///< only tiles are decoded
+    QCache<TileKey, QImage> tiles_;      ///< decoded tiles of a tiled image
+    QList<TileRequest>  requested_tiles_; ///< requests queued for decoding
+    int                 tile_generation_; ///< bumped when the tiles are cleared
+    QMutex              tiles_mutex_;    ///< tiles are decoded by the task thread
 
     /// The current image is dirty of not
     /// if current image is "dirty"(scaled size is smaller than the actual size),
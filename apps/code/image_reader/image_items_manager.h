@@ -4,6 +4,7 @@
 #include <QHash>
 
 #include "onyx/sys/sys_utils.h"
+#include "onyx/sys/memory_broker.h"
 
 #include "image_item.h"
 #include "image_render_policy.h"
@@ -15,6 +16,9 @@ namespace image
 
 static const unsigned int DEFAULT_MEM_LIMITATION = 15 * 1024 * 1024;
 
+template <typename KeyType, typename ValueType>
+class ItemsMemoryClient;
+
 template <typename KeyType, typename ValueType>
 class ItemsManager
 {
@@ -22,7 +26,7 @@ public:
     typedef QHash<KeyType, shared_ptr<ValueType> > CacheMap;
 
 public:
-    ItemsManager();
+    explicit ItemsManager(const QString & name = QString("images"), int priority = 10);
     virtual ~ItemsManager();
 
     inline void setMemoryLimit(const unsigned int bytes) { mem_limit_bytes_ = bytes; }
@@ -41,7 +45,15 @@ public:
 
     void clear();
 
+    // Called by the memory broker through ItemsMemoryClient
+    unsigned long memoryUsage();
+    int releaseCost();
+    unsigned long releaseMemory();
+
 private:
+    typename CacheMap::iterator findImageToRemove(const KeyType * key,
+                                                  vbf::RenderPolicy *render_policy);
+
     /// Remove an image
     bool removeImageData(const KeyType & key,
                          vbf::RenderPolicy *render_policy);
@@ -55,19 +67,57 @@ private:
     CacheMap images_;
     unsigned int mem_limit_bytes_;
     int used_mem_bytes_;
+
+    // Registered with the memory broker on the first reservation, so
+    // managers of items without image data never need the broker.
+    QString name_;
+    int priority_;
+    sys::MemoryClient *memory_client_;
+
+    // the image being rendered and the policy of the last reservation
+    const KeyType *reserved_key_;
+    vbf::RenderPolicy *render_policy_;
+};
+
+/// Forwards the calls of the memory broker to an ItemsManager.
+template <typename KeyType, typename ValueType>
+class ItemsMemoryClient : public sys::MemoryClient
+{
+public:
+    explicit ItemsMemoryClient(ItemsManager<KeyType,ValueType> & manager)
+      : manager_(manager)
+    {
+    }
+
+    unsigned long memoryUsage() { return manager_.memoryUsage(); }
+    int releaseCost() { return manager_.releaseCost(); }
+    unsigned long releaseMemory() { return manager_.releaseMemory(); }
+
+private:
+    ItemsManager<KeyType,ValueType> & manager_;
 };
 
 template <typename KeyType, typename ValueType>
-ItemsManager<KeyType,ValueType>::ItemsManager()
+ItemsManager<KeyType,ValueType>::ItemsManager(const QString & name, int priority)
   : images_()
   , mem_limit_bytes_(DEFAULT_MEM_LIMITATION)
   , used_mem_bytes_(0)
+  , name_(name)
+  , priority_(priority)
+  , memory_client_(0)
+  , reserved_key_(0)
+  , render_policy_(0)
 {
 }
 
 template <typename KeyType, typename ValueType>
 ItemsManager<KeyType,ValueType>::~ItemsManager()
 {
+    if (memory_client_)
+    {
+        sys::MemoryBroker::instance().unregisterClient(memory_client_);
+        delete memory_client_;
+    }
     clear();
 }
 
@@ -77,8 +127,16 @@ shared_ptr<ValueType> ItemsManager<KeyType,ValueType>::getImage(const KeyType &
     typename CacheMap::iterator iter = images_.find(key);
     if (iter != images_.end())
     {
+        if (memory_client_)
+        {
+            sys::MemoryBroker::instance().recordHit(memory_client_);
+        }
         return iter.value();
     }
+    if (memory_client_)
+    {
+        sys::MemoryBroker::instance().recordMiss(memory_client_);
+    }
     return shared_ptr<ValueType>();
 }
 
@@ -138,17 +196,63 @@ bool ItemsManager<KeyType,ValueType>::makeEnoughMemory(const unsigned int dm,
     }
     else
     {
-        while (sys::systemFreeMemory() < DEFAULT_MEM_LIMITATION)
+        if (memory_client_ == 0)
         {
-            if (!removeImageData(key, render_policy))
-            {
-                return false;
-            }
+            memory_client_ = new ItemsMemoryClient<KeyType,ValueType>(*this);
+            sys::MemoryBroker::instance().registerClient(memory_client_, name_, priority_);
         }
+        reserved_key_ = &key;
+        render_policy_ = render_policy;
+        bool ret = sys::MemoryBroker::instance().reserve(memory_client_, dm);
+        reserved_key_ = 0;
+        return ret;
     }
     return true;
 }
 
+template <typename KeyType, typename ValueType>
+unsigned long ItemsManager<KeyType,ValueType>::memoryUsage()
+{
+    recalcTotalLength();
+    return used_mem_bytes_;
+}
+
+/// Images out of the render requests cost nothing, the current image most
+template <typename KeyType, typename ValueType>
+int ItemsManager<KeyType,ValueType>::releaseCost()
+{
+    if (render_policy_ == 0)
+    {
+        return -1;
+    }
+    typename CacheMap::iterator iter = findImageToRemove(reserved_key_, render_policy_);
+    if (iter == images_.end())
+    {
+        return -1;
+    }
+    int priority = render_policy_->getPriority(iter.value()->index());
+    return sys::MIN_RENDER_PRIORITY - qMin(priority, sys::MIN_RENDER_PRIORITY);
+}
+
+template <typename KeyType, typename ValueType>
+unsigned long ItemsManager<KeyType,ValueType>::releaseMemory()
+{
+    if (render_policy_ == 0)
+    {
+        return 0;
+    }
+    typename CacheMap::iterator iter = findImageToRemove(reserved_key_, render_policy_);
+    if (iter == images_.end())
+    {
+        return 0;
+    }
+
+    unsigned long length = iter.value()->length();
+    used_mem_bytes_ -= length;
+    iter.value()->clearPage();
+    return length;
+}
+
 template <typename KeyType, typename ValueType>
 void ItemsManager<KeyType,ValueType>::recalcTotalLength()
 {
@@ -166,13 +270,20 @@ void ItemsManager<KeyType,ValueType>::recalcTotalLength()
     }
 }
 
+/// Find the image to remove first, which is not the image of key. The
+/// image of key is only kept when key is given.
 template <typename KeyType, typename ValueType>
-bool ItemsManager<KeyType,ValueType>::removeImageData(const KeyType & key,
-                                                      vbf::RenderPolicy *render_policy)
+typename ItemsManager<KeyType,ValueType>::CacheMap::iterator
+ItemsManager<KeyType,ValueType>::findImageToRemove(const KeyType * key,
+                                                   vbf::RenderPolicy *render_policy)
 {
     // remove the out-of-date page based on the remove strategy
     typename CacheMap::iterator iter = images_.begin();
     typename CacheMap::iterator remove_iter = iter;
+    if (remove_iter == images_.end())
+    {
+        return images_.end();
+    }
 
     while(iter != images_.end())
     {
@@ -188,10 +299,15 @@ bool ItemsManager<KeyType,ValueType>::removeImageData(const KeyType & key,
 
     if (remove_iter.value()->locked() || remove_iter.value()->image() == 0)
     {
-        return false;
+        return images_.end();
     }
 
-    shared_ptr<ValueType> dst_imge = getImage(key);
+    if (key == 0)
+    {
+        return remove_iter;
+    }
+
+    shared_ptr<ValueType> dst_imge = images_.value(*key);
     assert(dst_imge.get());
     if (dst_imge == remove_iter.value() ||
         comparePriority(*remove_iter.value(),
@@ -200,6 +316,18 @@ bool ItemsManager<KeyType,ValueType>::removeImageData(const KeyType & key,
     {
         // if the priority of removing page is higher than destination
         // page, return
+        return images_.end();
+    }
+    return remove_iter;
+}
+
+template <typename KeyType, typename ValueType>
+bool ItemsManager<KeyType,ValueType>::removeImageData(const KeyType & key,
+                                                      vbf::RenderPolicy *render_policy)
+{
+    typename CacheMap::iterator remove_iter = findImageToRemove(&key, render_policy);
+    if (remove_iter == images_.end())
+    {
         return false;
     }
 
@@ -14,7 +14,9 @@ static const unsigned int IMAGE_SIZE_LIMIT = 20 * 1024 * 1024;
 static const unsigned int THUMB_SIZE_LIMIT = 10 * 1024 * 1024;
 
 ImageModel::ImageModel(void)
-  : render_policy_(new ImageRenderPolicy())
+  : images_mgr_("images", 10)
+  , thumbs_mgr_("thumbnails", 5)
+  , render_policy_(new ImageRenderPolicy())
   , current_idx_(0)
   , image_count_(0)
 {
@@ -336,4 +338,10 @@ void ImageModel::onThumbnailReady(shared_ptr<ImageThumbnail> thumb,
     emit renderingThumbnailReadySignal(thumb, bounding_rect);
 }
 
+/// Handle the event of tiles ready
+void ImageModel::onTilesReady(shared_ptr<ImageItem> image)
+{
+    emit renderingTilesReadySignal(image);
+}
+
 }
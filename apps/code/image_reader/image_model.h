@@ -64,6 +64,7 @@ public:
 public Q_SLOTS:
     void onImageReady(shared_ptr<ImageItem> image, ImageStatus status, bool notify = false);
     void onThumbnailReady(shared_ptr<ImageThumbnail> thumb, const QRect& bounding_rect);
+    void onTilesReady(shared_ptr<ImageItem> image);
     void onSaveModelOptions();
 
 Q_SIGNALS:
@@ -86,6 +87,9 @@ Q_SIGNALS:
     void renderingThumbnailReadySignal(shared_ptr<BaseThumbnail> thumb,
                                        const QRect &bounding_rect);
 
+    /// tiles of a tiled image are decoded
+    void renderingTilesReadySignal(shared_ptr<ImageItem> image);
+
 private:
     typedef QVector<ImageKey> Entries;
     typedef Entries::iterator EntriesIter;
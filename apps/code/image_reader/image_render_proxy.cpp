@@ -191,6 +191,17 @@ void ImageRenderProxy::prerenderImage(const int idx,
     }
 }
 
+void ImageRenderProxy::renderTiles(shared_ptr<ImageItem> image,
+                                   const TileRequest &request,
+                                   ImageModel *model)
+{
+    assert(model != 0);
+
+    // prepending would drop the other queued tasks, append it
+    TileRenderTask *task = new TileRenderTask(image, request, model);
+    ImageTasksHandler::instance().addTask(task, true);
+}
+
 void ImageRenderProxy::updateRenderSetting(const RenderSetting &setting)
 {
     render_setting_ = setting;
@@ -249,6 +260,28 @@ bool RenderTask::isRenderingValid()
     return false;
 }
 
+// implementation of tile render task------------------------------------------
+void TileRenderTask::exec()
+{
+    assert(model_ != 0);
+    fromImageStatus(IMAGE_STATUS_RUNNING);
+    if (image_->decodeTiles(request_))
+    {
+        model_->onTilesReady(image_);
+    }
+    done_ = true;
+    fromImageStatus(IMAGE_STATUS_DONE);
+}
+
+TileRenderTask::~TileRenderTask()
+{
+    // a dropped task must not block new requests for its tiles
+    if (!done_)
+    {
+        image_->cancelTiles(request_);
+    }
+}
+
 // implementation of thumbnail render task-------------------------------------
 ThumbnailRenderTask::ThumbnailRenderTask(const QRect& rect,
                                          const QRect& bounding_rect,
@@ -45,6 +45,11 @@ public:
                         const RenderSetting &setting,
                         ImageModel *model);
 
+    /// Decode the tiles of a tiled image covering area
+    void renderTiles(shared_ptr<ImageItem> image,
+                     const TileRequest &request,
+                     ImageModel *model);
+
 private:
     /// global render setting
     RenderSetting render_setting_;
@@ -122,6 +127,31 @@ private:
     NO_COPY_AND_ASSIGN(ThumbnailRenderTask);
 };
 
+/// @brief Decodes the missing tiles of a tiled image
+class TileRenderTask : public BaseTask
+{
+public:
+    TileRenderTask(shared_ptr<ImageItem> image,
+                   const TileRequest &request,
+                   ImageModel *model)
+        : image_(image)
+        , request_(request)
+        , model_(model)
+        , done_(false)
+    {}
+    virtual ~TileRenderTask();
+
+    void exec();
+
+private:
+    shared_ptr<ImageItem> image_;
+    TileRequest request_;
+    ImageModel *model_;
+    bool     done_;
+
+    NO_COPY_AND_ASSIGN(TileRenderTask);
+};
+
 };
 
 #endif
@@ -471,6 +471,8 @@ void ImageView::attachModel(BaseModel * model)
             this, SLOT(onImageReady(shared_ptr<ImageItem>, ImageStatus, bool)));
     connect(model_, SIGNAL(renderingThumbnailReadySignal(shared_ptr<BaseThumbnail>, const QRect&)),
             this, SLOT(onThumbnailReady(shared_ptr<BaseThumbnail>, const QRect&)));
+    connect(model_, SIGNAL(renderingTilesReadySignal(shared_ptr<ImageItem>)),
+            this, SLOT(onTilesReady(shared_ptr<ImageItem>)));
     connect(model_, SIGNAL(requestSaveAllOptions()),
             this, SLOT(onSaveViewOptions()));
 }
@@ -483,6 +485,8 @@ void ImageView::deattachModel()
                this, SLOT(onImageReady(shared_ptr<ImageItem>, ImageStatus, bool)));
     disconnect(model_, SIGNAL(renderingThumbnailReadySignal(shared_ptr<BaseThumbnail>, const QRect&)),
                this, SLOT(onThumbnailReady(shared_ptr<BaseThumbnail>, const QRect&)));
+    disconnect(model_, SIGNAL(renderingTilesReadySignal(shared_ptr<ImageItem>)),
+               this, SLOT(onTilesReady(shared_ptr<ImageItem>)));
     disconnect(model_, SIGNAL(requestSaveAllOptions()),
                this, SLOT(onSaveViewOptions()));
 }
@@ -693,7 +697,20 @@ void ImageView::paintImage(QPainter &painter, shared_ptr<ImageItem> image)
     if (layout_->getContentPos(image->index(), cur_pos))
     {
         // draw content of page
-        painter.drawImage(cur_pos, *(image->image()));
+        if (image->tiled())
+        {
+            // the preview stands in for the tiles that are not decoded yet
+            QRect missing = image->drawTiles(painter, cur_pos, rect());
+            TileRequest request;
+            if (!missing.isEmpty() && image->requestTiles(missing, request))
+            {
+                render_proxy_.renderTiles(image, request, model_);
+            }
+        }
+        else
+        {
+            painter.drawImage(cur_pos, *(image->image()));
+        }
     }
     paintSketches(painter, image);
 }
@@ -1003,6 +1020,19 @@ void ImageView::onImageReady(shared_ptr<ImageItem> image, ImageStatus status, bo
     }
 }
 
+void ImageView::onTilesReady(shared_ptr<ImageItem> image)
+{
+    for (int i = 0; i < static_cast<int>(display_images_.size()); ++i)
+    {
+        if (display_images_.getImage(i) == image)
+        {
+            update();
+            onyx::screen::instance().flush(this, onyx::screen::ScreenProxy::GU);
+            return;
+        }
+    }
+}
+
 void ImageView::onLayoutDone()
 {
     // clear the previous visible pages
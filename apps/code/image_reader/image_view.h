@@ -73,6 +73,7 @@ private Q_SLOTS:
     void onNeedPage(const int page_number);
     void onNeedThumbnail(const int image_idx, const QRect &rect);
     void onThumbnailReady(shared_ptr<BaseThumbnail> thumb, const QRect &bounding_rect);
+    void onTilesReady(shared_ptr<ImageItem> image);
     void onThumbnailClear();
     void onThumbnailReturn(const int image_idx);
     void onNeedContentArea(const int page_number);
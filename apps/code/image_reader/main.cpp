@@ -12,6 +12,18 @@ int main(int argc,char **argv)
     Q_INIT_RESOURCE(images);
     Q_INIT_RESOURCE(onyx_ui_images);
     sys::SysStatus::instance().setSystemBusy( false );
-    return app.exec();
+
+    // Every time the user leaves a pooled reader, the event loop returns.
+    // Park the reader until explorer sends the next image.
+    int ret = 0;
+    do
+    {
+        ret = app.exec();
+        if (app.isPooled())
+        {
+            app.park();
+        }
+    } while (ret == 0 && app.isPooled());
+    return ret;
 }
 
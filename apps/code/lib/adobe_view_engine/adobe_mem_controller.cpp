@@ -13,10 +13,12 @@ AdobeMemController::AdobeMemController(void)
     , size_limit_( SIZE_LIMITATION )
     , total_length_( 0 )
 {
+    sys::MemoryBroker::instance().registerClient( this, "adobe surfaces", 10 );
 }
 
 AdobeMemController::~AdobeMemController(void)
 {
+    sys::MemoryBroker::instance().unregisterClient( this );
     clear();
 }
 
@@ -41,8 +43,10 @@ AdobeSurfacePtr AdobeMemController::getSurface(const AdobeLocationPtr & loc)
     CacheIter iter = cache_.find( page_position );
     if (iter != cache_.end())
     {
+        sys::MemoryBroker::instance().recordHit( this );
         return iter.value();
     }
+    sys::MemoryBroker::instance().recordMiss( this );
     return AdobeSurfacePtr();
 }
 
@@ -56,9 +60,11 @@ AdobeSurfacePtr AdobeMemController::getSurface(const AdobeRenderConf & conf)
     {
         if ( (*iter)->renderConf() == conf )
         {
+            sys::MemoryBroker::instance().recordHit( this );
             return *iter;
         }
     }
+    sys::MemoryBroker::instance().recordMiss( this );
     return AdobeSurfacePtr();
 }
 
@@ -75,8 +81,8 @@ bool AdobeMemController::removeSurface( const AdobeSurfacePtr surf )
     return true;
 }
 
-/// Remove a surface for given location
-bool AdobeMemController::removeSurface( const AdobeLocationPtr & loc )
+/// Find the surface with lowest priority, which is not the surface of loc
+AdobeMemController::CacheIter AdobeMemController::findSurfaceToRemove( const AdobeLocationPtr & loc )
 {
     // remove the surface with lowest priority based on the remove strategy
     CacheIter begin       = cache_.begin();
@@ -98,13 +104,24 @@ bool AdobeMemController::removeSurface( const AdobeLocationPtr & loc )
 
     if ( remove_iter == cache_.end() )
     {
-        return false;
+        return cache_.end();
     }
 
-    AdobeSurfacePtr surface = getSurface( loc );
-    if ( surface != 0 && surface == remove_iter.value() )
+    CacheIter current = ( loc.get() != 0 ) ? cache_.find( loc->getBookmark() ) : end;
+    if ( current != end && current.value() == remove_iter.value() )
     {
         // if it is the same surface, return
+        return cache_.end();
+    }
+    return remove_iter;
+}
+
+/// Remove a surface for given location
+bool AdobeMemController::removeSurface( const AdobeLocationPtr & loc )
+{
+    CacheIter remove_iter = findSurfaceToRemove( loc );
+    if ( remove_iter == cache_.end() )
+    {
         return false;
     }
 
@@ -171,15 +188,42 @@ bool AdobeMemController::makeEnoughMemory( const int delta,
     }
     else
     {
-      while (sys::needReleaseMemory())
-        {
-            if ( !removeSurface( loc ) )
-            {
-                return false;
-            }
-        }
+        reserved_loc_ = loc;
+        bool ret = sys::MemoryBroker::instance().reserve( this, delta );
+        reserved_loc_.reset();
+        return ret;
     }
     return true;
 }
 
+unsigned long AdobeMemController::memoryUsage()
+{
+    recalcTotalLength();
+    return bytesConsume();
+}
+
+/// Pages out of the render requests cost nothing, the current page most
+int AdobeMemController::releaseCost()
+{
+    CacheIter iter = findSurfaceToRemove( reserved_loc_ );
+    if ( iter == cache_.end() )
+    {
+        return -1;
+    }
+    int page_number = static_cast<int>(iter.value()->renderConf().getPagePosition()->getPagePosition());
+    return sys::MIN_RENDER_PRIORITY - qMin( policy_.getPriority( page_number ), sys::MIN_RENDER_PRIORITY );
+}
+
+unsigned long AdobeMemController::releaseMemory()
+{
+    CacheIter iter = findSurfaceToRemove( reserved_loc_ );
+    if ( iter == cache_.end() )
+    {
+        return 0;
+    }
+    unsigned long length = iter.value()->length();
+    removeSurface( reserved_loc_ );
+    return length;
+}
+
 }
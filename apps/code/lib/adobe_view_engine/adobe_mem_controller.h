@@ -5,12 +5,14 @@
 #include "adobe_surface.h"
 #include "adobe_render_policy.h"
 
+#include "onyx/sys/memory_broker.h"
+
 using namespace vbf;
 
 namespace adobe_view
 {
 
-class AdobeMemController
+class AdobeMemController : public sys::MemoryClient
 {
 public:
     AdobeMemController();
@@ -28,15 +30,21 @@ public:
     bool makeEnoughMemory( const int delta,
                            const AdobeLocationPtr & loc );
 
-private:
-    void recalcTotalLength();
-    int  bytesConsume();
-    bool removeSurface( const AdobeLocationPtr & loc );
+    // sys::MemoryClient
+    unsigned long memoryUsage();
+    int releaseCost();
+    unsigned long releaseMemory();
 
 private:
     typedef QHash< QString, AdobeSurfacePtr > Cache;
     typedef Cache::iterator CacheIter;
 
+private:
+    void recalcTotalLength();
+    int  bytesConsume();
+    CacheIter findSurfaceToRemove( const AdobeLocationPtr & loc );
+    bool removeSurface( const AdobeLocationPtr & loc );
+
 private:
     Cache cache_;
 
@@ -46,6 +54,9 @@ private:
     // the memory cost of current cached pages
     int total_length_;
 
+    // the location being rendered, its surface is never removed
+    AdobeLocationPtr reserved_loc_;
+
     // render policy
     AdobeRenderPolicy policy_;
 };
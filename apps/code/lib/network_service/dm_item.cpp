@@ -61,6 +61,38 @@ QLabel                                  \
      color: black;                      \
  }";
 
+/// Received data is collected until this many bytes are pending and then
+/// written in multiples of WRITE_ALIGNMENT, which keeps the writes on the
+/// SD card large and block aligned instead of one per readyRead.
+static const int WRITE_BUFFER_SIZE = 256 * 1024;
+static const qint64 WRITE_ALIGNMENT = 4096;
+
+/// The partial download state is kept next to the output file.
+static const QString STATE_SUFFIX = ".dlstate";
+static const QString STATE_URL = "url";
+static const QString STATE_ETAG = "etag";
+static const QString STATE_LAST_MODIFIED = "last_modified";
+static const QString STATE_TOTAL = "total";
+static const QString STATE_RECEIVED = "received";
+
+static const char * ETAG = "ETag";
+static const char * LAST_MODIFIED = "Last-Modified";
+static const char * CONTENT_RANGE = "Content-Range";
+
+/// Parse "bytes start-end/total" of a Content-Range header. The total
+/// is -1 when the server reports it as "*".
+static bool parseContentRange(const QByteArray & value, qint64 & start, qint64 & total)
+{
+    QRegExp rx("bytes\\s+(\\d+)-(\\d+)/(\\d+|\\*)");
+    if (rx.indexIn(QString::fromLatin1(value)) < 0)
+    {
+        return false;
+    }
+    start = rx.cap(1).toLongLong();
+    total = (rx.cap(3) == "*") ? -1 : rx.cap(3).toLongLong();
+    return true;
+}
+
 /*!
     DownloadItem is a widget that is displayed in the download manager list.
     It moves the data from the QNetworkReply into the QFile as well
@@ -73,6 +105,9 @@ DownloadItem::DownloadItem(QNetworkReply *reply, bool request_file_name, QWidget
     , bytes_received_(0)
     , bytes_total_(0)
     , input_file_name_(file_name)
+    , resume_offset_(0)
+    , write_pos_(0)
+    , expected_total_(0)
     , hbox_(this)
     , download_info_(0)
     , file_name_(0)
@@ -110,7 +145,10 @@ void DownloadItem::init()
 
     // reset info
     download_info_.clear();
-    getFileName();
+    if (resume_offset_ <= 0)
+    {
+        getFileName();
+    }
 
     // start timer for the download estimation
     download_time_.start();
@@ -181,6 +219,7 @@ void DownloadItem::getFileName()
         }
     }
     output_.setFileName(file_name);
+    write_pos_ = 0;
     if (request_file_name_)
     {
         downloadReadyRead();
@@ -266,24 +305,187 @@ void DownloadItem::tryAgain()
         return;
     }
 
+    resume();
+    emit statusChanged();
+}
+
+/// Restart the download. When a partial file with a valid state exists,
+/// only the missing tail is requested. The If-Range validator makes the
+/// server send the whole entity again if it changed in the meantime.
+void DownloadItem::resume()
+{
+    if (output_.isOpen())
+    {
+        flushBuffer(true);
+        output_.close();
+    }
     try_again_btn_.setEnabled(false);
     try_again_btn_.setVisible(false);
     stop_btn_.setEnabled(true);
     stop_btn_.setVisible(true);
 
-    QNetworkReply *r = getAccessManagerInstance()->get(QNetworkRequest(url_));
-    if (reply_ != 0)
+    QNetworkRequest request(url_);
+    resume_offset_ = 0;
+    if (hasPartialData() && loadState())
     {
-        reply_->deleteLater();
+        resume_offset_ = write_pos_;
+        file_name_.setText(QFileInfo(output_).completeBaseName());
+        request.setRawHeader("Range", QString("bytes=%1-").arg(resume_offset_).toLatin1());
+        if (!etag_.isEmpty())
+        {
+            request.setRawHeader("If-Range", etag_);
+        }
+        else if (!last_modified_.isEmpty())
+        {
+            request.setRawHeader("If-Range", last_modified_);
+        }
+        qDebug() << "DownloadItem::resume" << url_ << "from" << resume_offset_;
     }
+    else
+    {
+        if (output_.exists())
+        {
+            output_.remove();
+        }
+        clearState();
+        write_pos_ = 0;
+        expected_total_ = 0;
+    }
+    write_buffer_.clear();
 
-    if (output_.exists())
+    QNetworkReply *r = getAccessManagerInstance()->get(request);
+    if (reply_ != 0)
     {
-        output_.remove();
+        reply_->deleteLater();
     }
     reply_ = r;
     init();
-    emit statusChanged();
+}
+
+bool DownloadItem::hasPartialData() const
+{
+    return !output_.fileName().isEmpty() &&
+           output_.exists() &&
+           QFile::exists(stateFileName());
+}
+
+QString DownloadItem::stateFileName() const
+{
+    return output_.fileName() + STATE_SUFFIX;
+}
+
+bool DownloadItem::loadState()
+{
+    QSettings state(stateFileName(), QSettings::IniFormat);
+    if (state.value(STATE_URL).toUrl() != url_)
+    {
+        return false;
+    }
+
+    qint64 received = state.value(STATE_RECEIVED, 0).toLongLong();
+    qint64 total = state.value(STATE_TOTAL, 0).toLongLong();
+    etag_ = state.value(STATE_ETAG).toByteArray();
+    last_modified_ = state.value(STATE_LAST_MODIFIED).toByteArray();
+
+    // Without a validator we can not tell whether the remote file
+    // is still the one we have the head of.
+    if (received <= 0 || (etag_.isEmpty() && last_modified_.isEmpty()))
+    {
+        return false;
+    }
+    if (received > QFileInfo(output_).size() || (total > 0 && received > total))
+    {
+        return false;
+    }
+    write_pos_ = received;
+    expected_total_ = total;
+    return true;
+}
+
+void DownloadItem::saveState()
+{
+    if (output_.fileName().isEmpty())
+    {
+        return;
+    }
+
+    QSettings state(stateFileName(), QSettings::IniFormat);
+    state.setValue(STATE_URL, url_);
+    state.setValue(STATE_ETAG, etag_);
+    state.setValue(STATE_LAST_MODIFIED, last_modified_);
+    state.setValue(STATE_TOTAL, expected_total_);
+    state.setValue(STATE_RECEIVED, write_pos_);
+    state.sync();
+}
+
+void DownloadItem::clearState()
+{
+    QFile::remove(stateFileName());
+}
+
+/// Write the pending data to the output file. Unless all is set, only
+/// the part ending on a WRITE_ALIGNMENT boundary of the file is written
+/// and the remainder stays buffered for the next call.
+bool DownloadItem::flushBuffer(bool all)
+{
+    if (write_buffer_.isEmpty() || !output_.isOpen())
+    {
+        return true;
+    }
+
+    qint64 length = write_buffer_.size();
+    if (!all)
+    {
+        length = ((write_pos_ + length) & ~(WRITE_ALIGNMENT - 1)) - write_pos_;
+        if (length <= 0)
+        {
+            return true;
+        }
+    }
+
+    if (!output_.seek(write_pos_) ||
+        output_.write(write_buffer_.constData(), length) != length)
+    {
+        return false;
+    }
+    output_.flush();
+    write_buffer_.remove(0, length);
+    write_pos_ += length;
+    saveState();
+    return true;
+}
+
+/// Check the complete file against the size announced by the server.
+/// On failure the reason is shown in the info label.
+bool DownloadItem::verifyDownload()
+{
+    qint64 size = write_pos_;
+    if (expected_total_ > 0 && size != expected_total_)
+    {
+        qWarning() << "DownloadItem: size mismatch" << size << expected_total_ << url_;
+        download_info_.setText(tr("Incomplete download: %1 of %2 bytes").arg(size).arg(expected_total_));
+        return false;
+    }
+
+    // Drop a stale tail left behind by an earlier attempt.
+    if (output_.size() != size && !output_.resize(size))
+    {
+        download_info_.setText(tr("Error saving: %1").arg(fileError()));
+        return false;
+    }
+    return true;
+}
+
+/// The error of the output file. QFile leaves errorString() empty for
+/// some failures, e.g. a short write on a full card.
+QString DownloadItem::fileError() const
+{
+    QString message = output_.errorString();
+    if (message.isEmpty() || output_.error() == QFile::NoError)
+    {
+        message = tr("could not write %1").arg(QFileInfo(output_).fileName());
+    }
+    return message;
 }
 
 void DownloadItem::downloadReadyRead()
@@ -296,24 +498,31 @@ void DownloadItem::downloadReadyRead()
     if (!output_.isOpen())
     {
         // in case someone else has already put a file there
-        if (!request_file_name_)
+        if (!request_file_name_ && resume_offset_ <= 0 && !hasPartialData())
         {
             getFileName();
         }
 
-        if (!output_.open(QIODevice::WriteOnly))
+        QIODevice::OpenMode mode = QIODevice::WriteOnly;
+        if (resume_offset_ > 0)
+        {
+            mode |= QIODevice::ReadOnly;
+        }
+        if (!output_.open(mode))
         {
-            download_info_.setText(tr("Error opening save file: %1").arg(output_.errorString()));
+            download_info_.setText(tr("Error opening save file: %1").arg(fileError()));
             stop();
             emit statusChanged();
             return;
         }
+
         emit statusChanged();
     }
 
-    if (-1 == output_.write(reply_->readAll()))
+    write_buffer_.append(reply_->readAll());
+    if (write_buffer_.size() >= WRITE_BUFFER_SIZE && !flushBuffer(false))
     {
-        download_info_.setText(tr("Error saving: %1").arg(output_.errorString()));
+        download_info_.setText(tr("Error saving: %1").arg(fileError()));
         stop();
     }
 }
@@ -333,10 +542,45 @@ void DownloadItem::metaDataChanged()
     if (location_header.isValid())
     {
         url_ = location_header.toUrl();
-        reply_->deleteLater();
-        reply_ = getAccessManagerInstance()->get(QNetworkRequest(url_));
-        init();
+        resume();
+        return;
+    }
+
+    int status = reply_->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    QByteArray etag = reply_->rawHeader(ETAG);
+    qint64 length = reply_->header(QNetworkRequest::ContentLengthHeader).toLongLong();
+    if (resume_offset_ > 0)
+    {
+        qint64 start = -1;
+        qint64 total = -1;
+        bool partial = (status == 206 &&
+                        parseContentRange(reply_->rawHeader(CONTENT_RANGE), start, total) &&
+                        start == resume_offset_ &&
+                        (etag_.isEmpty() || etag.isEmpty() || etag == etag_));
+        if (partial)
+        {
+            if (total > 0)
+            {
+                expected_total_ = total;
+            }
+            return;
+        }
+
+        // The server ignored the range or the entity changed, so the
+        // reply carries the whole file. Start writing from the beginning.
+        qDebug() << "DownloadItem: range not honoured, restarting" << url_;
+        resume_offset_ = 0;
+        write_pos_ = 0;
+        write_buffer_.clear();
+        if (output_.isOpen())
+        {
+            output_.resize(0);
+        }
     }
+
+    etag_ = etag;
+    last_modified_ = reply_->rawHeader(LAST_MODIFIED);
+    expected_total_ = length > 0 ? length : 0;
 }
 
 void DownloadItem::downloadProgress(qint64 bytesReceived, qint64 bytesTotal)
@@ -347,7 +591,7 @@ void DownloadItem::downloadProgress(qint64 bytesReceived, qint64 bytesTotal)
     }
     else
     {
-        bytes_total_ = bytesTotal;
+        bytes_total_ = resume_offset_ + bytesTotal;
     }
 
     /*if (bytes_received_ == 0)
@@ -358,7 +602,7 @@ void DownloadItem::downloadProgress(qint64 bytesReceived, qint64 bytesTotal)
     {
         sys::SysStatus::instance().reportDownloadState(output_.fileName(), 100);
     }*/
-    bytes_received_ = bytesReceived;
+    bytes_received_ = resume_offset_ + bytesReceived;
     updateInfoLabel();
 }
 
@@ -490,6 +734,24 @@ void DownloadItem::finished()
     stop_btn_.setEnabled(false);
     stop_btn_.hide();
 
+    bool flushed = flushBuffer(true);
+    if (reply_->error() == QNetworkReply::NoError && output_.isOpen())
+    {
+        if (!flushed)
+        {
+            download_info_.setText(tr("Error saving: %1").arg(fileError()));
+        }
+        if (flushed && verifyDownload())
+        {
+            clearState();
+        }
+        else
+        {
+            // Keep the state, Try Again resumes from the data written.
+            try_again_btn_.setEnabled(true);
+            try_again_btn_.setVisible(true);
+        }
+    }
     output_.close();
     emit statusChanged();
 
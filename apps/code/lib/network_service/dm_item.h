@@ -21,6 +21,9 @@ public:
     inline QString fileName() { return output_.fileName(); }
     inline const QUrl & url() { return url_; }
 
+    bool hasPartialData() const;
+    void resume();
+
 protected:
     void resizeEvent(QResizeEvent*);
     void paintEvent(QPaintEvent*);
@@ -50,6 +53,14 @@ private:
     QString dataString(int size) const;
     QString saveFileName(const QString &directory);
 
+    QString stateFileName() const;
+    bool loadState();
+    void saveState();
+    void clearState();
+    bool flushBuffer(bool all);
+    bool verifyDownload();
+    QString fileError() const;
+
 private:
     QUrl           url_;
     QFile          output_;
@@ -60,6 +71,15 @@ private:
     QTime          download_time_;
     QString        input_file_name_;
 
+    // Resume state. resume_offset_ is the byte offset requested by the
+    // current reply, write_pos_ the file offset of the first buffered byte.
+    qint64         resume_offset_;
+    qint64         write_pos_;
+    qint64         expected_total_;
+    QByteArray     write_buffer_;
+    QByteArray     etag_;
+    QByteArray     last_modified_;
+
     QHBoxLayout        hbox_;
     ui::OnyxLabel      download_info_;
     ui::OnyxLabel      file_name_;
@@ -29,7 +29,7 @@ DownloadManager::DownloadManager(QWidget *parent)
     , remove_policy_(SuccessFullDownload)
 {
     model_ = new DownloadModel(this);
-    //load();
+    load();
 }
 
 DownloadManager::~DownloadManager()
@@ -124,6 +124,7 @@ void DownloadManager::handleUnsupportedContent(QNetworkReply *reply, bool reques
 void DownloadManager::addItem(DownloadItem *item)
 {
     connect(item, SIGNAL(statusChanged()), this, SLOT(updateColumn()));
+    connect(item, SIGNAL(statusChanged()), auto_saver_, SLOT(changeOccurred()));
     int column = downloads_.count();
     model_->beginInsertColumns(QModelIndex(), column, column);
     downloads_.append(item);
@@ -216,6 +217,9 @@ void DownloadManager::save() const
     }
 }
 
+/// Restore the settings of the previous session. The interrupted
+/// downloads are picked up once the event loop runs, so that the
+/// instance is complete before the first request goes out.
 void DownloadManager::load()
 {
     QSettings settings;
@@ -227,6 +231,19 @@ void DownloadManager::load()
                         Never :
                         static_cast<RemovePolicy>(remove_policy_enum.keyToValue(value));
 
+    QTimer::singleShot(0, this, SLOT(resumeUnfinished()));
+}
+
+/// Restart the downloads that were interrupted in a previous session,
+/// e.g. by a reboot. Only items whose partial file and state survived
+/// are restored; they continue from the last written offset. Entries
+/// that are already in the list are skipped, so calling this again
+/// does not start a second transfer into the same file.
+void DownloadManager::resumeUnfinished()
+{
+    QSettings settings;
+    settings.beginGroup(QLatin1String("downloadmanager"));
+
     int i = 0;
     QString key = QString(QLatin1String("download_%1_")).arg(i);
     while (settings.contains(key + QLatin1String("url")))
@@ -234,17 +251,38 @@ void DownloadManager::load()
         QUrl url = settings.value(key + QLatin1String("url")).toUrl();
         QString file_name = settings.value(key + QLatin1String("location")).toString();
         bool done = settings.value(key + QLatin1String("done"), true).toBool();
-        if (!url.isEmpty() && !file_name.isEmpty())
+        if (!done && !url.isEmpty() && !file_name.isEmpty() && !isQueued(url, file_name))
         {
             DownloadItem *item = new DownloadItem();
             item->output_.setFileName(file_name);
             item->url_ = url;
-            addItem(item);
+            if (item->hasPartialData())
+            {
+                addItem(item);
+                item->resume();
+            }
+            else
+            {
+                delete item;
+            }
         }
         key = QString(QLatin1String("download_%1_")).arg(++i);
     }
 }
 
+bool DownloadManager::isQueued(const QUrl &url, const QString &file_name) const
+{
+    QFileInfo info(file_name);
+    foreach (DownloadItem* item, downloads_)
+    {
+        if (item->url_ == url || QFileInfo(item->output_) == info)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
 void DownloadManager::cleanup()
 {
     if (downloads_.isEmpty())
@@ -39,6 +39,7 @@ public Q_SLOTS:
     void download(const QNetworkRequest &request, bool requestFileName = false);
     inline void download(const QUrl &url, bool requestFileName = false);
     void handleUnsupportedContent(QNetworkReply *reply, bool requestFileName = false);
+    void resumeUnfinished();
     void cleanup();
 
 private Q_SLOTS:
@@ -47,6 +48,7 @@ private Q_SLOTS:
 
 private:
     void addItem(DownloadItem *item);
+    bool isQueued(const QUrl &url, const QString &file_name) const;
     void updateItemCount();
     void load();
 
@@ -0,0 +1,342 @@
+#include "gtest/gtest.h"
+
+#include <QtNetwork/QTcpServer>
+#include <QtNetwork/QTcpSocket>
+
+#include "dm_item.h"
+#include "access_manager.h"
+
+namespace network_service
+{
+namespace
+{
+
+static const int TIMEOUT = 20000;
+static const char * BOOK_PATH = "/book.epub";
+
+/// A minimal HTTP server for a single file. It runs in its own thread
+/// with blocking sockets so the reply can be processed by the event
+/// loop of the test. The first response can be cut short to simulate
+/// a dropped connection, and the entity can be changed between two
+/// requests to check the If-Range handling. A response can also end
+/// early but cleanly, announcing the short length, like a proxy that
+/// cuts large transfers.
+class HttpServer : public QThread
+{
+public:
+    HttpServer()
+        : port_(0)
+        , drop_after_(-1)
+        , short_after_(-1)
+        , honour_range_(true)
+    {
+    }
+
+    ~HttpServer()
+    {
+        wait();
+    }
+
+    /// Serve count requests and stop.
+    void start(int count)
+    {
+        count_ = count;
+        QMutexLocker locker(&mutex_);
+        QThread::start();
+        ready_.wait(&mutex_);
+    }
+
+    quint16 port() const { return port_; }
+    QUrl url() const { return QUrl(QString("http://127.0.0.1:%1%2").arg(port_).arg(BOOK_PATH)); }
+
+    void setContent(const QByteArray & data, const QByteArray & etag)
+    {
+        QMutexLocker locker(&mutex_);
+        content_ = data;
+        etag_ = etag;
+    }
+    void setDropAfter(int bytes) { drop_after_ = bytes; }
+    void setShortAfter(int bytes) { short_after_ = bytes; }
+    void setHonourRange(bool honour) { honour_range_ = honour; }
+
+    QList<QByteArray> ranges()
+    {
+        QMutexLocker locker(&mutex_);
+        return ranges_;
+    }
+
+protected:
+    void run()
+    {
+        QTcpServer server;
+        server.listen(QHostAddress::LocalHost);
+        {
+            QMutexLocker locker(&mutex_);
+            port_ = server.serverPort();
+            ready_.wakeAll();
+        }
+
+        for (int i = 0; i < count_; ++i)
+        {
+            if (!server.waitForNewConnection(TIMEOUT))
+            {
+                return;
+            }
+            QTcpSocket *socket = server.nextPendingConnection();
+            serve(*socket);
+            delete socket;
+        }
+    }
+
+private:
+    void serve(QTcpSocket & socket)
+    {
+        QByteArray request;
+        while (!request.contains("\r\n\r\n") && socket.waitForReadyRead(TIMEOUT))
+        {
+            request += socket.readAll();
+        }
+
+        QByteArray range;
+        foreach (QByteArray line, request.split('\n'))
+        {
+            if (line.toLower().startsWith("range:"))
+            {
+                range = line.mid(6).trimmed();
+            }
+        }
+
+        QMutexLocker locker(&mutex_);
+        ranges_.append(range);
+
+        qint64 start = 0;
+        if (honour_range_ && range.startsWith("bytes="))
+        {
+            start = range.mid(6, range.indexOf('-') - 6).toLongLong();
+        }
+
+        QByteArray header;
+        QByteArray body = content_.mid(start);
+        if (short_after_ >= 0)
+        {
+            body.truncate(short_after_);
+            short_after_ = -1;
+        }
+        if (start > 0)
+        {
+            header = "HTTP/1.1 206 Partial Content\r\n";
+            header += QString("Content-Range: bytes %1-%2/%3\r\n")
+                .arg(start).arg(content_.size() - 1).arg(content_.size()).toLatin1();
+        }
+        else
+        {
+            header = "HTTP/1.1 200 OK\r\n";
+        }
+        header += "ETag: " + etag_ + "\r\n";
+        header += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+        header += "Connection: close\r\n\r\n";
+
+        if (drop_after_ >= 0)
+        {
+            body.truncate(drop_after_);
+            drop_after_ = -1;
+        }
+        socket.write(header);
+        socket.write(body);
+        while (socket.bytesToWrite() > 0 && socket.waitForBytesWritten(TIMEOUT))
+        {
+        }
+        socket.disconnectFromHost();
+        if (socket.state() != QAbstractSocket::UnconnectedState)
+        {
+            socket.waitForDisconnected(TIMEOUT);
+        }
+    }
+
+private:
+    QMutex            mutex_;
+    QWaitCondition    ready_;
+    int               count_;
+    quint16           port_;
+    int               drop_after_;
+    int               short_after_;
+    bool              honour_range_;
+    QByteArray        content_;
+    QByteArray        etag_;
+    QList<QByteArray> ranges_;
+};
+
+static QByteArray makeContent(int size, int seed)
+{
+    QByteArray data(size, 0);
+    quint32 value = seed;
+    for (int i = 0; i < size; ++i)
+    {
+        value = value * 1103515245 + 12345;
+        data[i] = static_cast<char>(value >> 16);
+    }
+    return data;
+}
+
+static bool waitUntilDone(DownloadItem & item)
+{
+    QTime timer;
+    timer.start();
+    while (item.downloading() && timer.elapsed() < TIMEOUT)
+    {
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents, 50);
+    }
+    return !item.downloading();
+}
+
+static QByteArray readFile(const QString & path)
+{
+    QFile file(path);
+    file.open(QIODevice::ReadOnly);
+    return file.readAll();
+}
+
+class DownloadItemTest : public ::testing::Test
+{
+public:
+    static void SetUpTestCase()
+    {
+        static char name[] = "dm_item_test";
+        static char *argv[] = { name, 0 };
+        static int argc = 1;
+        app_ = new QApplication(argc, argv);
+        QCoreApplication::setOrganizationName("onyx_test");
+        QCoreApplication::setApplicationName("dm_item_test");
+    }
+
+protected:
+    virtual void SetUp()
+    {
+        dir_ = QDir::temp();
+        dir_.mkdir("dm_item_test");
+        dir_.cd("dm_item_test");
+        foreach (QString name, dir_.entryList(QDir::Files | QDir::Hidden))
+        {
+            dir_.remove(name);
+        }
+
+        QSettings settings;
+        settings.beginGroup(QLatin1String("downloadmanager"));
+        settings.setValue(QLatin1String("download_directory"), dir_.absolutePath());
+    }
+
+    DownloadItem * startDownload(const QUrl & url)
+    {
+        return new DownloadItem(getAccessManagerInstance()->get(QNetworkRequest(url)));
+    }
+
+    static QApplication *app_;
+    QDir dir_;
+};
+
+QApplication * DownloadItemTest::app_ = 0;
+
+TEST_F(DownloadItemTest, ResumeAfterDisconnect)
+{
+    QByteArray content = makeContent(600 * 1024, 1);
+    HttpServer server;
+    server.setContent(content, "\"v1\"");
+    server.setDropAfter(300 * 1024 + 123);
+    server.start(2);
+
+    DownloadItem *item = startDownload(server.url());
+    ASSERT_TRUE(waitUntilDone(*item));
+    EXPECT_FALSE(item->downloadedSuccessfully());
+    EXPECT_TRUE(item->hasPartialData());
+
+    item->resume();
+    ASSERT_TRUE(waitUntilDone(*item));
+    EXPECT_TRUE(item->downloadedSuccessfully());
+    EXPECT_FALSE(item->hasPartialData());
+    EXPECT_TRUE(readFile(item->fileName()) == content);
+
+    // The second request asks only for the missing tail.
+    QList<QByteArray> ranges = server.ranges();
+    ASSERT_EQ(2, ranges.size());
+    EXPECT_TRUE(ranges[0].isEmpty());
+    EXPECT_TRUE(ranges[1].startsWith("bytes="));
+    EXPECT_NE(QByteArray("bytes=0-"), ranges[1]);
+    delete item;
+}
+
+TEST_F(DownloadItemTest, IncompleteResumeKeepsState)
+{
+    QByteArray content = makeContent(500 * 1024, 5);
+    HttpServer server;
+    server.setContent(content, "\"v1\"");
+    server.setDropAfter(100 * 1024);
+    server.start(3);
+
+    DownloadItem *item = startDownload(server.url());
+    ASSERT_TRUE(waitUntilDone(*item));
+    EXPECT_TRUE(item->hasPartialData());
+
+    // The second reply ends cleanly before the total of its range, so
+    // the size check fails. The data written so far is kept.
+    server.setShortAfter(150 * 1024);
+    item->resume();
+    ASSERT_TRUE(waitUntilDone(*item));
+    EXPECT_TRUE(item->downloadCancelled());
+    EXPECT_TRUE(item->hasPartialData());
+
+    item->resume();
+    ASSERT_TRUE(waitUntilDone(*item));
+    EXPECT_TRUE(item->downloadedSuccessfully());
+    EXPECT_TRUE(readFile(item->fileName()) == content);
+
+    // Every attempt goes on from where the one before stopped.
+    QList<QByteArray> ranges = server.ranges();
+    ASSERT_EQ(3, ranges.size());
+    EXPECT_TRUE(ranges[1].startsWith("bytes="));
+    EXPECT_TRUE(ranges[2].startsWith("bytes="));
+    EXPECT_GT(ranges[2].mid(6, ranges[2].indexOf('-') - 6).toLongLong(),
+              ranges[1].mid(6, ranges[1].indexOf('-') - 6).toLongLong());
+    delete item;
+}
+
+TEST_F(DownloadItemTest, ChangedEntityRestartsFromZero)
+{
+    QByteArray old_content = makeContent(400 * 1024, 2);
+    QByteArray new_content = makeContent(350 * 1024, 3);
+    HttpServer server;
+    server.setContent(old_content, "\"v1\"");
+    server.setDropAfter(100 * 1024);
+    server.start(2);
+
+    DownloadItem *item = startDownload(server.url());
+    ASSERT_TRUE(waitUntilDone(*item));
+    EXPECT_TRUE(item->hasPartialData());
+
+    // The server ignores the range because the entity changed, so the
+    // whole new file arrives with a 200 and replaces the partial head.
+    server.setContent(new_content, "\"v2\"");
+    server.setHonourRange(false);
+    item->resume();
+    ASSERT_TRUE(waitUntilDone(*item));
+    EXPECT_TRUE(item->downloadedSuccessfully());
+    EXPECT_TRUE(readFile(item->fileName()) == new_content);
+    delete item;
+}
+
+TEST_F(DownloadItemTest, CompleteDownloadLeavesNoState)
+{
+    QByteArray content = makeContent(64 * 1024 + 7, 4);
+    HttpServer server;
+    server.setContent(content, "\"v1\"");
+    server.start(1);
+
+    DownloadItem *item = startDownload(server.url());
+    ASSERT_TRUE(waitUntilDone(*item));
+    EXPECT_TRUE(item->downloadedSuccessfully());
+    EXPECT_FALSE(item->hasPartialData());
+    EXPECT_TRUE(readFile(item->fileName()) == content);
+    delete item;
+}
+
+}   // namespace
+}   // namespace network_service
@@ -21,6 +21,22 @@ int startNabooService(int argc, char** argv)
     Q_INIT_RESOURCE(dictionary_images);
     Q_INIT_RESOURCE(tts_images);
 
+    if (app.isPooled())
+    {
+        // Every time the user leaves the document, the event loop returns.
+        // Park the reader until explorer sends the next document.
+        int ret = 0;
+        do
+        {
+            ret = app.exec();
+            if (app.isPooled())
+            {
+                app.park();
+            }
+        } while (ret == 0 && app.isPooled());
+        return ret;
+    }
+
     if (app.open(app.currentPath()))
     {
         return app.exec();
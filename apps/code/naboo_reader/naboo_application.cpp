@@ -8,6 +8,8 @@ namespace naboo_reader
 NabooApplication::NabooApplication(int &argc, char **argv)
     : QApplication(argc, argv)
     , main_window_(this)
+    , pooled_(false)
+    , connected_(false)
 {
     if (argc > 1)
     {
@@ -15,6 +17,16 @@ NabooApplication::NabooApplication(int &argc, char **argv)
         main_window_.handleSetStatusBarFunctions(MENU | PROGRESS | CLOCK | MESSAGE | BATTERY);
         current_path_ = QString::fromLocal8Bit(argv[1]);
     }
+
+    // Explorer keeps a reader in standby, so the document can be opened
+    // without paying for process start and view construction.
+    if (current_path_ == "--standby")
+    {
+        current_path_.clear();
+        pooled_ = true;
+        main_window_.attachModel(&model_);
+        main_window_.activateView(NABOO_VIEW);
+    }
 }
 
 NabooApplication::~NabooApplication(void)
@@ -28,26 +40,43 @@ bool NabooApplication::open( const QString &path_name )
     main_window_.show();
     NabooView *view = down_cast<NabooView*>(main_window_.activateView(NABOO_VIEW));
 
-    // connect the signals with view
-    connect( view, SIGNAL(rotateScreen()), this, SLOT(onRotateScreen()) );
-    connect( view, SIGNAL(testSuspend()), this, SLOT(suspend()) );
-    connect( view, SIGNAL(testWakeUp()), this, SLOT(onWakeUp()) );
+    if (!connected_)
+    {
+        connected_ = true;
+
+        // connect the signals with view
+        connect( view, SIGNAL(rotateScreen()), this, SLOT(onRotateScreen()) );
+        connect( view, SIGNAL(testSuspend()), this, SLOT(suspend()) );
+        connect( view, SIGNAL(testWakeUp()), this, SLOT(onWakeUp()) );
 
-    // connect the signals with sys_state_
-    SysStatus & sys_status = SysStatus::instance();
-    connect( &sys_status, SIGNAL( mountTreeSignal( bool, const QString & ) ),
-             this, SLOT( onMountTreeSignal( bool, const QString &) ) );
-    connect( &sys_status, SIGNAL( sdCardChangedSignal( bool ) ), this, SLOT( onSDChangedSignal( bool ) ) );
-    connect( &sys_status, SIGNAL( aboutToShutdown() ), this, SLOT( onAboutToShutDown() ) );
-    connect( &sys_status, SIGNAL( wakeup() ), this, SLOT( onWakeUp() ) );
+        // connect the signals with sys_state_
+        SysStatus & sys_status = SysStatus::instance();
+        connect( &sys_status, SIGNAL( mountTreeSignal( bool, const QString & ) ),
+                 this, SLOT( onMountTreeSignal( bool, const QString &) ) );
+        connect( &sys_status, SIGNAL( sdCardChangedSignal( bool ) ), this, SLOT( onSDChangedSignal( bool ) ) );
+        connect( &sys_status, SIGNAL( aboutToShutdown() ), this, SLOT( onAboutToShutDown() ) );
+        connect( &sys_status, SIGNAL( wakeup() ), this, SLOT( onWakeUp() ) );
 
 #ifdef Q_WS_QWS
-    connect(qApp->desktop(), SIGNAL(resized(int)), this, SLOT(onScreenSizeChanged(int)), Qt::QueuedConnection);
+        connect(qApp->desktop(), SIGNAL(resized(int)), this, SLOT(onScreenSizeChanged(int)), Qt::QueuedConnection);
 #endif
+    }
 
+    if (model_.isReady())
+    {
+        // the pooled reader is asked to open another document
+        model_.save();
+        model_.close();
+    }
+
+    current_path_ = path_name;
     view->attachModel(&model_);
     bool ret = model_.open(path_name);
-    if ( !ret )
+    if ( ret )
+    {
+        emit documentOpened(path_name);
+    }
+    else
     {
         if ( sys::SysStatus::instance().isSystemBusy() )
         {
@@ -73,10 +102,25 @@ bool NabooApplication::close(const QString &path_name)
 {
     model_.save();
     model_.close();
-    main_window_.clearViews();
+    if (!pooled_)
+    {
+        // a parked reader keeps its view and connections
+        main_window_.clearViews();
+    }
     return true;
 }
 
+/// Release the document and go back to standby instead of exiting.
+/// The view is kept, so the next document opens with a warm process.
+void NabooApplication::park()
+{
+    model_.save();
+    model_.close();
+    main_window_.hide();
+    emit documentClosed(current_path_);
+    current_path_.clear();
+}
+
 bool NabooApplication::suspend()
 {
     // save all of the options for waking up
@@ -85,6 +129,12 @@ bool NabooApplication::suspend()
 
 void NabooApplication::onWakeUp()
 {
+    if (current_path_.isEmpty())
+    {
+        // parked without a document
+        return;
+    }
+
     // save the configurations before closing
     model_.save();
 
@@ -105,6 +155,7 @@ void NabooApplication::onWakeUp()
 void NabooApplication::onAboutToShutDown()
 {
     qDebug("System is about to shut down");
+    pooled_ = false;
     qApp->exit();
 }
 
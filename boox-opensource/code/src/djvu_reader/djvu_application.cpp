@@ -9,12 +9,24 @@ DjvuApplication::DjvuApplication(int &argc, char **argv)
     : QApplication(argc, argv)
     , main_window_(this)
     , model_()
+    , pooled_(false)
+    , connected_(false)
 {
     if (argc > 1)
     {
         ui::loadTranslator(QLocale::system().name());
         current_path_ = QString::fromLocal8Bit(argv[1]);
     }
+
+    // Explorer keeps a reader in standby, so the document can be opened
+    // without paying for process start and view construction.
+    if (current_path_ == "--standby")
+    {
+        current_path_.clear();
+        pooled_ = true;
+        main_window_.attachModel(&model_);
+        main_window_.activateView(DJVU_VIEW);
+    }
 }
 
 DjvuApplication::~DjvuApplication(void)
@@ -28,26 +40,43 @@ bool DjvuApplication::open( const QString &path_name )
     main_window_.show();
     DjVuView *view = down_cast<DjVuView*>(main_window_.activateView(DJVU_VIEW));
 
-    // connect the signals with view
-    connect( view, SIGNAL(rotateScreen()), this, SLOT(onRotateScreen()) );
-    connect( view, SIGNAL(testSuspend()), this, SLOT(onSuspend()) );
-    connect( view, SIGNAL(testWakeUp()), this, SLOT(onWakeUp()) );
+    if (!connected_)
+    {
+        connected_ = true;
+
+        // connect the signals with view
+        connect( view, SIGNAL(rotateScreen()), this, SLOT(onRotateScreen()) );
+        connect( view, SIGNAL(testSuspend()), this, SLOT(onSuspend()) );
+        connect( view, SIGNAL(testWakeUp()), this, SLOT(onWakeUp()) );
 
-    // connect the signals with sys_state_
-    SysStatus & sys_status = SysStatus::instance();
-    connect( &sys_status, SIGNAL( mountTreeSignal( bool, const QString & ) ),
-             this, SLOT( onMountTreeSignal( bool, const QString &) ) );
-    connect( &sys_status, SIGNAL( sdCardChangedSignal( bool ) ), this, SLOT( onSDChangedSignal( bool ) ) );
-    connect( &sys_status, SIGNAL( aboutToShutdown() ), this, SLOT( onAboutToShutDown() ) );
-    connect( &sys_status, SIGNAL( wakeup() ), this, SLOT( onWakeUp() ) );
+        // connect the signals with sys_state_
+        SysStatus & sys_status = SysStatus::instance();
+        connect( &sys_status, SIGNAL( mountTreeSignal( bool, const QString & ) ),
+                 this, SLOT( onMountTreeSignal( bool, const QString &) ) );
+        connect( &sys_status, SIGNAL( sdCardChangedSignal( bool ) ), this, SLOT( onSDChangedSignal( bool ) ) );
+        connect( &sys_status, SIGNAL( aboutToShutdown() ), this, SLOT( onAboutToShutDown() ) );
+        connect( &sys_status, SIGNAL( wakeup() ), this, SLOT( onWakeUp() ) );
 
 #ifdef Q_WS_QWS
-    connect(qApp->desktop(), SIGNAL(resized(int)), this, SLOT(onScreenSizeChanged(int)), Qt::QueuedConnection);
+        connect(qApp->desktop(), SIGNAL(resized(int)), this, SLOT(onScreenSizeChanged(int)), Qt::QueuedConnection);
 #endif
+    }
+
+    if (model_.isReady())
+    {
+        // the pooled reader is asked to open another document
+        model_.save();
+        model_.close();
+    }
 
+    current_path_ = path_name;
     view->attachModel(&model_);
     bool ret = model_.open(path_name);
-    if ( !ret )
+    if ( ret )
+    {
+        emit documentOpened(path_name);
+    }
+    else
     {
         if ( sys::SysStatus::instance().isSystemBusy() )
         {
@@ -78,6 +107,17 @@ bool DjvuApplication::close(const QString &path_name)
     return true;
 }
 
+/// Release the document and go back to standby instead of exiting.
+/// The view is kept, so the next document opens with a warm process.
+void DjvuApplication::park()
+{
+    model_.save();
+    model_.close();
+    main_window_.hide();
+    emit documentClosed(current_path_);
+    current_path_.clear();
+}
+
 bool DjvuApplication::onSuspend()
 {
     // save all of the options for waking up
@@ -103,6 +143,7 @@ void DjvuApplication::onWakeUp()
 void DjvuApplication::onAboutToShutDown()
 {
     qDebug("System is about to shut down");
+    pooled_ = false;
     qApp->exit();
 }
 
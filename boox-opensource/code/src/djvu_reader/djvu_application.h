@@ -20,6 +20,12 @@ public:
     ~DjvuApplication(void);
 
     const QString & currentPath() { return current_path_; }
+    bool isPooled() { return pooled_; }
+    void park();
+
+Q_SIGNALS:
+    void documentOpened(const QString & path);
+    void documentClosed(const QString & path);
 
 public Q_SLOTS:
     bool open(const QString &path_name);
@@ -50,6 +56,8 @@ private:
     MainWindow main_window_;
     DjVuModel  model_;            // Djvu model instance
     QString    current_path_;     // path of the current document
+    bool       pooled_;           // started by explorer in standby mode
+    bool       connected_;        // signals of view and system connected
 
     NO_COPY_AND_ASSIGN(DjvuApplication);
 };
@@ -68,8 +76,13 @@ public:
     {
         QDBusConnection::systemBus().registerService("com.onyx.service.djvu_reader");
         QDBusConnection::systemBus().registerObject("/com/onyx/object/djvu_reader", app_);
+        setAutoRelaySignals(true);
     }
 
+Q_SIGNALS:
+    void documentOpened(const QString & path);
+    void documentClosed(const QString & path);
+
 public Q_SLOTS:
     /// Must be in dbus data type, otherwise these methods will not
     /// be exported as dbus methods. So you can not use std::string
@@ -1,5 +1,10 @@
 #include "djvu_page.h"
 #include "djvu_source.h"
+#include "onyx/sys/trace.h"
+
+#include "libdjvu/DjVuInfo.h"
+#include "libdjvu/IW44Image.h"
+#include "libdjvu/GScaler.h"
 
 namespace djvu_reader
 {
@@ -691,6 +696,8 @@ void DjVuPageInfo::decodeText(GP<ByteStream> text_stream)
 DjVuPage::DjVuPage(int page_num)
 : djvu_image_(0)
 , page_num_(page_num)
+, tiled_(false)
+, preview_(false)
 {
     initialColorTable();
 }
@@ -724,13 +731,15 @@ int DjVuPage::imageLength()
 
 bool DjVuPage::render(DjVuSource * source, const RenderSetting & render_setting)
 {
-    if (!image_.isNull() && render_setting_ == render_setting)
+    if (!image_.isNull() && !preview_ && render_setting_ == render_setting)
     {
         // update render setting whenever
         render_setting_ = render_setting;
         return true;
     }
 
+    ONYX_TRACE_SPAN("page_render");
+
     if (!djvuImageDecoded(source))
     {
         return false;
@@ -752,6 +761,9 @@ bool DjVuPage::render(DjVuSource * source, const RenderSetting & render_setting)
     image.setColorTable(COLOR_TABLE);
     render_setting_ = render_setting;
 
+    tiled_ = false;
+    preview_ = false;
+
     int ret = renderDjVuPage(djvu_image_, DDJVU_RENDER_BLACK, render_setting.contentArea(),
                              render_rect, image.bytesPerLine(), (char*)image.bits());
     if (ret > 0)
@@ -767,6 +779,233 @@ bool DjVuPage::render(DjVuSource * source, const RenderSetting & render_setting)
     return false;
 }
 
+/// Rectangle of a tile in a page rendered at size
+QRect DjVuPage::tileRect(const QSize & size, int column, int row)
+{
+    QRect tile(column * TILE_SIZE, row * TILE_SIZE, TILE_SIZE, TILE_SIZE);
+    return tile.intersected(QRect(QPoint(0, 0), size));
+}
+
+/// Retrieve the column and row of the tiles covering area
+void DjVuPage::tilesInArea(const QSize & size, const QRect & area, QVector<QPoint> & tiles)
+{
+    tiles.clear();
+    QRect covered = area.intersected(QRect(QPoint(0, 0), size));
+    if (covered.isEmpty())
+    {
+        return;
+    }
+
+    for (int row = covered.top() / TILE_SIZE; row <= covered.bottom() / TILE_SIZE; ++row)
+    {
+        for (int column = covered.left() / TILE_SIZE; column <= covered.right() / TILE_SIZE; ++column)
+        {
+            tiles.push_back(QPoint(column, row));
+        }
+    }
+}
+
+/// Check whether all tiles covering area are rendered
+bool DjVuPage::hasTiles(DjVuSource * source, const RenderSetting & render_setting, const QRect & area)
+{
+    if (!tiled_ || render_setting_ != render_setting)
+    {
+        return false;
+    }
+
+    QSize size = render_setting.contentArea().size();
+    QVector<QPoint> tiles;
+    tilesInArea(size, area, tiles);
+    QImage tile;
+    for (int i = 0; i < tiles.size(); ++i)
+    {
+        DjVuTileKey key(page_num_, render_setting, tiles[i].x(), tiles[i].y());
+        if (!source->pageManager()->getTile(key, tile))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Render the tiles covering area which are not rendered yet. The image of
+/// the whole page is dropped, the page is drawn from its tiles.
+bool DjVuPage::renderTiles(DjVuSource * source, const RenderSetting & render_setting, const QRect & area)
+{
+    ONYX_TRACE_SPAN("page_render_tiles");
+
+    if (!djvuImageDecoded(source))
+    {
+        return false;
+    }
+
+    clearImage();
+    render_setting_ = render_setting;
+    tiled_ = true;
+    preview_ = false;
+
+    DjvuPageManager * manager = source->pageManager();
+    QRect page_rect(QPoint(0, 0), render_setting.contentArea().size());
+    QVector<QPoint> tiles;
+    tilesInArea(page_rect.size(), area, tiles);
+    for (int i = 0; i < tiles.size(); ++i)
+    {
+        DjVuTileKey key(page_num_, render_setting, tiles[i].x(), tiles[i].y());
+        QImage tile;
+        if (manager->getTile(key, tile))
+        {
+            continue;
+        }
+
+        QRect tile_rect = tileRect(page_rect.size(), tiles[i].x(), tiles[i].y());
+        if (!manager->makeEnoughMemory(tryCalcImageLength(tile_rect.width(),
+                                                          tile_rect.height(),
+                                                          QImage::Format_Indexed8),
+                                       page_num_))
+        {
+            return false;
+        }
+
+        tile = QImage(tile_rect.size(), QImage::Format_Indexed8);
+        tile.setColorTable(COLOR_TABLE);
+        if (renderDjVuPage(djvu_image_, DDJVU_RENDER_BLACK, page_rect,
+                           tile_rect, tile.bytesPerLine(), (char*)tile.bits()) <= 0)
+        {
+            return false;
+        }
+        manager->addTile(key, tile);
+    }
+    return true;
+}
+
+/// Render a coarse image of a page which is not decoded yet from the first
+/// chunk of its IW44 image, a fraction of the work of decoding the page.
+/// Pages are rendered in black mode, so a page with a mask is drawn from the
+/// mask alone. Decoding the mask for a preview would double the work of the
+/// page, such pages get no preview.
+bool DjVuPage::renderPreview(DjVuSource * source, const RenderSetting & render_setting)
+{
+    if (!image_.isNull() && render_setting_ == render_setting)
+    {
+        return false;
+    }
+
+    GP<DjVuFile> file = source->getDjVuDoc()->get_djvu_file(page_num_);
+    if (file == 0 || file->is_decode_ok())
+    {
+        return false;
+    }
+
+    ONYX_TRACE_SPAN("page_render_preview");
+
+    GP<DjVuInfo> info;
+    GP<IW44Image> background;
+    try
+    {
+        GP<IFFByteStream> iff(IFFByteStream::create(file->get_init_data_pool()->get_stream()));
+        GUTF8String chkid;
+        if (!iff->get_chunk(chkid) ||
+            (chkid != "FORM:DJVU" && chkid != "FORM:PM44" && chkid != "FORM:BM44"))
+        {
+            return false;
+        }
+
+        while (background == 0 && iff->get_chunk(chkid))
+        {
+            if (chkid == "INFO")
+            {
+                info = DjVuInfo::create();
+                info->decode(*iff->get_bytestream());
+            }
+            else if (chkid == "Sjbz" || chkid == "Smmr")
+            {
+                return false;
+            }
+            else if (chkid == "BG44" || chkid == "PM44" || chkid == "BM44")
+            {
+                background = IW44Image::create_decode(IW44Image::COLOR);
+                background->decode_chunk(iff->get_bytestream());
+            }
+            iff->close_chunk();
+        }
+    }
+    catch (...)
+    {
+        return false;
+    }
+
+    if (background == 0 || (info != 0 && info->orientation != 0))
+    {
+        return false;
+    }
+
+    int page_width = 0;
+    int page_height = 0;
+    if (info != 0)
+    {
+        page_width = info->width;
+        page_height = info->height;
+    }
+    else
+    {
+        page_width = background->get_width();
+        page_height = background->get_height();
+    }
+
+    QSize size = render_setting.contentArea().size();
+    if (page_width <= 0 || page_height <= 0 || size.isEmpty())
+    {
+        return false;
+    }
+
+    if (!source->pageManager()->makeEnoughMemory(tryCalcImageLength(size.width(),
+                                                                    size.height(),
+                                                                    QImage::Format_Indexed8),
+                                                 page_num_))
+    {
+        return false;
+    }
+
+    QImage image(size, QImage::Format_Indexed8);
+    image.setColorTable(COLOR_TABLE);
+    try
+    {
+        // Subsample as far as possible, scale the rest. The wavelet image
+        // subsamples by powers of two only.
+        int level = 1;
+        while (level < 32 &&
+               background->get_width() / (level * 2) >= size.width() &&
+               background->get_height() / (level * 2) >= size.height())
+        {
+            level *= 2;
+        }
+        int width = (background->get_width() + level - 1) / level;
+        int height = (background->get_height() + level - 1) / level;
+        GP<GPixmap> pm = background->get_pixmap(level, GRect(0, 0, width, height));
+
+        if (width != size.width() || height != size.height())
+        {
+            GP<GPixmap> scaled = GPixmap::create();
+            GP<GPixmapScaler> scaler = GPixmapScaler::create(width, height,
+                                                             size.width(), size.height());
+            scaler->scale(GRect(0, 0, width, height), *pm,
+                          GRect(0, 0, size.width(), size.height()), *scaled);
+            pm = scaled;
+        }
+        fmt_convert(pm, (char*)image.bits(), image.bytesPerLine());
+    }
+    catch (...)
+    {
+        return false;
+    }
+
+    image_ = image;
+    render_setting_ = render_setting;
+    tiled_ = false;
+    preview_ = true;
+    return true;
+}
+
 QRect DjVuPage::getContentArea(DjVuSource * source)
 {
     if (content_area_.isValid() || !djvuImageDecoded(source))
@@ -49,6 +49,20 @@ public:
     int imageLength();
     void clearImage();
     bool render(DjVuSource * source, const RenderSetting & render_setting);
+
+    // Pages rendered much larger than the screen are rendered in tiles
+    // of TILE_SIZE pixels, only the tiles covering an area at a time.
+    static const int TILE_SIZE = 256;
+    static QRect tileRect(const QSize & size, int column, int row);
+    static void tilesInArea(const QSize & size, const QRect & area, QVector<QPoint> & tiles);
+
+    // A coarse image shown while the page decodes
+    inline bool isPreview() const { return preview_; }
+    bool renderPreview(DjVuSource * source, const RenderSetting & render_setting);
+
+    inline bool isTiled() const { return tiled_; }
+    bool renderTiles(DjVuSource * source, const RenderSetting & render_setting, const QRect & area);
+    bool hasTiles(DjVuSource * source, const RenderSetting & render_setting, const QRect & area);
     QRect getContentArea(DjVuSource * source);
 
     int getTextPosition(DjVuSource * source, const QPoint & pos_in_page, bool return_block_start = false);
@@ -68,6 +82,8 @@ private:
     RenderSetting               render_setting_;
     QImage                      image_;
     QRect                       content_area_;
+    bool                        tiled_;
+    bool                        preview_;
 
     friend class DjVuSource;
 };
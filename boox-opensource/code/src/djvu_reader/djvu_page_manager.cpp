@@ -42,11 +42,16 @@ DjvuPageManager::DjvuPageManager(void)
     : cache_()
     , size_limit_( SIZE_LIMITATION )
     , total_length_( 0 )
+    , reserved_page_( -1 )
+    , tile_clock_( 0 )
+    , request_clock_( 0 )
 {
+    sys::MemoryBroker::instance().registerClient( this, "djvu pages", 10 );
 }
 
 DjvuPageManager::~DjvuPageManager(void)
 {
+    sys::MemoryBroker::instance().unregisterClient( this );
     clear();
 }
 
@@ -54,6 +59,7 @@ DjvuPageManager::~DjvuPageManager(void)
 void DjvuPageManager::clear()
 {
     cache_.clear();
+    tiles_.clear();
     total_length_ = 0;
 }
 
@@ -63,15 +69,24 @@ DjVuPagePtr DjvuPageManager::getPage(int page_num)
     CacheIter iter = cache_.find( page_num );
     if (iter != cache_.end())
     {
+        if ( !iter.value()->image()->isNull() )
+        {
+            sys::MemoryBroker::instance().recordHit( this );
+        }
+        else
+        {
+            sys::MemoryBroker::instance().recordMiss( this );
+        }
         return iter.value();
     }
+    sys::MemoryBroker::instance().recordMiss( this );
     DjVuPagePtr page(new DjVuPage(page_num));
     cache_[page_num] = page;
     return page;
 }
 
-/// Remove a surface for given location
-bool DjvuPageManager::clearImage( int page_num )
+/// Find the image with lowest priority, which is not the image of page_num
+DjvuPageManager::CacheIter DjvuPageManager::findImageToClear( int page_num )
 {
     // remove the surface with lowest priority based on the remove strategy
     CacheIter begin       = cache_.begin();
@@ -89,15 +104,21 @@ bool DjvuPageManager::clearImage( int page_num )
         iter++;
     }
 
-    if ( remove_iter == cache_.end() )
+    if ( remove_iter == cache_.end() ||
+         remove_iter.value()->image()->isNull() ||
+         remove_iter.key() == page_num )
     {
-        return false;
+        return cache_.end();
     }
+    return remove_iter;
+}
 
-    DjVuPagePtr page = getPage( page_num );
-    if ( page != 0 && page == remove_iter.value() )
+/// Remove a surface for given location
+bool DjvuPageManager::clearImage( int page_num )
+{
+    CacheIter remove_iter = findImageToClear( page_num );
+    if ( remove_iter == cache_.end() )
     {
-        // if it is the same surface, return
         return false;
     }
 
@@ -109,6 +130,65 @@ bool DjvuPageManager::clearImage( int page_num )
     return true;
 }
 
+/// Start a new tile request, the tiles of the previous requests can be
+/// cleared from now on
+void DjvuPageManager::beginTileRequest()
+{
+    request_clock_ = ++tile_clock_;
+}
+
+/// Get a rendered tile
+bool DjvuPageManager::getTile( const DjVuTileKey & key, QImage & tile )
+{
+    TileIter iter = tiles_.find( key );
+    if ( iter == tiles_.end() )
+    {
+        return false;
+    }
+    iter.value().last_used = tile_clock_;
+    tile = iter.value().image;
+    return true;
+}
+
+/// Add a rendered tile. The caller makes enough memory for it before
+/// rendering
+void DjvuPageManager::addTile( const DjVuTileKey & key, const QImage & tile )
+{
+    Tile & entry = tiles_[key];
+    total_length_ += tile.numBytes() - entry.image.numBytes();
+    entry.image = tile;
+    entry.last_used = tile_clock_;
+}
+
+/// Find the least recently used tile which is not used by the current
+/// tile request
+DjvuPageManager::TileIter DjvuPageManager::findTileToClear()
+{
+    TileIter remove_iter = tiles_.end();
+    for ( TileIter iter = tiles_.begin(); iter != tiles_.end(); ++iter )
+    {
+        if ( iter.value().last_used < request_clock_ &&
+             ( remove_iter == tiles_.end() ||
+               iter.value().last_used < remove_iter.value().last_used ) )
+        {
+            remove_iter = iter;
+        }
+    }
+    return remove_iter;
+}
+
+bool DjvuPageManager::clearTile()
+{
+    TileIter remove_iter = findTileToClear();
+    if ( remove_iter == tiles_.end() )
+    {
+        return false;
+    }
+    total_length_ -= remove_iter.value().image.numBytes();
+    tiles_.erase( remove_iter );
+    return true;
+}
+
 /// Recalculate length of all pages.
 /// The total length won't be updated unless calling this function
 void DjvuPageManager::recalcTotalLength()
@@ -121,6 +201,11 @@ void DjvuPageManager::recalcTotalLength()
     {
         total_length_ += iter.value()->imageLength();
     }
+
+    for (TileIter tile = tiles_.begin(); tile != tiles_.end(); ++tile)
+    {
+        total_length_ += tile.value().image.numBytes();
+    }
 }
 
 /// Return the total memory consumed by the cache manager
@@ -154,7 +239,8 @@ bool DjvuPageManager::makeEnoughMemory( const int delta, int page_num )
         int updated_limit = ( size_limit_ >> 2 );
         while ( delta + bytesConsume() > updated_limit )
         {
-            if ( !clearImage( page_num ) )
+            // tiles out of sight are cheaper to render again than pages
+            if ( !clearTile() && !clearImage( page_num ) )
             {
                 //qDebug("Skipped Page");
                 return false;
@@ -163,15 +249,55 @@ bool DjvuPageManager::makeEnoughMemory( const int delta, int page_num )
     }
     else
     {
-      while (sys::needReleaseMemory())
-        {
-            if ( !clearImage( page_num ) )
-            {
-                return false;
-            }
-        }
+        reserved_page_ = page_num;
+        bool ret = sys::MemoryBroker::instance().reserve( this, delta );
+        reserved_page_ = -1;
+        return ret;
     }
     return true;
 }
 
+unsigned long DjvuPageManager::memoryUsage()
+{
+    recalcTotalLength();
+    return bytesConsume();
+}
+
+/// Tiles out of sight and pages out of the render requests cost nothing,
+/// the current page most
+int DjvuPageManager::releaseCost()
+{
+    if ( findTileToClear() != tiles_.end() )
+    {
+        return 0;
+    }
+
+    CacheIter iter = findImageToClear( reserved_page_ );
+    if ( iter == cache_.end() )
+    {
+        return -1;
+    }
+    return sys::MIN_RENDER_PRIORITY - qMin( policy_.getPriority( iter.key() ), sys::MIN_RENDER_PRIORITY );
+}
+
+unsigned long DjvuPageManager::releaseMemory()
+{
+    TileIter tile = findTileToClear();
+    if ( tile != tiles_.end() )
+    {
+        unsigned long length = tile.value().image.numBytes();
+        clearTile();
+        return length;
+    }
+
+    CacheIter iter = findImageToClear( reserved_page_ );
+    if ( iter == cache_.end() )
+    {
+        return 0;
+    }
+    unsigned long length = iter.value()->imageLength();
+    clearImage( reserved_page_ );
+    return length;
+}
+
 }
@@ -5,12 +5,42 @@
 #include "djvu_render_policy.h"
 #include "djvu_page.h"
 
+#include "onyx/sys/memory_broker.h"
+
 using namespace vbf;
 
 namespace djvu_reader
 {
 
-class DjvuPageManager
+/// Identify a tile of a page rendered with one setting. The clip area only
+/// moves the tiles in the view, it is not part of the key.
+struct DjVuTileKey
+{
+    int          page;
+    QSize        size;
+    RotateDegree rotation;
+    int          column;
+    int          row;
+
+    DjVuTileKey(int p, const RenderSetting & s, int c, int r)
+        : page(p), size(s.contentArea().size()), rotation(s.rotation())
+        , column(c), row(r) {}
+
+    bool operator == (const DjVuTileKey & right) const
+    {
+        return page == right.page && size == right.size &&
+               rotation == right.rotation &&
+               column == right.column && row == right.row;
+    }
+};
+
+inline uint qHash(const DjVuTileKey & key)
+{
+    return (key.page << 20) ^ (key.size.width() << 10) ^ key.size.height() ^
+           (key.column << 16) ^ key.row ^ (static_cast<uint>(key.rotation) << 28);
+}
+
+class DjvuPageManager : public sys::MemoryClient
 {
 public:
     DjvuPageManager();
@@ -24,15 +54,36 @@ public:
     void setSizeLimit( const int limit );
     bool makeEnoughMemory( const int delta, int page_num );
 
-private:
-    bool clearImage( int page_num );
-    void recalcTotalLength();
-    int  bytesConsume();
+    // tiles of the pages rendered larger than the screen
+    void beginTileRequest();
+    bool getTile( const DjVuTileKey & key, QImage & tile );
+    void addTile( const DjVuTileKey & key, const QImage & tile );
+
+    // sys::MemoryClient
+    unsigned long memoryUsage();
+    int releaseCost();
+    unsigned long releaseMemory();
 
 private:
     typedef QHash< int, DjVuPagePtr > Cache;
     typedef Cache::iterator CacheIter;
 
+    struct Tile
+    {
+        QImage       image;
+        unsigned int last_used;
+    };
+    typedef QHash< DjVuTileKey, Tile > Tiles;
+    typedef Tiles::iterator TileIter;
+
+private:
+    CacheIter findImageToClear( int page_num );
+    bool clearImage( int page_num );
+    TileIter findTileToClear();
+    bool clearTile();
+    void recalcTotalLength();
+    int  bytesConsume();
+
 private:
     Cache cache_;
 
@@ -42,6 +93,14 @@ private:
     // the memory cost of current cached pages
     int total_length_;
 
+    // the page being rendered, never cleared to make room for others
+    int reserved_page_;
+
+    // rendered tiles, the tiles used since the last tile request are kept
+    Tiles tiles_;
+    unsigned int tile_clock_;
+    unsigned int request_clock_;
+
     // render policy
     DjVuRenderPolicy policy_;
 };
@@ -354,6 +354,40 @@ void DjVuSource::prerender(int page_num, const RenderSetting & render_setting)
     tasks_handler_.addTask(task, true);
 }
 
+/// Render the tiles of the visible area of a page, then the tiles next to
+/// it in the direction of panning, so the next pan finds them ready.
+void DjVuSource::renderTiles(int page_num,
+                             const RenderSetting & render_setting,
+                             const QRect & visible_area,
+                             const QPoint & pan_direction)
+{
+    assert(page_num >= 0 && page_num < page_count_);
+
+    page_manager_.beginTileRequest();
+    DjVuPagePtr page = page_manager_.getPage(page_num);
+    if (page->hasTiles(this, render_setting, visible_area))
+    {
+        notifyPageRenderReady(page);
+    }
+    else
+    {
+        DjVuRenderTask * task = new DjVuRenderTask(this, page_num, render_setting, visible_area);
+        tasks_handler_.addTask(task, false);
+    }
+
+    if (!pan_direction.isNull())
+    {
+        QRect next_area = visible_area.translated(pan_direction.x() * visible_area.width(),
+                                                  pan_direction.y() * visible_area.height());
+        next_area &= QRect(QPoint(0, 0), render_setting.contentArea().size());
+        if (next_area.isValid())
+        {
+            DjVuRenderTask * task = new DjVuRenderTask(this, page_num, render_setting, next_area, true);
+            tasks_handler_.addTask(task, true);
+        }
+    }
+}
+
 void DjVuSource::notifyPageRenderReady(DjVuPagePtr page)
 {
     emit pageRenderReady(page);
@@ -36,6 +36,8 @@ public:
 
     void render(int page_num, const RenderSetting & render_setting);
     void prerender(int page_num, const RenderSetting & render_setting);
+    void renderTiles(int page_num, const RenderSetting & render_setting,
+                     const QRect & visible_area, const QPoint & pan_direction);
     void requirePageContentArea(int page_num);
 
 Q_SIGNALS:
@@ -10,6 +10,22 @@ DjVuRenderTask::DjVuRenderTask(DjVuSource * source, int page_num, const RenderSe
 , page_num_(page_num)
 , render_setting_(render_setting)
 , prerender_(prerender)
+, preview_done_(false)
+{
+}
+
+DjVuRenderTask::DjVuRenderTask(DjVuSource * source,
+                               int page_num,
+                               const RenderSetting & render_setting,
+                               const QRect & tile_area,
+                               bool prerender)
+: BaseTask(DJVU_RENDER)
+, source_(source)
+, page_num_(page_num)
+, render_setting_(render_setting)
+, tile_area_(tile_area)
+, prerender_(prerender)
+, preview_done_(false)
 {
 }
 
@@ -29,6 +45,18 @@ void DjVuRenderTask::exec()
 
     DjVuPagePtr page = source_->getPage(page_num_);
 
+    // Decoding blocks until the whole page is decoded. Show a coarse
+    // preview of a visible page first and decode on the next run.
+    if (!preview_done_ && !prerender_ && !tile_area_.isValid() && !render_setting_.isThumbnail())
+    {
+        preview_done_ = true;
+        if (page->renderPreview(source_, render_setting_))
+        {
+            source_->notifyPageRenderReady(page);
+            return;
+        }
+    }
+
     // decode
     source_->getPageDjvuImage(page_num_, false);
 
@@ -39,6 +67,20 @@ void DjVuRenderTask::exec()
         return;
     }
 
+    if (tile_area_.isValid())
+    {
+        if (page->renderTiles(source_, render_setting_, tile_area_))
+        {
+            // tiles rendered ahead of panning are not displayed yet
+            if (!prerender_)
+            {
+                source_->notifyPageRenderReady(page);
+            }
+            abort();
+        }
+        return;
+    }
+
     // render the page
     if (page->render(source_, render_setting_))
     {
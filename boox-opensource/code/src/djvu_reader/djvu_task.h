@@ -19,6 +19,8 @@ class DjVuRenderTask : public BaseTask
 {
 public:
     DjVuRenderTask(DjVuSource * source, int page_num, const RenderSetting & render_setting, bool prerender = false);
+    DjVuRenderTask(DjVuSource * source, int page_num, const RenderSetting & render_setting,
+                   const QRect & tile_area, bool prerender = false);
     virtual ~DjVuRenderTask();
     virtual void exec();
 
@@ -29,7 +31,9 @@ private:
     DjVuSource*    source_;
     int            page_num_;
     RenderSetting  render_setting_;
+    QRect          tile_area_;      ///< render the tiles covering this area only
     bool           prerender_;
+    bool           preview_done_;   ///< the preview is shown before decoding
 };
 
 class DjVuGetContentTask : public BaseTask
@@ -27,6 +27,7 @@ static RotateDegree getSystemRotateDegree()
 DjVuView::DjVuView(QWidget *parent)
     : BaseView(parent, Qt::FramelessWindowHint)
     , model_(0)
+    , preview_page_(-1)
     , restore_count_(0)
     , bookmark_image_(0)
     , auto_flip_current_page_(1)
@@ -188,6 +189,50 @@ bool DjVuView::generateRenderSetting(vbf::PagePtr page, RenderSetting & setting)
     return true;
 }
 
+/// Render a page at once, or only the tiles of it in the view when it is
+/// rendered much larger than the view.
+void DjVuView::renderPage(vbf::PagePtr page, const RenderSetting & setting)
+{
+    QRect area;
+    if (getTileArea(page->key(), setting, area))
+    {
+        model_->source()->renderTiles(page->key(), setting, area, pan_direction_);
+    }
+    else
+    {
+        model_->source()->render(page->key(), setting);
+    }
+}
+
+/// Retrieve the area of the rendered page visible in the view. Return false
+/// if the page should not be rendered in tiles.
+bool DjVuView::getTileArea(int page_num, const RenderSetting & setting, QRect & area)
+{
+    static const int TILE_THRESHOLD = 2;
+
+    QSize page_size = setting.contentArea().size();
+    if (setting.isThumbnail() ||
+        static_cast<qint64>(page_size.width()) * page_size.height() <
+        static_cast<qint64>(TILE_THRESHOLD) * width() * height())
+    {
+        return false;
+    }
+
+    QPoint pos;
+    if (!layout_->getContentPos(page_num, pos))
+    {
+        return false;
+    }
+
+    QRect bounds(QPoint(0, 0), page_size);
+    if (setting.isClipImage())
+    {
+        bounds = setting.clipArea();
+    }
+    area = QRect(bounds.topLeft() - pos, size()).intersected(bounds);
+    return area.isValid();
+}
+
 void DjVuView::onLayoutDone()
 {
     // clear the previous visible pages
@@ -221,7 +266,7 @@ void DjVuView::onLayoutDone()
     // send the render requests
     RenderSetting render_setting;
     generateRenderSetting(page, render_setting);
-    model_->source()->render(page->key(), render_setting);
+    renderPage(page, render_setting);
 
     // load sketch page
     sketch::PageKey page_key;
@@ -396,6 +441,12 @@ void DjVuView::onPageRenderReady(DjVuPagePtr page)
 
 void DjVuView::handleNormalPageReady(DjVuPagePtr page)
 {
+    if (page->isPreview())
+    {
+        handlePreviewReady(page);
+        return;
+    }
+
     if (restore_count_ > 1)
     {
         qDebug("Restore Left:%d", restore_count_);
@@ -435,8 +486,11 @@ void DjVuView::handleNormalPageReady(DjVuPagePtr page)
         return;
     }
 
-    // set the waveform by current paging mode
-    if (display_images_.size() > 0)
+    // set the waveform by current paging mode, a page replacing its own
+    // preview is still the first page displayed
+    bool replace_preview = (preview_page_ == page->getPageNumber() && display_images_.size() == 1);
+    preview_page_ = -1;
+    if (display_images_.size() > 0 && !replace_preview)
     {
         onyx::screen::instance().setDefaultWaveform(onyx::screen::ScreenProxy::GU);
     }
@@ -476,7 +530,7 @@ void DjVuView::handleNormalPageReady(DjVuPagePtr page)
         // send the render requests
         RenderSetting render_setting;
         generateRenderSetting(next_page, render_setting);
-        model_->source()->render(next_page->key(), render_setting);
+        renderPage(next_page, render_setting);
 
         // load sketch page
         sketch::PageKey page_key;
@@ -489,6 +543,49 @@ void DjVuView::handleNormalPageReady(DjVuPagePtr page)
     update();
 }
 
+/// Show the preview of a page still being decoded with the fast waveform.
+/// The page stays in the layout pages, the final image replaces it.
+void DjVuView::handlePreviewReady(DjVuPagePtr page)
+{
+    if (restore_count_ > 1)
+    {
+        return;
+    }
+
+    bool found = false;
+    VisiblePagesIter end = layout_pages_.end();
+    for (VisiblePagesIter idx = layout_pages_.begin(); idx != end; ++idx)
+    {
+        if (page->getPageNumber() == (*idx)->key())
+        {
+            found = true;
+            break;
+        }
+    }
+    if (!found)
+    {
+        return;
+    }
+
+    // the preview is the first page displayed, the busy state must not
+    // cover it while the page is decoded
+    if (sys::SysStatus::instance().isSystemBusy())
+    {
+        sys::SysStatus::instance().setSystemBusy(false);
+    }
+
+    display_images_[page->getPageNumber()] = *(page->image());
+    preview_page_ = page->getPageNumber();
+
+    onyx::screen::instance().enableUpdate(false);
+    repaint();
+    onyx::screen::instance().enableUpdate(true);
+    onyx::screen::instance().updateWidget(this,
+                                          onyx::screen::ScreenProxy::DW,
+                                          false,
+                                          onyx::screen::ScreenCommand::WAIT_NONE);
+}
+
 void DjVuView::displayThumbnailView()
 {
     QWidget* view = down_cast<MainWindow*>(parentWidget())->getView(THUMBNAIL_VIEW);
@@ -1020,6 +1117,9 @@ void DjVuView::scroll(int offset_x, int offset_y)
         x = offset_y;
         y = offset_x;
     }
+
+    // the tiles in this direction are rendered ahead
+    pan_direction_ = QPoint((x > 0) - (x < 0), (y > 0) - (y < 0));
     layout_->scroll(x, y);
 }
 
@@ -1617,7 +1717,14 @@ void DjVuView::setSketchShape( const SketchShape shape )
 
 void DjVuView::paintPage(QPainter & painter, int page_num, QImage image)
 {
-    if (image.isNull() || layout_ == 0)
+    if (layout_ == 0)
+    {
+        return;
+    }
+
+    DjVuPagePtr page = model_->source()->getPage(page_num);
+    bool tiled = (page != 0 && page->isTiled());
+    if (image.isNull() && !tiled)
     {
         return;
     }
@@ -1633,22 +1740,55 @@ void DjVuView::paintPage(QPainter & painter, int page_num, QImage image)
     if (layout_->getContentPos(page_num, cur_pos))
     {
         // draw content of page
-        if (layout_->zoomSetting() != ZOOM_HIDE_MARGIN)
+        if (tiled)
+        {
+            paintTiles(painter, page, cur_pos);
+        }
+        else if (layout_->zoomSetting() != ZOOM_HIDE_MARGIN)
         {
             painter.drawImage(cur_pos, image);
         }
-        else
+        else if (page != 0)
         {
-            DjVuPagePtr page = model_->source()->getPage(page_num);
-            if (page != 0)
-            {
-                painter.drawImage(cur_pos, image, page->renderSetting().clipArea());
-            }
+            painter.drawImage(cur_pos, image, page->renderSetting().clipArea());
         }
     }
     paintSketches(painter, page_num);
 }
 
+/// Draw the rendered tiles in the view, the others are drawn once they
+/// are ready
+void DjVuView::paintTiles(QPainter & painter, DjVuPagePtr page, const QPoint & pos)
+{
+    const RenderSetting & setting = page->renderSetting();
+    QRect area;
+    if (!getTileArea(page->getPageNumber(), setting, area))
+    {
+        return;
+    }
+
+    QPoint origin = setting.isClipImage() ? setting.clipArea().topLeft() : QPoint(0, 0);
+    QSize page_size = setting.contentArea().size();
+    QVector<QPoint> tiles;
+    DjVuPage::tilesInArea(page_size, area, tiles);
+
+    QImage tile;
+    for (int i = 0; i < tiles.size(); ++i)
+    {
+        DjVuTileKey key(page->getPageNumber(), setting, tiles[i].x(), tiles[i].y());
+        if (!model_->source()->pageManager()->getTile(key, tile))
+        {
+            continue;
+        }
+
+        QRect tile_rect = DjVuPage::tileRect(page_size, tiles[i].x(), tiles[i].y());
+        QRect visible = tile_rect.intersected(area);
+        painter.drawImage(pos + visible.topLeft() - origin,
+                          tile,
+                          visible.translated(-tile_rect.topLeft()));
+    }
+}
+
 void DjVuView::paintSketches( QPainter & painter, int page_no )
 {
     QPoint page_pos;
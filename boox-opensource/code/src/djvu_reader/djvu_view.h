@@ -84,6 +84,9 @@ private:
     void switchLayout(PageLayoutType mode);
 
     bool generateRenderSetting(vbf::PagePtr page, RenderSetting & setting);
+    void renderPage(vbf::PagePtr page, const RenderSetting & setting);
+    bool getTileArea(int page_num, const RenderSetting & setting, QRect & area);
+    void paintTiles(QPainter & painter, DjVuPagePtr page, const QPoint & pos);
     void updateCurrentPage(const int page_number);
     bool hitTest(const QPoint &point);
     bool hitTestBookmark(const QPoint &point);
@@ -91,6 +94,7 @@ private:
 
     // handle page ready events
     void handleNormalPageReady(DjVuPagePtr page);
+    void handlePreviewReady(DjVuPagePtr page);
     void handleThumbnailReady(DjVuPagePtr page);
 
     // configurations
@@ -190,6 +194,7 @@ private:
     SketchProxy             sketch_proxy_;              ///< sketch proxy
     StrokeArea              stroke_area_;               ///< stroke area
     PanArea                 pan_area_;                  ///< pan area
+    QPoint                  pan_direction_;             ///< direction of the last pan
     StatusManager           status_mgr_;                ///< status manager
 
     ViewSetting             view_setting_;              ///< current view setting
@@ -198,6 +203,7 @@ private:
     QVector<int>            rendering_pages_;           ///< list of pages' indexes for rendering
 
     DisplayImages           display_images_;            ///< display images
+    int                     preview_page_;              ///< page displayed as preview, -1 if none
 
     // Popup menu actions
     ZoomSettingActions      zoom_setting_actions_;
@@ -233,6 +239,7 @@ private:
 inline void DjVuView::clearVisiblePages()
 {
     display_images_.clear();
+    preview_page_ = -1;
 }
 
 };
@@ -11,6 +11,22 @@ int main(int argc, char* argv[])
     Q_INIT_RESOURCE(onyx_ui_images);
     Q_INIT_RESOURCE(dictionary_images);
 
+    if (app.isPooled())
+    {
+        // Every time the user leaves the document, the event loop returns.
+        // Park the reader until explorer sends the next document.
+        int ret = 0;
+        do
+        {
+            ret = app.exec();
+            if (app.isPooled())
+            {
+                app.park();
+            }
+        } while (ret == 0 && app.isPooled());
+        return ret;
+    }
+
     if (app.open(app.currentPath()))
     {
         return app.exec();
@@ -17,6 +17,8 @@
  * 02110-1301, USA.
  */
 
+#include <ZLibrary.h>
+#include <ZLFile.h>
 #include <ZLOptions.h>
 #include <ZLDialogManager.h>
 #include <ZLStringUtil.h>
@@ -35,6 +37,7 @@
 static const std::string PARAGRAPH_OPTION_NAME = "Paragraph";
 static const std::string WORD_OPTION_NAME = "Word";
 static const std::string CHAR_OPTION_NAME = "Char";
+static const std::string PAGES_DIR_NAME = "pages";
 static const std::string BUFFER_SIZE = "UndoBufferSize";
 static const std::string POSITION_IN_BUFFER = "PositionInBuffer";
 static const char * const BUFFER_PARAGRAPH_PREFIX = "Paragraph_";
@@ -57,6 +60,12 @@ void BookTextView::setModel(shared_ptr<ZLTextModel> model, const std::string &la
 
 	myFileName = fileName;
 
+	// The cache is checked against the text before it is used, a book
+	// that shares the name with another one is only counted again.
+	ZLFile pagesDir("~" + ZLibrary::FileNameDelimiter + ZLibrary::ApplicationName() + ZLibrary::FileNameDelimiter + PAGES_DIR_NAME);
+	pagesDir.directory(true);
+	setPaginationFile(pagesDir.path() + ZLibrary::FileNameDelimiter + ZLFile(fileName).name(false));
+
 	gotoPosition(
 		ZLIntegerOption(ZLCategoryKey::STATE, fileName, PARAGRAPH_OPTION_NAME, 0).value(),
 		ZLIntegerOption(ZLCategoryKey::STATE, fileName, WORD_OPTION_NAME, 0).value(),
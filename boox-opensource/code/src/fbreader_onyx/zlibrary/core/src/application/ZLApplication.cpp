@@ -173,6 +173,12 @@ void ZLApplication::presentWindow() {
     }
 }
 
+void ZLApplication::onSearchFinished() {
+    if (myViewWidget != 0) {
+        myViewWidget->onSearchFinished();
+    }
+}
+
 void ZLApplication::Action::checkAndRun() {
     if (isEnabled()) {
         run();
@@ -17,6 +17,8 @@
  * 02110-1301, USA.
  */
 
+#include <string.h>
+
 #include "ZLSearchUtil.h"
 #include "ZLUnicodeUtil.h"
 
@@ -30,48 +32,49 @@ ZLSearchPattern::ZLSearchPattern(const std::string &pattern, bool ignoreCase) {
 	}
 }
 
+// The first byte of the pattern is looked for with memchr, or with a
+// two-byte check when the case is ignored; the rest is compared only at
+// the positions where the first byte matches.
 int ZLSearchUtil::find(const char *text, size_t length, const ZLSearchPattern &pattern, int pos) {
+	if (pos < 0) {
+		pos = 0;
+	}
+	const std::string &lower = pattern.lowerCasePattern();
+	const size_t patternLength = lower.length();
+	if ((patternLength == 0) || (length < patternLength) || ((size_t)pos > length - patternLength)) {
+		return -1;
+	}
+	const char *last = text + length - patternLength;
+
 	if (pattern.ignoreCase()) {
-		if (pos < 0) {
-			pos = 0;
-		}
-		const std::string &lower = pattern.lowerCasePattern();
 		const std::string &upper = pattern.upperCasePattern();
-		const char *last = text + length - pattern.lowerCasePattern().length();
-		const char *patternLast = lower.data() + lower.length() - 1;
+		const char lowerFirst = lower[0];
+		const char upperFirst = upper[0];
 		for (const char *i = text + pos; i <= last; ++i) {
-			const char *j0 = lower.data();
-			const char *j1 = upper.data();
-			const char *k = i;
-			for (; j0 <= patternLast; ++j0, ++j1, ++k) {
-				if ((*j0 != *k) && (*j1 != *k)) {
+			if ((*i != lowerFirst) && (*i != upperFirst)) {
+				continue;
+			}
+			size_t j = 1;
+			for (; j < patternLength; ++j) {
+				if ((lower[j] != i[j]) && (upper[j] != i[j])) {
 					break;
 				}
 			}
-			if (j0 > patternLast) {
+			if (j == patternLength) {
 				return i - text;
 			}
 		}
-		return -1;
 	} else {
-		if (pos < 0) {
-			pos = 0;
-		}
-		const std::string &lower = pattern.lowerCasePattern();
-		const char *last = text + length - pattern.lowerCasePattern().length();
-		const char *patternLast = lower.data() + lower.length() - 1;
+		const char first = lower[0];
 		for (const char *i = text + pos; i <= last; ++i) {
-			const char *j0 = lower.data();
-			const char *k = i;
-			for (; j0 <= patternLast; ++j0, ++k) {
-				if (*j0 != *k) {
-					break;
-				}
+			i = (const char*)memchr(i, first, last - i + 1);
+			if (i == 0) {
+				break;
 			}
-			if (j0 > patternLast) {
+			if (memcmp(i + 1, lower.data() + 1, patternLength - 1) == 0) {
 				return i - text;
 			}
 		}
-		return -1;
 	}
+	return -1;
 }
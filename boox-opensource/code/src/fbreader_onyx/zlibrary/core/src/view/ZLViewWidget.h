@@ -51,6 +51,9 @@ public:
 	void onScrollbarStep(ZLView::Direction direction, int steps);
 	void onScrollbarPageStep(ZLView::Direction direction, int steps);
 
+	// Called when a text search running in the background has finished.
+	virtual void onSearchFinished();
+
     virtual bool  isHyperlinkSelected() { return false;};
 
 private:
@@ -69,6 +72,7 @@ friend class ZLApplication;
 inline ZLViewWidget::ZLViewWidget(ZLView::Angle initialAngle)
     : myView(), myRotation(initialAngle) {}
 inline ZLViewWidget::~ZLViewWidget() {}
+inline void ZLViewWidget::onSearchFinished() {}
 inline shared_ptr<ZLView> ZLViewWidget::view() const { return myView; }
 
 #endif /* __ZLVIEWWIDGET_H__ */
@@ -22,6 +22,8 @@
 
 #include <vector>
 #include <string>
+#include <list>
+#include <map>
 
 #include "ZLTextHyphenator.h"
 
@@ -41,6 +43,7 @@ private:
 	unsigned char *myValues;
 
 friend class ZLTextTeXPatternComparator;
+friend class ZLTextTeXHyphenator;
 };
 
 class ZLTextTeXPatternComparator {
@@ -55,6 +58,7 @@ private:
 	static const std::string PatternZip();
 
 public:
+	ZLTextTeXHyphenator();
 	~ZLTextTeXHyphenator();
 
 	void load(const std::string &language);
@@ -64,12 +68,49 @@ public:
 protected:
 	void hyphenate(ZLUnicodeUtil::Ucs4String &ucs4String, std::vector<unsigned char> &mask, int length) const;
 
+private:
+	// The patterns are compiled into a trie that is kept in a file, the
+	// next load of the language maps the file instead of parsing the xml.
+	// Edges of a node are sorted by symbol; a node that ends a pattern
+	// refers to the pattern values, one more than the node depth.
+	struct TrieNode {
+		unsigned int FirstEdge;
+		unsigned int EdgeNumber;
+		unsigned int Values;
+		unsigned int ValueNumber;
+	};
+
+	struct TrieEdge {
+		ZLUnicodeUtil::Ucs4Char Symbol;
+		unsigned int Node;
+	};
+
+	std::string trieKey(const std::string &language) const;
+	std::string trieFileName(const std::string &language) const;
+	bool mapTrie(const std::string &fileName, const std::string &key);
+	void compileTrie(const std::string &key);
+	void saveTrie(const std::string &fileName) const;
+	bool setTrie(const char *data, size_t size, const std::string &key);
+	const TrieNode *child(const TrieNode &node, ZLUnicodeUtil::Ucs4Char symbol) const;
+
 private:
 	typedef std::vector<ZLTextTeXHyphenationPattern*>::const_iterator PatternIterator;
+	typedef std::list<std::pair<ZLUnicodeUtil::Ucs4String,std::vector<unsigned char> > > MaskList;
 
 	std::vector<ZLTextTeXHyphenationPattern*> myPatternTable;
 	std::string myLanguage;
 
+	std::string myTrieBuffer;
+	void *myMappedTrie;
+	size_t myMappedTrieSize;
+	const TrieNode *myNodes;
+	const TrieEdge *myEdges;
+	const unsigned char *myValues;
+
+	mutable std::vector<unsigned char> myPatternValues;
+	mutable MaskList myMasks;
+	mutable std::map<ZLUnicodeUtil::Ucs4String,MaskList::iterator> myMaskIndex;
+
 friend class ZLTextHyphenationReader;
 };
 
@@ -26,7 +26,7 @@
 #include "ZLTextModel.h"
 #include "ZLTextParagraph.h"
 
-ZLTextModel::ZLTextModel(const size_t rowSize) : myAllocator(rowSize), myLastEntryStart(0) {
+ZLTextModel::ZLTextModel(const size_t rowSize) : myAllocator(rowSize), myLastEntryStart(0), mySearchStart(0), mySearchEnd(0), mySearchOrigin(0), mySearchIndex(0), mySearchWrapped(false), myMarkInsertIndex(0) {
 }
 
 ZLTextModel::~ZLTextModel() {
@@ -36,27 +36,77 @@ ZLTextModel::~ZLTextModel() {
 }
 
 void ZLTextModel::search(const std::string &text, size_t startIndex, size_t endIndex, bool ignoreCase) const {
-	ZLSearchPattern pattern(text, ignoreCase);
+	startSearch(text, startIndex, endIndex, startIndex, ignoreCase);
+	while (searchParagraphs(1024)) {
+	}
+}
+
+// The paragraphs from originIndex to endIndex are searched first, then the
+// ones from startIndex to originIndex. The marks are kept sorted all the
+// time, so the ones found so far can be used while the search goes on.
+void ZLTextModel::startSearch(const std::string &text, size_t startIndex, size_t endIndex, size_t originIndex, bool ignoreCase) const {
 	myMarks.clear();
+	mySearchPattern.reset(new ZLSearchPattern(text, ignoreCase));
+	mySearchEnd = std::min(endIndex, myParagraphs.size());
+	mySearchStart = std::min(startIndex, mySearchEnd);
+	mySearchOrigin = std::max(mySearchStart, std::min(originIndex, mySearchEnd));
+	mySearchIndex = mySearchOrigin;
+	mySearchWrapped = false;
+	myMarkInsertIndex = 0;
+}
+
+// Searches at most number paragraphs. Returns false when the search is
+// finished or has been stopped.
+bool ZLTextModel::searchParagraphs(size_t number) const {
+	if (!mySearchPattern) {
+		return false;
+	}
+	for (; number > 0; --number) {
+		if (!mySearchWrapped && (mySearchIndex >= mySearchEnd)) {
+			mySearchWrapped = true;
+			mySearchIndex = mySearchStart;
+		}
+		if (mySearchWrapped && (mySearchIndex >= mySearchOrigin)) {
+			mySearchPattern.reset();
+			return false;
+		}
+		searchParagraph(mySearchIndex++);
+	}
+	return true;
+}
 
-	std::vector<ZLTextParagraph*>::const_iterator start =
-		(startIndex < myParagraphs.size()) ? myParagraphs.begin() + startIndex : myParagraphs.end();
-	std::vector<ZLTextParagraph*>::const_iterator end =
-		(endIndex < myParagraphs.size()) ? myParagraphs.begin() + endIndex : myParagraphs.end();
-	for (std::vector<ZLTextParagraph*>::const_iterator it = start; it < end; ++it) {
-		int offset = 0;
-		for (ZLTextParagraph::Iterator jt = **it; !jt.isEnd(); jt.next()) {
-			if (jt.entryKind() == ZLTextParagraphEntry::TEXT_ENTRY) {
-				const ZLTextEntry& textEntry = (ZLTextEntry&)*jt.entry();
-				const char *str = textEntry.data();
-				const size_t len = textEntry.dataLength();
-				for (int pos = ZLSearchUtil::find(str, len, pattern); pos != -1; pos = ZLSearchUtil::find(str, len, pattern, pos + 1)) {
-					myMarks.push_back(ZLTextMark(it - myParagraphs.begin(), offset + pos, pattern.length()));
-				}
-				offset += len;
+void ZLTextModel::stopSearch() const {
+	mySearchPattern.reset();
+}
+
+void ZLTextModel::removeAllMarks() {
+	stopSearch();
+	myMarks.clear();
+}
+
+void ZLTextModel::searchParagraph(size_t index) const {
+	const ZLSearchPattern &pattern = *mySearchPattern;
+	std::vector<ZLTextMark> marks;
+	int offset = 0;
+	for (ZLTextParagraph::Iterator it = *myParagraphs[index]; !it.isEnd(); it.next()) {
+		if (it.entryKind() == ZLTextParagraphEntry::TEXT_ENTRY) {
+			const char *str = it.textData();
+			const size_t len = it.textDataLength();
+			for (int pos = ZLSearchUtil::find(str, len, pattern); pos != -1; pos = ZLSearchUtil::find(str, len, pattern, pos + 1)) {
+				marks.push_back(ZLTextMark(index, offset + pos, pattern.length()));
 			}
+			offset += len;
 		}
 	}
+	if (marks.empty()) {
+		return;
+	}
+	if (mySearchWrapped) {
+		myMarks.insert(myMarks.begin() + myMarkInsertIndex, marks.begin(), marks.end());
+		myMarkInsertIndex += marks.size();
+	} else {
+		myMarks.insert(myMarks.end(), marks.begin(), marks.end());
+	}
 }
 
 void ZLTextModel::selectParagraph(size_t index) const {
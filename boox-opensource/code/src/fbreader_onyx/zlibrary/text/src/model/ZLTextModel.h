@@ -33,6 +33,7 @@ using namespace std;
 
 class ZLTextParagraph;
 class ZLTextTreeParagraph;
+class ZLSearchPattern;
 
 class ZLTextModel {
 	
@@ -55,6 +56,10 @@ public:
 	const std::vector<ZLTextMark> &marks() const;
 
 	virtual void search(const std::string &text, size_t startIndex, size_t endIndex, bool ignoreCase) const;
+	void startSearch(const std::string &text, size_t startIndex, size_t endIndex, size_t originIndex, bool ignoreCase) const;
+	bool searchParagraphs(size_t number) const;
+	bool isSearchFinished() const;
+	void stopSearch() const;
 	virtual void selectParagraph(size_t index) const;
 	void removeAllMarks();
 
@@ -76,6 +81,9 @@ protected:
 	void addParagraphInternal(ZLTextParagraph *paragraph);
 	void removeParagraphInternal(int index);
 	
+private:
+	void searchParagraph(size_t index) const;
+
 private:
 	std::vector<ZLTextParagraph*> myParagraphs;
 	mutable std::vector<ZLTextMark> myMarks;
@@ -83,6 +91,14 @@ private:
 
 	char *myLastEntryStart;
 
+	mutable shared_ptr<ZLSearchPattern> mySearchPattern;
+	mutable size_t mySearchStart;
+	mutable size_t mySearchEnd;
+	mutable size_t mySearchOrigin;
+	mutable size_t mySearchIndex;
+	mutable bool mySearchWrapped;
+	mutable size_t myMarkInsertIndex;
+
 private:
 	ZLTextModel(const ZLTextModel&);
 	const ZLTextModel &operator = (const ZLTextModel&);
@@ -116,7 +132,7 @@ private:
 
 inline size_t ZLTextModel::paragraphsNumber() const { return myParagraphs.size(); }
 inline const std::vector<ZLTextMark> &ZLTextModel::marks() const { return myMarks; }
-inline void ZLTextModel::removeAllMarks() { myMarks.clear(); }
+inline bool ZLTextModel::isSearchFinished() const { return !mySearchPattern; }
 
 inline ZLTextParagraph *ZLTextModel::operator[] (size_t index) {
 	return myParagraphs[min(myParagraphs.size() - 1, index)];
@@ -75,6 +75,13 @@ ZLTextStyleEntry::ZLTextStyleEntry(char *address) {
 	}
 }
 
+// The text of a text entry without creating the entry object.
+size_t ZLTextParagraph::Iterator::textDataLength() const {
+	size_t len;
+	memcpy(&len, myPointer + 1, sizeof(size_t));
+	return len;
+}
+
 const shared_ptr<ZLTextParagraphEntry> ZLTextParagraph::Iterator::entry() const {
 	if (!myEntry) {
 		switch (*myPointer) {
@@ -248,6 +248,8 @@ public:
 		void next();
 		const shared_ptr<ZLTextParagraphEntry> entry() const;
 		ZLTextParagraphEntry::Kind entryKind() const;
+		const char *textData() const;
+		size_t textDataLength() const;
 
 	private:
 		char *myPointer;
@@ -407,6 +409,7 @@ inline ZLTextParagraph::Iterator::Iterator(const ZLTextParagraph &paragraph) : m
 inline ZLTextParagraph::Iterator::~Iterator() {}
 inline bool ZLTextParagraph::Iterator::isEnd() const { return myIndex == myEndIndex; }
 inline ZLTextParagraphEntry::Kind ZLTextParagraph::Iterator::entryKind() const { return (ZLTextParagraphEntry::Kind)*myPointer; }
+inline const char *ZLTextParagraph::Iterator::textData() const { return myPointer + 1 + sizeof(size_t); }
 
 inline ZLTextSpecialParagraph::ZLTextSpecialParagraph(Kind kind) : myKind(kind) {}
 inline ZLTextSpecialParagraph::~ZLTextSpecialParagraph() {}
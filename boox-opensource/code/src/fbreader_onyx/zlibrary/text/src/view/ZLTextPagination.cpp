@@ -0,0 +1,326 @@
+/*
+ * Copyright (C) 2004-2009 Geometer Plus <contact@geometerplus.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include <algorithm>
+
+#include <ZLFile.h>
+#include <ZLInputStream.h>
+#include <ZLOutputStream.h>
+#include <ZLStringUtil.h>
+
+#include <ZLTextModel.h>
+
+#include "ZLTextView.h"
+#include "ZLTextLineInfo.h"
+
+// The book is laid out page by page with the same code the view uses to
+// scroll forward, so the page starts match the pages the reader sees. The
+// layout shares the paint context and the paragraph cursor cache with the
+// view, so it runs on the gui thread in short slices between events.
+static const int PAGINATION_INTERVAL = 50;
+static const int PAGINATION_SLICE = 20;
+
+static const char PAGINATION_MAGIC[4] = { 'Z', 'L', 'P', 'G' };
+static const unsigned int PAGINATION_VERSION = 1;
+
+class ZLTextPaginator : public ZLRunnable {
+
+public:
+	ZLTextPaginator(ZLTextView &view);
+
+private:
+	void run();
+
+private:
+	ZLTextView &myView;
+};
+
+ZLTextPaginator::ZLTextPaginator(ZLTextView &view) : myView(view) {
+}
+
+void ZLTextPaginator::run() {
+	myView.paginate();
+}
+
+struct ZLTextPageParagraphLess {
+	bool operator () (const ZLTextView::PageStart &page, int paragraph) const {
+		return page.Paragraph < paragraph;
+	}
+};
+
+static bool operator < (const ZLTextView::PageStart &page0, const ZLTextView::PageStart &page1) {
+	if (page0.Paragraph != page1.Paragraph) {
+		return page0.Paragraph < page1.Paragraph;
+	}
+	if (page0.Element != page1.Element) {
+		return page0.Element < page1.Element;
+	}
+	return page0.Char < page1.Char;
+}
+
+static ZLTextView::PageStart pageStart(const ZLTextWordCursor &cursor) {
+	ZLTextView::PageStart page;
+	page.Paragraph = cursor.paragraphCursor().index();
+	page.Element = cursor.elementIndex();
+	page.Char = cursor.charIndex();
+	return page;
+}
+
+static bool readNumber(ZLInputStream &stream, unsigned int &number) {
+	return stream.read((char*)&number, sizeof(number)) == sizeof(number);
+}
+
+static void writeNumber(ZLOutputStream &stream, unsigned int number) {
+	stream.write((const char*)&number, sizeof(number));
+}
+
+// fileName is a path prefix, every layout of the book gets its own file
+// next to it. Pages are only counted for views that have one.
+void ZLTextView::setPaginationFile(const std::string &fileName) {
+	stopPagination();
+	myPaginationFile = fileName;
+	myPaginationKey.erase();
+	myPageStarts.clear();
+	myPaginationFinished = false;
+	checkPagination();
+}
+
+// Everything the page breaks depend on. Options of single styles are not
+// listed, changing them is rare and only shifts the numbers until the next
+// change of the base style.
+std::string ZLTextView::paginationKey() const {
+	if (!myModel || (myModel->paragraphsNumber() == 0)) {
+		return std::string();
+	}
+
+	ZLTextBaseStyle &style = ZLTextStyleCollection::instance().baseStyle();
+	std::string key = style.FontFamilyOption.value();
+	key += ':';
+	ZLStringUtil::appendNumber(key, style.FontSizeOption.value());
+	key += ':';
+	ZLStringUtil::appendNumber(key, style.LineSpacePercentOption.value());
+	key += ':';
+	ZLStringUtil::appendNumber(key, style.AlignmentOption.value());
+	key += style.BoldOption.value() ? 'b' : '-';
+	key += style.ItalicOption.value() ? 'i' : '-';
+	key += style.AutoHyphenationOption.value() ? 'h' : '-';
+	key += ':';
+	ZLStringUtil::appendNumber(key, viewWidth());
+	key += 'x';
+	ZLStringUtil::appendNumber(key, textAreaHeight());
+	key += ':';
+	key += myLanguage;
+	key += ':';
+	ZLStringUtil::appendNumber(key, myModel->paragraphsNumber());
+	key += ':';
+	ZLStringUtil::appendNumber(key, myTextSize.back());
+	return key;
+}
+
+std::string ZLTextView::paginationFileName() const {
+	unsigned int hash = 2166136261U;
+	for (std::string::const_iterator it = myPaginationKey.begin(); it != myPaginationKey.end(); ++it) {
+		hash = (hash ^ (unsigned char)*it) * 16777619U;
+	}
+	static const char digits[] = "0123456789abcdef";
+	std::string fileName = myPaginationFile + '.';
+	for (int shift = 28; shift >= 0; shift -= 4) {
+		fileName += digits[(hash >> shift) & 0xf];
+	}
+	return fileName;
+}
+
+// Called whenever the paint info has been rebuilt, so a new font or
+// window size is noticed before the next page number is shown.
+void ZLTextView::checkPagination() {
+	if (myPaginationFile.empty()) {
+		return;
+	}
+	const std::string key = paginationKey();
+	if (key.empty() || (key == myPaginationKey)) {
+		return;
+	}
+
+	stopPagination();
+	myPaginationKey = key;
+	myPageStarts.clear();
+	myPaginationFinished = false;
+	readPagination();
+	if (!myPaginationFinished) {
+		if (!myPaginator) {
+			myPaginator.reset(new ZLTextPaginator(*this));
+		}
+		ZLTimeManager::instance().addTask(myPaginator, PAGINATION_INTERVAL);
+	}
+}
+
+// Keeps what has been counted so far, the next run for the same layout
+// continues from the last page.
+void ZLTextView::stopPagination() {
+	if (myPaginator) {
+		ZLTimeManager::instance().removeTask(myPaginator);
+	}
+	writePagination();
+}
+
+void ZLTextView::paginate() {
+	if (!myModel || myPaginationFinished) {
+		stopPagination();
+		return;
+	}
+
+	ZLTextWordCursor cursor;
+	if (myPageStarts.empty()) {
+		cursor = ZLTextParagraphCursor::cursor(*myModel, myLanguage);
+		myPageStarts.push_back(pageStart(cursor));
+	} else {
+		const PageStart &last = myPageStarts.back();
+		cursor = ZLTextParagraphCursor::cursor(*myModel, myLanguage, last.Paragraph);
+		cursor.moveTo(last.Element, last.Char);
+	}
+
+	// The lines of the counted pages must not be kept, the view only caches
+	// the lines of the pages around the current one. Its cache is set aside
+	// while counting and put back afterwards.
+	std::set<ZLTextLineInfoPtr> viewCache;
+	viewCache.swap(myLineInfoCache);
+
+	std::vector<ZLTextLineInfoPtr> infos;
+	const ZLTime start;
+	do {
+		if (cursor.paragraphCursor().isLast() && cursor.isEndOfParagraph()) {
+			myPaginationFinished = true;
+			break;
+		}
+		ZLTextWordCursor end = buildInfos(cursor, infos);
+		if (end == cursor) {
+			myPaginationFinished = true;
+			break;
+		}
+		cursor = end;
+		if (!cursor.paragraphCursor().isLast() || !cursor.isEndOfParagraph()) {
+			myPageStarts.push_back(pageStart(cursor));
+		}
+		myPaginationChanged = true;
+	} while (ZLTime().millisecondsFrom(start) < PAGINATION_SLICE);
+
+	myLineInfoCache.swap(viewCache);
+
+	if (myPaginationFinished) {
+		myPaginationChanged = true;
+		stopPagination();
+	}
+}
+
+void ZLTextView::readPagination() {
+	shared_ptr<ZLInputStream> stream = ZLFile(paginationFileName()).inputStream();
+	if (!stream || !stream->open()) {
+		return;
+	}
+
+	char magic[sizeof(PAGINATION_MAGIC)];
+	unsigned int version = 0;
+	unsigned int keyLength = 0;
+	if ((stream->read(magic, sizeof(magic)) != sizeof(magic)) ||
+			!std::equal(magic, magic + sizeof(magic), PAGINATION_MAGIC) ||
+			!readNumber(*stream, version) || (version != PAGINATION_VERSION) ||
+			!readNumber(*stream, keyLength) || (keyLength != myPaginationKey.length())) {
+		stream->close();
+		return;
+	}
+
+	std::string key(keyLength, '\0');
+	unsigned int finished = 0;
+	unsigned int count = 0;
+	if (((keyLength > 0) && (stream->read(&key[0], keyLength) != keyLength)) ||
+			(key != myPaginationKey) ||
+			!readNumber(*stream, finished) || !readNumber(*stream, count)) {
+		stream->close();
+		return;
+	}
+
+	std::vector<PageStart> pages(count);
+	const size_t size = count * sizeof(PageStart);
+	if ((count > 0) && (stream->read((char*)&pages.front(), size) != size)) {
+		stream->close();
+		return;
+	}
+	stream->close();
+
+	myPageStarts.swap(pages);
+	myPaginationFinished = (finished != 0) && !myPageStarts.empty();
+	myPaginationChanged = false;
+}
+
+void ZLTextView::writePagination() {
+	if (!myPaginationChanged || myPaginationFile.empty() || myPaginationKey.empty()) {
+		return;
+	}
+	myPaginationChanged = false;
+
+	shared_ptr<ZLOutputStream> stream = ZLFile(paginationFileName()).outputStream();
+	if (!stream || !stream->open()) {
+		return;
+	}
+	stream->write(PAGINATION_MAGIC, sizeof(PAGINATION_MAGIC));
+	writeNumber(*stream, PAGINATION_VERSION);
+	writeNumber(*stream, myPaginationKey.length());
+	stream->write(myPaginationKey);
+	writeNumber(*stream, myPaginationFinished ? 1 : 0);
+	writeNumber(*stream, myPageStarts.size());
+	if (!myPageStarts.empty()) {
+		stream->write((const char*)&myPageStarts.front(), myPageStarts.size() * sizeof(PageStart));
+	}
+	stream->close();
+}
+
+// Pages of the text the current position belongs to. A page starting in
+// the paragraph that ends the previous text is counted to the next one.
+bool ZLTextView::exactPageRange(size_t &from, size_t &to) const {
+	if (!hasExactPages()) {
+		return false;
+	}
+	std::vector<size_t>::const_iterator i = nextBreakIterator();
+	const int startIndex = (i != myTextBreaks.begin()) ? *(i - 1) : 0;
+	const int endIndex = (i != myTextBreaks.end()) ? *i : myModel->paragraphsNumber();
+	from = std::lower_bound(myPageStarts.begin(), myPageStarts.end(), startIndex, ZLTextPageParagraphLess()) - myPageStarts.begin();
+	to = std::lower_bound(myPageStarts.begin(), myPageStarts.end(), endIndex, ZLTextPageParagraphLess()) - myPageStarts.begin();
+	return from < to;
+}
+
+size_t ZLTextView::exactPageIndex() const {
+	size_t from, to;
+	if (startCursor().isNull() || !exactPageRange(from, to)) {
+		return 0;
+	}
+	std::vector<PageStart>::const_iterator it =
+		std::upper_bound(myPageStarts.begin() + from, myPageStarts.begin() + to, pageStart(startCursor()));
+	const size_t index = it - myPageStarts.begin() - from;
+	return std::max(index, (size_t)1);
+}
+
+void ZLTextView::gotoExactPage(size_t index) {
+	size_t from, to;
+	if (!exactPageRange(from, to)) {
+		return;
+	}
+	index = std::min(std::max(index, (size_t)1), to - from);
+	const PageStart &page = myPageStarts[from + index - 1];
+	gotoPosition(page.Paragraph, page.Element, page.Char);
+}
@@ -269,6 +269,8 @@ void ZLTextView::preparePaintInfo() {
 	}
 	myPaintState = READY;
 	myLineInfoCache.clear();
+
+	checkPagination();
 }
 
 ZLTextWordCursor ZLTextView::findStart(const ZLTextWordCursor &end, SizeUnit unit, int size) {
@@ -306,7 +308,11 @@ ZLTextWordCursor ZLTextView::findStart(const ZLTextWordCursor &end, SizeUnit uni
 }
 
 ZLTextWordCursor ZLTextView::buildInfos(const ZLTextWordCursor &start) {
-	myLineInfos.clear();
+	return buildInfos(start, myLineInfos);
+}
+
+ZLTextWordCursor ZLTextView::buildInfos(const ZLTextWordCursor &start, std::vector<ZLTextLineInfoPtr> &infos) {
+	infos.clear();
 
 	ZLTextWordCursor cursor = start;
 	int textAreaHeight = this->textAreaHeight();
@@ -329,7 +335,7 @@ ZLTextWordCursor ZLTextView::buildInfos(const ZLTextWordCursor &start) {
 			}
 			textAreaHeight -= infoPtr->VSpaceAfter;
 			cursor = infoPtr->End;
-			myLineInfos.push_back(infoPtr);
+			infos.push_back(infoPtr);
 			if (textAreaHeight < 0) {
 				break;
 			}
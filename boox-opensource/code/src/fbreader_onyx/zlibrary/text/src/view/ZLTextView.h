@@ -36,6 +36,7 @@
 #include <ZLTextSelectionModel.h>
 #include <ZLTextArea.h>
 #include <ZLTextParagraph.h>
+#include <ZLTextMark.h>
 
 class ZLTextModel;
 class ZLTextMark;
@@ -155,6 +156,15 @@ public:
 	size_t pageIndex();
 	size_t pageNumber() const;
 
+	struct PageStart {
+		int Paragraph;
+		int Element;
+		int Char;
+	};
+
+	void setPaginationFile(const std::string &fileName);
+	bool hasExactPages() const;
+
 	void scrollPage(bool forward, ScrollingMode mode, unsigned int value);
 	void scrollToStartOfText();
 	void scrollToEndOfText();
@@ -175,6 +185,8 @@ public:
 	void findNext();
 	bool canFindPrevious() const;
 	void findPrevious();
+	void stopSearch();
+	bool isSearchFinished() const;
 
 	void highlightParagraph(int paragraphNumber);
 
@@ -247,6 +259,7 @@ private:
 	ZLTextWordCursor findStart(const ZLTextWordCursor &end, SizeUnit unit, int textHeight);
 
 	ZLTextWordCursor buildInfos(const ZLTextWordCursor &start);
+	ZLTextWordCursor buildInfos(const ZLTextWordCursor &start, std::vector<ZLTextLineInfoPtr> &infos);
 
 	std::vector<size_t>::const_iterator nextBreakIterator() const;
 
@@ -261,6 +274,20 @@ private:
 
 	void gotoCharIndex(size_t charIndex);
 
+	void checkPagination();
+	void stopPagination();
+	void paginate();
+	std::string paginationKey() const;
+	std::string paginationFileName() const;
+	void readPagination();
+	void writePagination();
+	bool exactPageRange(size_t &from, size_t &to) const;
+	size_t exactPageIndex() const;
+	void gotoExactPage(size_t index);
+
+	void continueSearch();
+	size_t visibleMarkNumber() const;
+
 private:
 	shared_ptr<ZLTextModel> myModel;
 	std::string myLanguage;
@@ -298,6 +325,24 @@ private:
 	bool myTreeStateIsFrozen;
 	bool myDoUpdateScrollbar;
 
+	std::string myPaginationFile;
+	std::string myPaginationKey;
+	std::vector<PageStart> myPageStarts;
+	bool myPaginationFinished;
+	bool myPaginationChanged;
+	shared_ptr<ZLRunnable> myPaginator;
+
+	enum {
+		SEARCH_GOAL_NONE,
+		SEARCH_GOAL_FIRST,
+		SEARCH_GOAL_LAST,
+		SEARCH_GOAL_NEXT,
+		SEARCH_GOAL_PREVIOUS
+	} mySearchGoal;
+	ZLTextMark mySearchPosition;
+	size_t myVisibleMarkNumber;
+	shared_ptr<ZLRunnable> mySearcher;
+
 	struct DoubleClickInfo {
 		DoubleClickInfo();
 		void update(int x, int y, bool press);
@@ -309,6 +354,8 @@ private:
 	} myDoubleClickInfo;
 
 friend class ZLTextSelectionModel;
+friend class ZLTextPaginator;
+friend class ZLTextSearcher;
 };
 
 inline ZLTextView::ViewStyle::~ViewStyle() {}
@@ -321,6 +368,7 @@ inline void ZLTextView::ViewStyle::decreaseBidiLevel() { if (myBidiLevel > myBas
 inline unsigned char ZLTextView::ViewStyle::bidiLevel() const { return myBidiLevel; }
 
 inline bool ZLTextView::empty() const { return myPaintState == NOTHING_TO_PAINT; }
+inline bool ZLTextView::hasExactPages() const { return myPaginationFinished && !myPageStarts.empty(); }
 inline const ZLTextWordCursor &ZLTextView::startCursor() const { return myStartCursor; }
 inline const ZLTextWordCursor &ZLTextView::endCursor() const { return myEndCursor; }
 inline const shared_ptr<ZLTextModel> ZLTextView::model() const { return myModel; }
@@ -24,16 +24,33 @@
 #include <QtGui/QImage>
 
 #include <ZLImage.h>
+#include <ZLStringUtil.h>
 
 #include "ZLQtPaintContext.h"
 #include "../image/ZLQtImageManager.h"
 
+static const size_t MAX_CACHED_WORDS = 8192;
+
+static bool isAscii(const char *str, int len) {
+	for (const char *end = str + len; str < end; ++str) {
+		if ((unsigned char)*str >= 128) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static QString qString(const char *str, int len) {
+	return isAscii(str, len) ? QString::fromLatin1(str, len) : QString::fromUtf8(str, len);
+}
+
 ZLQtPaintContext::ZLQtPaintContext() {
 	myPainter = new QPainter();
 	myPixmap = 0;
 	mySpaceWidth = -1;
 	myDescent = 0;
 	myFontIsStored = false;
+	myWidthCache = 0;
 }
 
 ZLQtPaintContext::~ZLQtPaintContext() {
@@ -124,6 +141,11 @@ void ZLQtPaintContext::setFont(const std::string &family, int size, bool bold, b
 			myPainter->setFont(font);
 			mySpaceWidth = -1;
 			myDescent = myPainter->fontMetrics().descent();
+			std::string key = family;
+			key += bold ? "/b" : "/-";
+			key += italic ? 'i' : '-';
+			ZLStringUtil::appendNumber(key, size);
+			myWidthCache = &myWidthCaches[key];
 		}
 	}
 }
@@ -144,7 +166,21 @@ void ZLQtPaintContext::setFillColor(ZLColor color, FillStyle style) {
 }
 
 int ZLQtPaintContext::stringWidth(const char *str, int len, bool) const {
-	return myPainter->fontMetrics().width(QString::fromUtf8(str, len));
+	if (myWidthCache == 0) {
+		return myPainter->fontMetrics().width(QString::fromUtf8(str, len));
+	}
+
+	const std::string word(str, len);
+	WidthCache::const_iterator it = myWidthCache->find(word);
+	if (it != myWidthCache->end()) {
+		return it->second;
+	}
+	if (myWidthCache->size() >= MAX_CACHED_WORDS) {
+		myWidthCache->clear();
+	}
+	const int width = myPainter->fontMetrics().width(qString(str, len));
+	myWidthCache->insert(std::pair<std::string,int>(word, width));
+	return width;
 }
 
 int ZLQtPaintContext::spaceWidth() const {
@@ -163,9 +199,11 @@ int ZLQtPaintContext::stringHeight() const {
 }
 
 void ZLQtPaintContext::drawString(int x, int y, const char *str, int len, bool rtl) {
-	QString qStr = QString::fromUtf8(str, len);
-	myPainter->setLayoutDirection(rtl ? Qt::RightToLeft : Qt::LeftToRight);
-	myPainter->drawText(x, y, qStr);
+	const Qt::LayoutDirection direction = rtl ? Qt::RightToLeft : Qt::LeftToRight;
+	if (myPainter->layoutDirection() != direction) {
+		myPainter->setLayoutDirection(direction);
+	}
+	myPainter->drawText(x, y, qString(str, len));
 }
 
 void ZLQtPaintContext::drawImage(int x, int y, const ZLImageData &image) {
@@ -20,6 +20,9 @@
 #ifndef __ZLQTPAINTCONTEXT_H__
 #define __ZLQTPAINTCONTEXT_H__
 
+#include <map>
+#include <string>
+
 #include <ZLPaintContext.h>
 
 class QPainter;
@@ -59,12 +62,21 @@ public:
 	void fillRectangle(int x0, int y0, int x1, int y1);
 	void drawFilledCircle(int x, int y, int r);
 
+private:
+	// Word widths measured with one font. Line breaking measures every
+	// word several times, so the widths are kept for all fonts used on a
+	// page. Whole words are measured, so kerning is taken into account.
+	typedef std::map<std::string,int> WidthCache;
+
 private:
 	QPainter *myPainter;
 	QPixmap *myPixmap;
 	mutable int mySpaceWidth;
 	int myDescent;
 
+	mutable std::map<std::string,WidthCache> myWidthCaches;
+	mutable WidthCache *myWidthCache;
+
 	bool myFontIsStored;
 	std::string myStoredFamily;
 	int myStoredSize;
@@ -104,6 +104,7 @@ ZLQtViewWidget::ZLQtViewWidget(QWidget *parent, ZLApplication *application)
 , status_bar_(0)
 , sys_status_(sys::SysStatus::instance())
 , enable_text_selection_(false)
+, find_pending_(false)
 , conf_stored_(false)
 , point_(0,0)
 {
@@ -1158,6 +1159,7 @@ bool ZLQtViewWidget::updateSearchCriteria()
 
 void ZLQtViewWidget::onSearch(BaseSearchContext& context)
 {
+    find_pending_ = false;
     if (search_context_.userData() <= BEFORE_SEARCH)
     {
         myApplication->SearchPatternOption.setValue(context.pattern().toUtf8().constData());
@@ -1165,24 +1167,23 @@ void ZLQtViewWidget::onSearch(BaseSearchContext& context)
         myApplication->doAction("search");
         search_context_.userData() = IN_SEARCHING;
 
-        // TODO
-        updateSearchWidget();
+        // A long search goes on in the background, the widget is
+        // updated by onSearchFinished then.
+        if (isSearchFinished())
+        {
+            updateSearchWidget();
+        }
     }
     else
     {
-        if (context.forward())
+        if (updateSearchWidget())
         {
-            if (updateSearchWidget())
-            {
-                myApplication->doAction("findNext");
-            }
+            myApplication->doAction(context.forward() ? "findNext" : "findPrevious");
         }
-        else
+        else if (!isSearchFinished())
         {
-            if (updateSearchWidget())
-            {
-                myApplication->doAction("findPrevious");
-            }
+            // The match can be in the part of the book not searched yet.
+            find_pending_ = true;
         }
     }
 }
@@ -1190,23 +1191,40 @@ void ZLQtViewWidget::onSearch(BaseSearchContext& context)
 /// Return true if we can continue searching.
 bool ZLQtViewWidget::updateSearchWidget()
 {
-    if (search_context_.forward())
+    const std::string action = search_context_.forward() ? "findNext" : "findPrevious";
+    if (!myApplication->action(action)->isEnabled())
     {
-        if (!myApplication->action("findNext")->isEnabled())
+        // No more matches is known only when the whole book is searched.
+        if (isSearchFinished())
         {
             search_widget_->noMoreMatches();
-            return false;
         }
+        return false;
     }
-    else
+    return true;
+}
+
+bool ZLQtViewWidget::isSearchFinished()
+{
+    ZLTextView *ptr = static_cast<ZLTextView *>(view().get());
+    return ptr == 0 || ptr->isSearchFinished();
+}
+
+/// Called by the view when the background search has finished. Runs the
+/// find next/previous that was pressed while the search was going on.
+void ZLQtViewWidget::onSearchFinished()
+{
+    const bool find = find_pending_;
+    find_pending_ = false;
+    if (!search_widget_ || search_context_.userData() != IN_SEARCHING)
     {
-        if (!myApplication->action("findPrevious")->isEnabled())
-        {
-            search_widget_->noMoreMatches();
-            return false;
-        }
+        return;
+    }
+
+    if (updateSearchWidget() && find)
+    {
+        myApplication->doAction(search_context_.forward() ? "findNext" : "findPrevious");
     }
-    return true;
 }
 
 void ZLQtViewWidget::lookup()
@@ -1243,6 +1261,7 @@ void ZLQtViewWidget::onDictClosed()
 
 void ZLQtViewWidget::onSearchClosed()
 {
+    find_pending_ = false;
     myApplication->doAction("clearSearchResult");
 }
 
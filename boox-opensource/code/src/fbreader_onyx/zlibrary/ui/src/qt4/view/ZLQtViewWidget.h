@@ -87,6 +87,7 @@ public Q_SLOTS:
     void onSearch(BaseSearchContext&);
     bool updateSearchWidget();
     void onSearchClosed();
+    void onSearchFinished();
 
     void lookup();
     void onDictClosed();
@@ -122,6 +123,7 @@ private:
     void stopDictLookup();
 
     void showSearchWidget();
+    bool isSearchFinished();
     bool updateSearchCriteria();
 
     bool addBookmark();
@@ -204,6 +206,7 @@ private:
 
     BaseSearchContext search_context_;
     scoped_ptr<SearchWidget> search_widget_;
+    bool find_pending_;
 
     ZLApplication *myApplication;
     bool conf_stored_;
@@ -8,6 +8,8 @@
 #include <QSqlDatabase>
 #include <QString>
 
+#include "onyx/cms/sql_storage.h"
+
 namespace onyx {
 namespace feed_reader {
 
@@ -24,8 +26,8 @@ shared_ptr<Database> Database::getShared() {
 }
 
 Database::Database()
-        : db_(QSqlDatabase::database()) {
-    if (!db_.isOpen()) {
+        : db_(QSqlDatabase::database(QSqlDatabase::defaultConnection, false)) {
+    if (!cms::SqlStorage::open(db_)) {
         qDebug() << "Cannot open: " << Database::path_;
         QMessageBox::critical(
                 0,
@@ -38,6 +40,7 @@ Database::Database()
 }
 
 Database::~Database() {
+    cms::SqlStorage::close(db_);
     db_.close();
     db_ = QSqlDatabase();  // Decrease ref count.
 }
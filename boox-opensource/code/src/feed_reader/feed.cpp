@@ -23,9 +23,21 @@ namespace feed_reader {
 bool Feed::createTable() {
     shared_ptr<Database> db(Database::getShared());
     QSqlQuery query;
-    return query.exec("CREATE TABLE IF NOT EXISTS feeds"
-                      "(id INTEGER PRIMARY KEY AUTOINCREMENT,"
-                      " title, site_url, feed_url UNIQUE NOT NULL);");
+    if (!query.exec("CREATE TABLE IF NOT EXISTS feeds"
+                    "(id INTEGER PRIMARY KEY AUTOINCREMENT,"
+                    " title, site_url, feed_url UNIQUE NOT NULL,"
+                    " etag, last_modified);")) {
+        return false;
+    }
+    // Databases created by older versions lack the validator columns.
+    QSqlRecord record = QSqlDatabase::database().record("feeds");
+    if (!record.contains("etag")) {
+        query.exec("ALTER TABLE feeds ADD COLUMN etag;");
+    }
+    if (!record.contains("last_modified")) {
+        query.exec("ALTER TABLE feeds ADD COLUMN last_modified;");
+    }
+    return true;
 }
 
 // static
@@ -66,11 +78,18 @@ vector<shared_ptr<Article> >* Feed::mutable_articles() {
     return &articles_;
 }
 
+// Store all articles of the feed in one transaction, so the database
+// is synced once per feed instead of once per article.
 bool Feed::saveArticles() {
+    Article::createTableIfNeeded();
+    shared_ptr<Database> db(Database::getShared());
+    QSqlDatabase database = QSqlDatabase::database();
+    if (!database.transaction()) {
+        qDebug() << "Cannot start transaction:" << database.lastError().text();
+    }
+
     for (int i = articles_.size()-1; i >= 0; --i) {
         shared_ptr<Article> article(articles_[i]);
-        // TODO: Perhaps we should skip saving articles that already
-        // exists?
         if (article->existsInDbAndIsRead()) {
             article->set_read(true);
         }
@@ -78,6 +97,12 @@ bool Feed::saveArticles() {
             qDebug() << "Failed to save article.";
         }
     }
+
+    if (!database.commit()) {
+        qDebug() << "Cannot commit articles:" << database.lastError().text();
+        database.rollback();
+        return false;
+    }
     return true;
 }
 
@@ -116,13 +141,16 @@ bool Feed::update() {
     {
         QSqlQuery query;
         if (!query.prepare("UPDATE feeds SET "
-                           "title=:title, site_url=:site_url "
+                           "title=:title, site_url=:site_url, "
+                           "etag=:etag, last_modified=:last_modified "
                            "WHERE feed_url=:feed_url")) {
             ReportDatabaseError(query, "Error preparing to update feed.");
             return false;
         }
         query.addBindValue(title_);
         query.addBindValue(site_url_.toString());
+        query.addBindValue(QString::fromLatin1(etag_));
+        query.addBindValue(QString::fromLatin1(last_modified_));
         query.addBindValue(feed_url_.toString());
         if (!query.exec()) {
             ReportDatabaseError(query, "Error updating feed.");
@@ -186,6 +214,10 @@ void Feed::initializeFromQuery(QSqlQuery* query) {
                  .toString());
     set_feed_url(query->value(query->record().indexOf("feed_url"))
                  .toString());
+    set_etag(query->value(query->record().indexOf("etag"))
+             .toString().toLatin1());
+    set_last_modified(query->value(query->record().indexOf("last_modified"))
+                      .toString().toLatin1());
 }
 
 //static
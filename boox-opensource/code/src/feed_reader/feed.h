@@ -3,6 +3,7 @@
 #ifndef ONYX_FEED_READER_FEED_H__
 #define ONYX_FEED_READER_FEED_H__
 
+#include <QByteArray>
 #include <QString>
 #include <QUrl>
 
@@ -58,6 +59,24 @@ class Feed {
         feed_url_ = QUrl(url);
     }
 
+    // Validators of the last response, sent back as If-None-Match and
+    // If-Modified-Since so an unchanged feed is not downloaded again.
+    const QByteArray& etag() const {
+        return etag_;
+    }
+
+    void set_etag(const QByteArray& etag) {
+        etag_ = etag;
+    }
+
+    const QByteArray& last_modified() const {
+        return last_modified_;
+    }
+
+    void set_last_modified(const QByteArray& last_modified) {
+        last_modified_ = last_modified;
+    }
+
     const vector<shared_ptr<Article> >& articles();
     vector<shared_ptr<Article> >* mutable_articles();
 
@@ -86,6 +105,8 @@ class Feed {
     QString title_;
     QUrl site_url_;
     QUrl feed_url_;
+    QByteArray etag_;
+    QByteArray last_modified_;
     int id_;
     vector<shared_ptr<Article> > articles_;
 
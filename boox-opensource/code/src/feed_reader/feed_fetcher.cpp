@@ -1,115 +1,221 @@
 // -*- mode: c++; c-basic-offset: 4; -*-
 
-#include <queue>
+#include <string.h>
+#include <deque>
 
 #include <QDebug>
-#include <QHttp>
-#include <QXmlStreamReader>
+#include <QHash>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
 #include <QTextCodec>
 #include "onyx/base/base.h"
 #include "onyx/base/shared_ptr.h"
 #include "onyx/ui/message_dialog.h"
+#include "article.h"
 #include "feed.h"
 #include "feed_fetcher.h"
 #include "feed_parser.h"
 
-#include <QDir>
-#include <QFile>
 namespace onyx {
 namespace feed_reader {
 
+namespace {
+
+// Enough to hide the latency of slow servers without flooding the
+// wireless link.
+const int MAX_CONNECTIONS = 4;
+const int MAX_REDIRECTS = 5;
+
+enum ParseMode {
+    // The root element has not arrived yet.
+    PARSE_UNDECIDED,
+    // Feed the parser while the body streams in.
+    PARSE_STREAMING,
+    // Keep the whole body and parse it after xmlAtomValidator, needed
+    // for Atom feeds with unescaped markup and for GB encodings.
+    PARSE_BUFFERED
+};
+
+}  // namespace
+
+struct FeedFetcher::Fetch {
+    shared_ptr<Feed> feed;
+    scoped_ptr<FeedParser> parser;
+    QByteArray bytes;
+    ParseMode mode;
+    int redirects;
+    // Number of articles the feed had before this fetch, restored when
+    // the body has to be parsed again.
+    size_t article_count;
+};
+
 struct FeedFetcher::Impl {
-    shared_ptr<Feed> current_feed_;
-    std::queue<shared_ptr<Feed> > pending_feeds_;
-    QXmlStreamReader xml_;
-    int connection_id_;
+    std::deque<shared_ptr<Feed> > pending_feeds_;
+    QHash<QNetworkReply*, Fetch*> active_;
+    // Prototype of the per connection parsers.
     scoped_ptr<FeedParser> parser_;
-    scoped_ptr<QHttp> http_;
+    scoped_ptr<QNetworkAccessManager> manager_;
 };
 
 FeedFetcher::FeedFetcher(FeedParser* parser) : impl_(new Impl) {
     impl_->parser_.reset(parser);
-    bytes_.clear();
-    init();
+    impl_->manager_.reset(new QNetworkAccessManager);
 }
 
-void FeedFetcher::init() {
-    impl_->http_.reset(new QHttp);
-    connect(impl_->http_.get(), SIGNAL(readyRead(const QHttpResponseHeader &)),
-            this, SLOT(readData(const QHttpResponseHeader &)));
+FeedFetcher::~FeedFetcher() {
+    // The replies may still emit finished() while the program is being
+    // closed.
+    abortAll();
+}
 
-    connect(impl_->http_.get(), SIGNAL(requestFinished(int, bool)),
-            this, SLOT(finishFetch(int, bool)));
+void FeedFetcher::abortAll() {
+    QHash<QNetworkReply*, Fetch*>::iterator it = impl_->active_.begin();
+    for (; it != impl_->active_.end(); ++it) {
+        it.key()->disconnect(this);
+        it.key()->abort();
+        it.key()->deleteLater();
+        delete it.value();
+    }
+    impl_->active_.clear();
 }
 
-FeedFetcher::~FeedFetcher() {}
+bool FeedFetcher::isQueued(const shared_ptr<Feed>& feed) const {
+    for (size_t i = 0; i < impl_->pending_feeds_.size(); ++i) {
+        if (impl_->pending_feeds_[i]->feed_url() == feed->feed_url()) {
+            return true;
+        }
+    }
+    foreach (Fetch* fetch, impl_->active_) {
+        if (fetch->feed->feed_url() == feed->feed_url()) {
+            return true;
+        }
+    }
+    return false;
+}
 
 void FeedFetcher::startFetch() {
-    // Do nothing if the queue is empty, or we haven't done with the
-    // current feed.
-    qDebug() << "To check whether the queue is empty";
-    if (impl_->pending_feeds_.empty() || impl_->current_feed_.get()) {
-        return;
-    }
-    qDebug() << "To check whether the program is being closed";
-    // When the program is being closed, QHttp may emit a
-    // requestFinished signal that triggers this function.
-    if (!impl_->parser_.get()) {
-        return;
+    while (!impl_->pending_feeds_.empty() &&
+           impl_->active_.size() < MAX_CONNECTIONS) {
+        Fetch* fetch = new Fetch;
+        fetch->feed = impl_->pending_feeds_.front();
+        impl_->pending_feeds_.pop_front();
+        assert(fetch->feed.get());
+        fetch->redirects = 0;
+        fetch->article_count = fetch->feed->articles().size();
+        sendRequest(0, fetch, fetch->feed->feed_url());
     }
+}
 
-    impl_->xml_.clear();
-    impl_->connection_id_ = -1;
-    impl_->current_feed_ = impl_->pending_feeds_.front();
-    assert(impl_->current_feed_.get());
-    impl_->parser_->startNewFeed(impl_->current_feed_);
-    const QUrl& url(impl_->current_feed_->feed_url());
-    int port = (url.port() == -1 ? 80 : url.port());
-    init();
-    CHECK(impl_->http_.get());
+// Start a request for fetch. previous is the reply that redirected to
+// url, or 0 for the first request.
+void FeedFetcher::sendRequest(QNetworkReply* previous, Fetch* fetch,
+                              const QUrl& url) {
+    if (previous) {
+        impl_->active_.remove(previous);
+        previous->deleteLater();
+    }
+    fetch->parser.reset(impl_->parser_->createNew());
+    fetch->parser->startNewFeed(fetch->feed);
+    fetch->bytes.clear();
+    fetch->mode = PARSE_UNDECIDED;
+    fetch->feed->mutable_articles()->resize(fetch->article_count);
 
-    impl_->http_->setHost(url.host(), port);
-    impl_->connection_id_ = impl_->http_->get(url.toString());
+    QNetworkRequest request(url);
+    if (!fetch->feed->etag().isEmpty()) {
+        request.setRawHeader("If-None-Match", fetch->feed->etag());
+    }
+    if (!fetch->feed->last_modified().isEmpty()) {
+        request.setRawHeader("If-Modified-Since",
+                             fetch->feed->last_modified());
+    }
+    QNetworkReply* reply = impl_->manager_->get(request);
+    impl_->active_.insert(reply, fetch);
+    connect(reply, SIGNAL(readyRead()), this, SLOT(readData()));
+    connect(reply, SIGNAL(finished()), this, SLOT(finishFetch()));
 }
 
 void FeedFetcher::scheduleFetch(shared_ptr<Feed> feed) {
     CHECK(feed.get());
+    if (isQueued(feed)) {
+        qDebug() << "Feed already queued: " << feed->feed_url();
+        return;
+    }
     qDebug() << "Feed added to queue: " << feed->feed_url();
-    // TODO(hjiang): Check if the feed is already in the queue.
-    impl_->pending_feeds_.push(feed);
+    impl_->pending_feeds_.push_back(feed);
     startFetch();
 }
 
-void FeedFetcher::readData(const QHttpResponseHeader& response_header) {
-    if(!impl_->current_feed_.get())
+void FeedFetcher::readData() {
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    Fetch* fetch = impl_->active_.value(reply, 0);
+    if (!fetch) {
         return;
-    int statusCode =  response_header.statusCode();
-    qDebug() << statusCode;
-    if (statusCode == 200) {
-        //TODO in order to insert CDATA to invalid XML atom,
-        //we need capture data of full page
-        bytes_.append(impl_->http_->readAll());
-//         qDebug() << bytes_.size() << " bytes received.";
-        // insert CDATA FLAG if not exists
-    } else if ((statusCode >300 || statusCode <300)
-        && (response_header.hasKey("location") || response_header.hasKey("Location"))) {
-        qDebug()<<response_header.statusCode();
-        QUrl location = QUrl(response_header.value("location"));
-        if (location.isEmpty()) {
-            location = QUrl(response_header.value("Location"));
+    }
+    int status_code =
+            reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (status_code != 200) {
+        // Redirects and errors are handled when the reply is finished.
+        reply->readAll();
+        return;
+    }
+    parseChunk(fetch, reply->readAll());
+}
+
+// Choose the parse mode from the document prolog and feed the parser
+// as long as streaming is possible.
+void FeedFetcher::parseChunk(Fetch* fetch, const QByteArray& data) {
+    fetch->bytes.append(data);
+    if (fetch->mode == PARSE_UNDECIDED) {
+        const QByteArray& bytes = fetch->bytes;
+        int pos = 0;
+        while ((pos = bytes.indexOf('<', pos)) >= 0 &&
+               pos + 1 < bytes.size() &&
+               (bytes.at(pos + 1) == '?' || bytes.at(pos + 1) == '!')) {
+            ++pos;
+        }
+        if (pos < 0 || pos + 1 >= bytes.size()) {
+            return;
+        }
+        int end = pos + 1;
+        while (end < bytes.size() && !strchr(" \t\r\n/>", bytes.at(end))) {
+            ++end;
+        }
+        if (end >= bytes.size()) {
+            return;
+        }
+        QByteArray root = bytes.mid(pos + 1, end - pos - 1);
+        QByteArray prolog = bytes.left(pos).toUpper();
+        if (root.endsWith("feed") || prolog.contains("ENCODING=\"GB")) {
+            fetch->mode = PARSE_BUFFERED;
+            return;
+        }
+        fetch->mode = PARSE_STREAMING;
+        if (!fetch->parser->append(bytes)) {
+            fetch->mode = PARSE_BUFFERED;
+        }
+    } else if (fetch->mode == PARSE_STREAMING) {
+        if (!fetch->parser->append(data)) {
+            qDebug() << "Streaming parse failed, falling back: "
+                     << fetch->parser->errorString();
+            fetch->mode = PARSE_BUFFERED;
         }
-        qDebug() << location;
-        impl_->http_.get()->setHost(location.host(),80);
-        impl_->connection_id_ = impl_->http_.get()->get(location.toString());
-    } else if (statusCode == 404) {
-       //NOTE: Do Nothing
-       qDebug() << "404 !!";
-    } else {
-        qDebug() << "Received non-200 response code: "
-                 << statusCode << response_header.toString();
     }
 }
 
+// Parse the complete body again after fixing it up.
+bool FeedFetcher::parseBuffered(Fetch* fetch) {
+    fetch->feed->mutable_articles()->resize(fetch->article_count);
+    fetch->parser.reset(impl_->parser_->createNew());
+    fetch->parser->startNewFeed(fetch->feed);
+    if (!fetch->parser->append(xmlAtomValidator(fetch->bytes))) {
+        qDebug() << "Error parsing feed: "
+                 << fetch->parser->errorString();
+        return false;
+    }
+    return true;
+}
+
 QByteArray FeedFetcher::xmlAtomValidator(const QByteArray& d)
 {
     static QRegExp rx_encoding = QRegExp("<\?xml version=\"1.0\" encoding=\"([^\?>]+)\"");
@@ -145,47 +251,68 @@ QByteArray FeedFetcher::xmlAtomValidator(const QByteArray& d)
     return xml_plain_text.toUtf8();
 }
 
-void FeedFetcher::finishFetch(int connection_id, bool error) {
-    // process data here, yeah, need a better way
-    if (bytes_.isEmpty()) return;
-    QByteArray bytes = xmlAtomValidator(bytes_);
-    //TODO emit signal to caller that whether the request is finished
-    if (!impl_->parser_->append(bytes)) {
-        qDebug() << "Error parsing feed: "
-                    << impl_->parser_->errorString();
-    }
-    bytes_.clear();
-    qDebug() << "Connection finished: " << connection_id;
-    if (connection_id == impl_->connection_id_) {
-        // Stop and clear all pending fetch ops if this is true
-        // (network connection problem).
-        bool has_error = false;
-        if (error) {
-            qDebug() << "Received error during HTTP fetch: "
-                     << impl_->http_->errorString();
-            QHttp::Error e = impl_->http_->error();
-            if (e == QHttp::HostNotFound || e == QHttp::UnknownError) {
-                has_error = true;
-            }
+void FeedFetcher::finishFetch() {
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    Fetch* fetch = impl_->active_.value(reply, 0);
+    if (!fetch) {
+        return;
+    }
+
+    if (reply->error() != QNetworkReply::NoError) {
+        qDebug() << "Received error during HTTP fetch: "
+                 << reply->errorString();
+        QNetworkReply::NetworkError e = reply->error();
+        if (e == QNetworkReply::HostNotFoundError ||
+            e == QNetworkReply::UnknownNetworkError) {
+            // Stop and clear all pending fetch ops (network connection
+            // problem).
+            impl_->pending_feeds_.clear();
+            abortAll();
+            emit networkError();
+            return;
+        }
+    } else {
+        int status_code = reply->attribute(
+                QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        QUrl location = reply->attribute(
+                QNetworkRequest::RedirectionTargetAttribute).toUrl();
+        if (location.isValid() && fetch->redirects < MAX_REDIRECTS) {
+            qDebug() << "Redirected to " << location;
+            ++fetch->redirects;
+            sendRequest(reply, fetch, reply->url().resolved(location));
+            return;
+        }
+
+        if (status_code == 304) {
+            qDebug() << "Feed not modified: " << fetch->feed->feed_url();
+        } else if (status_code != 200) {
+            qDebug() << "Received non-200 response code: " << status_code;
         } else {
-            if (impl_->parser_->hasError()) {
+            parseChunk(fetch, reply->readAll());
+            bool ok = true;
+            if (fetch->mode != PARSE_STREAMING ||
+                !fetch->parser->finished()) {
+                ok = parseBuffered(fetch);
+            }
+            if (!ok || fetch->parser->hasError()) {
                 qDebug() << "Error parsing feed: "
-                         << impl_->parser_->errorString();
-            } else if (impl_->parser_->finished()) {
-                impl_->parser_->finalize();
-                emit feedUpdated(impl_->parser_->feed());
+                         << fetch->parser->errorString();
+            } else if (fetch->parser->finished()) {
+                fetch->feed->set_etag(reply->rawHeader("ETag"));
+                fetch->feed->set_last_modified(
+                        reply->rawHeader("Last-Modified"));
+                fetch->parser->finalize();
+                emit feedUpdated(fetch->parser->feed());
             } else {
                 qDebug() << "Feed ended prematurely!";
             }
         }
-        impl_->pending_feeds_.pop();
-        impl_->current_feed_.reset();
-        if (has_error) {
-            emit networkError();
-            return;
-        }
-        startFetch();
     }
+
+    impl_->active_.remove(reply);
+    reply->deleteLater();
+    delete fetch;
+    startFetch();
 }
 
 }  // namespace feed_reader
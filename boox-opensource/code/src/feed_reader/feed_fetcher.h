@@ -9,13 +9,16 @@
 #include "onyx/base/shared_ptr.h"
 #include "feed.h"
 
-class QHttpResponseHeader;
+class QNetworkReply;
 
 namespace onyx {
 namespace feed_reader {
 
 class FeedParser;
 
+// Fetches feeds over up to MAX_CONNECTIONS parallel connections. The
+// body is parsed while it arrives, and a feed that has not changed
+// since the last fetch is answered with 304 and not downloaded again.
 class FeedFetcher : public QObject {
     Q_OBJECT;
   public:
@@ -30,20 +33,22 @@ class FeedFetcher : public QObject {
     void networkError();
 
   private slots:
-    void readData(const QHttpResponseHeader& response_header);
-    void finishFetch(int id, bool error);
+    void readData();
+    void finishFetch();
 
   private:
+    struct Fetch;
+
     void startFetch();
-    void parseXml();
+    void sendRequest(QNetworkReply* previous, Fetch* fetch, const QUrl& url);
+    void parseChunk(Fetch* fetch, const QByteArray& data);
+    bool parseBuffered(Fetch* fetch);
+    bool isQueued(const shared_ptr<Feed>& feed) const;
+    void abortAll();
     QByteArray xmlAtomValidator(const QByteArray&);
-    // Reinitialize the state of the object. Called before starting to
-    // fetch a new feed.
-    void init();
 
     struct Impl;
     scoped_ptr<Impl> impl_;
-    QByteArray bytes_;
 
     NO_COPY_AND_ASSIGN(FeedFetcher);
 };
@@ -18,6 +18,9 @@ class FeedParser {
   public:
     FeedParser() {}
     virtual ~FeedParser() {};
+    // Create an empty parser of the same kind. The fetcher uses one
+    // parser per connection.
+    FeedParser* createNew() const { return createNewInternal(); }
     void startNewFeed(shared_ptr<Feed> feed /* outputv */) {
         startNewFeedInternal(feed);
     };
@@ -34,6 +37,7 @@ class FeedParser {
     }
 
   private:
+    virtual FeedParser* createNewInternal() const = 0;
     virtual void startNewFeedInternal(shared_ptr<Feed> feed) = 0;
     virtual bool appendInternal(const QByteArray& data) = 0;
     virtual bool hasErrorInternal() const = 0;
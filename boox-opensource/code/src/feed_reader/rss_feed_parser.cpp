@@ -25,6 +25,10 @@ RssFeedParser::RssFeedParser()
 RssFeedParser::~RssFeedParser() {
 }
 
+FeedParser* RssFeedParser::createNewInternal() const {
+    return new RssFeedParser;
+}
+
 void RssFeedParser::startNewFeedInternal(shared_ptr<Feed> feed) {
     feed_ = feed;
     current_text_.clear();
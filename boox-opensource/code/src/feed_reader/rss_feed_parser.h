@@ -19,6 +19,7 @@ class RssFeedParser : public FeedParser {
     virtual ~RssFeedParser();
 
   private:
+    virtual FeedParser* createNewInternal() const;
     virtual void startNewFeedInternal(shared_ptr<Feed> feed);
     virtual bool appendInternal(const QByteArray& data);
     virtual bool hasErrorInternal() const;
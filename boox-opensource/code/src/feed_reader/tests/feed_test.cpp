@@ -173,5 +173,47 @@ TEST_F(FeedTest, UnreadCount) {
     }
 }
 
+TEST_F(FeedTest, SaveArticles) {
+    {
+        Feed feed;
+        feed.set_feed_url("http://baidu.com");
+        ASSERT_TRUE(feed.saveNew());
+    }
+    shared_ptr<Feed> feed(Feed::loadByUrl("http://baidu.com"));
+    ASSERT_TRUE(feed.get());
+    {
+        Article article(feed);
+        article.set_url("http://someurl/1");
+        article.set_title("read before");
+        article.set_read(true);
+        ASSERT_TRUE(article.saveOrUpdate());
+    }
+
+    const char* URLS[] = { "http://someurl/1", "http://someurl/2",
+                           "http://someurl/3" };
+    const size_t URL_COUNT = sizeof(URLS) / sizeof(URLS[0]);
+    for (int round = 0; round < 2; ++round) {
+        feed->mutable_articles()->clear();
+        for (size_t i = 0; i < URL_COUNT; ++i) {
+            shared_ptr<Article> article(new Article(feed));
+            article->set_url(URLS[i]);
+            article->set_title("fetched");
+            feed->mutable_articles()->push_back(article);
+        }
+        ASSERT_TRUE(feed->saveArticles());
+    }
+
+    // Saved again, the articles replace the stored ones and keep
+    // their read state.
+    vector<shared_ptr<Article> > articles;
+    ASSERT_TRUE(Article::loadByFeed(feed, &articles));
+    ASSERT_EQ(URL_COUNT, articles.size());
+    for (size_t i = 0; i < articles.size(); ++i) {
+        EXPECT_EQ("fetched", articles[i]->title());
+        EXPECT_EQ(articles[i]->url() == URLS[0], articles[i]->read());
+    }
+    EXPECT_EQ(2, feed->unreadCount());
+}
+
 }  // namespace onyx
 }  // namespace feed_reader
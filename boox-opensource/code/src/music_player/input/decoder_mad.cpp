@@ -33,6 +33,8 @@ DecoderMAD::DecoderMAD(QObject *parent, DecoderFactory *d, QIODevice *i, Output
     , bitrate_(0)
     , freq_(0)
     , len_(0)
+    , skip_samples_(0)
+    , remaining_samples_(-1)
     , input_buf_(0)
     , input_bytes_(0)
     , output_buf_(0)
@@ -79,6 +81,8 @@ bool DecoderMAD::initialize()
     bitrate_ = 0;
     freq_ = 0;
     len_ = 0;
+    skip_samples_ = 0;
+    remaining_samples_ = -1;
     input_bytes_ = 0;
     output_bytes_ = 0;
     output_at_ = 0;
@@ -132,6 +136,14 @@ bool DecoderMAD::initialize()
     stream.sync = 0;
     configure(freq_, channels_, 16);
 
+    // The index of local files is loaded or built in the background
+    QFile *file = qobject_cast<QFile *>(input());
+    if (file != 0)
+    {
+        index_.reset(new Mp3FrameIndex(file->fileName()));
+        index_->load();
+    }
+
     inited_ = TRUE;
     return TRUE;
 }
@@ -344,6 +356,8 @@ qint64 DecoderMAD::totalTime()
 {
     if (! inited_)
         return 0.;
+    if (index_ && index_->isReady())
+        return index_->duration();
     return total_time_;
 }
 
@@ -401,15 +415,36 @@ void DecoderMAD::run()
     }
 
     seeking_finished_ = false;
+
+    // start at the first audio frame, after the tags, the encoder info
+    // frame and the encoder delay
+    qint64 start_pos = 0;
+    if (seek_time_ < 0 && index_ &&
+        index_->locate(0, start_pos, skip_samples_, remaining_samples_))
+    {
+        input()->seek(start_pos);
+    }
     mutex()->unlock();
     while (! done_ && ! finish_ && ! derror_)
     {
         mutex()->lock();
 
-        if (seek_time_ >= 0.0 && total_time_ > 0)
+        if (seek_time_ >= 0.0 && totalTime() > 0)
         {
             qDebug("Seek Time:%d", (int)seek_time_);
-            long seek_pos = long(seek_time_ * input()->size() / total_time_);
+            qint64 seek_pos = 0;
+            if (index_ && index_->locate(seek_time_, seek_pos, skip_samples_, remaining_samples_))
+            {
+                // the frames before the target are decoded and dropped
+                skip_frames = 0;
+            }
+            else
+            {
+                seek_pos = qint64(seek_time_ * input()->size() / total_time_);
+                skip_frames = 2;
+                skip_samples_ = 0;
+                remaining_samples_ = -1;
+            }
             input()->seek(seek_pos);
             output_size_ = long(seek_time_) * long(freq_ * channels_ * 16 / 2);
             mad_frame_mute(&frame);
@@ -420,7 +455,6 @@ void DecoderMAD::run()
             output_at_ = 0;
             output_bytes_ = 0;
             stream.next_frame = 0;
-            skip_frames = 2;
             eof_ = false;
             seek_time_ = -1;
             seeking_finished_ = true;
@@ -490,6 +524,16 @@ void DecoderMAD::run()
                     derror_ = true;
                     break;
                 }
+
+                // the header of the frame is decoded, but its samples are
+                // never output, e.g. the first frame after a seek whose
+                // data begins in the frames before it
+                if (stream.error >= MAD_ERROR_BADCRC)
+                {
+                    mutex()->lock();
+                    dropFrame();
+                    mutex()->unlock();
+                }
                 continue;
             }
             mutex()->lock();
@@ -598,6 +642,23 @@ static inline signed long fix_sample(unsigned int bits, mad_fixed_t sample)
     return quantized >> (MAD_F_FRACBITS + 1 - bits);
 }
 
+/// Account for a frame which is not output. Its samples are neither dropped
+/// before the seek target nor played before the encoder padding.
+void DecoderMAD::dropFrame()
+{
+    qint64 samples = 32 * MAD_NSBSAMPLES(&frame.header);
+    if (skip_samples_ > 0)
+    {
+        qint64 skip = qMin(skip_samples_, samples);
+        skip_samples_ -= skip;
+        samples -= skip;
+    }
+    if (remaining_samples_ > 0)
+    {
+        remaining_samples_ = qMax(qint64(0), remaining_samples_ - samples);
+    }
+}
+
 enum mad_flow DecoderMAD::madOutput()
 {
     unsigned int samples, channels_;
@@ -612,6 +673,21 @@ enum mad_flow DecoderMAD::madOutput()
     bitrate_ = frame.header.bitrate / 1000;
     done_ = user_stop_;
 
+    // drop the samples before the seek target and after the last one
+    if (skip_samples_ > 0)
+    {
+        unsigned int skip = static_cast<unsigned int>(qMin(skip_samples_, qint64(samples)));
+        skip_samples_ -= skip;
+        samples -= skip;
+        left += skip;
+        right += skip;
+    }
+    if (remaining_samples_ >= 0)
+    {
+        samples = static_cast<unsigned int>(qMin(remaining_samples_, qint64(samples)));
+        remaining_samples_ -= samples;
+    }
+
     while (samples-- && !user_stop_)
     {
         signed int sample;
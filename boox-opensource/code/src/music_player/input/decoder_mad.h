@@ -4,6 +4,7 @@
 #include <utils/player_utils.h>
 #include <core/decoder.h>
 #include "decodermadfactory.h"
+#include "mp3_frame_index.h"
 
 extern "C"
 {
@@ -32,6 +33,7 @@ private:
     void run();
 
     enum mad_flow madOutput();
+    void dropFrame();
     enum mad_flow madError(struct mad_stream *, struct mad_frame *);
 
     // helper functions
@@ -80,6 +82,12 @@ private:
     unsigned int  bks_;
     mad_fixed_t   eqbands_[32];
 
+    // frame index, samples to drop before the seek target and samples left
+    // before the encoder padding; -1 while unknown
+    scoped_ptr<Mp3FrameIndex> index_;
+    qint64        skip_samples_;
+    qint64        remaining_samples_;
+
     // file input buffer
     char*         input_buf_;
     unsigned long input_bytes_;
@@ -0,0 +1,377 @@
+#include <string.h>
+
+#include "onyx/cms/media_db.h"
+
+#include "mp3_frame_index.h"
+
+extern "C"
+{
+#include <mad.h>
+}
+
+namespace player
+{
+
+static const int INDEX_VERSION = 1;
+
+/// One entry per INDEX_STEP frames, about one entry per second.
+static const int INDEX_STEP = 32;
+
+/// Frames decoded before the target frame, to fill the bit reservoir and
+/// the overlap of the synthesis filter bank.
+static const int PRIME_FRAMES = 2;
+
+/// Samples of delay added by the decoder, trimmed together with the delay
+/// of the encoder.
+static const int DECODER_DELAY = 529;
+
+static const int SCAN_BUFFER_SIZE = 64 * 1024;
+
+static const quint32 XING_FRAMES = 0x0001;
+static const quint32 XING_BYTES  = 0x0002;
+static const quint32 XING_TOC    = 0x0004;
+static const quint32 XING_SCALE  = 0x0008;
+
+static inline quint32 read32(const uchar *p)
+{
+    return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static int samplesPerFrame(const struct mad_header & header)
+{
+    if (header.layer == MAD_LAYER_I)
+    {
+        return 384;
+    }
+    if (header.layer == MAD_LAYER_III && (header.flags & MAD_FLAG_LSF_EXT))
+    {
+        return 576;
+    }
+    return 1152;
+}
+
+/// Size of the ID3v2 tag at the beginning of the file, 0 without tag.
+static qint64 id3v2Size(QFile & file)
+{
+    uchar data[10];
+    if (file.read(reinterpret_cast<char *>(data), 10) != 10 ||
+        data[0] != 'I' || data[1] != 'D' || data[2] != '3' ||
+        ((data[6] | data[7] | data[8] | data[9]) & 0x80))
+    {
+        return 0;
+    }
+    qint64 size = (data[6] << 21) | (data[7] << 14) | (data[8] << 7) | data[9];
+    return 10 + size + ((data[5] & 0x10) ? 10 : 0);
+}
+
+/// Check whether the frame is the Xing, Info or VBRI frame written by the
+/// encoder instead of audio. Retrieve the encoder delay and padding from
+/// the LAME tag following the Xing fields.
+static bool isInfoFrame(const uchar *frame,
+                        int size,
+                        const struct mad_header & header,
+                        int & delay,
+                        int & padding)
+{
+    if (header.layer != MAD_LAYER_III)
+    {
+        return false;
+    }
+
+    if (size >= 40 && memcmp(frame + 36, "VBRI", 4) == 0)
+    {
+        return true;
+    }
+
+    bool mono = (header.mode == MAD_MODE_SINGLE_CHANNEL);
+    int side_info = (header.flags & MAD_FLAG_LSF_EXT) ? (mono ? 9 : 17) : (mono ? 17 : 32);
+    int pos = 4 + ((header.flags & MAD_FLAG_PROTECTION) ? 2 : 0) + side_info;
+    if (pos + 8 > size)
+    {
+        return false;
+    }
+
+    const uchar *xing = frame + pos;
+    if (memcmp(xing, "Xing", 4) != 0 && memcmp(xing, "Info", 4) != 0)
+    {
+        return false;
+    }
+
+    quint32 flags = read32(xing + 4);
+    int lame = pos + 8;
+    lame += (flags & XING_FRAMES) ? 4 : 0;
+    lame += (flags & XING_BYTES) ? 4 : 0;
+    lame += (flags & XING_TOC) ? 100 : 0;
+    lame += (flags & XING_SCALE) ? 4 : 0;
+    if (lame + 24 <= size)
+    {
+        const uchar *tag = frame + lame;
+        if (memcmp(tag, "LAME", 4) == 0 || memcmp(tag, "Lavf", 4) == 0 ||
+            memcmp(tag, "Lavc", 4) == 0)
+        {
+            delay = (tag[21] << 4) | (tag[22] >> 4);
+            padding = ((tag[22] & 0x0f) << 8) | tag[23];
+        }
+    }
+    return true;
+}
+
+Mp3FrameIndex::Mp3FrameIndex(const QString & path, QObject *parent)
+    : QThread(parent)
+    , path_(path)
+    , file_size_(0)
+    , ready_(false)
+    , saved_(false)
+    , cancelled_(0)
+    , sample_rate_(0)
+    , frame_samples_(0)
+    , start_skip_(0)
+    , samples_(0)
+{
+    QFileInfo info(path_);
+    file_size_ = info.size();
+    modified_ = info.lastModified();
+    connect(this, SIGNAL(finished()), this, SLOT(onScanFinished()));
+}
+
+Mp3FrameIndex::~Mp3FrameIndex()
+{
+    cancelled_ = 1;
+    wait();
+
+    // The finished signal may not have been delivered yet.
+    save();
+}
+
+void Mp3FrameIndex::load()
+{
+    QByteArray data;
+    {
+        cms::MediaDB db;
+        db.seekIndex(path_, data);
+    }
+
+    if (fromByteArray(data))
+    {
+        QMutexLocker locker(&mutex_);
+        ready_ = true;
+        saved_ = true;
+        return;
+    }
+    start(QThread::LowestPriority);
+}
+
+bool Mp3FrameIndex::isReady()
+{
+    QMutexLocker locker(&mutex_);
+    return ready_;
+}
+
+qint64 Mp3FrameIndex::duration()
+{
+    QMutexLocker locker(&mutex_);
+    if (!ready_ || sample_rate_ <= 0)
+    {
+        return 0;
+    }
+    return samples_ * 1000 / sample_rate_;
+}
+
+bool Mp3FrameIndex::locate(qint64 time, qint64 & offset, qint64 & skip, qint64 & remaining)
+{
+    QMutexLocker locker(&mutex_);
+    if (!ready_ || offsets_.isEmpty())
+    {
+        return false;
+    }
+
+    qint64 target = qBound(Q_INT64_C(0), time * sample_rate_ / 1000, samples_);
+    qint64 sample = target + start_skip_;
+    qint64 frame = qMax(sample / frame_samples_ - PRIME_FRAMES, Q_INT64_C(0));
+    int entry = static_cast<int>(qMin(frame / INDEX_STEP, static_cast<qint64>(offsets_.size() - 1)));
+
+    offset = offsets_[entry];
+    skip = sample - static_cast<qint64>(entry) * INDEX_STEP * frame_samples_;
+    remaining = samples_ - target;
+    return true;
+}
+
+void Mp3FrameIndex::run()
+{
+    if (!scan())
+    {
+        qDebug("Mp3FrameIndex: cannot index %s", qPrintable(path_));
+    }
+}
+
+void Mp3FrameIndex::onScanFinished()
+{
+    save();
+}
+
+/// Decode the frame headers only. The frame data is never read by the
+/// decoder, so the scan costs little more than reading the file.
+bool Mp3FrameIndex::scan()
+{
+    QFile file(path_);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    qint64 base = id3v2Size(file);
+    if (!file.seek(base))
+    {
+        return false;
+    }
+
+    QByteArray buffer(SCAN_BUFFER_SIZE + MAD_BUFFER_GUARD, 0);
+    uchar *data = reinterpret_cast<uchar *>(buffer.data());
+
+    struct mad_stream stream;
+    struct mad_header header;
+    mad_stream_init(&stream);
+    mad_header_init(&header);
+
+    int sample_rate = 0;
+    int frame_samples = 0;
+    int delay = -1;
+    int padding = 0;
+    qint64 frames = 0;
+    QVector<qint64> offsets;
+    bool eof = false;
+    while (!cancelled_)
+    {
+        if (stream.buffer == 0 || stream.error == MAD_ERROR_BUFLEN)
+        {
+            if (eof)
+            {
+                break;
+            }
+
+            int remaining = 0;
+            if (stream.next_frame)
+            {
+                remaining = stream.bufend - stream.next_frame;
+                base += stream.next_frame - data;
+                memmove(data, stream.next_frame, remaining);
+            }
+
+            qint64 length = file.read(reinterpret_cast<char *>(data) + remaining,
+                                      SCAN_BUFFER_SIZE - remaining);
+            if (length <= 0)
+            {
+                // The last frame is decoded only when followed by the guard.
+                eof = true;
+                memset(data + remaining, 0, MAD_BUFFER_GUARD);
+                length = MAD_BUFFER_GUARD;
+            }
+            mad_stream_buffer(&stream, data, remaining + length);
+            stream.error = MAD_ERROR_NONE;
+        }
+
+        if (mad_header_decode(&header, &stream) == -1)
+        {
+            if (stream.error == MAD_ERROR_BUFLEN || MAD_RECOVERABLE(stream.error))
+            {
+                continue;
+            }
+            break;
+        }
+
+        if (sample_rate == 0)
+        {
+            sample_rate = header.samplerate;
+            frame_samples = samplesPerFrame(header);
+            int size = stream.next_frame - stream.this_frame;
+            if (isInfoFrame(stream.this_frame, size, header, delay, padding))
+            {
+                continue;
+            }
+        }
+
+        if (frames % INDEX_STEP == 0)
+        {
+            offsets.push_back(base + (stream.this_frame - data));
+        }
+        ++frames;
+    }
+
+    mad_header_finish(&header);
+    mad_stream_finish(&stream);
+
+    if (cancelled_ || frames <= 0)
+    {
+        return false;
+    }
+
+    qint64 start_skip = 0;
+    qint64 samples = frames * frame_samples;
+    if (delay >= 0)
+    {
+        start_skip = delay + DECODER_DELAY;
+        samples = qMax(samples - delay - padding, Q_INT64_C(0));
+    }
+
+    QMutexLocker locker(&mutex_);
+    sample_rate_ = sample_rate;
+    frame_samples_ = frame_samples;
+    start_skip_ = start_skip;
+    samples_ = samples;
+    offsets_ = offsets;
+    ready_ = true;
+    return true;
+}
+
+void Mp3FrameIndex::save()
+{
+    QByteArray data;
+    {
+        QMutexLocker locker(&mutex_);
+        if (!ready_ || saved_)
+        {
+            return;
+        }
+        saved_ = true;
+    }
+    data = toByteArray();
+
+    cms::MediaDB db;
+    db.updateSeekIndex(path_, data);
+}
+
+QByteArray Mp3FrameIndex::toByteArray()
+{
+    QMutexLocker locker(&mutex_);
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << INDEX_VERSION << file_size_ << modified_
+           << sample_rate_ << frame_samples_ << start_skip_ << samples_ << offsets_;
+    return data;
+}
+
+/// Accept the stored index only when the file has not changed since.
+bool Mp3FrameIndex::fromByteArray(const QByteArray & data)
+{
+    if (data.isEmpty())
+    {
+        return false;
+    }
+
+    QDataStream stream(data);
+    int version = 0;
+    qint64 file_size = 0;
+    QDateTime modified;
+    stream >> version >> file_size >> modified;
+    if (version != INDEX_VERSION || file_size != file_size_ || modified != modified_)
+    {
+        return false;
+    }
+
+    QMutexLocker locker(&mutex_);
+    stream >> sample_rate_ >> frame_samples_ >> start_skip_ >> samples_ >> offsets_;
+    return stream.status() == QDataStream::Ok && sample_rate_ > 0 &&
+           frame_samples_ > 0 && !offsets_.isEmpty();
+}
+
+}
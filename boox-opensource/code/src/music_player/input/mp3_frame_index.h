@@ -0,0 +1,67 @@
+#ifndef PLAYER_MP3_FRAME_INDEX_H_
+#define PLAYER_MP3_FRAME_INDEX_H_
+
+#include <utils/player_utils.h>
+
+namespace player
+{
+
+/// The Mp3FrameIndex class stores the positions of the frames of a mp3
+/// file. It is built by scanning the frame headers on a worker thread and
+/// kept in the media database, so every file is scanned once. The index
+/// gives the exact duration of VBR files without table of contents, sample
+/// accurate seeking and the encoder delay and padding for gapless playback.
+class Mp3FrameIndex : public QThread
+{
+    Q_OBJECT
+public:
+    Mp3FrameIndex(const QString & path, QObject *parent = 0);
+    ~Mp3FrameIndex();
+
+    /// Load the index from the media database, or start building it when
+    /// it is missing or the file has changed.
+    void load();
+    bool isReady();
+
+    /// Duration in milliseconds, without encoder delay and padding.
+    qint64 duration();
+
+    /// Retrieve the offset of the frame to start decoding from for the
+    /// sample at time, the number of samples to drop before it and the
+    /// number of samples left to play from it. Both count every frame from
+    /// the offset, the decoder subtracts the frames it fails to decode.
+    bool locate(qint64 time, qint64 & offset, qint64 & skip, qint64 & remaining);
+
+protected:
+    void run();
+
+private Q_SLOTS:
+    void onScanFinished();
+
+private:
+    friend class Mp3FrameIndexTest;
+    bool scan();
+    void save();
+    QByteArray toByteArray();
+    bool fromByteArray(const QByteArray & data);
+
+private:
+    QString          path_;
+    qint64           file_size_;
+    QDateTime        modified_;
+
+    QMutex           mutex_;
+    bool             ready_;
+    bool             saved_;
+    volatile int     cancelled_;
+
+    int              sample_rate_;
+    int              frame_samples_;    ///< samples per frame
+    qint64           start_skip_;       ///< encoder and decoder delay
+    qint64           samples_;          ///< samples without delay and padding
+    QVector<qint64>  offsets_;          ///< offset of every INDEX_STEP-th frame
+};
+
+};
+
+#endif // PLAYER_MP3_FRAME_INDEX_H_
@@ -44,6 +44,7 @@
 # include "frame.h"
 # include "huffman.h"
 # include "layer3.h"
+# include "simd.h"
 
 /* --- Layer III ----------------------------------------------------------- */
 
@@ -1543,6 +1544,11 @@ void III_aliasreduce(mad_fixed_t xr[576], int lines)
   mad_fixed_t const *bound;
   int i;
 
+  if (mad_simd->aliasreduce) {
+    mad_simd->aliasreduce(xr, lines, cs, ca);
+    return;
+  }
+
   bound = &xr[lines];
   for (xr += 18; xr < bound; xr += 18) {
     for (i = 0; i < 8; ++i) {
@@ -2072,6 +2078,11 @@ void III_imdct_l(mad_fixed_t const X[18], mad_fixed_t z[36],
 
   switch (block_type) {
   case 0:  /* normal window */
+    if (mad_simd->window) {
+      mad_simd->window(z, window_l, 36);
+      break;
+    }
+
 # if defined(ASO_INTERLEAVE1)
     {
       register mad_fixed_t tmp1, tmp2;
@@ -959,6 +959,21 @@ int mad_decoder_message(struct mad_decoder *, void *, unsigned int *);
 
 # endif
 
+/* simd.h */
+
+# ifndef LIBMAD_SIMD_H
+# define LIBMAD_SIMD_H
+
+enum mad_simd_level {
+  MAD_SIMD_NONE = 0,			/* portable C only */
+  MAD_SIMD_AUTO				/* best kernels for this CPU */
+};
+
+void mad_simd_init(void);
+char const *mad_simd_select(enum mad_simd_level);
+
+# endif
+
 # ifdef __cplusplus
 }
 # endif
@@ -0,0 +1,110 @@
+/*
+ * libmad - MPEG audio decoder library
+ * Copyright (C) 2000-2004 Underbit Technologies, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+# ifdef HAVE_CONFIG_H
+#  include "libmad_config.h"
+# endif
+
+# include "global.h"
+
+# include <stdlib.h>
+# include <string.h>
+
+# if defined(MAD_SIMD_NEON) && defined(__linux__)
+#  include <fcntl.h>
+#  include <unistd.h>
+# endif
+
+# include "simd.h"
+
+static
+struct mad_simd const mad_simd_none = { "none", 0, 0, 0 };
+
+struct mad_simd const *mad_simd = &mad_simd_none;
+
+static int selected;
+
+# if defined(MAD_SIMD_NEON)
+/*
+ * NAME:	cpu_has_neon()
+ * DESCRIPTION:	check the hardware capabilities given to the process
+ */
+static
+int cpu_has_neon(void)
+{
+#  if defined(__linux__)
+  unsigned long entry[2];
+  int fd, found = 0;
+
+  fd = open("/proc/self/auxv", O_RDONLY);
+  if (fd < 0)
+    return 0;
+
+  while (read(fd, entry, sizeof(entry)) == sizeof(entry)) {
+    if (entry[0] == 16 /* AT_HWCAP */) {
+      found = (entry[1] & (1 << 12) /* HWCAP_NEON */) != 0;
+      break;
+    }
+  }
+
+  close(fd);
+  return found;
+#  else
+  return 1;
+#  endif
+}
+# endif
+
+/*
+ * NAME:	simd->select()
+ * DESCRIPTION:	choose the kernels used by all decoders, return their name
+ */
+char const *mad_simd_select(enum mad_simd_level level)
+{
+  struct mad_simd const *kernels = &mad_simd_none;
+
+  if (level == MAD_SIMD_AUTO) {
+    /* MAD_SIMD=none in the environment forces the portable code */
+    char const *env = getenv("MAD_SIMD");
+
+    if (env == 0 || strcmp(env, "none") != 0) {
+# if defined(MAD_SIMD_NEON)
+      if (cpu_has_neon())
+	kernels = &mad_simd_neon;
+# elif defined(MAD_SIMD_SSE2)
+      kernels = &mad_simd_sse2;
+# endif
+    }
+  }
+
+  mad_simd = kernels;
+  selected = 1;
+
+  return kernels->name;
+}
+
+/*
+ * NAME:	simd->init()
+ * DESCRIPTION:	select the best kernels unless a choice was made already
+ */
+void mad_simd_init(void)
+{
+  if (!selected)
+    mad_simd_select(MAD_SIMD_AUTO);
+}
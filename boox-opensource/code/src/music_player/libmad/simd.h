@@ -0,0 +1,82 @@
+/*
+ * libmad - MPEG audio decoder library
+ * Copyright (C) 2000-2004 Underbit Technologies, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+# ifndef LIBMAD_SIMD_H
+# define LIBMAD_SIMD_H
+
+# include "fixed.h"
+
+/*
+ * Vector kernels for the hot loops of the default fixed-point build. They
+ * compute exactly what the portable code computes: FPM_DEFAULT products
+ * and sums are 32-bit integer operations, so lane arithmetic gives the
+ * same bits in any order. A kernel left NULL means the portable code runs.
+ */
+
+enum mad_simd_level {
+  MAD_SIMD_NONE = 0,			/* portable C only */
+  MAD_SIMD_AUTO				/* best kernels for this CPU */
+};
+
+struct mad_simd {
+  char const *name;
+
+  /* 32 PCM samples of the synthesis window, see synth_full() */
+  void (*synth_window)(mad_fixed_t const (*fe)[8],
+		       mad_fixed_t const (*fx)[8],
+		       mad_fixed_t const (*fo)[8],
+		       mad_fixed_t const (*dpe)[8],
+		       mad_fixed_t const (*dpo)[8],
+		       mad_fixed_t const (*mpe)[8],
+		       mad_fixed_t const (*mpo)[8],
+		       mad_fixed_t *pcm);
+
+  /* alias reduction butterflies, see III_aliasreduce() */
+  void (*aliasreduce)(mad_fixed_t *xr, int lines,
+		      mad_fixed_t const cs[8], mad_fixed_t const ca[8]);
+
+  /* z[i] = mad_f_mul(z[i], w[i]), n a multiple of 4 */
+  void (*window)(mad_fixed_t *z, mad_fixed_t const *w, unsigned int n);
+};
+
+extern struct mad_simd const *mad_simd;
+
+void mad_simd_init(void);
+char const *mad_simd_select(enum mad_simd_level);
+
+/*
+ * The NEON kernels are enabled by the build with MAD_SIMD_NEON, which also
+ * compiles simd_neon.c for NEON; they are used only when the CPU reports
+ * NEON. SSE2 is part of every x86-64 CPU and of i386 builds targeting it.
+ */
+# if !defined(FPM_DEFAULT) || defined(OPT_SPEED) || defined(MAD_NO_SIMD)
+#  undef MAD_SIMD_NEON
+# elif !defined(MAD_SIMD_NEON) && defined(__SSE2__)
+#  define MAD_SIMD_SSE2
+# endif
+
+# if defined(MAD_SIMD_NEON)
+extern struct mad_simd const mad_simd_neon;
+# endif
+
+# if defined(MAD_SIMD_SSE2)
+extern struct mad_simd const mad_simd_sse2;
+# endif
+
+# endif
@@ -0,0 +1,143 @@
+/*
+ * libmad - MPEG audio decoder library
+ * Copyright (C) 2000-2004 Underbit Technologies, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Kernels shared by the vector implementations. The including file
+ * defines the vector type vec_t and these operations on 4 lanes:
+ *
+ *   vec_zero()  vec_load(p)  vec_store(p, v)  vec_add(a, b)  vec_sub(a, b)
+ *   vec_mul(a, b)            low 32 bits of the products
+ *   vec_rshr12(v)  vec_rshr16(v)   (v + half) >> n, without overflow
+ *   vec_shr2(v)              arithmetic shift right by 2
+ *   vec_reverse(v)           lanes in reverse order
+ *   vec_sum4(a, b, c, d)     { sum(a), sum(b), sum(c), sum(d) }
+ */
+
+/* FPM_DEFAULT mad_f_mul(), y already rounded by vec_rshr16() */
+# define vec_f_mul(x, y16)  vec_mul(vec_rshr12(x), (y16))
+
+/* dot product of 8 filter values with 8 window values, as 4 lanes */
+# define vec_dot8(f, d)  \
+    vec_add(vec_mul(vec_load(&(f)[0]), vec_load(&(d)[0])),  \
+	    vec_mul(vec_load(&(f)[4]), vec_load(&(d)[4])))
+
+/*
+ * NAME:	synth_window()
+ * DESCRIPTION:	compute 32 PCM samples from the filter bank outputs
+ *
+ * Row sb of the portable code computes pcm[sb] and pcm[32 - sb] from the
+ * filter rows fe[sb] and fo[sb - 1]. The window coefficients are taken
+ * from tables rearranged in the order of the filter values, so each row
+ * is a pair of 8 value dot products. Four rows are summed at once.
+ */
+static
+void synth_window(mad_fixed_t const (*fe)[8],
+		  mad_fixed_t const (*fx)[8],
+		  mad_fixed_t const (*fo)[8],
+		  mad_fixed_t const (*dpe)[8],
+		  mad_fixed_t const (*dpo)[8],
+		  mad_fixed_t const (*mpe)[8],
+		  mad_fixed_t const (*mpo)[8],
+		  mad_fixed_t *pcm)
+{
+  vec_t a[4], b[4];
+  int sb, i;
+
+  /* pcm[0 .. 15] */
+
+  a[0] = vec_sub(vec_dot8(fe[0], dpe[0]), vec_dot8(fx[0], dpo[0]));
+
+  for (sb = 1, i = 1; sb < 16; ++sb) {
+    a[i] = vec_sub(vec_dot8(fe[sb], dpe[sb]), vec_dot8(fo[sb - 1], dpo[sb]));
+
+    if (++i == 4) {
+      vec_store(&pcm[sb - 3], vec_shr2(vec_sum4(a[0], a[1], a[2], a[3])));
+      i = 0;
+    }
+  }
+
+  /* pcm[31 .. 17] and pcm[16] */
+
+  for (sb = 1, i = 0; sb < 16; ++sb) {
+    b[i] = vec_add(vec_dot8(fe[sb], mpe[sb]), vec_dot8(fo[sb - 1], mpo[sb]));
+
+    if (++i == 4) {
+      vec_store(&pcm[32 - sb],
+		vec_reverse(vec_shr2(vec_sum4(b[0], b[1], b[2], b[3]))));
+      i = 0;
+    }
+  }
+
+  b[3] = vec_sub(vec_zero(), vec_dot8(fo[15], dpo[16]));
+
+  vec_store(&pcm[16], vec_reverse(vec_shr2(vec_sum4(b[0], b[1], b[2], b[3]))));
+}
+
+/*
+ * NAME:	aliasreduce()
+ * DESCRIPTION:	perform frequency line alias reduction
+ */
+static
+void aliasreduce(mad_fixed_t *xr, int lines,
+		 mad_fixed_t const cs[8], mad_fixed_t const ca[8])
+{
+  mad_fixed_t const *bound;
+  vec_t cs0, cs1, ca0, ca1;
+
+  cs0 = vec_rshr16(vec_load(&cs[0]));
+  cs1 = vec_rshr16(vec_load(&cs[4]));
+  ca0 = vec_rshr16(vec_load(&ca[0]));
+  ca1 = vec_rshr16(vec_load(&ca[4]));
+
+  bound = &xr[lines];
+  for (xr += 18; xr < bound; xr += 18) {
+    vec_t a0, a1, b0, b1, nb0, nb1;
+
+    /* a[i] = xr[-1 - i], b[i] = xr[i] */
+
+    a0 = vec_reverse(vec_load(&xr[-4]));
+    a1 = vec_reverse(vec_load(&xr[-8]));
+    b0 = vec_load(&xr[0]);
+    b1 = vec_load(&xr[4]);
+
+    nb0 = vec_add(vec_f_mul(b0, cs0), vec_f_mul(a0, ca0));
+    nb1 = vec_add(vec_f_mul(b1, cs1), vec_f_mul(a1, ca1));
+
+    a0 = vec_add(vec_f_mul(a0, cs0), vec_f_mul(vec_sub(vec_zero(), b0), ca0));
+    a1 = vec_add(vec_f_mul(a1, cs1), vec_f_mul(vec_sub(vec_zero(), b1), ca1));
+
+    vec_store(&xr[-4], vec_reverse(a0));
+    vec_store(&xr[-8], vec_reverse(a1));
+    vec_store(&xr[0], nb0);
+    vec_store(&xr[4], nb1);
+  }
+}
+
+/*
+ * NAME:	window()
+ * DESCRIPTION:	multiply n values by the window, n a multiple of 4
+ */
+static
+void window(mad_fixed_t *z, mad_fixed_t const *w, unsigned int n)
+{
+  unsigned int i;
+
+  for (i = 0; i < n; i += 4)
+    vec_store(&z[i], vec_f_mul(vec_load(&z[i]), vec_rshr16(vec_load(&w[i]))));
+}
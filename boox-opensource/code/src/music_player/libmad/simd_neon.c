@@ -0,0 +1,76 @@
+/*
+ * libmad - MPEG audio decoder library
+ * Copyright (C) 2000-2004 Underbit Technologies, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+# ifdef HAVE_CONFIG_H
+#  include "libmad_config.h"
+# endif
+
+# include "global.h"
+
+# include "simd.h"
+
+# if defined(MAD_SIMD_NEON)
+
+#  if !defined(__ARM_NEON__)
+#   error "simd_neon.c must be compiled with -mfpu=neon"
+#  endif
+
+#  include <arm_neon.h>
+
+typedef int32x4_t vec_t;
+
+#  define vec_zero()		vdupq_n_s32(0)
+#  define vec_load(p)		vld1q_s32(p)
+#  define vec_store(p, v)	vst1q_s32((p), (v))
+#  define vec_add(a, b)		vaddq_s32((a), (b))
+#  define vec_sub(a, b)		vsubq_s32((a), (b))
+#  define vec_mul(a, b)		vmulq_s32((a), (b))
+#  define vec_rshr12(v)		vrshrq_n_s32((v), 12)
+#  define vec_rshr16(v)		vrshrq_n_s32((v), 16)
+#  define vec_shr2(v)		vshrq_n_s32((v), 2)
+
+static inline
+int32x4_t vec_reverse(int32x4_t v)
+{
+  int32x4_t r = vrev64q_s32(v);
+
+  return vcombine_s32(vget_high_s32(r), vget_low_s32(r));
+}
+
+static inline
+int32x4_t vec_sum4(int32x4_t a, int32x4_t b, int32x4_t c, int32x4_t d)
+{
+  int32x2_t ab, cd;
+
+  ab = vpadd_s32(vadd_s32(vget_low_s32(a), vget_high_s32(a)),
+		 vadd_s32(vget_low_s32(b), vget_high_s32(b)));
+  cd = vpadd_s32(vadd_s32(vget_low_s32(c), vget_high_s32(c)),
+		 vadd_s32(vget_low_s32(d), vget_high_s32(d)));
+
+  return vcombine_s32(ab, cd);
+}
+
+#  include "simd_kernels.h"
+
+struct mad_simd const mad_simd_neon = {
+  "neon", synth_window, aliasreduce, window
+};
+
+# endif
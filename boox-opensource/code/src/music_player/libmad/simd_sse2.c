@@ -0,0 +1,82 @@
+/*
+ * libmad - MPEG audio decoder library
+ * Copyright (C) 2000-2004 Underbit Technologies, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+# ifdef HAVE_CONFIG_H
+#  include "libmad_config.h"
+# endif
+
+# include "global.h"
+
+# include "simd.h"
+
+# if defined(MAD_SIMD_SSE2)
+
+#  include <emmintrin.h>
+
+typedef __m128i vec_t;
+
+#  define vec_zero()		_mm_setzero_si128()
+#  define vec_load(p)		_mm_loadu_si128((__m128i const *) (p))
+#  define vec_store(p, v)	_mm_storeu_si128((__m128i *) (p), (v))
+#  define vec_add(a, b)		_mm_add_epi32((a), (b))
+#  define vec_sub(a, b)		_mm_sub_epi32((a), (b))
+#  define vec_shr2(v)		_mm_srai_epi32((v), 2)
+#  define vec_reverse(v)	_mm_shuffle_epi32((v), _MM_SHUFFLE(0, 1, 2, 3))
+
+/* (v + (1 << (n - 1))) >> n == (v >> n) + bit n - 1 of v */
+#  define vec_rshr(v, n)  \
+    _mm_add_epi32(_mm_srai_epi32((v), (n)),  \
+		  _mm_and_si128(_mm_srai_epi32((v), (n) - 1),  \
+				_mm_set1_epi32(1)))
+#  define vec_rshr12(v)		vec_rshr((v), 12)
+#  define vec_rshr16(v)		vec_rshr((v), 16)
+
+/* SSE2 has no 32-bit low multiply; the low half of even and odd products */
+static inline
+__m128i vec_mul(__m128i a, __m128i b)
+{
+  __m128i even, odd;
+
+  even = _mm_mul_epu32(a, b);
+  odd  = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+
+  return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+			    _mm_shuffle_epi32(odd,  _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+static inline
+__m128i vec_sum4(__m128i a, __m128i b, __m128i c, __m128i d)
+{
+  __m128i ab, cd;
+
+  /* { a0 + a2, b0 + b2, a1 + a3, b1 + b3 } and likewise for c, d */
+  ab = _mm_add_epi32(_mm_unpacklo_epi32(a, b), _mm_unpackhi_epi32(a, b));
+  cd = _mm_add_epi32(_mm_unpacklo_epi32(c, d), _mm_unpackhi_epi32(c, d));
+
+  return _mm_add_epi32(_mm_unpacklo_epi64(ab, cd), _mm_unpackhi_epi64(ab, cd));
+}
+
+#  include "simd_kernels.h"
+
+struct mad_simd const mad_simd_sse2 = {
+  "sse2", synth_window, aliasreduce, window
+};
+
+# endif
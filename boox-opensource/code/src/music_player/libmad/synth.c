@@ -28,6 +28,7 @@
 # include "fixed.h"
 # include "frame.h"
 # include "synth.h"
+# include "simd.h"
 
 /*
  * NAME:	synth->init()
@@ -37,6 +38,8 @@ void mad_synth_init(struct mad_synth *synth)
 {
   mad_synth_mute(synth);
 
+  mad_simd_init();
+
   synth->phase = 0;
 
   synth->pcm.samplerate = 0;
@@ -687,6 +690,79 @@ void synth_full(struct mad_synth *synth, struct mad_frame const *frame,
 }
 # endif
 
+/*
+ * The window coefficients of synth_full() in the order of the filter
+ * values: Dfwd[o][sb] holds the 8 values read at *Dptr + o and Dmir[o][sb]
+ * the 8 values read at *Dptr - o, for every phase offset o.
+ */
+
+static
+mad_fixed_t Dfwd[16][17][8], Dmir[16][16][8];
+
+/*
+ * NAME:	synth->tables()
+ * DESCRIPTION:	rearrange the window for the vector kernels
+ */
+static
+void synth_tables(void)
+{
+  static unsigned int const fwd[8] = { 0, 14, 12, 10, 8, 6, 4, 2 };
+  static int done;
+  unsigned int o, sb, k;
+
+  if (done)
+    return;
+
+  for (o = 0; o < 16; ++o) {
+    for (sb = 0; sb < 17; ++sb) {
+      for (k = 0; k < 8; ++k) {
+	Dfwd[o][sb][k] = D[sb][o + fwd[k]];
+
+	if (sb < 16)
+	  Dmir[o][sb][k] = D[sb][15 + 2 * k - o];
+      }
+    }
+  }
+
+  done = 1;
+}
+
+/*
+ * NAME:	synth->full_simd()
+ * DESCRIPTION:	perform full frequency PCM synthesis with the vector kernels
+ */
+static
+void synth_full_simd(struct mad_synth *synth, struct mad_frame const *frame,
+		     unsigned int nch, unsigned int ns)
+{
+  unsigned int phase, ch, s, pe, po;
+  mad_fixed_t *pcm1, (*filter)[2][2][16][8];
+  mad_fixed_t const (*sbsample)[36][32];
+
+  for (ch = 0; ch < nch; ++ch) {
+    sbsample = &frame->sbsample[ch];
+    filter   = &synth->filter[ch];
+    phase    = synth->phase;
+    pcm1     = synth->pcm.samples[ch];
+
+    for (s = 0; s < ns; ++s) {
+      dct32((*sbsample)[s], phase >> 1,
+	    (*filter)[0][phase & 1], (*filter)[1][phase & 1]);
+
+      pe = phase & ~1;
+      po = ((phase - 1) & 0xf) | 1;
+
+      mad_simd->synth_window((*filter)[0][ phase & 1],
+			     (*filter)[0][~phase & 1],
+			     (*filter)[1][~phase & 1],
+			     Dfwd[pe], Dfwd[po], Dmir[pe], Dmir[po], pcm1);
+      pcm1 += 32;
+
+      phase = (phase + 1) % 16;
+    }
+  }
+}
+
 /*
  * NAME:	synth->half()
  * DESCRIPTION:	perform half frequency PCM synthesis
@@ -844,6 +920,11 @@ void mad_synth_frame(struct mad_synth *synth, struct mad_frame const *frame)
 
   synth_frame = synth_full;
 
+  if (mad_simd->synth_window) {
+    synth_tables();
+    synth_frame = synth_full_simd;
+  }
+
   if (frame->options & MAD_OPTION_HALFSAMPLERATE) {
     synth->pcm.samplerate /= 2;
     synth->pcm.length     /= 2;
@@ -7,13 +7,101 @@
 namespace player
 {
 
+/// Key of the tag settings the cached tags were read with. It is stored
+/// with the tags, no metadata field uses it.
+static const int TAG_SETTINGS = -1;
+
+/// The settings deciding which tags are read and how they are decoded.
+static QString tagSettings()
+{
+    QSettings settings(PlayerUtils::configFile(), QSettings::IniFormat);
+    settings.beginGroup("MAD");
+    QStringList values;
+    values << settings.value("tag_1").toString()
+           << settings.value("tag_2").toString()
+           << settings.value("tag_3").toString()
+           << settings.value("ID3v1_encoding").toString()
+           << settings.value("ID3v2_encoding").toString();
+    return values.join(",");
+}
+
+static QByteArray tagsToByteArray(const QMap<PlayerUtils::MetaData, QString> & metadata,
+                                  const QString & tag_settings)
+{
+    QMap<int, QString> tags;
+    tags.insert(TAG_SETTINGS, tag_settings);
+    QMap<PlayerUtils::MetaData, QString>::const_iterator it = metadata.begin();
+    for (; it != metadata.end(); ++it)
+    {
+        tags.insert(it.key(), it.value());
+    }
+
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << tags;
+    return data;
+}
+
+/// Retrieve the cached tags, false if they were read with other settings.
+static bool tagsFromByteArray(const QByteArray & data,
+                              const QString & tag_settings,
+                              QMap<PlayerUtils::MetaData, QString> & metadata)
+{
+    QMap<int, QString> tags;
+    QDataStream stream(data);
+    stream >> tags;
+    if (stream.status() != QDataStream::Ok ||
+        !tags.contains(TAG_SETTINGS) ||
+        tags.take(TAG_SETTINGS) != tag_settings)
+    {
+        return false;
+    }
+
+    metadata.clear();
+    QMap<int, QString>::const_iterator it = tags.begin();
+    for (; it != tags.end(); ++it)
+    {
+        metadata.insert(static_cast<PlayerUtils::MetaData>(it.key()), it.value());
+    }
+    return true;
+}
+
+/// The order addDirectory() lists the paths in: the files of a directory
+/// by name, then its subdirectories.
+static bool directoryOrder(const QString & a, const QString & b)
+{
+    QStringList x = a.split('/');
+    QStringList y = b.split('/');
+    int i = 0;
+    while (i < x.size() - 1 && i < y.size() - 1 && x[i] == y[i])
+    {
+        ++i;
+    }
+
+    bool x_file = (i == x.size() - 1);
+    bool y_file = (i == y.size() - 1);
+    if (x_file != y_file)
+    {
+        return x_file;
+    }
+    return x[i] < y[i];
+}
+
+static bool isUnchanged(const cms::MediaTrack & track, const QFileInfo & file_info)
+{
+    return track.size == file_info.size() &&
+           track.modified.toTime_t() == file_info.lastModified().toTime_t();
+}
+
 FileLoader::FileLoader(QObject *parent)
     : QThread(parent)
     , files_to_load_()
     , directory_()
+    , use_metadata_(false)
 {
     filters_ = Decoder::nameFilters();
     finished_ = false;
+    connect(this, SIGNAL(finished()), this, SLOT(onLoadFinished()));
 }
 
 
@@ -32,11 +120,19 @@ void FileLoader::addFiles(const QStringList &files)
 
     foreach(QString s, files)
     {
-        QList <FileInfo *> playList;
-        Decoder::createPlayList(s, playList, PlaylistSettings::instance()->useMetadata());
-        foreach(FileInfo *info, playList)
+        QFileInfo fileInfo(s);
+        if (fileInfo.isFile())
+        {
+            addFile(fileInfo);
+        }
+        else
         {
-            emit newPlayListItem(new PlayListItem(info));
+            QList <FileInfo *> playList;
+            Decoder::createPlayList(s, playList, PlaylistSettings::instance()->useMetadata());
+            foreach(FileInfo *info, playList)
+            {
+                emit newPlayListItem(new PlayListItem(info));
+            }
         }
         if (finished_)
         {
@@ -48,21 +144,13 @@ void FileLoader::addFiles(const QStringList &files)
 
 void FileLoader::addDirectory(const QString& s)
 {
-    QList <FileInfo *> playList;
     QDir dir(s);
     dir.setFilter(QDir::Files | QDir::Hidden | QDir::NoSymLinks);
     dir.setSorting(QDir::Name);
     QFileInfoList l = dir.entryInfoList(filters_);
     for (int i = 0; i < l.size(); ++i)
     {
-        QFileInfo fileInfo = l.at(i);
-        Decoder::createPlayList(fileInfo.absoluteFilePath (),
-                                playList,
-                                PlaylistSettings::instance()->useMetadata());
-        foreach(FileInfo *info, playList)
-        {
-            emit newPlayListItem(new PlayListItem(info));
-        }
+        addFile(l.at(i));
         if (finished_) return;
     }
     dir.setFilter(QDir::Dirs | QDir::NoDotAndDotDot);
@@ -80,6 +168,104 @@ void FileLoader::addDirectory(const QString& s)
     }
 }
 
+/// Show the cached files of the directory without looking at the files.
+/// addDirectory() checks them afterwards.
+void FileLoader::addCachedDirectory()
+{
+    QString prefix = QDir(directory_).absolutePath() + "/";
+    QStringList paths;
+    cms::MediaTracks::const_iterator it = tracks_.begin();
+    for (; it != tracks_.end(); ++it)
+    {
+        if (it.key().startsWith(prefix))
+        {
+            paths << it.key();
+        }
+    }
+    qSort(paths.begin(), paths.end(), directoryOrder);
+
+    foreach(const QString & path, paths)
+    {
+        if (finished_)
+        {
+            return;
+        }
+
+        PlayListItem *item = createCachedItem(tracks_.value(path));
+        if (item != 0)
+        {
+            shown_paths_.insert(path);
+            emit newPlayListItem(item);
+        }
+    }
+}
+
+void FileLoader::addFile(const QFileInfo & file_info)
+{
+    QString path = file_info.absoluteFilePath();
+    loaded_paths_.insert(path);
+    if (use_metadata_)
+    {
+        cms::MediaTracks::const_iterator it = tracks_.find(path);
+        bool unchanged = (it != tracks_.end() && isUnchanged(*it, file_info));
+        if (shown_paths_.contains(path))
+        {
+            if (unchanged)
+            {
+                return;
+            }
+
+            // The file changed since its cached item was shown.
+            emit playListItemRemoved(path);
+        }
+        else if (unchanged)
+        {
+            PlayListItem *item = createCachedItem(*it);
+            if (item != 0)
+            {
+                emit newPlayListItem(item);
+                return;
+            }
+        }
+    }
+
+    QList <FileInfo *> playList;
+    Decoder::createPlayList(path, playList, use_metadata_);
+
+    // Files holding several tracks are not cached.
+    if (use_metadata_ && playList.size() == 1)
+    {
+        cms::MediaTrack track;
+        track.path = path;
+        track.size = file_info.size();
+        track.modified = file_info.lastModified();
+        track.duration = playList.front()->length();
+        track.tags = tagsToByteArray(playList.front()->metaData(), tag_settings_);
+        changed_tracks_ << track;
+    }
+
+    foreach(FileInfo *info, playList)
+    {
+        emit newPlayListItem(new PlayListItem(info));
+    }
+}
+
+/// Create the item of a cached file, 0 if its tags were read with other
+/// settings.
+PlayListItem * FileLoader::createCachedItem(const cms::MediaTrack & track)
+{
+    QMap<PlayerUtils::MetaData, QString> metadata;
+    if (!tagsFromByteArray(track.tags, tag_settings_, metadata))
+    {
+        return 0;
+    }
+
+    FileInfo *info = new FileInfo(track.path);
+    info->setLength(track.duration);
+    info->setMetaData(metadata);
+    return new PlayListItem(info);
+}
+
 void FileLoader::run()
 {
     if (!files_to_load_.isEmpty())
@@ -88,7 +274,65 @@ void FileLoader::run()
     }
     else if (!directory_.isEmpty())
     {
+        if (use_metadata_)
+        {
+            addCachedDirectory();
+        }
         addDirectory(directory_);
+
+        // Forget the cached files of the directory which were not found.
+        QString prefix = QDir(directory_).absolutePath() + "/";
+        cms::MediaTracks::const_iterator it = tracks_.begin();
+        for (; !finished_ && it != tracks_.end(); ++it)
+        {
+            if (it.key().startsWith(prefix) && !loaded_paths_.contains(it.key()))
+            {
+                removed_paths_ << it.key();
+                if (shown_paths_.contains(it.key()))
+                {
+                    emit playListItemRemoved(it.key());
+                }
+            }
+        }
+    }
+}
+
+/// Store the files read by the worker thread. It runs on the thread owning
+/// the loader, like the other users of the media database. The cached files
+/// are updated too, the next load of the loader does not query them again.
+void FileLoader::onLoadFinished()
+{
+    shown_paths_.clear();
+    loaded_paths_.clear();
+    if (changed_tracks_.isEmpty() && removed_paths_.isEmpty())
+    {
+        return;
+    }
+
+    cms::MediaDB db;
+    db.updateTracks(changed_tracks_);
+    db.removeTracks(removed_paths_);
+
+    foreach(const cms::MediaTrack & track, changed_tracks_)
+    {
+        tracks_.insert(track.path, track);
+    }
+    foreach(const QString & path, removed_paths_)
+    {
+        tracks_.remove(path);
+    }
+    changed_tracks_.clear();
+    removed_paths_.clear();
+}
+
+void FileLoader::loadTracks()
+{
+    use_metadata_ = PlaylistSettings::instance()->useMetadata();
+    tag_settings_ = tagSettings();
+    if (use_metadata_ && tracks_.isEmpty())
+    {
+        cms::MediaDB db;
+        tracks_ = db.tracks();
     }
 }
 
@@ -96,12 +340,14 @@ void FileLoader::setFilesToLoad(const QStringList & l)
 {
     files_to_load_ = l;
     directory_ = QString();
+    loadTracks();
 }
 
 void FileLoader::setDirectoryToLoad(const QString & d)
 {
     directory_ = d;
     files_to_load_.clear();
+    loadTracks();
 }
 
 void FileLoader::finish()
@@ -2,12 +2,18 @@
 #define PLAYER_FILELOADER_H_
 
 #include <utils/player_utils.h>
+#include "onyx/cms/media_db.h"
 
 namespace player
 {
 
 class PlayListItem;
 
+/// The FileLoader class creates the playlist items of files and directories
+/// on a worker thread. The tags and durations read from the files are kept
+/// in the media database, so only new and changed files are opened again.
+/// The cached files of a directory are shown before it is listed, the items
+/// of files which changed or are gone are replaced or removed afterwards.
 class FileLoader : public QThread
 {
     Q_OBJECT
@@ -21,17 +27,35 @@ public:
 
 Q_SIGNALS:
     void newPlayListItem(PlayListItem *item);
+    void playListItemRemoved(const QString & path);
 
 protected:
     virtual void run();
     void addFiles(const QStringList &files);
     void addDirectory(const QString& s);
 
+private Q_SLOTS:
+    void onLoadFinished();
+
+private:
+    void loadTracks();
+    void addCachedDirectory();
+    void addFile(const QFileInfo & file_info);
+    PlayListItem * createCachedItem(const cms::MediaTrack & track);
+
 private:
     QStringList filters_;
     QStringList files_to_load_;
     QString     directory_;
     bool        finished_;
+
+    bool                    use_metadata_;
+    QString                 tag_settings_;      ///< settings the tags are read with
+    cms::MediaTracks        tracks_;            ///< cached files
+    QSet<QString>           shown_paths_;       ///< cached files shown before listing
+    QSet<QString>           loaded_paths_;      ///< files found on this load
+    QList<cms::MediaTrack>  changed_tracks_;    ///< files read on this load
+    QStringList             removed_paths_;     ///< cached files which are gone
 };
 
 };
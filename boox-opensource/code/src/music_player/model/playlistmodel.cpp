@@ -266,6 +266,19 @@ void PlayListModel::removeAt (int i)
     }
 }
 
+/// Remove the item of a file which changed or vanished while it was loaded.
+void PlayListModel::removeFile(const QString & path)
+{
+    for (int i = 0; i < items_.size(); ++i)
+    {
+        if (items_.at(i)->fileInfo()->path() == path)
+        {
+            removeAt(i);
+            return;
+        }
+    }
+}
+
 void PlayListModel::removeSelection(bool inverted)
 {
     int i = 0;
@@ -468,6 +481,7 @@ FileLoader * PlayListModel::createFileLoader()
     // f_loader->setStackSize(20 * 1024 * 1024);
     running_loaders_ << f_loader;
     connect(f_loader, SIGNAL(newPlayListItem(PlayListItem*)), this, SLOT(load(PlayListItem*)), Qt::QueuedConnection);
+    connect(f_loader, SIGNAL(playListItemRemoved(const QString &)), this, SLOT(removeFile(const QString &)), Qt::QueuedConnection);
     connect(f_loader, SIGNAL(finished()), this, SLOT(preparePlayState()));
     connect(f_loader, SIGNAL(finished()), f_loader, SLOT(deleteLater()));
     return f_loader;
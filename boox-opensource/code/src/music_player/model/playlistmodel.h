@@ -121,6 +121,7 @@ public Q_SLOTS:
     void removeSelected();
     void removeUnselected();
     void removeAt (int i);
+    void removeFile(const QString & path);
     void invertSelection();
     void selectAll();
     void showDetails();
@@ -0,0 +1,64 @@
+# Writes synthetic_blocks.mp3, the reference stream of mad_simd_test: a
+# short MPEG-1 layer III stream of random spectra with long, start, short
+# and stop blocks, stereo and mid/side frames, all coded with huffman
+# table 1 and no bit reservoir. No encoder is needed to regenerate it:
+#
+#   python make_synthetic_mp3.py synthetic_blocks.mp3
+import random, sys
+
+class Bits:
+    def __init__(self): self.bits = []
+    def put(self, value, n):
+        for i in range(n - 1, -1, -1): self.bits.append((value >> i) & 1)
+    def bytes(self):
+        b = self.bits + [0] * (-len(self.bits) % 8)
+        return bytes(int(''.join(map(str, b[i:i + 8])), 2) for i in range(0, len(b), 8))
+
+# huffman table 1
+T1 = {(0, 0): '1', (0, 1): '001', (1, 0): '01', (1, 1): '000'}
+
+def granule_data(rnd, pairs, density):
+    bits = []
+    for _ in range(pairs):
+        x = int(rnd.random() < density); y = int(rnd.random() < density)
+        bits += [int(c) for c in T1[(x, y)]]
+        if x: bits.append(rnd.randint(0, 1))
+        if y: bits.append(rnd.randint(0, 1))
+    return bits
+
+FRAME_SIZE = 384   # 128 kbit/s, 48 kHz
+BLOCKS = [0, 0, 0, 1, 2, 2, 3, 0]
+
+def frame(rnd, index):
+    ms = index >= 24
+    h = Bits()
+    h.put(0xfffb, 16); h.put(0x94, 8)
+    h.put((0x1 << 6 | 0x2 << 4) if ms else 0x00, 8)
+    side = Bits(); main = []
+    side.put(0, 9); side.put(0, 3); side.put(0, 8)
+    budget = (FRAME_SIZE - 36) * 8 // 4
+    for gr in range(2):
+        block = BLOCKS[(index * 2 + gr) % len(BLOCKS)]
+        for ch in range(2):
+            while True:
+                pairs = rnd.randint(60, 280)
+                data = granule_data(rnd, pairs, rnd.choice([0.1, 0.3, 0.6]))
+                if len(data) <= budget: break
+            side.put(len(data), 12); side.put(pairs, 9)
+            side.put(rnd.randint(150, 185), 8); side.put(0, 4)
+            if block == 0:
+                side.put(0, 1); side.put(1, 5); side.put(1, 5); side.put(1, 5)
+                side.put(7, 4); side.put(7, 3)
+            else:
+                side.put(1, 1); side.put(block, 2); side.put(0, 1)
+                side.put(1, 5); side.put(1, 5)
+                for w in range(3): side.put(rnd.randint(0, 2) if block == 2 else 0, 3)
+            side.put(0, 1); side.put(0, 1); side.put(0, 1)
+            main += data
+    out = Bits(); out.bits = h.bits + side.bits + main
+    data = out.bytes()
+    assert len(data) <= FRAME_SIZE
+    return data + bytes(FRAME_SIZE - len(data))
+
+rnd = random.Random(46)
+open(sys.argv[1], 'wb').write(b''.join(frame(rnd, i) for i in range(48)))
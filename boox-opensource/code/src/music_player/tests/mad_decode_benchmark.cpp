@@ -0,0 +1,87 @@
+// -*- mode: c++; c-basic-offset: 4; -*-
+
+// Decode mp3 files with the portable and the vector kernels of libmad and
+// print the decoding speed as a multiple of realtime.
+//
+//   mad_decode_benchmark file.mp3 [file.mp3 ...]
+
+#include <stdio.h>
+
+#include <QTime>
+#include <QFile>
+
+#include "libmad/mad.h"
+
+namespace
+{
+
+/// Decode data and return the duration of the stream in seconds.
+double decode(const QByteArray & data)
+{
+    mad_stream stream;
+    mad_frame frame;
+    mad_synth synth;
+    double seconds = 0;
+
+    mad_stream_init(&stream);
+    mad_frame_init(&frame);
+    mad_synth_init(&synth);
+
+    mad_stream_buffer(&stream,
+                      reinterpret_cast<const unsigned char *>(data.constData()),
+                      data.size());
+    while (true)
+    {
+        if (mad_frame_decode(&frame, &stream) == -1)
+        {
+            if (MAD_RECOVERABLE(stream.error))
+            {
+                continue;
+            }
+            break;
+        }
+        mad_synth_frame(&synth, &frame);
+        seconds += static_cast<double>(synth.pcm.length) / synth.pcm.samplerate;
+    }
+
+    mad_synth_finish(&synth);
+    mad_frame_finish(&frame);
+    mad_stream_finish(&stream);
+    return seconds;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s file.mp3 [file.mp3 ...]\n", argv[0]);
+        return 1;
+    }
+
+    const mad_simd_level levels[] = { MAD_SIMD_NONE, MAD_SIMD_AUTO };
+    for (int i = 1; i < argc; ++i)
+    {
+        QFile file(QString::fromLocal8Bit(argv[i]));
+        if (!file.open(QIODevice::ReadOnly))
+        {
+            fprintf(stderr, "Could not open %s\n", argv[i]);
+            continue;
+        }
+        QByteArray data = file.readAll();
+
+        for (unsigned int l = 0; l < sizeof(levels) / sizeof(levels[0]); ++l)
+        {
+            const char *name = mad_simd_select(levels[l]);
+            QTime timer;
+            timer.start();
+            double seconds = decode(data);
+            int elapsed = qMax(timer.elapsed(), 1);
+
+            printf("%s %-5s %8.2f s audio %8d ms %8.1fx realtime\n",
+                   argv[i], name, seconds, elapsed, seconds * 1000 / elapsed);
+        }
+    }
+    return 0;
+}
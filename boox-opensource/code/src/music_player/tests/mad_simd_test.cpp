@@ -0,0 +1,291 @@
+// -*- mode: c++; c-basic-offset: 4; -*-
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vector>
+
+#include <QDir>
+#include <QFile>
+#include <QStringList>
+
+#include "gtest/gtest.h"
+
+// The kernel table is internal to libmad. Its header and the types of the
+// library build come before mad.h, which declares the public part only.
+extern "C"
+{
+#include "libmad/libmad_config.h"
+#include "libmad/simd.h"
+}
+#include "libmad/mad.h"
+
+namespace
+{
+
+typedef std::vector<mad_fixed_t> Samples;
+
+/// Decode a whole mp3 stream with the kernels of level and return the
+/// samples of all channels in decoding order.
+Samples decode(const QByteArray & data, mad_simd_level level)
+{
+    Samples samples;
+    mad_stream stream;
+    mad_frame frame;
+    mad_synth synth;
+
+    mad_simd_select(level);
+    mad_stream_init(&stream);
+    mad_frame_init(&frame);
+    mad_synth_init(&synth);
+
+    mad_stream_buffer(&stream,
+                      reinterpret_cast<const unsigned char *>(data.constData()),
+                      data.size());
+    while (true)
+    {
+        if (mad_frame_decode(&frame, &stream) == -1)
+        {
+            if (MAD_RECOVERABLE(stream.error))
+            {
+                continue;
+            }
+            break;
+        }
+        mad_synth_frame(&synth, &frame);
+        for (int ch = 0; ch < synth.pcm.channels; ++ch)
+        {
+            samples.insert(samples.end(), synth.pcm.samples[ch],
+                           synth.pcm.samples[ch] + synth.pcm.length);
+        }
+    }
+
+    mad_synth_finish(&synth);
+    mad_frame_finish(&frame);
+    mad_stream_finish(&stream);
+    return samples;
+}
+
+QDir referenceDir()
+{
+    const char *dir = getenv("MAD_REFERENCE_DIR");
+    return QDir(dir ? QString::fromLocal8Bit(dir) : QString(TEST_DATA_DIR));
+}
+
+mad_fixed_t randomSample()
+{
+    // Subband samples within +-4.0.
+    return static_cast<mad_fixed_t>(rand() % (8 << 16) - (4 << 16)) << 12;
+}
+
+/// A fixed point value within +-limit with every bit random, so the
+/// rounding of mad_f_mul() is exercised.
+mad_fixed_t randomFixed(mad_fixed_t limit)
+{
+    unsigned int bits = (static_cast<unsigned int>(rand()) << 16) ^
+                        static_cast<unsigned int>(rand());
+    return static_cast<mad_fixed_t>(bits % (2u * limit)) - limit;
+}
+
+/// mad_f_mul() of the library built with FPM_DEFAULT, mad.h selects the
+/// assembly version for other users.
+mad_fixed_t fixedMul(mad_fixed_t x, mad_fixed_t y)
+{
+    return ((x + (1L << 11)) >> 12) * ((y + (1L << 15)) >> 16);
+}
+
+/// III_aliasreduce() of layer3.c for the default fixed point build.
+void aliasreducePortable(mad_fixed_t *xr, int lines,
+                         mad_fixed_t const cs[8], mad_fixed_t const ca[8])
+{
+    mad_fixed_t const *bound = &xr[lines];
+    for (xr += 18; xr < bound; xr += 18)
+    {
+        for (int i = 0; i < 8; ++i)
+        {
+            mad_fixed_t a = xr[-1 - i];
+            mad_fixed_t b = xr[i];
+            if (a | b)
+            {
+                xr[-1 - i] = fixedMul(a, cs[i]) + fixedMul(-b, ca[i]);
+                xr[i] = fixedMul(b, cs[i]) + fixedMul(a, ca[i]);
+            }
+        }
+    }
+}
+
+/// The long block windowing of III_imdct_l() in layer3.c.
+void windowPortable(mad_fixed_t *z, mad_fixed_t const *w, unsigned int n)
+{
+    for (unsigned int i = 0; i < n; ++i)
+    {
+        z[i] = fixedMul(z[i], w[i]);
+    }
+}
+
+}
+
+/// Synthesise random subband samples with both implementations. 50 frames
+/// of 36 slots run through all 16 phases of the filter bank.
+TEST(MadSimdTest, SynthesisIsBitExact)
+{
+    static mad_frame frame;
+    static mad_synth portable, vector;
+
+    mad_frame_init(&frame);
+    frame.header.layer = MAD_LAYER_III;
+    frame.header.mode = MAD_MODE_STEREO;
+    frame.header.samplerate = 44100;
+
+    mad_simd_select(MAD_SIMD_NONE);
+    mad_synth_init(&portable);
+    mad_synth_init(&vector);
+
+    srand(47);
+    for (int f = 0; f < 50; ++f)
+    {
+        for (int ch = 0; ch < 2; ++ch)
+        {
+            for (int s = 0; s < 36; ++s)
+            {
+                for (int sb = 0; sb < 32; ++sb)
+                {
+                    frame.sbsample[ch][s][sb] = randomSample();
+                }
+            }
+        }
+
+        mad_simd_select(MAD_SIMD_NONE);
+        mad_synth_frame(&portable, &frame);
+        mad_simd_select(MAD_SIMD_AUTO);
+        mad_synth_frame(&vector, &frame);
+
+        for (int ch = 0; ch < 2; ++ch)
+        {
+            for (int i = 0; i < 1152; ++i)
+            {
+                ASSERT_EQ(portable.pcm.samples[ch][i], vector.pcm.samples[ch][i])
+                    << "frame " << f << " channel " << ch << " sample " << i;
+            }
+        }
+    }
+
+    mad_frame_finish(&frame);
+}
+
+/// Run the alias reduction kernel on random lines, including silent ones
+/// skipped by the portable code, with random coefficients within +-1.0.
+TEST(MadSimdTest, AliasReduceIsBitExact)
+{
+    mad_simd_select(MAD_SIMD_AUTO);
+    if (mad_simd->aliasreduce == 0)
+    {
+        printf("No alias reduction kernel for this CPU\n");
+        return;
+    }
+
+    srand(1543);
+    for (int run = 0; run < 200; ++run)
+    {
+        // Mixed blocks reduce the first 36 lines only.
+        int lines = (run % 3 == 0) ? 36 : 18 * (1 + rand() % 32);
+        mad_fixed_t cs[8], ca[8];
+        for (int i = 0; i < 8; ++i)
+        {
+            cs[i] = randomFixed(MAD_F_ONE);
+            ca[i] = randomFixed(MAD_F_ONE);
+        }
+
+        mad_fixed_t portable[576], vector[576];
+        for (int i = 0; i < 576; ++i)
+        {
+            // Samples within +-2.0 so the sums of two products fit.
+            portable[i] = (rand() % 8 == 0) ? 0 : randomFixed(2 * MAD_F_ONE);
+            vector[i] = portable[i];
+        }
+
+        aliasreducePortable(portable, lines, cs, ca);
+        mad_simd->aliasreduce(vector, lines, cs, ca);
+
+        for (int i = 0; i < 576; ++i)
+        {
+            ASSERT_EQ(portable[i], vector[i])
+                << "run " << run << " lines " << lines << " line " << i;
+        }
+    }
+}
+
+/// Window random IMDCT outputs with the long block window and with random
+/// windows within +-1.0.
+TEST(MadSimdTest, LongWindowIsBitExact)
+{
+    mad_simd_select(MAD_SIMD_AUTO);
+    if (mad_simd->window == 0)
+    {
+        printf("No windowing kernel for this CPU\n");
+        return;
+    }
+
+    mad_fixed_t window_l[36];
+    for (int i = 0; i < 36; ++i)
+    {
+        window_l[i] = static_cast<mad_fixed_t>(sin(M_PI / 36 * (i + 0.5)) * MAD_F_ONE + 0.5);
+    }
+
+    srand(2072);
+    for (int run = 0; run < 200; ++run)
+    {
+        mad_fixed_t random_window[36];
+        for (int i = 0; i < 36; ++i)
+        {
+            random_window[i] = randomFixed(MAD_F_ONE);
+        }
+        mad_fixed_t const *w = (run % 2 == 0) ? window_l : random_window;
+
+        mad_fixed_t portable[36], vector[36];
+        for (int i = 0; i < 36; ++i)
+        {
+            portable[i] = randomFixed(4 * MAD_F_ONE);
+            vector[i] = portable[i];
+        }
+
+        windowPortable(portable, w, 36);
+        mad_simd->window(vector, w, 36);
+
+        for (int i = 0; i < 36; ++i)
+        {
+            ASSERT_EQ(portable[i], vector[i]) << "run " << run << " sample " << i;
+        }
+    }
+}
+
+/// Decode the reference streams with both implementations and compare the
+/// PCM output. Set MAD_REFERENCE_DIR to use other streams than tests/data.
+TEST(MadSimdTest, ReferenceStreamsAreBitExact)
+{
+    QDir dir = referenceDir();
+    QStringList files = dir.entryList(QStringList("*.mp3"), QDir::Files);
+    if (files.isEmpty())
+    {
+        printf("No reference streams in %s\n", qPrintable(dir.absolutePath()));
+        return;
+    }
+
+    foreach (const QString & name, files)
+    {
+        QFile file(dir.absoluteFilePath(name));
+        ASSERT_TRUE(file.open(QIODevice::ReadOnly)) << qPrintable(name);
+        QByteArray data = file.readAll();
+
+        Samples portable = decode(data, MAD_SIMD_NONE);
+        Samples vector = decode(data, MAD_SIMD_AUTO);
+
+        EXPECT_FALSE(portable.empty()) << qPrintable(name);
+        ASSERT_EQ(portable.size(), vector.size()) << qPrintable(name);
+        for (size_t i = 0; i < portable.size(); ++i)
+        {
+            ASSERT_EQ(portable[i], vector[i]) << qPrintable(name) << " sample " << i;
+        }
+    }
+}
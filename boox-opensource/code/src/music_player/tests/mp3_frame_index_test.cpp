@@ -0,0 +1,342 @@
+// -*- mode: c++; c-basic-offset: 4; -*-
+
+#include <string.h>
+
+#include <QDir>
+#include <QFile>
+
+#include "gtest/gtest.h"
+
+#include "input/mp3_frame_index.h"
+
+namespace player
+{
+
+/// Scans the generated files directly, the index is never stored in the
+/// media database.
+class Mp3FrameIndexTest : public ::testing::Test
+{
+protected:
+    static bool scan(Mp3FrameIndex & index)
+    {
+        bool ok = index.scan();
+        index.saved_ = true;
+        return ok;
+    }
+
+    static int sampleRate(Mp3FrameIndex & index) { return index.sample_rate_; }
+    static int frameSamples(Mp3FrameIndex & index) { return index.frame_samples_; }
+    static qint64 startSkip(Mp3FrameIndex & index) { return index.start_skip_; }
+    static qint64 samples(Mp3FrameIndex & index) { return index.samples_; }
+    static QVector<qint64> offsets(Mp3FrameIndex & index) { return index.offsets_; }
+};
+
+}
+
+using namespace player;
+
+namespace
+{
+
+/// The layer III formats of the generated frames, without padding.
+struct FrameFormat
+{
+    uchar header[4];
+    int size;
+    int side_info;
+};
+
+/// MPEG-1, 128 kbit/s, 48 kHz, stereo.
+const FrameFormat MPEG1_STEREO = { { 0xff, 0xfb, 0x94, 0x00 }, 384, 32 };
+
+/// MPEG-1, 128 kbit/s, 48 kHz, single channel.
+const FrameFormat MPEG1_MONO = { { 0xff, 0xfb, 0x94, 0xc0 }, 384, 17 };
+
+/// MPEG-1, 128 kbit/s, 48 kHz, stereo, protected by a CRC.
+const FrameFormat MPEG1_CRC = { { 0xff, 0xfa, 0x94, 0x00 }, 384, 32 };
+
+/// MPEG-2, 64 kbit/s, 24 kHz, stereo.
+const FrameFormat MPEG2_STEREO = { { 0xff, 0xf3, 0x84, 0x00 }, 192, 17 };
+
+const int ID3_SIZE = 10 + 128;
+const int FRAMES = 100;
+
+/// An ID3v2 tag of 128 bytes after the header.
+QByteArray id3Tag()
+{
+    QByteArray tag(ID3_SIZE, 0);
+    memcpy(tag.data(), "ID3\x03\x00\x00\x00\x00\x01\x00", 10);
+    return tag;
+}
+
+/// A frame of silence, the side information and main data are all zero.
+QByteArray frame(const FrameFormat & format)
+{
+    QByteArray data(format.size, 0);
+    memcpy(data.data(), format.header, 4);
+    return data;
+}
+
+QByteArray frames(const FrameFormat & format, int count)
+{
+    QByteArray data;
+    for (int i = 0; i < count; ++i)
+    {
+        data += frame(format);
+    }
+    return data;
+}
+
+/// Offset of the Xing or Info tag in the first frame.
+int xingOffset(const FrameFormat & format)
+{
+    return 4 + ((format.header[1] & 0x01) ? 0 : 2) + format.side_info;
+}
+
+void write32(char *p, quint32 value)
+{
+    p[0] = value >> 24;
+    p[1] = value >> 16;
+    p[2] = value >> 8;
+    p[3] = value;
+}
+
+/// The Xing or Info frame with the fields of flags and an encoder tag with
+/// delay and padding when encoder is not 0.
+QByteArray infoFrame(const FrameFormat & format,
+                     const char *id,
+                     quint32 flags,
+                     const char *encoder,
+                     int delay,
+                     int padding)
+{
+    QByteArray data = frame(format);
+    char *xing = data.data() + xingOffset(format);
+    memcpy(xing, id, 4);
+    write32(xing + 4, flags);
+    char *fields = xing + 8;
+    if (flags & 0x0001)
+    {
+        write32(fields, FRAMES);
+        fields += 4;
+    }
+    if (flags & 0x0002)
+    {
+        write32(fields, FRAMES * format.size);
+        fields += 4;
+    }
+    if (flags & 0x0004)
+    {
+        // The table of contents is not used, fill it with bytes that are
+        // no valid tag.
+        memset(fields, 0xaa, 100);
+        fields += 100;
+    }
+    if (flags & 0x0008)
+    {
+        write32(fields, 50);
+        fields += 4;
+    }
+    if (encoder != 0)
+    {
+        memcpy(fields, encoder, 4);
+        memcpy(fields + 4, "3.99r", 5);
+        fields[21] = delay >> 4;
+        fields[22] = ((delay & 0x0f) << 4) | (padding >> 8);
+        fields[23] = padding & 0xff;
+    }
+    return data;
+}
+
+QByteArray vbriFrame(const FrameFormat & format)
+{
+    QByteArray data = frame(format);
+    memcpy(data.data() + 36, "VBRI", 4);
+    return data;
+}
+
+QString writeFile(const QString & name, const QByteArray & data)
+{
+    QString path = QDir::temp().absoluteFilePath("mp3_frame_index_test_" + name);
+    QFile file(path);
+    file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    file.write(data);
+    return path;
+}
+
+}
+
+/// Frames after an ID3v2 tag and bytes without sync. Every 32nd frame is
+/// indexed, the tag and the junk are not counted.
+TEST_F(Mp3FrameIndexTest, HeaderScan)
+{
+    QByteArray data = id3Tag() + QByteArray("junk!") + frames(MPEG1_STEREO, FRAMES);
+    Mp3FrameIndex index(writeFile("header_scan.mp3", data));
+    ASSERT_TRUE(scan(index));
+    ASSERT_TRUE(index.isReady());
+
+    EXPECT_EQ(48000, sampleRate(index));
+    EXPECT_EQ(1152, frameSamples(index));
+    EXPECT_EQ(0, startSkip(index));
+    EXPECT_EQ(FRAMES * 1152, samples(index));
+    EXPECT_EQ(2400, index.duration());
+
+    QVector<qint64> expected;
+    for (int i = 0; i < FRAMES; i += 32)
+    {
+        expected.push_back(ID3_SIZE + 5 + i * MPEG1_STEREO.size);
+    }
+    EXPECT_TRUE(offsets(index) == expected);
+}
+
+/// MPEG-2 layer III frames hold 576 samples.
+TEST_F(Mp3FrameIndexTest, HeaderScanLsf)
+{
+    Mp3FrameIndex index(writeFile("header_scan_lsf.mp3", frames(MPEG2_STEREO, FRAMES)));
+    ASSERT_TRUE(scan(index));
+
+    EXPECT_EQ(24000, sampleRate(index));
+    EXPECT_EQ(576, frameSamples(index));
+    EXPECT_EQ(FRAMES * 576, samples(index));
+    EXPECT_EQ(2400, index.duration());
+    ASSERT_EQ(4, offsets(index).size());
+    EXPECT_EQ(32 * MPEG2_STEREO.size, offsets(index)[1]);
+}
+
+/// A file without frames cannot be indexed.
+TEST_F(Mp3FrameIndexTest, NoFrames)
+{
+    Mp3FrameIndex index(writeFile("no_frames.mp3", id3Tag() + QByteArray(4096, 'x')));
+    EXPECT_FALSE(scan(index));
+    EXPECT_FALSE(index.isReady());
+    EXPECT_EQ(0, index.duration());
+}
+
+/// The Xing, Info and VBRI frames of the encoder are not audio. Without an
+/// encoder tag nothing is trimmed.
+TEST_F(Mp3FrameIndexTest, InfoFramesAreSkipped)
+{
+    struct Case
+    {
+        const char *name;
+        QByteArray first;
+        const FrameFormat *format;
+    };
+    const Case cases[] =
+    {
+        { "xing", infoFrame(MPEG1_STEREO, "Xing", 0x000f, 0, 0, 0), &MPEG1_STEREO },
+        { "info_mono", infoFrame(MPEG1_MONO, "Info", 0x0001, 0, 0, 0), &MPEG1_MONO },
+        { "info_crc", infoFrame(MPEG1_CRC, "Info", 0x0003, 0, 0, 0), &MPEG1_CRC },
+        { "info_lsf", infoFrame(MPEG2_STEREO, "Info", 0x0000, 0, 0, 0), &MPEG2_STEREO },
+        { "vbri", vbriFrame(MPEG1_STEREO), &MPEG1_STEREO },
+    };
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i)
+    {
+        const Case & c = cases[i];
+        QByteArray data = c.first + frames(*c.format, FRAMES);
+        Mp3FrameIndex index(writeFile(QString(c.name) + ".mp3", data));
+        ASSERT_TRUE(scan(index)) << c.name;
+        EXPECT_EQ(0, startSkip(index)) << c.name;
+        EXPECT_EQ(FRAMES * frameSamples(index), samples(index)) << c.name;
+        ASSERT_FALSE(offsets(index).isEmpty()) << c.name;
+        EXPECT_EQ(c.format->size, offsets(index)[0]) << c.name;
+    }
+}
+
+/// A Xing frame at the position of a single channel frame in a stereo file
+/// is audio.
+TEST_F(Mp3FrameIndexTest, MisplacedXingIsAudio)
+{
+    QByteArray data = infoFrame(MPEG1_MONO, "Xing", 0x0001, 0, 0, 0);
+    data[3] = MPEG1_STEREO.header[3];
+    data += frames(MPEG1_STEREO, FRAMES - 1);
+    Mp3FrameIndex index(writeFile("misplaced_xing.mp3", data));
+    ASSERT_TRUE(scan(index));
+    EXPECT_EQ(FRAMES * 1152, samples(index));
+    EXPECT_EQ(0, offsets(index)[0]);
+}
+
+/// The delay and padding of the LAME tag, or the tag of libavformat, are
+/// trimmed together with the delay of the decoder.
+TEST_F(Mp3FrameIndexTest, EncoderDelayAndPadding)
+{
+    const char *encoders[] = { "LAME", "Lavf", "Lavc" };
+    for (size_t i = 0; i < sizeof(encoders) / sizeof(encoders[0]); ++i)
+    {
+        QByteArray data = infoFrame(MPEG1_STEREO, "Info", 0x000f, encoders[i], 576, 1000) +
+                          frames(MPEG1_STEREO, FRAMES);
+        Mp3FrameIndex index(writeFile("encoder_delay.mp3", data));
+        ASSERT_TRUE(scan(index)) << encoders[i];
+        EXPECT_EQ(576 + 529, startSkip(index)) << encoders[i];
+        EXPECT_EQ(FRAMES * 1152 - 576 - 1000, samples(index)) << encoders[i];
+        EXPECT_EQ((FRAMES * 1152 - 1576) * 1000 / 48000, index.duration()) << encoders[i];
+    }
+
+    // The largest values the 12 bit fields hold.
+    QByteArray data = infoFrame(MPEG1_STEREO, "Xing", 0x0001, "LAME", 4095, 4095) +
+                      frames(MPEG1_STEREO, FRAMES);
+    Mp3FrameIndex index(writeFile("encoder_delay_max.mp3", data));
+    ASSERT_TRUE(scan(index));
+    EXPECT_EQ(4095 + 529, startSkip(index));
+    EXPECT_EQ(FRAMES * 1152 - 2 * 4095, samples(index));
+}
+
+/// An unknown encoder tag is ignored.
+TEST_F(Mp3FrameIndexTest, UnknownEncoderTag)
+{
+    QByteArray data = infoFrame(MPEG1_STEREO, "Info", 0x000f, "GOGO", 576, 1000) +
+                      frames(MPEG1_STEREO, FRAMES);
+    Mp3FrameIndex index(writeFile("unknown_encoder.mp3", data));
+    ASSERT_TRUE(scan(index));
+    EXPECT_EQ(0, startSkip(index));
+    EXPECT_EQ(FRAMES * 1152, samples(index));
+}
+
+/// The frame to start from leaves PRIME_FRAMES before the target, the skip
+/// counts from the indexed frame and the remaining samples end before the
+/// padding.
+TEST_F(Mp3FrameIndexTest, Locate)
+{
+    const qint64 base = ID3_SIZE + MPEG1_STEREO.size;
+    const qint64 total = FRAMES * 1152 - 576 - 1000;
+    QByteArray data = id3Tag() +
+                      infoFrame(MPEG1_STEREO, "Info", 0x000f, "LAME", 576, 1000) +
+                      frames(MPEG1_STEREO, FRAMES);
+    Mp3FrameIndex index(writeFile("locate.mp3", data));
+
+    qint64 offset = -1, skip = -1, remaining = -1;
+    EXPECT_FALSE(index.locate(0, offset, skip, remaining));
+    ASSERT_TRUE(scan(index));
+
+    // The start, delays trimmed.
+    ASSERT_TRUE(index.locate(0, offset, skip, remaining));
+    EXPECT_EQ(base, offset);
+    EXPECT_EQ(1105, skip);
+    EXPECT_EQ(total, remaining);
+
+    // Sample 96000 + 1105 is in frame 84, two frames before it is frame 82
+    // of entry 2, which starts at sample 2 * 32 * 1152 = 73728.
+    ASSERT_TRUE(index.locate(2000, offset, skip, remaining));
+    EXPECT_EQ(base + 64 * MPEG1_STEREO.size, offset);
+    EXPECT_EQ(96000 + 1105 - 73728, skip);
+    EXPECT_EQ(total - 96000, remaining);
+
+    // Sample 36864 + 1105 is in frame 32, frame 30 belongs to entry 0.
+    ASSERT_TRUE(index.locate(768, offset, skip, remaining));
+    EXPECT_EQ(base, offset);
+    EXPECT_EQ(36864 + 1105, skip);
+    EXPECT_EQ(total - 36864, remaining);
+
+    // Times before the start and after the end are clamped, the last
+    // entry covers the end.
+    ASSERT_TRUE(index.locate(-500, offset, skip, remaining));
+    EXPECT_EQ(base, offset);
+    EXPECT_EQ(1105, skip);
+    EXPECT_EQ(total, remaining);
+
+    ASSERT_TRUE(index.locate(60000, offset, skip, remaining));
+    EXPECT_EQ(base + 96 * MPEG1_STEREO.size, offset);
+    EXPECT_EQ(total + 1105 - 96 * 1152, skip);
+    EXPECT_EQ(0, remaining);
+}
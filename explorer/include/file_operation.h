@@ -0,0 +1,108 @@
+#ifndef FILE_OPERATION_H_
+#define FILE_OPERATION_H_
+
+#include <QtCore/QtCore>
+
+namespace explorer {
+
+namespace model {
+
+/// Copies, moves or removes a file or a directory tree on a worker
+/// thread. Progress is reported by signals, the operation can be
+/// cancelled at any time. A cancelled or failed copy removes everything
+/// it has created and puts back the files it has replaced, a move keeps
+/// the source until its copy is complete. Removed files can not be
+/// restored.
+class FileOperation : public QThread
+{
+    Q_OBJECT
+
+public:
+    enum Type
+    {
+        COPY,
+        MOVE,
+        REMOVE
+    };
+
+    /// For COPY and MOVE, target is the destination directory or the
+    /// file to replace. It is ignored for REMOVE.
+    FileOperation(Type type,
+                  const QString & source,
+                  const QString & target = QString(),
+                  QObject *parent = 0);
+    ~FileOperation();
+
+    Type type() const { return type_; }
+    const QString & source() const { return source_; }
+    const QString & target() const { return target_; }
+
+    void cancel();
+    bool isCancelled() const { return cancelled_ != 0; }
+    bool succeeded() const { return succeeded_; }
+    const QString & errorString() const { return error_; }
+
+    /// Files copied, moved or removed. The target is empty for removed
+    /// files.
+    struct Result
+    {
+        QString source;
+        QString target;
+        qint64 size;
+    };
+    const QList<Result> & results() const { return results_; }
+
+    /// Update the content and thumbnail databases for the results. The
+    /// databases are not used on the worker thread, so the caller calls
+    /// this on the gui thread once the operation has finished.
+    void updateContent();
+
+Q_SIGNALS:
+    /// Emitted at most once a second. seconds_left is -1 while unknown.
+    void progress(qint64 done, qint64 total, qint64 bytes_per_second, int seconds_left);
+
+protected:
+    void run();
+
+private:
+    qint64 totalSize(const QString & path);
+    bool copyTree(const QString & source, const QString & target);
+    bool copyLink(const QString & source, const QString & target);
+    bool copyFile(const QString & source, const QString & target);
+    bool copyData(int source, int target, qint64 size);
+    bool removeTree(const QString & path, bool report);
+    void addMoved(const QString & source, const QString & target);
+    void rollback();
+    void removeBackups();
+    void addProgress(qint64 bytes);
+    bool fail(const QString & error);
+
+private:
+    Type type_;
+    QString source_;
+    QString target_;
+
+    volatile int cancelled_;
+    bool succeeded_;
+    QString error_;
+
+    // Paths created by the copy, removed again on rollback.
+    QStringList created_;
+    // Files replaced by the copy, kept under another name until the
+    // operation has succeeded.
+    QList<QPair<QString, QString> > replaced_;
+    QList<Result> results_;
+
+    qint64 total_;
+    qint64 done_;
+    QTime started_;
+    int last_report_;
+
+    char *buffer_;
+};
+
+}  // namespace model
+
+}  // namespace explorer
+
+#endif
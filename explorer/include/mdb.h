@@ -9,4 +9,14 @@ ContentManager & mdb();
 
 void closeMdb();
 
+/// Retrieve the content information of a file. The information of all
+/// files in the same directory is loaded with one query and kept until
+/// the database changes. Returns false when the file has no record.
+bool cachedContentNode(ContentNode & node,
+                       const QString & absolute_path,
+                       qint64 size);
+
+/// Drop the cached content information of the directory location.
+void invalidateContentNodes(const QString & location);
+
 #endif
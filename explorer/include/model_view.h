@@ -10,6 +10,7 @@
 #include "onyx/ui/ui.h"
 
 #include "model_tree.h"
+#include "file_operation.h"
 #include "node_view.h"
 #include "node_header_view.h"
 #include "path_bar.h"
@@ -81,6 +82,7 @@ public Q_SLOTS:
     void rename(Node *ptr);
 
     void triggerOnlineService();
+    void onFileOperationProgress(qint64 done, qint64 total, qint64 bytes_per_second, int seconds_left);
     void onDownloadStateChanged(const QString &, int, bool);
     void onViewerClosed();
 
@@ -202,6 +204,8 @@ private:
     void handleRecentDocumentsActions(HistoryActions & actions);
     void handleWebSiteActions(WebSiteActions & actions);
 
+    bool runFileOperation(model::FileOperation & operation, const QString & title);
+
     bool umountSD();
     void formatFlash();
     void formatSD();
@@ -280,6 +284,8 @@ private:
     bool can_shutdown_;
     bool is_cut_;
 
+    ui::MessageDialog *operation_dialog_;   ///< Progress of the running file operation.
+
     NO_COPY_AND_ASSIGN(ModelView);
 };
 
@@ -133,17 +133,30 @@ private Q_SLOTS:
 
     void onMetFinished(int, QProcess::ExitStatus);
 
+    void prepareStandbyViewers();
+    void onStandbyFinished(int, QProcess::ExitStatus);
+
 private:
     struct Viewer
     {
         Service service;
         ServiceState state;
         QProcess process;
+        QStringList display_args;   ///< Display parameters it was started with.
+        bool pooled;                ///< Started in standby mode, returns to the pool.
     };
     typedef Viewer * ViewerPtr;
     typedef std::map<QString, ViewerPtr> ApplicationTable;
     typedef ApplicationTable::iterator ApplicationTableIter;
 
+    /// Time from the open request to the documentOpened signal.
+    struct OpenTime
+    {
+        OpenTime() : count(0), total(0) {}
+        int count;
+        int total;
+    };
+
 private:
     SystemController(void);
     SystemController(SystemController&);
@@ -170,6 +183,10 @@ private:
     void setupConnection();
 
     ViewerPtr startViewer(Service & service, const QString &path, const QStringList &additional_args = QStringList());
+    ViewerPtr takeStandbyViewer(Service & service);
+    bool startStandbyViewer(Service & service);
+    void releaseStandbyViewers();
+    bool isPoolable(const Service & service);
     int maxDocuments();
 
     QString suffix(const QFileInfo & info);
@@ -197,6 +214,12 @@ private:
 
     QDBusConnection connection_;
     ApplicationTable applications_;     ///< Running instances.
+    ApplicationTable standby_;          ///< Parked viewers without document.
+
+    QTime open_timer_;                  ///< Started when a document is requested.
+    QString open_key_;                  ///< Suffix and warm or cold start.
+    QString open_interface_;            ///< Interface of the viewer opening it.
+    QMap<QString, OpenTime> open_times_;
 
     QProcess met_process_;  ///< To extract metadata.
     QString met_doc_path_;
@@ -43,6 +43,7 @@ ContentThumbnail & FileNode::thumbDB()
 void FileNode::update()
 {
     QFileInfo info(absolute_path());
+    size_ = info.size();
     mutable_last_read() = info.lastRead().toString(DATE_FORMAT);
     metadata(true);
 }
@@ -54,9 +55,11 @@ ContentNode & FileNode::metadata(bool force_update)
         cms_node_.reset(new ContentNode);
     }
 
+    // The cache loads the whole directory at once, so listing or sorting a
+    // folder by rating does not query the database for every file.
     if (force_update || data_state_ == MD_TOSCAN)
     {
-        mdb().getContentNode(*cms_node_, absolute_path(), false);
+        cachedContentNode(*cms_node_, absolute_path(), size_);
         data_state_ = MD_SCANNED;
     }
     return *cms_node_;
@@ -74,6 +77,7 @@ bool FileNode::updateMetadata(ContentNode &data)
     {
         mdb().createContentNode(data);
     }
+    invalidateContentNodes(data.location());
     return mdb().updateContentNode(data);
 }
 
@@ -83,6 +87,7 @@ bool FileNode::remove(QString &error)
     if (mdb().getContentNode(node, absolute_path(), false))
     {
         mdb().removeContentNode(node);
+        invalidateContentNodes(node.location());
     }
 
     QFile file(absolute_path());
@@ -0,0 +1,657 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+
+#include <QtSql/QtSql>
+
+#include "onyx/cms/cms_utils.h"
+#include "file_operation.h"
+#include "mdb.h"
+
+namespace explorer {
+
+namespace model {
+
+// Data is copied in chunks of this size, so cancelling takes effect
+// quickly and the progress is reported smoothly.
+static const size_t CHUNK_SIZE = 1024 * 1024;
+static const size_t BUFFER_ALIGNMENT = 4096;
+static const int REPORT_INTERVAL = 1000;
+
+FileOperation::FileOperation(Type type,
+                             const QString & source,
+                             const QString & target,
+                             QObject *parent)
+    : QThread(parent)
+    , type_(type)
+    , source_(QFileInfo(source).absoluteFilePath())
+    , target_(target.isEmpty() ? QString() : QFileInfo(target).absoluteFilePath())
+    , cancelled_(0)
+    , succeeded_(false)
+    , total_(0)
+    , done_(0)
+    , last_report_(0)
+    , buffer_(0)
+{
+}
+
+FileOperation::~FileOperation()
+{
+    cancel();
+    wait();
+    free(buffer_);
+}
+
+void FileOperation::cancel()
+{
+    cancelled_ = 1;
+}
+
+bool FileOperation::fail(const QString & error)
+{
+    if (error_.isEmpty())
+    {
+        error_ = error;
+    }
+    return false;
+}
+
+void FileOperation::run()
+{
+    started_.start();
+    total_ = totalSize(source_);
+    emit progress(0, total_, 0, -1);
+
+    if (type_ == REMOVE)
+    {
+        succeeded_ = removeTree(source_, true);
+    }
+    else
+    {
+        QString target = target_;
+        if (QFileInfo(target_).isDir())
+        {
+            target = QDir(target_).absoluteFilePath(QFileInfo(source_).fileName());
+        }
+
+        if (target == source_ || target.startsWith(source_ + "/"))
+        {
+            fail(tr("The target is inside the source."));
+        }
+        else if (type_ == MOVE && ::rename(QFile::encodeName(source_), QFile::encodeName(target)) == 0)
+        {
+            // Same file system, nothing to copy.
+            addMoved(source_, target);
+            succeeded_ = true;
+        }
+        else if (type_ == MOVE && errno != EXDEV && errno != ENOTEMPTY && errno != EEXIST)
+        {
+            fail(QString::fromLocal8Bit(strerror(errno)));
+        }
+        else if (!copyTree(source_, target))
+        {
+            rollback();
+        }
+        else
+        {
+            removeBackups();
+
+            // The source of a move is only removed once it has been copied
+            // completely. A failure here leaves both copies.
+            if (type_ == MOVE)
+            {
+                QList<Result> copied;
+                copied.swap(results_);
+                cancelled_ = 0;
+                if (!removeTree(source_, false))
+                {
+                    qWarning("Could not remove %s: %s", qPrintable(source_), qPrintable(error_));
+                }
+                results_ = copied;
+            }
+            succeeded_ = true;
+        }
+    }
+
+    int elapsed = qMax(started_.elapsed(), 1);
+    emit progress(done_, total_, done_ * 1000 / elapsed, 0);
+}
+
+qint64 FileOperation::totalSize(const QString & path)
+{
+    QFileInfo info(path);
+    if (!info.isDir() || info.isSymLink())
+    {
+        return info.size();
+    }
+
+    qint64 total = 0;
+    QDirIterator iter(path,
+                      QDir::Files | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot,
+                      QDirIterator::Subdirectories);
+    while (iter.hasNext() && !cancelled_)
+    {
+        iter.next();
+        total += iter.fileInfo().size();
+    }
+    return total;
+}
+
+void FileOperation::addProgress(qint64 bytes)
+{
+    done_ += bytes;
+    int elapsed = started_.elapsed();
+    if (elapsed - last_report_ < REPORT_INTERVAL)
+    {
+        return;
+    }
+    last_report_ = elapsed;
+
+    qint64 speed = done_ * 1000 / qMax(elapsed, 1);
+    int left = (speed > 0) ? static_cast<int>((total_ - done_) / speed) : -1;
+    emit progress(done_, total_, speed, left);
+}
+
+bool FileOperation::copyTree(const QString & source, const QString & target)
+{
+    if (cancelled_)
+    {
+        return fail(tr("Cancelled."));
+    }
+
+    QFileInfo info(source);
+    if (info.isDir() && info.isSymLink())
+    {
+        // Copy the link, not the tree behind it. It may point back into
+        // the source, and totalSize() does not count that tree either.
+        return copyLink(source, target);
+    }
+    if (!info.isDir())
+    {
+        return copyFile(source, target);
+    }
+
+    if (!QFileInfo(target).isDir())
+    {
+        if (!QDir().mkdir(target))
+        {
+            return fail(tr("Could not create %1.").arg(target));
+        }
+        created_ << target;
+    }
+
+    QFileInfoList entries = QDir(source).entryInfoList(
+        QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot);
+    for (QFileInfoList::iterator iter = entries.begin(); iter != entries.end(); ++iter)
+    {
+        if (!copyTree(iter->absoluteFilePath(), target + "/" + iter->fileName()))
+        {
+            return false;
+        }
+    }
+
+    // Set the times after the entries, creating them changes the times.
+    struct stat st;
+    if (::stat(QFile::encodeName(source), &st) == 0)
+    {
+        struct timeval times[2];
+        times[0].tv_sec = st.st_atime;
+        times[0].tv_usec = 0;
+        times[1].tv_sec = st.st_mtime;
+        times[1].tv_usec = 0;
+        ::utimes(QFile::encodeName(target), times);
+    }
+    return true;
+}
+
+bool FileOperation::copyLink(const QString & source, const QString & target)
+{
+    char link[PATH_MAX];
+    ssize_t n = ::readlink(QFile::encodeName(source), link, sizeof(link) - 1);
+    if (n < 0)
+    {
+        return fail(tr("Could not read %1.").arg(source));
+    }
+    link[n] = 0;
+
+    if (::symlink(link, QFile::encodeName(target)) != 0)
+    {
+        if (errno == EEXIST)
+        {
+            return fail(tr("Could not create %1.").arg(target));
+        }
+
+        // FAT cards have no links, the linked folder is not copied.
+        qWarning("Could not link %s: %s", qPrintable(target), strerror(errno));
+        return true;
+    }
+    created_ << target;
+    return true;
+}
+
+/// Create an empty file with a name no other file in the directory of
+/// path has, so a partial copy or a backup never takes the name of a
+/// file of the user. The name is returned, or an empty string.
+static QString createUniqueFile(const QString & path)
+{
+    QFileInfo info(path);
+    QTemporaryFile file(info.absoluteDir().absoluteFilePath("." + info.fileName() + ".XXXXXX"));
+    file.setAutoRemove(false);
+    if (!file.open())
+    {
+        return QString();
+    }
+    return file.fileName();
+}
+
+bool FileOperation::copyFile(const QString & source, const QString & target)
+{
+    int in = ::open(QFile::encodeName(source), O_RDONLY);
+    if (in < 0)
+    {
+        return fail(tr("Could not read %1.").arg(source));
+    }
+    struct stat st;
+    if (::fstat(in, &st) != 0)
+    {
+        ::close(in);
+        return fail(tr("Could not read %1.").arg(source));
+    }
+
+    // An existing file is only replaced once the new copy is complete.
+    bool replace = QFile::exists(target);
+    QString path = replace ? createUniqueFile(target) : target;
+    int out = path.isEmpty() ? -1 :
+        ::open(QFile::encodeName(path), O_WRONLY | O_CREAT | O_TRUNC, st.st_mode & 0777);
+    if (out < 0)
+    {
+        if (!path.isEmpty() && replace)
+        {
+            QFile::remove(path);
+        }
+        ::close(in);
+        return fail(tr("Could not create %1.").arg(target));
+    }
+    created_ << path;
+    if (replace)
+    {
+        ::fchmod(out, st.st_mode & 0777);
+    }
+
+    bool ok = copyData(in, out, st.st_size);
+    ::close(in);
+    if (::close(out) != 0)
+    {
+        ok = fail(tr("Could not write %1.").arg(target));
+    }
+    if (!ok)
+    {
+        return false;
+    }
+
+    struct timeval times[2];
+    times[0].tv_sec = st.st_atime;
+    times[0].tv_usec = 0;
+    times[1].tv_sec = st.st_mtime;
+    times[1].tv_usec = 0;
+    ::utimes(QFile::encodeName(path), times);
+
+    // The replaced file is kept until the whole operation has succeeded,
+    // a rollback puts it back.
+    if (replace)
+    {
+        // The backup takes the place of an empty file created for it.
+        QString backup = createUniqueFile(target);
+        if (backup.isEmpty())
+        {
+            return fail(tr("Could not replace %1.").arg(target));
+        }
+        if (::rename(QFile::encodeName(target), QFile::encodeName(backup)) != 0)
+        {
+            QFile::remove(backup);
+            return fail(tr("Could not replace %1.").arg(target));
+        }
+        if (::rename(QFile::encodeName(path), QFile::encodeName(target)) != 0)
+        {
+            ::rename(QFile::encodeName(backup), QFile::encodeName(target));
+            return fail(tr("Could not replace %1.").arg(target));
+        }
+        created_.removeLast();
+        replaced_ << qMakePair(backup, target);
+    }
+
+    Result result;
+    result.source = source;
+    result.target = target;
+    result.size = st.st_size;
+    results_ << result;
+    return true;
+}
+
+/// Copy in the kernel when possible, with copy_file_range or sendfile,
+/// otherwise through an aligned buffer. Every method continues at the
+/// file positions the previous one has left.
+bool FileOperation::copyData(int source, int target, qint64 size)
+{
+    qint64 left = size;
+
+#ifdef SYS_copy_file_range
+    while (left > 0 && !cancelled_)
+    {
+        size_t count = static_cast<size_t>(qMin(left, static_cast<qint64>(CHUNK_SIZE)));
+        ssize_t n = ::syscall(SYS_copy_file_range, source, 0, target, 0, count, 0);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            break;
+        }
+        left -= n;
+        addProgress(n);
+    }
+#endif
+
+    while (left > 0 && !cancelled_)
+    {
+        size_t count = static_cast<size_t>(qMin(left, static_cast<qint64>(CHUNK_SIZE)));
+        ssize_t n = ::sendfile(target, source, 0, count);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            break;
+        }
+        left -= n;
+        addProgress(n);
+    }
+
+    if (left > 0 && !cancelled_ && buffer_ == 0)
+    {
+        void *buffer = 0;
+        if (posix_memalign(&buffer, BUFFER_ALIGNMENT, CHUNK_SIZE) != 0)
+        {
+            return fail(tr("Out of memory."));
+        }
+        buffer_ = static_cast<char *>(buffer);
+    }
+
+    // Read to the end of the file, it may have grown since its size was
+    // taken.
+    while (!cancelled_)
+    {
+        ssize_t n = ::read(source, buffer_, CHUNK_SIZE);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n < 0)
+        {
+            return fail(QString::fromLocal8Bit(strerror(errno)));
+        }
+        if (n == 0)
+        {
+            break;
+        }
+
+        for (ssize_t written = 0; written < n; )
+        {
+            ssize_t w = ::write(target, buffer_ + written, n - written);
+            if (w < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (w <= 0)
+            {
+                return fail(QString::fromLocal8Bit(strerror(w < 0 ? errno : ENOSPC)));
+            }
+            written += w;
+        }
+        addProgress(n);
+    }
+
+    if (cancelled_)
+    {
+        return fail(tr("Cancelled."));
+    }
+    return true;
+}
+
+/// Removed files can not be restored, so removing stops at the first
+/// error or when cancelled.
+bool FileOperation::removeTree(const QString & path, bool report)
+{
+    if (cancelled_)
+    {
+        return fail(tr("Cancelled."));
+    }
+
+    QFileInfo info(path);
+    if (info.isDir() && !info.isSymLink())
+    {
+        QFileInfoList entries = QDir(path).entryInfoList(
+            QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot);
+        for (QFileInfoList::iterator iter = entries.begin(); iter != entries.end(); ++iter)
+        {
+            if (!removeTree(iter->absoluteFilePath(), report))
+            {
+                return false;
+            }
+        }
+        if (!QDir().rmdir(path))
+        {
+            return fail(tr("Could not remove %1.").arg(path));
+        }
+        return true;
+    }
+
+    qint64 size = info.size();
+    if (!QFile::remove(path))
+    {
+        return fail(tr("Could not remove %1.").arg(path));
+    }
+    if (report)
+    {
+        Result result;
+        result.source = path;
+        result.size = size;
+        results_ << result;
+        addProgress(size);
+    }
+    return true;
+}
+
+void FileOperation::addMoved(const QString & source, const QString & target)
+{
+    QFileInfo info(target);
+    if (!info.isDir())
+    {
+        Result result;
+        result.source = source;
+        result.target = target;
+        result.size = info.size();
+        results_ << result;
+        done_ += result.size;
+        return;
+    }
+
+    QDirIterator iter(target,
+                      QDir::Files | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot,
+                      QDirIterator::Subdirectories);
+    while (iter.hasNext())
+    {
+        iter.next();
+        Result result;
+        result.source = source + iter.filePath().mid(target.size());
+        result.target = iter.filePath();
+        result.size = iter.fileInfo().size();
+        results_ << result;
+        done_ += result.size;
+    }
+}
+
+void FileOperation::rollback()
+{
+    while (!replaced_.isEmpty())
+    {
+        QPair<QString, QString> replaced = replaced_.takeLast();
+        ::rename(QFile::encodeName(replaced.first), QFile::encodeName(replaced.second));
+    }
+    while (!created_.isEmpty())
+    {
+        QString path = created_.takeLast();
+        QFileInfo info(path);
+        if (info.isDir() && !info.isSymLink())
+        {
+            QDir().rmdir(path);
+        }
+        else
+        {
+            QFile::remove(path);
+        }
+    }
+    results_.clear();
+}
+
+void FileOperation::removeBackups()
+{
+    while (!replaced_.isEmpty())
+    {
+        QFile::remove(replaced_.takeLast().first);
+    }
+}
+
+/// Copy or move the thumbnail of a single file to the thumbnail database
+/// of the target folder. Folders carry their database along. The folder
+/// nodes keep their own connections to these databases, so a private
+/// connection is used here.
+static void transferThumbnail(const QString & source, const QString & target, bool move)
+{
+    QFileInfo source_info(source);
+    QFileInfo target_info(target);
+    QString source_db = cms::getThumbDB(source_info.absolutePath());
+    QString target_db = cms::getThumbDB(target_info.absolutePath());
+    if (source_db == target_db || !QFile::exists(source_db) || !QFile::exists(target_db))
+    {
+        return;
+    }
+
+    static const QString CONNECTION = "file_operation_thumbnails";
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", CONNECTION);
+        db.setDatabaseName(target_db);
+        if (db.open())
+        {
+            QSqlQuery query(db);
+            query.prepare("attach database ? as source");
+            query.addBindValue(source_db);
+            if (query.exec())
+            {
+                query.prepare("insert or replace into thumbs "
+                              "(name, date, small_image, middle_image, large_image) "
+                              "select ?, date, small_image, middle_image, large_image "
+                              "from source.thumbs where name = ?");
+                query.addBindValue(target_info.fileName());
+                query.addBindValue(source_info.fileName());
+                query.exec();
+
+                if (move)
+                {
+                    query.prepare("delete from source.thumbs where name = ?");
+                    query.addBindValue(source_info.fileName());
+                    query.exec();
+                }
+                query.exec("detach database source");
+            }
+            db.close();
+        }
+    }
+    QSqlDatabase::removeDatabase(CONNECTION);
+}
+
+void FileOperation::updateContent()
+{
+    // Records are looked up a directory at a time.
+    QMap<QString, QList<int> > by_location;
+    for (int i = 0; i < results_.size(); ++i)
+    {
+        by_location[QFileInfo(results_[i].source).absolutePath()] << i;
+    }
+
+    for (QMap<QString, QList<int> >::iterator dir = by_location.begin();
+         dir != by_location.end();
+         ++dir)
+    {
+        ContentNodes nodes;
+        mdb().getContentNodes(dir.key(), nodes);
+        invalidateContentNodes(dir.key());
+        if (nodes.empty())
+        {
+            continue;
+        }
+
+        QMultiHash<QString, int> by_name;
+        for (size_t i = 0; i < nodes.size(); ++i)
+        {
+            by_name.insert(nodes[i].name(), static_cast<int>(i));
+        }
+
+        const QList<int> & indexes = dir.value();
+        for (int i = 0; i < indexes.size(); ++i)
+        {
+            const Result & result = results_[indexes[i]];
+            QString name = QFileInfo(result.source).fileName();
+            for (QMultiHash<QString, int>::iterator iter = by_name.find(name);
+                 iter != by_name.end() && iter.key() == name;
+                 ++iter)
+            {
+                ContentNode & node = nodes[iter.value()];
+                if (node.size() != result.size)
+                {
+                    continue;
+                }
+
+                if (type_ == REMOVE)
+                {
+                    mdb().removeContentNode(node);
+                }
+                else
+                {
+                    QFileInfo target(result.target);
+                    node.mutable_name() = target.fileName();
+                    node.mutable_location() = target.absolutePath();
+                    if (type_ == MOVE)
+                    {
+                        mdb().updateContentNode(node);
+                    }
+                    else
+                    {
+                        mdb().createContentNode(node);
+                    }
+                    invalidateContentNodes(target.absolutePath());
+                }
+                break;
+            }
+        }
+    }
+
+    if (type_ != REMOVE && results_.size() == 1 && !QFileInfo(results_.front().target).isDir())
+    {
+        transferThumbnail(results_.front().source, results_.front().target, type_ == MOVE);
+    }
+}
+
+}  // namespace model
+
+}  // namespace explorer
@@ -6,6 +6,18 @@ using namespace cms;
 /// center database.
 static ContentManager s_mdb_instance_;
 
+/// Content nodes of a directory, keyed by file name.
+struct DirContentNodes
+{
+    QMultiHash<QString, ContentNode> nodes;
+    QDateTime db_modified;
+    uint loaded;
+};
+typedef QHash<QString, DirContentNodes> DirContentCache;
+
+static DirContentCache s_dir_cache_;
+static const int MAX_CACHED_DIRS = 16;
+
 ContentManager & mdb()
 {
     if (!s_mdb_instance_.isOpen())
@@ -23,5 +35,94 @@ void closeMdb()
     {
         s_mdb_instance_.close();
     }
+    s_dir_cache_.clear();
+}
+
+/// In WAL mode a commit only changes the -wal file, the database file
+/// itself is written when the log is checkpointed. The later of the two
+/// modification times is used.
+static QDateTime databaseModified()
+{
+    static QString path;
+    if (path.isEmpty())
+    {
+        cms::getDatabasePath("", path);
+    }
+    QDateTime modified = QFileInfo(path).lastModified();
+    QFileInfo wal(path + "-wal");
+    if (wal.exists() && wal.lastModified() > modified)
+    {
+        modified = wal.lastModified();
+    }
+    return modified;
+}
+
+/// The modification time has a resolution of one second. Nodes loaded in
+/// the second the database was changed in are only used until the next
+/// second, then they are loaded again.
+static bool isUpToDate(const DirContentNodes & dir, const QDateTime & db_modified)
+{
+    if (dir.db_modified != db_modified)
+    {
+        return false;
+    }
+    return db_modified.toTime_t() < dir.loaded ||
+           QDateTime::currentDateTime().toTime_t() == dir.loaded;
 }
 
+bool cachedContentNode(ContentNode & node,
+                       const QString & absolute_path,
+                       qint64 size)
+{
+    int pos = absolute_path.lastIndexOf('/');
+    QString location = (pos > 0) ? absolute_path.left(pos) : QString("/");
+    QString name = absolute_path.mid(pos + 1);
+
+    QDateTime db_modified = databaseModified();
+    DirContentCache::iterator dir = s_dir_cache_.find(location);
+    if (dir == s_dir_cache_.end() || !isUpToDate(dir.value(), db_modified))
+    {
+        if (s_dir_cache_.size() >= MAX_CACHED_DIRS)
+        {
+            s_dir_cache_.clear();
+        }
+
+        ContentNodes all;
+        mdb().getContentNodes(location, all);
+
+        DirContentNodes & entry = s_dir_cache_[location];
+        entry.nodes.clear();
+        for (ContentNodes::const_iterator it = all.begin(); it != all.end(); ++it)
+        {
+            entry.nodes.insert(it->name(), *it);
+        }
+        entry.db_modified = db_modified;
+        entry.loaded = QDateTime::currentDateTime().toTime_t();
+        dir = s_dir_cache_.find(location);
+    }
+
+    // Records are matched by name, location and size like
+    // ContentManager::getContentNode does.
+    const QMultiHash<QString, ContentNode> & nodes = dir.value().nodes;
+    for (QMultiHash<QString, ContentNode>::const_iterator it = nodes.find(name);
+         it != nodes.end() && it.key() == name;
+         ++it)
+    {
+        if (it.value().size() == size)
+        {
+            node = it.value();
+            return true;
+        }
+    }
+
+    node = ContentNode();
+    node.mutable_name() = name;
+    node.mutable_location() = location;
+    node.mutable_size() = size;
+    return false;
+}
+
+void invalidateContentNodes(const QString & location)
+{
+    s_dir_cache_.remove(location);
+}
@@ -80,6 +80,7 @@ ModelView::ModelView(QWidget *parent, ModelTree & model)
     , enable_extract_(false)
     , current_state_(SHUTDOWN_REASON_NONE)
     , can_shutdown_(false)
+    , operation_dialog_(0)
 {
     // Load settings.
     loadSettings();
@@ -1311,23 +1312,8 @@ bool ModelView::copy(const QString & path)
         return false;
     }
 
-    sys::SysStatus::instance().setSystemBusy(true);
-    QString program = "cp";
-    QStringList arguments;
-    arguments << "-rf" <<  source_nodes_ << path ;
-
-    int code = sys::runScriptBlock(program, arguments, 3000 * 1000);
-    if (code != 0)
-    {
-        sys::SysStatus::instance().setSystemBusy(false);
-
-        ErrorDialog dialog(tr("pasted failed."));
-        dialog.exec();
-        return false;
-    }
-
-    sys::SysStatus::instance().setSystemBusy(false);
-    return true;
+    FileOperation operation(FileOperation::COPY, source_nodes_, path);
+    return runFileOperation(operation, tr("Copy"));
 }
 
 /// Move the content from clipboard to here and clear the clipboard.
@@ -1351,26 +1337,78 @@ bool ModelView::move(const QString& path)
         return false;
     }
 
-    sys::SysStatus::instance().setSystemBusy(true);
-    QString program = "mv";
-    QStringList arguments;
-    arguments << source_nodes_ << path;
-
-    int code = sys::runScriptBlock(program, arguments, 3000 * 1000);
-    if (code !=0 )
+    FileOperation operation(FileOperation::MOVE, source_nodes_, path);
+    if (!runFileOperation(operation, tr("Move")))
     {
-        sys::SysStatus::instance().setSystemBusy(false);
-
-        ErrorDialog dialog(tr("pasted failed."));
-        dialog.exec();
         return false;
     }
+    clearClipboard();
+    return true;
+}
+
+/// Run the file operation on its thread while a dialog shows the progress.
+/// The operation is cancelled when the dialog is closed before it finished.
+bool ModelView::runFileOperation(FileOperation & operation, const QString & title)
+{
+    MessageDialog dialog(QMessageBox::Information,
+                         title,
+                         tr("Preparing..."),
+                         QMessageBox::Cancel,
+                         this);
+    operation_dialog_ = &dialog;
+    connect(&operation, SIGNAL(progress(qint64, qint64, qint64, int)),
+            this, SLOT(onFileOperationProgress(qint64, qint64, qint64, int)));
+    connect(&operation, SIGNAL(finished()), &dialog, SLOT(accept()));
+
+    sys::SysStatus::instance().setSystemBusy(true);
+    operation.start();
+    dialog.exec();
+    if (operation.isRunning())
+    {
+        operation.cancel();
+        operation.wait();
+    }
+    operation_dialog_ = 0;
 
+    operation.updateContent();
     sys::SysStatus::instance().setSystemBusy(false);
-    clearClipboard();
+
+    if (!operation.succeeded())
+    {
+        if (!operation.isCancelled())
+        {
+            qWarning("%s", qPrintable(operation.errorString()));
+            ErrorDialog error(operation.type() == FileOperation::REMOVE ?
+                              tr("Delete failed.") : tr("pasted failed."));
+            error.exec();
+        }
+        return false;
+    }
     return true;
 }
 
+void ModelView::onFileOperationProgress(qint64 done,
+                                        qint64 total,
+                                        qint64 bytes_per_second,
+                                        int seconds_left)
+{
+    if (operation_dialog_ == 0)
+    {
+        return;
+    }
+
+    const qint64 MB = 1024 * 1024;
+    QString text = tr("%1 MB of %2 MB, %3 KB/s")
+                   .arg(done / MB)
+                   .arg(total / MB)
+                   .arg(bytes_per_second / 1024);
+    if (seconds_left >= 0)
+    {
+        text += "\n" + tr("%1 seconds left").arg(seconds_left);
+    }
+    operation_dialog_->updateInformation(text);
+}
+
 bool ModelView::deleteSelectedNode()
 {
     if (isRecentDocumentsSelected())
@@ -1440,13 +1478,8 @@ bool ModelView::deleteSelectedShortcut()
 
 bool ModelView::removeDirectory(const QString &path)
 {
-    sys::SysStatus::instance().setSystemBusy(true);
-    QStringList args;
-    args << "-rf";
-    args << path;
-    sys::runScriptBlock("rm", args);
-    sys::SysStatus::instance().setSystemBusy(false);
-    return true;
+    FileOperation operation(FileOperation::REMOVE, path);
+    return runFileOperation(operation, tr("Delete"));
 }
 
 void ModelView::clearAllWritePads()
@@ -17,6 +17,21 @@ namespace controller
 
 static bool has_touch = true;
 
+/// Viewers that accept the --standby argument. They start without a
+/// document, wait for the open call and return to standby on close.
+/// onyx_reader is missing: FBReader is built around the book given on
+/// the command line and its D-Bus open method does nothing.
+static const char * STANDBY_VIEWERS[] = { "djvu_reader", "naboo_reader", "image_reader", 0 };
+static const QString STANDBY_ARG = "--standby";
+
+/// Wait a bit before filling the pool, so it does not slow down the
+/// explorer start or the closing of the last viewer.
+static const int STANDBY_DELAY = 3000;
+
+/// A document that takes longer to open is not counted, the viewer most
+/// likely failed without telling.
+static const int OPEN_TIMEOUT = 60000;
+
 // The default initial state may be read from settings file.
 // It would be possible to read it from config.xml file,
 // so we are able to provide feature like "first language settings" etc.
@@ -28,6 +43,7 @@ SystemController::SystemController()
     initializeServiceTable();
     setupConnection();
     has_touch = sys::SysStatus::instance().hasTouchScreen();
+    QTimer::singleShot(STANDBY_DELAY, this, SLOT(prepareStandbyViewers()));
 }
 
 SystemController::~SystemController()
@@ -99,23 +115,27 @@ bool SystemController::isCalibrationRunning()
 
 void SystemController::onServiceLaunched(const QString &name)
 {
-    // Search in all running applications.
-    for(ApplicationTableIter iter = applications_.begin(); iter != applications_.end(); ++iter)
+    // Search in all running and parked applications.
+    ApplicationTable * tables[] = { &applications_, &standby_ };
+    for (int i = 0; i < 2; ++i)
     {
-        if (iter->second->service.service_name() == name)
+        for(ApplicationTableIter iter = tables[i]->begin(); iter != tables[i]->end(); ++iter)
         {
-            // Setup connection.
-            connection_.connect(iter->second->service.service_name(), QString(),
-                iter->second->service.interface_name(),
-                "documentOpened",
-                this,
-                SLOT(onFileOpened(const QDBusMessage &)));
-            connection_.connect(iter->second->service.service_name(), QString(),
-                iter->second->service.interface_name(),
-                "documentClosed",
-                this,
-                SLOT(onFileOpened(const QDBusMessage &)));
-            return;
+            if (iter->second->service.service_name() == name)
+            {
+                // Setup connection.
+                connection_.connect(iter->second->service.service_name(), QString(),
+                    iter->second->service.interface_name(),
+                    "documentOpened",
+                    this,
+                    SLOT(onFileOpened(const QDBusMessage &)));
+                connection_.connect(iter->second->service.service_name(), QString(),
+                    iter->second->service.interface_name(),
+                    "documentClosed",
+                    this,
+                    SLOT(onFileClosed(const QDBusMessage &)));
+                return;
+            }
         }
     }
 }
@@ -198,6 +218,12 @@ void SystemController::onProcessFinished(int exitCode,
         if (iter->second->process.exitStatus() == exitStatus &&
             sender() == &iter->second->process)
         {
+            // The document it was asked to open will not be reported.
+            if (iter->second->service.interface_name() == open_interface_)
+            {
+                open_key_.clear();
+            }
+
             // Should disconnect signal, otherwise, this function will be invoked again.
             disconnect(&iter->second->process, SIGNAL(stateChanged(QProcess::ProcessState)),
                 this, SLOT(onProcessStateChanged(QProcess::ProcessState)));
@@ -208,6 +234,7 @@ void SystemController::onProcessFinished(int exitCode,
 
             delete iter->second;
             applications_.erase(iter);
+            QTimer::singleShot(STANDBY_DELAY, this, SLOT(prepareStandbyViewers()));
             return;
         }
     }
@@ -218,12 +245,187 @@ void SystemController::onFileOpened(const QDBusMessage &message)
     // qDebug("document opened %s", qPrintable(message.arguments())
     emit viewerStateChanged(SERVICE_RUNNING);
 
+    // Record the open time, so warm and cold starts can be compared.
+    if (!open_key_.isEmpty() && message.interface() == open_interface_)
+    {
+        int elapsed = open_timer_.elapsed();
+        if (elapsed > OPEN_TIMEOUT)
+        {
+            qDebug("Open %s took %d ms, not counted", qPrintable(open_key_), elapsed);
+            open_key_.clear();
+            return;
+        }
+        OpenTime & t = open_times_[open_key_];
+        t.count++;
+        t.total += elapsed;
+        qDebug("Open %s in %d ms, average %d ms of %d",
+               qPrintable(open_key_), elapsed, t.total / t.count, t.count);
+        open_key_.clear();
+    }
+
     // Update the opened document list.
 }
 
+/// A pooled viewer does not exit when the document is closed. Move it
+/// back to the pool and report the viewer as closed.
 void SystemController::onFileClosed(const QDBusMessage &message)
 {
-    // Update the opened document list.
+    for(ApplicationTableIter iter = applications_.begin(); iter != applications_.end(); ++iter)
+    {
+        ViewerPtr ptr = iter->second;
+        if (!ptr->pooled || ptr->service.interface_name() != message.interface())
+        {
+            continue;
+        }
+
+        if (sys::needReleaseMemory() || standby_.find(iter->first) != standby_.end())
+        {
+            // Let it go, the finished handler does the cleanup.
+            ptr->process.kill();
+            return;
+        }
+
+        disconnect(&ptr->process, SIGNAL(stateChanged(QProcess::ProcessState)),
+            this, SLOT(onProcessStateChanged(QProcess::ProcessState)));
+        disconnect(&ptr->process, SIGNAL(finished(int, QProcess::ExitStatus)),
+            this, SLOT(onProcessFinished(int, QProcess::ExitStatus)));
+        connect(&ptr->process, SIGNAL(finished(int, QProcess::ExitStatus)),
+            this, SLOT(onStandbyFinished(int, QProcess::ExitStatus)));
+
+        postStop(ptr);
+        standby_[iter->first] = ptr;
+        applications_.erase(iter);
+        emit viewerStateChanged(SERVICE_CLOSED);
+        return;
+    }
+}
+
+/// Start the parked viewers. Nothing is started while a viewer is
+/// running or the memory is low.
+void SystemController::prepareStandbyViewers()
+{
+    if (qgetenv("DISABLE_VIEWER_POOL").toInt() > 0 ||
+        runningViewers() > 0 ||
+        sys::needReleaseMemory())
+    {
+        return;
+    }
+
+    for(ServicesIter iter = all_services_.begin(); iter != all_services_.end(); ++iter)
+    {
+        if (isPoolable(*iter))
+        {
+            startStandbyViewer(*iter);
+        }
+    }
+}
+
+void SystemController::onStandbyFinished(int, QProcess::ExitStatus)
+{
+    for(ApplicationTableIter iter = standby_.begin(); iter != standby_.end(); ++iter)
+    {
+        if (sender() == &iter->second->process)
+        {
+            disconnect(&iter->second->process, SIGNAL(finished(int, QProcess::ExitStatus)),
+                this, SLOT(onStandbyFinished(int, QProcess::ExitStatus)));
+            delete iter->second;
+            standby_.erase(iter);
+            return;
+        }
+    }
+}
+
+bool SystemController::isPoolable(const Service & service)
+{
+    for (int i = 0; STANDBY_VIEWERS[i] != 0; ++i)
+    {
+        if (service.app_name() == STANDBY_VIEWERS[i])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SystemController::startStandbyViewer(Service & service)
+{
+    if (standby_.find(service.app_name()) != standby_.end() ||
+        applications_.find(service.app_name()) != applications_.end())
+    {
+        return false;
+    }
+
+    ViewerPtr ptr = new Viewer;
+    ptr->service = service;
+    ptr->state = SERVICE_INVALID;
+    ptr->pooled = true;
+    setupDisplayParameters(ptr->display_args);
+    ptr->process.setEnvironment(QProcess::systemEnvironment());
+    connect(&ptr->process, SIGNAL(finished(int, QProcess::ExitStatus)),
+        this, SLOT(onStandbyFinished(int, QProcess::ExitStatus)));
+
+    QStringList args(ptr->display_args);
+    args << STANDBY_ARG;
+    standby_[service.app_name()] = ptr;
+    ptr->process.start(service.app_name(), args);
+    if (ptr->process.error() == QProcess::FailedToStart)
+    {
+        standby_.erase(service.app_name());
+        delete ptr;
+        return false;
+    }
+    return true;
+}
+
+/// Take the parked viewer of the service out of the pool. A viewer that
+/// has not registered its service yet, or was started with another
+/// screen rotation, can not be used and is stopped.
+SystemController::ViewerPtr SystemController::takeStandbyViewer(Service & service)
+{
+    ApplicationTableIter iter = standby_.find(service.app_name());
+    if (iter == standby_.end())
+    {
+        return 0;
+    }
+
+    // Another service of the same program, e.g. the DRM handler of
+    // naboo_reader, needs its own process. Keep the parked one.
+    ViewerPtr ptr = iter->second;
+    if (ptr->service.service_name() != service.service_name())
+    {
+        return 0;
+    }
+    standby_.erase(iter);
+    disconnect(&ptr->process, SIGNAL(finished(int, QProcess::ExitStatus)),
+        this, SLOT(onStandbyFinished(int, QProcess::ExitStatus)));
+
+    QStringList args;
+    setupDisplayParameters(args);
+    QDBusConnectionInterface *iface = connection_.interface();
+    if (ptr->display_args != args ||
+        ptr->process.state() != QProcess::Running ||
+        iface == 0 ||
+        !iface->isServiceRegistered(service.service_name()))
+    {
+        ptr->process.kill();
+        ptr->process.waitForFinished(500);
+        delete ptr;
+        return 0;
+    }
+    return ptr;
+}
+
+void SystemController::releaseStandbyViewers()
+{
+    for(ApplicationTableIter iter = standby_.begin(); iter != standby_.end(); ++iter)
+    {
+        disconnect(&iter->second->process, SIGNAL(finished(int, QProcess::ExitStatus)),
+            this, SLOT(onStandbyFinished(int, QProcess::ExitStatus)));
+        iter->second->process.kill();
+        iter->second->process.waitForFinished(500);
+        delete iter->second;
+    }
+    standby_.clear();
 }
 
 /// It will be invoked when timeout after launching.
@@ -325,6 +527,7 @@ void SystemController::stopAllApplications(bool wait_for_finished)
         delete iter->second;
     }
     applications_.clear();
+    releaseStandbyViewers();
 
     // Also stop background applications.
     stopExtracting();
@@ -468,9 +671,44 @@ SystemController::ViewerPtr SystemController::startViewer(Service & service,
 
     // Search in the running table.
     ViewerPtr ptr = 0;
+    open_timer_.start();
+    open_key_ = QFileInfo(path).suffix().toLower();
+    open_interface_ = service.interface_name();
     ApplicationTableIter iter = applications_.find(service.app_name());
-    if (iter == applications_.end())
+
+    // The parked viewers take a path only, e.g. a new note needs a cold start.
+    if (iter == applications_.end() &&
+        additional_args.isEmpty() &&
+        (ptr = takeStandbyViewer(service)) != 0)
+    {
+        // Hand the document to the parked viewer.
+        open_key_ += " warm";
+        ptr->state = SERVICE_LAUNCHING;
+        connect(&ptr->process, SIGNAL(stateChanged(QProcess::ProcessState)),
+            this, SLOT(onProcessStateChanged(QProcess::ProcessState)));
+        connect(&ptr->process, SIGNAL(finished(int, QProcess::ExitStatus)),
+            this, SLOT(onProcessFinished(int, QProcess::ExitStatus)));
+        applications_[service.app_name()] = ptr;
+        emit viewerStateChanged(SERVICE_LAUNCHING);
+
+        QDBusMessage message = QDBusMessage::createMethodCall(service.service_name(),
+            service.object_path(),
+            service.interface_name(),
+            service.method());
+        message << path;
+        connection_.call(message, QDBus::NoBlock);
+        postStart(ptr);
+    }
+    else if (iter == applications_.end())
     {
+        open_key_ += " cold";
+
+        // The parked viewers would compete with the new process for memory.
+        if (sys::needReleaseMemory())
+        {
+            releaseStandbyViewers();
+        }
+
         // Create the process. Although we can use dbus activation to create the process,
         // we have to create the process ourselves. The reason is that we have to pass
         // the display parameter to the process. Make sure the viewer can be found
@@ -490,6 +728,7 @@ SystemController::ViewerPtr SystemController::startViewer(Service & service,
         ptr = new Viewer;
         ptr->service = service;
         ptr->state = SERVICE_LAUNCHING;
+        ptr->pooled = false;
         ptr->process.setEnvironment(QProcess::systemEnvironment());
 
         connect(&ptr->process, SIGNAL(stateChanged(QProcess::ProcessState)),
@@ -515,6 +754,7 @@ SystemController::ViewerPtr SystemController::startViewer(Service & service,
         // There is already this kind of service now.
         // Check if we can use dbus to open the document.
         ptr = iter->second;
+        open_key_ += " running";
 
         // Now, use dbus service to open it. Make sure the service is listed in /etc/dbus-1/system.conf
         // for security reason.
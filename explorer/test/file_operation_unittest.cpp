@@ -0,0 +1,141 @@
+// Copies trees with FileOperation and checks the result, a cancelled copy
+// and the rollback of a failed one.
+
+#include <unistd.h>
+
+#include "onyx/base/base.h"
+#include "testing/testing.h"
+#include "file_operation.h"
+
+using namespace explorer::model;
+
+namespace
+{
+
+QString testDir(const QString & name)
+{
+    QDir dir(QDir::temp().absoluteFilePath("file_operation_unittest/" + name));
+    FileOperation clean(FileOperation::REMOVE, dir.absolutePath());
+    clean.start();
+    clean.wait();
+    QDir().mkpath(dir.absolutePath());
+    return dir.absolutePath();
+}
+
+void writeFile(const QString & path, const QByteArray & data)
+{
+    QFile file(path);
+    file.open(QIODevice::WriteOnly);
+    file.write(data);
+}
+
+QByteArray readFile(const QString & path)
+{
+    QFile file(path);
+    file.open(QIODevice::ReadOnly);
+    return file.readAll();
+}
+
+/// Entries of dir, hidden ones included.
+QStringList entries(const QString & dir)
+{
+    return QDir(dir).entryList(QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot,
+                               QDir::Name);
+}
+
+bool runOperation(FileOperation & operation)
+{
+    operation.start();
+    operation.wait();
+    return operation.succeeded();
+}
+
+/// A tree with a replaced file. The user files whose names the copy used
+/// for its partial file and its backup stay as they are.
+TEST(FileOperationCopy)
+{
+    QString source = testDir("copy_source");
+    QString target = testDir("copy_target");
+    QDir().mkpath(source + "/books/sub");
+    writeFile(source + "/books/a.txt", "new a");
+    writeFile(source + "/books/sub/b.txt", "b");
+
+    QDir().mkpath(target + "/books");
+    writeFile(target + "/books/a.txt", "old a");
+    writeFile(target + "/books/a.txt.part", "user part");
+    writeFile(target + "/books/a.txt.orig", "user orig");
+
+    FileOperation copy(FileOperation::COPY, source + "/books", target);
+    EXPECT_TRUE(runOperation(copy));
+    EXPECT_EQ(QByteArray("new a"), readFile(target + "/books/a.txt"));
+    EXPECT_EQ(QByteArray("b"), readFile(target + "/books/sub/b.txt"));
+    EXPECT_EQ(QByteArray("user part"), readFile(target + "/books/a.txt.part"));
+    EXPECT_EQ(QByteArray("user orig"), readFile(target + "/books/a.txt.orig"));
+    EXPECT_TRUE(entries(target + "/books") ==
+                (QStringList() << "a.txt" << "a.txt.orig" << "a.txt.part" << "sub"));
+    EXPECT_EQ(2, copy.results().size());
+}
+
+/// A copy cancelled before it starts leaves the target untouched.
+TEST(FileOperationCancel)
+{
+    QString source = testDir("cancel_source");
+    QString target = testDir("cancel_target");
+    QDir().mkpath(source + "/books");
+    writeFile(source + "/books/a.txt", "new a");
+    QDir().mkpath(target + "/books");
+    writeFile(target + "/books/a.txt", "old a");
+
+    FileOperation copy(FileOperation::COPY, source + "/books", target);
+    copy.cancel();
+    EXPECT_FALSE(runOperation(copy));
+    EXPECT_TRUE(copy.isCancelled());
+    EXPECT_EQ(QByteArray("old a"), readFile(target + "/books/a.txt"));
+    EXPECT_TRUE(entries(target + "/books") == QStringList("a.txt"));
+    EXPECT_TRUE(copy.results().isEmpty());
+}
+
+/// A copy failing half way removes what it created and puts the replaced
+/// files back. The failure is a source file whose target is a folder.
+TEST(FileOperationRollback)
+{
+    QString source = testDir("rollback_source");
+    QString target = testDir("rollback_target");
+    QDir().mkpath(source + "/books/new");
+    writeFile(source + "/books/a.txt", "new a");
+    writeFile(source + "/books/new/c.txt", "c");
+    writeFile(source + "/books/z", "file");
+
+    QDir().mkpath(target + "/books/z");
+    writeFile(target + "/books/a.txt", "old a");
+    writeFile(target + "/books/a.txt.orig", "user orig");
+
+    FileOperation copy(FileOperation::COPY, source + "/books", target);
+    EXPECT_FALSE(runOperation(copy));
+    EXPECT_FALSE(copy.errorString().isEmpty());
+    EXPECT_EQ(QByteArray("old a"), readFile(target + "/books/a.txt"));
+    EXPECT_EQ(QByteArray("user orig"), readFile(target + "/books/a.txt.orig"));
+    EXPECT_TRUE(entries(target + "/books") == (QStringList() << "a.txt" << "a.txt.orig" << "z"));
+    EXPECT_TRUE(QFileInfo(target + "/books/z").isDir());
+    EXPECT_TRUE(copy.results().isEmpty());
+}
+
+/// A link to a folder is copied as a link. One pointing back into the
+/// source does not make the copy recurse.
+TEST(FileOperationSymLink)
+{
+    QString source = testDir("link_source");
+    QString target = testDir("link_target");
+    QDir().mkpath(source + "/books");
+    writeFile(source + "/books/a.txt", "a");
+    ::symlink("..", QFile::encodeName(source + "/books/up"));
+
+    FileOperation copy(FileOperation::COPY, source + "/books", target);
+    EXPECT_TRUE(runOperation(copy));
+    EXPECT_EQ(QByteArray("a"), readFile(target + "/books/a.txt"));
+    QFileInfo link(target + "/books/up");
+    EXPECT_TRUE(link.isSymLink());
+    EXPECT_EQ(1, copy.results().size());
+}
+
+}
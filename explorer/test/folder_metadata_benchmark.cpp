@@ -0,0 +1,75 @@
+// Compares loading the content information of a large folder file by
+// file, as the explorer used to, with one query for the whole folder.
+
+#include "onyx/base/base.h"
+#include "testing/testing.h"
+#include "onyx/cms/content_manager.h"
+
+using namespace cms;
+
+namespace
+{
+
+static const int FILE_COUNT = 5000;
+
+TEST(FolderMetadataBenchmark)
+{
+    QDir dir(QDir::temp().absoluteFilePath("folder_metadata_benchmark"));
+    dir.mkpath(dir.absolutePath());
+    QString db_path = dir.absoluteFilePath("content.db");
+    QFile::remove(db_path);
+
+    ContentManager db;
+    EXPECT_TRUE(db.open(db_path));
+
+    QStringList paths;
+    for (int i = 0; i < FILE_COUNT; ++i)
+    {
+        QString path = dir.absoluteFilePath(QString("book%1.pdf").arg(i));
+        QFile file(path);
+        file.open(QIODevice::WriteOnly);
+        file.close();
+        paths << path;
+
+        // Every other file has a record.
+        if (i % 2 == 0)
+        {
+            ContentNode node(path);
+            node.mutable_rating() = i % 5;
+            db.createContentNode(node);
+        }
+    }
+
+    QTime timer;
+    timer.start();
+    int found = 0;
+    for (int i = 0; i < paths.size(); ++i)
+    {
+        ContentNode node;
+        if (db.getContentNode(node, paths[i], false))
+        {
+            ++found;
+        }
+    }
+    int single_ms = timer.elapsed();
+
+    timer.restart();
+    ContentNodes nodes;
+    EXPECT_TRUE(db.getContentNodes(dir.absolutePath(), nodes));
+    int batch_ms = timer.elapsed();
+
+    EXPECT_EQ(found, FILE_COUNT / 2);
+    EXPECT_EQ(static_cast<int>(nodes.size()), FILE_COUNT / 2);
+    qDebug("%d files: %d ms file by file, %d ms with one query",
+           FILE_COUNT, single_ms, batch_ms);
+
+    db.close();
+    for (int i = 0; i < paths.size(); ++i)
+    {
+        QFile::remove(paths[i]);
+    }
+    QFile::remove(db_path);
+    dir.rmdir(dir.absolutePath());
+}
+
+}
@@ -1,66 +1,568 @@
-#include <stdio.h>
-#include <stdlib.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/syscall.h>
 #include "clog.h"
+#include "clog_format.h"
 
 #ifdef ENABLE_LOG
 
-// only log errors by default
-static LogLevel g_log_level = LOG_ERROR;
-
+// Messages are not formatted by the thread that logs them. Every thread
+// copies the format pointer and the arguments into its own ring buffer and
+// a background thread formats and writes them. The buffers have a single
+// writer and a single reader, so no lock is taken on the logging path.
+// When a buffer is full the message is dropped and counted, the logging
+// thread never waits for the disk.
+//
+// Errors are the exception: they are written before log_msg returns, so
+// they are not lost when the process dies right after. The thread that
+// logs an error takes the write lock, writes what the buffers hold and
+// then the error, the reader of the buffers is the holder of the lock.
+
+#define LOG_BUFFER_SIZE (64 * 1024)
+#define LOG_MAX_ARGS 1024
+#define LOG_FLUSH_INTERVAL_US (50 * 1000)
+#define LOG_FILE_MAX_DEFAULT (4 * 1024 * 1024)
+
+typedef struct
+{
+    unsigned int size;        // whole record, padded to 8 bytes
+    unsigned int args_size;
+    int line;
+    int level;
+    const char* fmt;          // NULL for the padding at the end of the ring
+    const char* src;
+    unsigned long long time_us;
+} LogRecord;
+
+typedef struct LogBuffer
+{
+    struct LogBuffer* next;
+    volatile int in_use;
+    unsigned int tid;
+    volatile unsigned int head;       // advanced by the logging thread only
+    volatile unsigned int tail;       // advanced by the background thread only
+    volatile unsigned int dropped;
+    unsigned int reported;
+    char data[LOG_BUFFER_SIZE];
+} LogBuffer;
+
+typedef struct
+{
+    const char* fmt;
+    const char* src;
+    int line;
+    unsigned int id;
+} LogFormat;
+
+// only log errors by default
+static LogLevel g_log_level = LOG_ERROR;
+
 static FILE* g_log_fp = NULL;
+static char* g_log_path = NULL;
+static long g_log_max = LOG_FILE_MAX_DEFAULT;
+static int g_log_binary = 0;
+
+static LogBuffer* volatile g_buffers = NULL;
+static __thread LogBuffer* t_buffer = NULL;
+static pthread_key_t g_buffer_key;
+
+static pthread_t g_thread;
+static pthread_mutex_t g_write_mutex = PTHREAD_MUTEX_INITIALIZER;
+static volatile int g_running = 0;
+static volatile int g_stop = 0;
+static int g_fork_handlers = 0;
+
+// Call sites already written to the binary file, used by the background
+// thread only.
+static LogFormat* g_formats = NULL;
+static unsigned int g_formats_capacity = 0;
+static unsigned int g_formats_count = 0;
+
+static unsigned int align_record(unsigned int size)
+{
+    return (size + 7) & ~7u;
+}
+
+static void release_buffer(void* buffer)
+{
+    __sync_synchronize();
+    ((LogBuffer*)buffer)->in_use = 0;
+}
+
+static LogBuffer* acquire_buffer()
+{
+    LogBuffer* buffer;
+    if (t_buffer)
+    {
+        return t_buffer;
+    }
+
+    // Buffers of finished threads are reused, what they still hold is
+    // drained as usual.
+    for (buffer = g_buffers; buffer; buffer = buffer->next)
+    {
+        if (!buffer->in_use && __sync_bool_compare_and_swap(&buffer->in_use, 0, 1))
+        {
+            break;
+        }
+    }
+
+    if (!buffer)
+    {
+        buffer = (LogBuffer*)calloc(1, sizeof(LogBuffer));
+        if (!buffer)
+        {
+            return NULL;
+        }
+        buffer->in_use = 1;
+        do
+        {
+            buffer->next = g_buffers;
+        } while (!__sync_bool_compare_and_swap(&g_buffers, buffer->next, buffer));
+    }
+
+    buffer->tid = (unsigned int)syscall(SYS_gettid);
+    pthread_setspecific(g_buffer_key, buffer);
+    t_buffer = buffer;
+    return buffer;
+}
+
+static void write_text(FILE* fp, const char* src, int line, const char* fmt, va_list args)
+{
+    flockfile(fp);
+    fprintf(fp, "%s:%d ", src, line);
+    vfprintf(fp, fmt, args);
+    fprintf(fp, "\n");
+    fflush(fp);
+    funlockfile(fp);
+}
+
+static void write_bytes(const void* data, size_t size)
+{
+    fwrite(data, 1, size, g_log_fp);
+}
+
+static void write_string(const char* str)
+{
+    size_t length = strlen(str);
+    unsigned short size = length > 0xffff ? 0xffff : length;
+    write_bytes(&size, sizeof(size));
+    write_bytes(str, size);
+}
+
+static void write_header()
+{
+    unsigned int version = CLOG_FILE_VERSION;
+    write_bytes(CLOG_FILE_MAGIC, 4);
+    write_bytes(&version, sizeof(version));
+    g_formats_count = 0;
+    if (g_formats)
+    {
+        memset(g_formats, 0, g_formats_capacity * sizeof(LogFormat));
+    }
+}
+
+static unsigned int format_slot(const char* fmt, const char* src, int line)
+{
+    unsigned long hash = ((unsigned long)fmt * 31 + (unsigned long)src) * 31 + line;
+    unsigned int i = (hash ^ (hash >> 13)) & (g_formats_capacity - 1);
+    while (g_formats[i].fmt &&
+           (g_formats[i].fmt != fmt || g_formats[i].src != src || g_formats[i].line != line))
+    {
+        i = (i + 1) & (g_formats_capacity - 1);
+    }
+    return i;
+}
+
+// Returns the id of the call site, writing its format record the first time.
+static unsigned int format_id(const char* fmt, const char* src, int line)
+{
+    unsigned int i;
+    unsigned int value;
+    char kind = CLOG_RECORD_FORMAT;
+
+    if (g_formats_count * 4 >= g_formats_capacity * 3)
+    {
+        LogFormat* old = g_formats;
+        unsigned int old_capacity = g_formats_capacity;
+        LogFormat* formats;
+        g_formats_capacity = old_capacity ? old_capacity * 2 : 256;
+        formats = (LogFormat*)calloc(g_formats_capacity, sizeof(LogFormat));
+        if (!formats)
+        {
+            abort();
+        }
+        g_formats = formats;
+        for (i = 0; i < old_capacity; ++i)
+        {
+            if (old[i].fmt)
+            {
+                g_formats[format_slot(old[i].fmt, old[i].src, old[i].line)] = old[i];
+            }
+        }
+        free(old);
+    }
+
+    i = format_slot(fmt, src, line);
+    if (g_formats[i].fmt)
+    {
+        return g_formats[i].id;
+    }
+
+    g_formats[i].fmt = fmt;
+    g_formats[i].src = src;
+    g_formats[i].line = line;
+    g_formats[i].id = g_formats_count++;
+
+    write_bytes(&kind, 1);
+    write_bytes(&g_formats[i].id, sizeof(unsigned int));
+    value = line;
+    write_bytes(&value, sizeof(value));
+    write_string(src);
+    write_string(fmt);
+    return g_formats[i].id;
+}
+
+static void write_record(unsigned int tid, const LogRecord* record, const char* args)
+{
+    if (g_log_binary)
+    {
+        unsigned int id = format_id(record->fmt, record->src, record->line);
+        char kind = CLOG_RECORD_MESSAGE;
+        unsigned char level = record->level;
+        unsigned short size = record->args_size;
+        write_bytes(&kind, 1);
+        write_bytes(&id, sizeof(id));
+        write_bytes(&level, 1);
+        write_bytes(&record->time_us, sizeof(record->time_us));
+        write_bytes(&tid, sizeof(tid));
+        write_bytes(&size, sizeof(size));
+        write_bytes(args, size);
+    }
+    else
+    {
+        fprintf(g_log_fp, "%s:%d ", record->src, record->line);
+        clog_format(g_log_fp, record->fmt, args, record->args_size);
+        fputc('\n', g_log_fp);
+    }
+}
+
+static void write_dropped(unsigned int count)
+{
+    if (g_log_binary)
+    {
+        char kind = CLOG_RECORD_DROPPED;
+        write_bytes(&kind, 1);
+        write_bytes(&count, sizeof(count));
+    }
+    else
+    {
+        fprintf(g_log_fp, "clog: %u messages dropped\n", count);
+    }
+}
+
+static void rotate_file()
+{
+    size_t length = strlen(g_log_path);
+    char* old_path = (char*)malloc(length + 3);
+    FILE* fp;
+
+    if (!old_path)
+    {
+        return;
+    }
+    memcpy(old_path, g_log_path, length);
+    memcpy(old_path + length, ".1", 3);
+
+    fclose(g_log_fp);
+    rename(g_log_path, old_path);
+    free(old_path);
+
+    fp = fopen(g_log_path, "a");
+    g_log_fp = fp ? fp : stdout;
+    if (g_log_binary && fp)
+    {
+        write_header();
+    }
+}
+
+// Writes everything the ring buffers hold. Called with the write lock held.
+static void drain_buffers()
+{
+    LogBuffer* buffer;
+    for (buffer = g_buffers; buffer; buffer = buffer->next)
+    {
+        unsigned int head = buffer->head;
+        unsigned int tail = buffer->tail;
+        unsigned int dropped = buffer->dropped;
+        __sync_synchronize();
+
+        while (tail != head)
+        {
+            unsigned int pos = tail % LOG_BUFFER_SIZE;
+            const LogRecord* record = (const LogRecord*)(buffer->data + pos);
+            if (LOG_BUFFER_SIZE - pos < sizeof(LogRecord))
+            {
+                tail += LOG_BUFFER_SIZE - pos;
+                continue;
+            }
+            if (record->fmt)
+            {
+                write_record(buffer->tid, record, (const char*)(record + 1));
+            }
+            tail += record->size;
+        }
+
+        __sync_synchronize();
+        buffer->tail = tail;
+
+        if (dropped != buffer->reported)
+        {
+            write_dropped(dropped - buffer->reported);
+            buffer->reported = dropped;
+        }
+    }
+}
+
+static void flush_file()
+{
+    fflush(g_log_fp);
+    if (g_log_path && g_log_fp != stdout && ftell(g_log_fp) > g_log_max)
+    {
+        rotate_file();
+    }
+}
+
+static void* log_thread(void* arg)
+{
+    (void)arg;
+    while (!g_stop)
+    {
+        usleep(LOG_FLUSH_INTERVAL_US);
+        pthread_mutex_lock(&g_write_mutex);
+        drain_buffers();
+        flush_file();
+        pthread_mutex_unlock(&g_write_mutex);
+    }
+    return NULL;
+}
+
+static void log_exit()
+{
+    if (g_running)
+    {
+        g_stop = 1;
+        pthread_join(g_thread, NULL);
+        pthread_mutex_lock(&g_write_mutex);
+        g_running = 0;
+        drain_buffers();
+        flush_file();
+        pthread_mutex_unlock(&g_write_mutex);
+    }
+}
+
+// The write lock is held over fork(), so the child gets the log file in a
+// consistent state. The background thread does not exist in the child, it
+// writes its messages at once; what the buffers held at the fork is written
+// by the parent.
+static void fork_prepare()
+{
+    pthread_mutex_lock(&g_write_mutex);
+}
+
+static void fork_parent()
+{
+    pthread_mutex_unlock(&g_write_mutex);
+}
+
+static void fork_child()
+{
+    g_running = 0;
+    pthread_mutex_unlock(&g_write_mutex);
+}
+
+static void write_error(LogLevel level, const char* src, int line, const char* fmt, va_list args)
+{
+    char packed[LOG_MAX_ARGS];
+    LogRecord record;
+    struct timeval now;
+
+    record.args_size = clog_pack(packed, sizeof(packed), fmt, args);
+    record.size = 0;
+    record.line = line;
+    record.level = level;
+    record.fmt = fmt;
+    record.src = src;
+    gettimeofday(&now, NULL);
+    record.time_us = (unsigned long long)now.tv_sec * 1000000 + now.tv_usec;
+
+    pthread_mutex_lock(&g_write_mutex);
+    drain_buffers();
+    write_record((unsigned int)syscall(SYS_gettid), &record, packed);
+    flush_file();
+    pthread_mutex_unlock(&g_write_mutex);
+}
+
+void log_init()
+{
+    const char* p = getenv("LOG_LEVEL");
+    if (p)
+    {
+        g_log_level = atoi(p);
+
+        if (g_log_level < LOG_ERROR)
+        {
+            g_log_level = LOG_ERROR;
+        }
+        else if (g_log_level > LOG_INFO)
+        {
+            g_log_level = LOG_INFO;
+        }
+    }
+
+    if (g_running)
+    {
+        return;
+    }
+
+    // output to stdout by default
+    g_log_fp = stdout;
+
+    p = getenv("LOG_FILE_MAX");
+    if (p && atol(p) > 0)
+    {
+        g_log_max = atol(p);
+    }
+
+    p = getenv("LOG_FILE");
+    if (p)
+    {
+        FILE *fp = fopen(p, "a");
+        if (fp)
+        {
+            g_log_fp = fp;
+            g_log_path = strdup(p);
+            fseek(fp, 0, SEEK_END);
+
+            // the binary format can only be read from the file header on,
+            // so it never continues an existing file
+            g_log_binary = getenv("LOG_BINARY") != NULL;
+            if (g_log_binary)
+            {
+                if (ftell(fp) > 0 && g_log_path)
+                {
+                    rotate_file();
+                }
+                else
+                {
+                    write_header();
+                }
+            }
+        }
+    }
+
+    if (pthread_key_create(&g_buffer_key, release_buffer) != 0)
+    {
+        return;
+    }
+    g_stop = 0;
+    if (pthread_create(&g_thread, NULL, log_thread, NULL) == 0)
+    {
+        g_running = 1;
+        if (!g_fork_handlers)
+        {
+            g_fork_handlers = 1;
+            pthread_atfork(fork_prepare, fork_parent, fork_child);
+            atexit(log_exit);
+        }
+    }
+}
+
+void log_msg(LogLevel level, const char* src, int line, const char* fmt, ...)
+{
+    if (level <= g_log_level)
+    {
+        // %m prints the errno of the caller, logging does not change it.
+        const int error = errno;
+        va_list args;
+        va_start(args, fmt);
+
+        // Before log_init and after exit the message is written at once.
+        if (!g_running)
+        {
+            write_text(g_log_binary || !g_log_fp ? stderr : g_log_fp, src, line, fmt, args);
+        }
+        else if (level <= LOG_ERROR)
+        {
+            write_error(level, src, line, fmt, args);
+        }
+        else
+        {
+            LogBuffer* buffer = acquire_buffer();
+            errno = error;
+            if (!buffer)
+            {
+                write_text(g_log_binary ? stderr : g_log_fp, src, line, fmt, args);
+            }
+            else
+            {
+                char packed[LOG_MAX_ARGS];
+                unsigned int args_size = clog_pack(packed, sizeof(packed), fmt, args);
+                unsigned int size = align_record(sizeof(LogRecord) + args_size);
+                unsigned int head = buffer->head;
+                unsigned int pos = head % LOG_BUFFER_SIZE;
+                unsigned int pad = 0;
+                unsigned int tail;
+                LogRecord* record;
+                struct timeval now;
+
+                if (LOG_BUFFER_SIZE - pos < size)
+                {
+                    pad = LOG_BUFFER_SIZE - pos;
+                }
+                tail = buffer->tail;
+                __sync_synchronize();
+
+                if (LOG_BUFFER_SIZE - (head - tail) < pad + size)
+                {
+                    __sync_fetch_and_add(&buffer->dropped, 1);
+                }
+                else
+                {
+                    if (pad >= sizeof(LogRecord))
+                    {
+                        record = (LogRecord*)(buffer->data + pos);
+                        record->size = pad;
+                        record->fmt = NULL;
+                    }
+                    head += pad;
+
+                    gettimeofday(&now, NULL);
+                    record = (LogRecord*)(buffer->data + head % LOG_BUFFER_SIZE);
+                    record->size = size;
+                    record->args_size = args_size;
+                    record->line = line;
+                    record->level = level;
+                    record->fmt = fmt;
+                    record->src = src;
+                    record->time_us = (unsigned long long)now.tv_sec * 1000000 + now.tv_usec;
+                    memcpy(record + 1, packed, args_size);
+
+                    __sync_synchronize();
+                    buffer->head = head + size;
+                }
+            }
+        }
+
+        va_end(args);
+        errno = error;
+    }
+}
 
-void log_init()
-{
-    const char* p = getenv("LOG_LEVEL");
-    if (p)
-    {
-        g_log_level = atoi(p);
-        
-        if (g_log_level < LOG_ERROR)
-        {
-            g_log_level = LOG_ERROR;
-        }
-        else if (g_log_level > LOG_INFO)
-        {
-            g_log_level = LOG_INFO;
-        }
-    }
-
-    // output to stdout by default
-    g_log_fp = stdout;
-
-    p = getenv("LOG_FILE");
-    if (p)
-    {
-        FILE *fp = fopen(p, "a");
-        if (fp)
-        {
-            // set file stream line buffered
-            // the buffer will be flushed to file once and only it contains a newline indicator (\n)
-            setlinebuf(fp);
-            g_log_fp = fp;
-        }
-    }
-}
-
-void log_msg(LogLevel level, const char* src, int line, const char* fmt, ...)
-{
-    if (level <= g_log_level)
-    {
-        flockfile(g_log_fp);
-
-        va_list args;
-        va_start(args, fmt);
-
-        fprintf(g_log_fp, "%s:%d ", src, line);
-        vfprintf(g_log_fp, fmt, args);
-        fprintf(g_log_fp, "\n");
-
-        va_end(args);
-
-        funlockfile(g_log_fp);
-    }
-}
-
-#endif
+#endif
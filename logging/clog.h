@@ -16,6 +16,10 @@ typedef enum
 } LogLevel;
 
 void log_init();
+
+// Messages are written by a background thread, errors before log_msg
+// returns. The arguments are copied: a string is cut after
+// CLOG_MAX_STRING (1000) bytes, %m prints the errno of the caller.
 void log_msg(LogLevel level, const char* src, int line, const char* fmt, ...);
 
 #else
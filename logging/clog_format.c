@@ -0,0 +1,568 @@
+#include <ctype.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "clog_format.h"
+
+typedef enum
+{
+    ARG_NONE,
+    ARG_INT,
+    ARG_LONG,
+    ARG_LLONG,
+    ARG_SIZE,
+    ARG_INTMAX,
+    ARG_PTRDIFF,
+    ARG_DOUBLE,
+    ARG_LDOUBLE,
+    ARG_PTR,
+    ARG_STR,
+    ARG_ERRNO,
+} ArgType;
+
+#define PRECISION_NONE -1
+#define PRECISION_STAR -2
+
+// Parse the conversion p points to. Returns the end of the conversion,
+// its argument type, the number of '*' width and precision arguments and
+// the precision, PRECISION_STAR when it is one of these arguments.
+static const char* scan_conversion(const char* p, ArgType* type, int* stars, int* precision)
+{
+    char length = 0;
+
+    *type = ARG_NONE;
+    *stars = 0;
+    *precision = PRECISION_NONE;
+    ++p;
+    while (*p && strchr("-+ #0'", *p))
+    {
+        ++p;
+    }
+    if (*p == '*')
+    {
+        ++*stars;
+        ++p;
+    }
+    while (isdigit((unsigned char)*p))
+    {
+        ++p;
+    }
+    if (*p == '.')
+    {
+        ++p;
+        *precision = 0;
+        if (*p == '*')
+        {
+            *precision = PRECISION_STAR;
+            ++*stars;
+            ++p;
+        }
+        while (isdigit((unsigned char)*p))
+        {
+            if (*precision >= 0 && *precision < CLOG_MAX_STRING)
+            {
+                *precision = *precision * 10 + (*p - '0');
+            }
+            ++p;
+        }
+    }
+
+    switch (*p)
+    {
+    case 'h':
+        length = *p++;
+        if (*p == 'h')
+        {
+            ++p;
+        }
+        break;
+    case 'l':
+        length = *p++;
+        if (*p == 'l')
+        {
+            length = 'q';
+            ++p;
+        }
+        break;
+    case 'q':
+    case 'z':
+    case 'j':
+    case 't':
+    case 'L':
+        length = *p++;
+        break;
+    }
+
+    switch (*p)
+    {
+    case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+        switch (length)
+        {
+        case 'l': *type = ARG_LONG; break;
+        case 'q': *type = ARG_LLONG; break;
+        case 'z': *type = ARG_SIZE; break;
+        case 'j': *type = ARG_INTMAX; break;
+        case 't': *type = ARG_PTRDIFF; break;
+        default: *type = ARG_INT; break;
+        }
+        break;
+    case 'c':
+        *type = ARG_INT;
+        break;
+    case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+        *type = (length == 'L') ? ARG_LDOUBLE : ARG_DOUBLE;
+        break;
+    case 's':
+        // Wide strings are not copied, only the pointer is kept.
+        *type = (length == 'l') ? ARG_PTR : ARG_STR;
+        break;
+    case 'p':
+    case 'n':
+        *type = ARG_PTR;
+        break;
+    case 'm':
+        // glibc prints strerror(errno) for %m, the errno of the caller is
+        // kept in the arguments.
+        *type = ARG_ERRNO;
+        break;
+    }
+    if (*p)
+    {
+        ++p;
+    }
+    return p;
+}
+
+static int put(char* out, size_t size, size_t* used, const void* value, size_t length)
+{
+    if (size - *used < length)
+    {
+        return 0;
+    }
+    memcpy(out + *used, value, length);
+    *used += length;
+    return 1;
+}
+
+static int get(const char** args, const char* end, void* value, size_t length)
+{
+    if ((size_t)(end - *args) < length)
+    {
+        return 0;
+    }
+    memcpy(value, *args, length);
+    *args += length;
+    return 1;
+}
+
+size_t clog_pack(char* out, size_t size, const char* fmt, va_list args)
+{
+    size_t used = 0;
+    int ok = 1;
+    const char* p = fmt;
+    const int error = errno;
+    va_list ap;
+
+    va_copy(ap, args);
+    while (ok && (p = strchr(p, '%')) != NULL)
+    {
+        ArgType type;
+        int stars;
+        int precision;
+        int star = 0;
+        int i;
+        p = scan_conversion(p, &type, &stars, &precision);
+        for (i = 0; ok && i < stars; ++i)
+        {
+            star = va_arg(ap, int);
+            ok = put(out, size, &used, &star, sizeof(star));
+        }
+        // A negative '*' precision is taken as if there was none.
+        if (precision == PRECISION_STAR)
+        {
+            precision = star < 0 ? PRECISION_NONE : star;
+        }
+        if (!ok)
+        {
+            break;
+        }
+
+        switch (type)
+        {
+        case ARG_INT:
+        case ARG_LONG:
+        case ARG_LLONG:
+        case ARG_SIZE:
+        case ARG_INTMAX:
+        case ARG_PTRDIFF:
+        {
+            long long value;
+            if (type == ARG_INT) value = va_arg(ap, int);
+            else if (type == ARG_LONG) value = va_arg(ap, long);
+            else if (type == ARG_LLONG) value = va_arg(ap, long long);
+            else if (type == ARG_SIZE) value = va_arg(ap, size_t);
+            else if (type == ARG_INTMAX) value = va_arg(ap, intmax_t);
+            else value = va_arg(ap, ptrdiff_t);
+            ok = put(out, size, &used, &value, sizeof(value));
+            break;
+        }
+        case ARG_DOUBLE:
+        {
+            double value = va_arg(ap, double);
+            ok = put(out, size, &used, &value, sizeof(value));
+            break;
+        }
+        case ARG_LDOUBLE:
+        {
+            long double value = va_arg(ap, long double);
+            ok = put(out, size, &used, &value, sizeof(value));
+            break;
+        }
+        case ARG_PTR:
+        {
+            unsigned long long value = (uintptr_t)va_arg(ap, void*);
+            ok = put(out, size, &used, &value, sizeof(value));
+            break;
+        }
+        case ARG_STR:
+        {
+            const char* str = va_arg(ap, const char*);
+            size_t limit = CLOG_MAX_STRING;
+            unsigned short length;
+            if (str == NULL)
+            {
+                str = "(null)";
+            }
+            // Only the bytes printed are copied, the string does not need
+            // to be terminated after them.
+            if (precision != PRECISION_NONE && (size_t)precision < limit)
+            {
+                limit = precision;
+            }
+            length = strnlen(str, limit);
+            ok = put(out, size, &used, &length, sizeof(length)) &&
+                 put(out, size, &used, str, length);
+            break;
+        }
+        case ARG_ERRNO:
+        {
+            long long value = error;
+            ok = put(out, size, &used, &value, sizeof(value));
+            break;
+        }
+        case ARG_NONE:
+            break;
+        }
+    }
+    va_end(ap);
+    return used;
+}
+
+void clog_format(FILE* fp, const char* fmt, const char* args, size_t size)
+{
+    const char* end = args + size;
+    const char* p = fmt;
+    int ok = 1;
+
+    while (*p)
+    {
+        const char* q = strchr(p, '%');
+        const char* next;
+        ArgType type;
+        int stars;
+        int precision;
+        char spec[64];
+        size_t length = 0;
+        const char* s;
+
+        if (q == NULL)
+        {
+            fputs(p, fp);
+            break;
+        }
+        fwrite(p, 1, q - p, fp);
+        next = scan_conversion(q, &type, &stars, &precision);
+        p = next;
+
+        if (type == ARG_NONE)
+        {
+            if (next - q == 2 && q[1] == '%')
+            {
+                fputc('%', fp);
+            }
+            else
+            {
+                fwrite(q, 1, next - q, fp);
+            }
+            continue;
+        }
+
+        // Put the '*' values into the conversion, so every conversion is
+        // printed with one argument.
+        for (s = q; ok && s < next && length + 12 < sizeof(spec); ++s)
+        {
+            if (*s == '*')
+            {
+                int star = 0;
+                ok = get(&args, end, &star, sizeof(star));
+                // A negative precision is left out, as printf ignores it.
+                if (s[-1] == '.' && star < 0)
+                {
+                    --length;
+                    continue;
+                }
+                length += snprintf(spec + length, sizeof(spec) - length, "%d", star);
+            }
+            else
+            {
+                spec[length++] = *s;
+            }
+        }
+        spec[length] = 0;
+        if (s < next)
+        {
+            ok = 0;
+        }
+        if (!ok)
+        {
+            fputc('?', fp);
+            continue;
+        }
+
+        switch (type)
+        {
+        case ARG_INT:
+        case ARG_LONG:
+        case ARG_LLONG:
+        case ARG_SIZE:
+        case ARG_INTMAX:
+        case ARG_PTRDIFF:
+        {
+            long long value;
+            if (!(ok = get(&args, end, &value, sizeof(value)))) break;
+            if (type == ARG_INT) fprintf(fp, spec, (int)value);
+            else if (type == ARG_LONG) fprintf(fp, spec, (long)value);
+            else if (type == ARG_LLONG) fprintf(fp, spec, value);
+            else if (type == ARG_SIZE) fprintf(fp, spec, (size_t)value);
+            else if (type == ARG_INTMAX) fprintf(fp, spec, (intmax_t)value);
+            else fprintf(fp, spec, (ptrdiff_t)value);
+            break;
+        }
+        case ARG_DOUBLE:
+        {
+            double value;
+            if ((ok = get(&args, end, &value, sizeof(value)))) fprintf(fp, spec, value);
+            break;
+        }
+        case ARG_LDOUBLE:
+        {
+            long double value;
+            if ((ok = get(&args, end, &value, sizeof(value)))) fprintf(fp, spec, value);
+            break;
+        }
+        case ARG_PTR:
+        {
+            unsigned long long value;
+            // %n and wide strings only keep their place in the arguments.
+            if ((ok = get(&args, end, &value, sizeof(value))) && next[-1] == 'p')
+            {
+                fprintf(fp, spec, (void*)(uintptr_t)value);
+            }
+            break;
+        }
+        case ARG_STR:
+        {
+            unsigned short value_length;
+            char value[CLOG_MAX_STRING + 1];
+            if ((ok = get(&args, end, &value_length, sizeof(value_length)) &&
+                      value_length <= CLOG_MAX_STRING &&
+                      get(&args, end, value, value_length)))
+            {
+                value[value_length] = 0;
+                fprintf(fp, spec, value);
+            }
+            break;
+        }
+        case ARG_ERRNO:
+        {
+            long long value;
+            if ((ok = get(&args, end, &value, sizeof(value))))
+            {
+                spec[length - 1] = 's';
+                fprintf(fp, spec, strerror((int)value));
+            }
+            break;
+        }
+        case ARG_NONE:
+            break;
+        }
+        if (!ok)
+        {
+            fputc('?', fp);
+        }
+    }
+}
+
+typedef struct
+{
+    char* src;
+    char* fmt;
+    unsigned int line;
+} Format;
+
+typedef struct
+{
+    Format* formats;
+    unsigned int count;
+} Formats;
+
+static int read_bytes(FILE* fp, void* data, size_t size)
+{
+    return fread(data, 1, size, fp) == size;
+}
+
+static char* read_string(FILE* fp)
+{
+    unsigned short size;
+    char* str;
+    if (!read_bytes(fp, &size, sizeof(size)))
+    {
+        return NULL;
+    }
+    str = (char*)malloc(size + 1);
+    if (!str || !read_bytes(fp, str, size))
+    {
+        free(str);
+        return NULL;
+    }
+    str[size] = 0;
+    return str;
+}
+
+static void clear_formats(Formats* formats)
+{
+    unsigned int i;
+    for (i = 0; i < formats->count; ++i)
+    {
+        free(formats->formats[i].src);
+        free(formats->formats[i].fmt);
+    }
+    free(formats->formats);
+    formats->formats = NULL;
+    formats->count = 0;
+}
+
+static int read_format(FILE* fp, Formats* formats)
+{
+    unsigned int id;
+    unsigned int line;
+    Format* format;
+    if (!read_bytes(fp, &id, sizeof(id)) || !read_bytes(fp, &line, sizeof(line)))
+    {
+        return 0;
+    }
+    if (id >= formats->count)
+    {
+        Format* grown = (Format*)realloc(formats->formats, (id + 1) * sizeof(Format));
+        if (!grown)
+        {
+            return 0;
+        }
+        memset(grown + formats->count, 0, (id + 1 - formats->count) * sizeof(Format));
+        formats->formats = grown;
+        formats->count = id + 1;
+    }
+    format = formats->formats + id;
+    free(format->src);
+    free(format->fmt);
+    format->line = line;
+    format->src = read_string(fp);
+    format->fmt = read_string(fp);
+    return format->src && format->fmt;
+}
+
+static int read_message(FILE* fp, FILE* out, const Formats* formats, int verbose)
+{
+    static const char* levels[] = { "ERROR", "WARNING", "INFO" };
+    unsigned int id;
+    unsigned char level;
+    unsigned long long time_us;
+    unsigned int tid;
+    unsigned short size;
+    char args[0x10000];
+
+    if (!read_bytes(fp, &id, sizeof(id)) ||
+        !read_bytes(fp, &level, sizeof(level)) ||
+        !read_bytes(fp, &time_us, sizeof(time_us)) ||
+        !read_bytes(fp, &tid, sizeof(tid)) ||
+        !read_bytes(fp, &size, sizeof(size)) ||
+        !read_bytes(fp, args, size))
+    {
+        return 0;
+    }
+    if (id >= formats->count || !formats->formats[id].fmt)
+    {
+        return 0;
+    }
+
+    if (verbose)
+    {
+        time_t seconds = time_us / 1000000;
+        char stamp[32];
+        strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", localtime(&seconds));
+        fprintf(out, "%s.%06u %u %s ", stamp, (unsigned int)(time_us % 1000000), tid,
+                level < 3 ? levels[level] : "?");
+    }
+    fprintf(out, "%s:%u ", formats->formats[id].src, formats->formats[id].line);
+    clog_format(out, formats->formats[id].fmt, args, size);
+    fputc('\n', out);
+    return 1;
+}
+
+int clog_dump(FILE* fp, FILE* out, int verbose)
+{
+    Formats formats = { NULL, 0 };
+    char magic[4];
+    unsigned int version;
+    int kind;
+    int ok = 1;
+
+    if (!read_bytes(fp, magic, sizeof(magic)) ||
+        memcmp(magic, CLOG_FILE_MAGIC, sizeof(magic)) != 0 ||
+        !read_bytes(fp, &version, sizeof(version)) ||
+        version != CLOG_FILE_VERSION)
+    {
+        return CLOG_DUMP_NOT_BINARY;
+    }
+
+    while (ok && (kind = fgetc(fp)) != EOF)
+    {
+        switch (kind)
+        {
+        case CLOG_RECORD_FORMAT:
+            ok = read_format(fp, &formats);
+            break;
+        case CLOG_RECORD_MESSAGE:
+            ok = read_message(fp, out, &formats, verbose);
+            break;
+        case CLOG_RECORD_DROPPED:
+        {
+            unsigned int count;
+            ok = read_bytes(fp, &count, sizeof(count));
+            if (ok)
+            {
+                fprintf(out, "clog: %u messages dropped\n", count);
+            }
+            break;
+        }
+        default:
+            ok = 0;
+            break;
+        }
+    }
+
+    clear_formats(&formats);
+    return ok ? CLOG_DUMP_OK : CLOG_DUMP_DAMAGED;
+}
@@ -0,0 +1,48 @@
+#ifndef _CLOG_FORMAT_H
+#define _CLOG_FORMAT_H
+
+// Packing of printf style arguments into a byte buffer and formatting of
+// the packed arguments. Used by the clog backend thread and by clogdump,
+// which reads the binary logs.
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stddef.h>
+
+// Layout of binary log files:
+//   file    := "CLOG" version:u32 record*
+//   record  := 'F' id:u32 line:u32 src:str fmt:str
+//            | 'M' id:u32 level:u8 time_us:u64 tid:u32 size:u16 args
+//            | 'D' count:u32
+//   str     := length:u16 bytes
+// A 'F' record introduces a call site, every 'M' record refers to one.
+// 'D' records report messages dropped because a ring buffer was full.
+#define CLOG_FILE_MAGIC "CLOG"
+#define CLOG_FILE_VERSION 1
+
+#define CLOG_RECORD_FORMAT  'F'
+#define CLOG_RECORD_MESSAGE 'M'
+#define CLOG_RECORD_DROPPED 'D'
+
+// A string argument is cut after this many bytes when the arguments are
+// packed, a longer one is logged only in part. The packed arguments of
+// one message take at most 1024 bytes, the ones that do not fit are
+// printed as "?".
+#define CLOG_MAX_STRING 1000
+
+// Packs the arguments of fmt into out. Arguments that do not fit are
+// left out and printed as "?". Returns the number of bytes used.
+size_t clog_pack(char* out, size_t size, const char* fmt, va_list args);
+
+// Prints fmt with the arguments packed by clog_pack.
+void clog_format(FILE* fp, const char* fmt, const char* args, size_t size);
+
+#define CLOG_DUMP_OK          0
+#define CLOG_DUMP_NOT_BINARY  1
+#define CLOG_DUMP_DAMAGED     2
+
+// Prints the binary log read from fp to out as text, with the time, thread
+// and level of every message when verbose is set.
+int clog_dump(FILE* fp, FILE* out, int verbose);
+
+#endif // _CLOG_FORMAT_H
@@ -0,0 +1,173 @@
+// Packs log arguments the way the clog backend does and prints them back,
+// through clog_format and through a binary log read by clog_dump.
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <string>
+
+#define ENABLE_LOG
+extern "C" {
+#include "logging/clog.h"
+#include "logging/clog_format.h"
+}
+
+#include "testing/testing.h"
+
+namespace {
+
+std::string printed(const char* fmt, ...)
+{
+    char text[4096];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(text, sizeof(text), fmt, args);
+    va_end(args);
+    return text;
+}
+
+std::string packed(const char* fmt, ...)
+{
+    char args[1024];
+    char* text = NULL;
+    size_t length = 0;
+    va_list ap;
+    va_start(ap, fmt);
+    size_t size = clog_pack(args, sizeof(args), fmt, ap);
+    va_end(ap);
+
+    FILE* fp = open_memstream(&text, &length);
+    clog_format(fp, fmt, args, size);
+    fclose(fp);
+    std::string result(text, length);
+    free(text);
+    return result;
+}
+
+std::string readFile(const char* path)
+{
+    std::string result;
+    FILE* fp = fopen(path, "rb");
+    if (fp)
+    {
+        char buffer[4096];
+        size_t size;
+        while ((size = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+        {
+            result.append(buffer, size);
+        }
+        fclose(fp);
+    }
+    return result;
+}
+
+void writeMessages()
+{
+    LOGMSG(LOG_INFO, "first %d %s", 1, "info");
+    LOGMSG(LOG_WARNING, "%.*s|%-6s|%5.2f", 3, "warning", "w", 2.5);
+    LOGMSG(LOG_ERROR, "error %lld %zu", 1LL << 40, (size_t)7);
+    LOGMSG(LOG_INFO, "last %c%%", 'x');
+}
+
+// Writes writeMessages() to path from a child process, which exits so the
+// background thread is drained.
+bool writeLog(const char* path, bool binary)
+{
+    unlink(path);
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        setenv("LOG_FILE", path, 1);
+        setenv("LOG_LEVEL", "2", 1);
+        if (binary)
+        {
+            setenv("LOG_BINARY", "1", 1);
+        }
+        else
+        {
+            unsetenv("LOG_BINARY");
+        }
+        log_init();
+        writeMessages();
+        exit(0);
+    }
+    int status = 0;
+    return pid > 0 && waitpid(pid, &status, 0) == pid &&
+           WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+TEST(PackedArgumentsPrintLikePrintf)
+{
+    EXPECT_EQ(printed("%d %5u %-3x %lld %zu %c|", -3, 42u, 0xab, -(1LL << 40), (size_t)9, 'q'),
+              packed("%d %5u %-3x %lld %zu %c|", -3, 42u, 0xab, -(1LL << 40), (size_t)9, 'q'));
+    EXPECT_EQ(printed("%g %.2f %e", 1.5, 2.345, 1e-7),
+              packed("%g %.2f %e", 1.5, 2.345, 1e-7));
+    EXPECT_EQ(printed("%*d|%-*d|%.*d", 6, 12, 4, 3, 5, 7),
+              packed("%*d|%-*d|%.*d", 6, 12, 4, 3, 5, 7));
+    EXPECT_EQ(printed("100%% %s", "done"), packed("100%% %s", "done"));
+}
+
+TEST(StringPrecisionLimitsTheCopy)
+{
+    EXPECT_EQ(std::string("abc|xy|   ab|abcdef"),
+              packed("%.3s|%.*s|%*s|%.*s", "abcdef", 2, "xyz", 5, "ab", -1, "abcdef"));
+
+    // Only the bytes printed are read, the buffer is not terminated.
+    const char unterminated[3] = { 'a', 'b', 'c' };
+    EXPECT_EQ(std::string("[abc]"), packed("[%.3s]", unterminated));
+    EXPECT_EQ(std::string("[ab]"), packed("[%.*s]", 2, unterminated));
+}
+
+TEST(LongStringsAreCut)
+{
+    std::string text(3 * CLOG_MAX_STRING, 'x');
+    EXPECT_EQ(std::string(CLOG_MAX_STRING, 'x'), packed("%s", text.c_str()));
+    EXPECT_EQ(std::string(10, 'x'), packed("%.10s", text.c_str()));
+}
+
+TEST(ErrnoConversion)
+{
+    errno = ENOENT;
+    const std::string text = packed("open: %m");
+    EXPECT_EQ(std::string("open: ") + strerror(ENOENT), text);
+    EXPECT_EQ(printed("[%-30s]", strerror(EACCES)), (errno = EACCES, packed("[%-30m]")));
+}
+
+TEST(BinaryLogDumpsLikeTextLog)
+{
+    char text_path[] = "/tmp/clog_unittest_text_XXXXXX";
+    char binary_path[] = "/tmp/clog_unittest_binary_XXXXXX";
+    close(mkstemp(text_path));
+    close(mkstemp(binary_path));
+
+    EXPECT_TRUE(writeLog(text_path, false));
+    EXPECT_TRUE(writeLog(binary_path, true));
+
+    const std::string text = readFile(text_path);
+    EXPECT_SUBSTR("error 1099511627776 7", text);
+
+    char* dumped = NULL;
+    size_t length = 0;
+    FILE* out = open_memstream(&dumped, &length);
+    FILE* in = fopen(binary_path, "rb");
+    EXPECT_NOTNULL(in);
+    if (in)
+    {
+        EXPECT_EQ(CLOG_DUMP_OK, clog_dump(in, out, 0));
+        fclose(in);
+    }
+    fclose(out);
+    EXPECT_EQ(text, std::string(dumped, length));
+    free(dumped);
+
+    unlink(text_path);
+    unlink(binary_path);
+}
+
+}  // namespace
@@ -0,0 +1,45 @@
+#include <stdio.h>
+#include <string.h>
+#include "clog_format.h"
+
+// Prints a binary log written with LOG_BINARY set as text.
+//   clogdump [-v] file
+// With -v every message is prefixed with its time, thread and level.
+
+int main(int argc, char* argv[])
+{
+    int verbose = 0;
+    FILE* fp;
+    int result;
+
+    if (argc > 1 && strcmp(argv[1], "-v") == 0)
+    {
+        verbose = 1;
+        --argc;
+        ++argv;
+    }
+    if (argc != 2)
+    {
+        fprintf(stderr, "usage: clogdump [-v] file\n");
+        return 2;
+    }
+
+    fp = fopen(argv[1], "rb");
+    if (!fp)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+    result = clog_dump(fp, stdout, verbose);
+    if (result == CLOG_DUMP_NOT_BINARY)
+    {
+        fprintf(stderr, "clogdump: %s is not a binary log\n", argv[1]);
+    }
+    else if (result == CLOG_DUMP_DAMAGED)
+    {
+        fprintf(stderr, "clogdump: %s is truncated or damaged\n", argv[1]);
+    }
+
+    fclose(fp);
+    return result == CLOG_DUMP_OK ? 0 : 1;
+}
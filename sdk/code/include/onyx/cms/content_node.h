@@ -158,6 +158,7 @@ private:
     static bool getContentNode(QSqlDatabase&, ContentNode &);
     static bool getContentNode(QSqlDatabase&, const cms_long, ContentNode &);
     static bool getContentNodeByUrl(QSqlDatabase&, const QString & url, ContentNode &);
+    static bool getContentNodes(QSqlDatabase&, const QString & location, std::vector<ContentNode> &);
     static bool updateContentNodeByUrl(QSqlDatabase&, const ContentNode &, const QString & url);
     static bool allNodes(QSqlDatabase&, cms_ids & list);
 
@@ -23,6 +23,21 @@ QString typeString(MediaType type);
 
 typedef QStringList MediaInfoList;
 
+/// Information of a music file cached by the player. It stays valid as
+/// long as the file keeps its size and modification time.
+struct MediaTrack
+{
+    MediaTrack() : size(0), duration(0), has_seek_index(false) {}
+
+    QString path;
+    qint64 size;
+    QDateTime modified;
+    qint64 duration;
+    QByteArray tags;        ///< Tags serialized by the player.
+    bool has_seek_index;    ///< A seek index of the file is stored.
+};
+typedef QHash<QString, MediaTrack> MediaTracks;
+
 class MediaDB
 {
 public:
@@ -38,6 +53,15 @@ public:
     bool update(MediaType type, const MediaInfoList & list);
     bool remove(MediaType type);
 
+    /// Seek index of a music file, owned by the decoder which built it.
+    bool seekIndex(const QString & path, QByteArray & data);
+    bool updateSeekIndex(const QString & path, const QByteArray & data);
+
+    /// All cached music files, read in one query.
+    MediaTracks tracks();
+    bool updateTracks(const QList<MediaTrack> & tracks);
+    bool removeTracks(const QStringList & paths);
+
 private:
     bool makeSureTableExist(QSqlDatabase &db);
     QSqlDatabase & db();
@@ -0,0 +1,65 @@
+#ifndef CMS_SQL_STORAGE_H_
+#define CMS_SQL_STORAGE_H_
+
+#include <QtCore/QtCore>
+#include <QtSql/QtSql>
+
+namespace cms
+{
+
+/// Counters collected by the storage layer. Query time is the wall
+/// clock time spent in QSqlQuery::exec on the caller thread; commits
+/// counts the transactions written by the background writer, each of
+/// them costing one synchronous flush on the storage device. Failed
+/// writes are the queued statements that could not be written.
+struct SqlStatistics
+{
+    SqlStatistics();
+
+    int    queries;
+    qint64 query_time;      ///< Total query time in milliseconds.
+    int    slow_queries;    ///< Queries that took longer than 50ms.
+    int    cached_statements;
+    int    queued_writes;
+    int    commits;
+    int    failed_writes;
+};
+
+/// Shared access layer for all sqlite databases used by the sdk.
+/// - open() applies the same journal and sync settings everywhere.
+/// - query() returns a prepared statement from a per connection cache.
+/// - write() queues a modification for the background writer, which
+///   groups the queued statements into a single transaction.
+/// Callers must call flush() before they depend on the data being
+/// on disk, e.g. before suspend. A batch that can not be committed,
+/// e.g. because another process holds the database locked, is rolled
+/// back and tried again a few times. Writes lost after that are
+/// reported by the next flush() and by write() until then. close() and the destruction of the
+/// application object flush as well. A cached query flushes the pending
+/// writes of its database automatically, so reads always see them.
+/// Cached queries are forward only; call finish() after reading.
+class SqlStorage
+{
+public:
+    static bool open(QSqlDatabase & database, bool wal = true);
+    static void close(QSqlDatabase & database);
+
+    static QSqlQuery & query(QSqlDatabase & database, const QString & sql);
+    static bool exec(QSqlQuery & query);
+
+    static bool write(QSqlDatabase & database,
+                      const QString & sql,
+                      const QVariantList & values);
+    static bool flush();
+    static bool flush(const QString & database_name);
+    static void wait(const QString & database_name);
+
+    static SqlStatistics statistics();
+
+private:
+    SqlStorage();
+};
+
+}  // namespace cms
+
+#endif  // CMS_SQL_STORAGE_H_
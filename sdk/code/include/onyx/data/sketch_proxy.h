@@ -6,6 +6,7 @@
 #include "onyx/data/sketch_document.h"
 
 #include "onyx/touch/touch_listener.h"
+#include "onyx/touch/stroke_capture.h"
 
 namespace sketch
 {
@@ -89,6 +90,7 @@ private Q_SLOTS:
     void onUpdateScreenTimeout();
     void onForceDriverDrawLines();
     void onReceivedTouchData(TouchData & data);
+    void onStrokeCaptured(const CapturedStroke & stroke);
 
 protected:
     bool eventFilter(QObject *obj, QEvent *event);
@@ -138,6 +140,9 @@ private:
                            const Strokes & strokes,
                            const SketchPosition & pos);
 
+    void updateStrokeCapture();
+    void reportInkLatency();
+
     // last position
     void resetLastPosition();
     void keepLastPosition(const SketchPosition & pos);
@@ -150,6 +155,8 @@ private:
     QWidget         *attached_widget_;   // attached widget
 
     TouchEventListener raw_event_listener_; // raw touch event listener
+    StrokeCapture   stroke_capture_;     // draws the ink off the gui thread
+    bool            widget_active_;      // attached widget shown and focused
 
     SketchHandlers  sketch_handlers_;    // sketch/erase handlers
     SketchStrokePtr stroke_;             // current stroke
@@ -167,6 +174,7 @@ private:
     SketchMode      mode_;               // current sketch mode
     SketchStatus    status_;             // current sketch status
     int             pressure_of_last_point_; // pressure data of last touch point
+    bool            replaying_;          // adding a captured stroke, already on screen
 };
 
 };
@@ -0,0 +1,114 @@
+/// Public header of the memory broker shared by the page and image caches.
+
+#ifndef SYS_MEMORY_BROKER_H__
+#define SYS_MEMORY_BROKER_H__
+
+#include <QtCore/QtCore>
+
+namespace sys
+{
+
+/// Priority the render policies give to the pages and images they do not
+/// render. Clients return MIN_RENDER_PRIORITY minus the priority of an
+/// entry as its release cost, so entries far from the rendered ones are
+/// dropped first.
+static const int MIN_RENDER_PRIORITY = 0xffff;
+
+class MemoryReleaser;
+
+/// A cache whose memory is managed by the MemoryBroker. The broker calls a
+/// client only on the thread the client was registered on: from reserve()
+/// and budget() of the client itself, and from the event loop of that
+/// thread when other clients need memory. The broker never holds its lock
+/// while it calls a client, so a client may call the broker with its own
+/// lock held.
+class MemoryClient
+{
+public:
+    virtual ~MemoryClient() {}
+
+    /// Bytes held by the cache.
+    virtual unsigned long memoryUsage() = 0;
+
+    /// Cost of dropping the entry releaseMemory() would drop next. Entries
+    /// with lower cost are dropped first. Return a negative value when
+    /// nothing can be dropped.
+    virtual int releaseCost() = 0;
+
+    /// Drop the least valuable entry. Return the number of bytes freed.
+    virtual unsigned long releaseMemory() = 0;
+};
+
+struct MemoryClientStats
+{
+    QString name;
+    int priority;
+    unsigned long usage;
+    unsigned long budget;
+    unsigned long released;
+    unsigned int hits;
+    unsigned int misses;
+};
+
+/// The MemoryBroker shares the memory the system can give to the caches of
+/// the process. Every cache registers with a priority. The budget of a
+/// cache is its share of the memory in use by all caches plus the memory
+/// still available, weighted by priority. When memory runs short the
+/// caches above their budget are asked to drop the excess on their own
+/// thread, and the reserving cache drops its own entries, lowest cost
+/// first, for the rest.
+class MemoryBroker
+{
+public:
+    static MemoryBroker & instance()
+    {
+        static MemoryBroker instance_;
+        return instance_;
+    }
+    ~MemoryBroker();
+
+    /// Register client on the thread that owns the cache. That thread
+    /// needs an event loop to release memory for the other caches.
+    void registerClient(MemoryClient *client, const QString & name, int priority);
+    void unregisterClient(MemoryClient *client);
+
+    /// Make room for bytes more in the cache of client. Return false
+    /// when not enough memory could be released.
+    bool reserve(MemoryClient *client, unsigned long bytes);
+
+    unsigned long budget(MemoryClient *client);
+
+    void recordHit(MemoryClient *client);
+    void recordMiss(MemoryClient *client);
+
+    QVector<MemoryClientStats> stats();
+    void dump();
+
+private:
+    MemoryBroker();
+    MemoryBroker(const MemoryBroker &);
+    MemoryBroker & operator = (const MemoryBroker &);
+
+    friend class MemoryReleaser;
+
+    struct Client
+    {
+        MemoryClient *client;
+        MemoryReleaser *releaser;   ///< lives on the thread of the client
+        unsigned long pending;      ///< bytes the client is asked to drop
+        MemoryClientStats stats;
+    };
+
+    Client * find(MemoryClient *client);
+    void updateBudgets(unsigned long available);
+    unsigned long release(MemoryClient *client, unsigned long bytes);
+    void releasePending(MemoryClient *client);
+
+private:
+    QMutex mutex_;
+    QVector<Client> clients_;
+};
+
+}
+
+#endif  // SYS_MEMORY_BROKER_H__
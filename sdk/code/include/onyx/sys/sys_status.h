@@ -48,6 +48,7 @@ class SysStatus : public QObject
 
     void dbgUpdateBattery(int left, int status);
     void dump();
+    void callStatistics(int & calls, int & total_ms, int & max_ms) const;
 
   public slots:
     bool batteryStatus(int& left, int& status);
@@ -133,6 +134,9 @@ class SysStatus : public QObject
     bool setAsScreensaver(const QString & path);
     void snapshot(const QString &path);
 
+    void enableTelemetry(bool enable);
+    bool exportChromeTrace(const QString &path);
+
     bool hasTouchScreen();
     bool isTTSEnabled();
     bool isDictionaryEnabled();
@@ -221,6 +225,8 @@ class SysStatus : public QObject
 
   private slots:
     void onBatteryChanged(int, int);
+    void onSuspendIntervalChanged(int);
+    void onShutdownIntervalChanged(int);
     void onMountTreeChanged(bool mounted, const QString &mount_point);
     void onMountTreeChanged2(bool mounted, const QString &mount_point, const QString & reason);
     void onSdCardChanged(bool insert);
@@ -273,12 +279,32 @@ class SysStatus : public QObject
     SysStatus();
     SysStatus(SysStatus & ref);
     void installSlots();
+    QDBusMessage call(const QDBusMessage & message) const;
+    bool fetchSnapshot();
 
     QDBusConnection connection_;    ///< Connection to system manager.
     bool usb_mounted_;
     bool sd_mounted_;
     bool flash_mounted_;
     bool system_busy_;
+
+    // Local mirror of the system manager state. It is filled by one
+    // statusSnapshot call and kept up to date by the change signals.
+    bool mirror_connected_;
+    bool snapshot_valid_;
+    int  battery_left_;
+    int  battery_status_;
+    int  volume_;
+    bool mute_;
+    int  suspend_interval_;
+    int  shutdown_interval_;
+    int  music_player_running_;     ///< -1 if unknown.
+
+    // Blocking calls made to the system manager.
+    mutable int sync_calls_;
+    mutable int sync_call_time_;
+    mutable int slowest_call_;
+
     scoped_ptr<WpaConnection> wpa_proxy_;
     scoped_ptr<WpaConnectionManager> connection_manager_;
 };
@@ -27,6 +27,13 @@ unsigned long systemTotalMemory();
 /// Retrieve system available physical memory in bytes.
 unsigned long systemFreeMemory();
 
+/// Retrieve the memory that can be allocated without swapping in bytes.
+/// Unlike systemFreeMemory() this counts the reclaimable page cache.
+unsigned long systemAvailableMemory();
+
+/// Whether tasks stall waiting for memory.
+bool underMemoryPressure();
+
 unsigned long safeMemoryLimit();
 
 bool needReleaseMemory();
@@ -0,0 +1,64 @@
+// Authors: John
+
+/// Lightweight trace spans reported to the system manager telemetry.
+
+#ifndef SYS_TRACE_H__
+#define SYS_TRACE_H__
+
+#include <QtCore/QtCore>
+
+namespace sys
+{
+
+/// Collects the spans of the calling process and sends them to the
+/// system manager in batches. Recording is enabled by setting ONYX_TRACE
+/// in the environment; when it is off a span costs one flag check.
+class Trace
+{
+public:
+    static bool isEnabled();
+
+    /// Monotonic time in microseconds, shared by all processes.
+    static qint64 now();
+
+    /// \param name Must be a string literal, only the pointer is kept.
+    static void addSpan(const char *name, qint64 begin, qint64 end);
+    static void flush();
+
+private:
+    Trace();
+};
+
+/// Measures the lifetime of the enclosing scope.
+class TraceSpan
+{
+public:
+    explicit TraceSpan(const char *name)
+        : name_(name)
+        , begin_(Trace::isEnabled() ? Trace::now() : -1)
+    {
+    }
+
+    ~TraceSpan()
+    {
+        if (begin_ >= 0)
+        {
+            Trace::addSpan(name_, begin_, Trace::now());
+        }
+    }
+
+private:
+    const char *name_;
+    qint64 begin_;
+};
+
+}  // namespace sys
+
+#define ONYX_TRACE_CONCAT_(a, b) a##b
+#define ONYX_TRACE_CONCAT(a, b) ONYX_TRACE_CONCAT_(a, b)
+
+/// Record a span named name from here to the end of the scope.
+#define ONYX_TRACE_SPAN(name) \
+    sys::TraceSpan ONYX_TRACE_CONCAT(onyx_trace_span_, __LINE__)(name)
+
+#endif  // SYS_TRACE_H__
@@ -0,0 +1,67 @@
+/// Public header of the zip archive directory reader.
+
+#ifndef SYS_ZIP_DIRECTORY_H__
+#define SYS_ZIP_DIRECTORY_H__
+
+#include <QtCore/QtCore>
+
+namespace sys
+{
+
+/// An entry of the central directory of a zip archive.
+struct ZipEntry
+{
+    QString name;
+    quint16 method;               ///< 0 stored, 8 deflated.
+    quint32 crc;
+    quint64 compressed_size;
+    quint64 uncompressed_size;
+    quint64 local_header_offset;
+
+    bool isDir() const { return name.endsWith('/'); }
+};
+typedef QVector<ZipEntry> ZipEntries;
+
+/// Reads the central directory of zip archives without extracting
+/// anything. Only the end of central directory record and the central
+/// directory itself are mapped. The entries are cached by path and
+/// modification time, so the explorer, the readers and the thumbnail
+/// generation can ask for the same archive again at no cost.
+class ZipDirectory
+{
+public:
+    static ZipDirectory & instance()
+    {
+        static ZipDirectory instance_;
+        return instance_;
+    }
+    ~ZipDirectory();
+
+    /// Retrieve the entries of the archive in the order of the central
+    /// directory. Return false when path is not a readable zip archive.
+    bool entries(const QString & path, ZipEntries & result);
+
+    void clear();
+
+private:
+    ZipDirectory();
+    ZipDirectory(const ZipDirectory &);
+    ZipDirectory & operator = (const ZipDirectory &);
+
+    struct Cached
+    {
+        QDateTime modified;
+        qint64 size;
+        ZipEntries entries;
+    };
+
+    static bool read(const QString & path, ZipEntries & result);
+
+private:
+    QMutex mutex_;
+    QCache<QString, Cached> cache_;
+};
+
+}
+
+#endif  // SYS_ZIP_DIRECTORY_H__
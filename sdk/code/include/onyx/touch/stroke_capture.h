@@ -0,0 +1,101 @@
+#ifndef ONYX_TOUCH_STROKE_CAPTURE_H_
+#define ONYX_TOUCH_STROKE_CAPTURE_H_
+
+#include <QtCore/QtCore>
+#include "touch_data.h"
+
+/// Points of a finished stroke in global coordinates.
+struct CapturedStroke
+{
+    QVector<QPoint> points;
+};
+Q_DECLARE_METATYPE(CapturedStroke)
+
+/// Time from reading a touch sample to sending the screen command
+/// that draws it, in microseconds.
+struct InkLatency
+{
+    InkLatency() : samples(0), total(0), max(0) {}
+
+    int    samples;
+    qint64 total;
+    qint64 max;
+};
+
+/// StrokeCapture reads the raw touch socket on its own thread and draws
+/// the ink through the screen daemon without going through the gui
+/// thread. Samples are decimated and sent as DRAW_LINES batches when the
+/// batch is full or the oldest pending sample reaches the deadline.
+/// Finished strokes are reported by strokeCaptured, so the owner can add
+/// them to the document model.
+class StrokeCapture : public QThread
+{
+    Q_OBJECT
+
+public:
+    StrokeCapture();
+    ~StrokeCapture();
+
+    /// \param area The capture area in global coordinates.
+    /// \param screen The screen geometry used to rotate the points.
+    /// \param rotation Widget rotation in quarter turns.
+    void setDrawingArea(const QRect & area, const QRect & screen, int rotation);
+    void setPen(int color, int width);
+    void setDeadline(int ms);
+    void setMinDistance(int pixels);
+
+    void setEnabled(bool enable);
+    bool isEnabled();
+    void stop();
+
+    InkLatency latency();
+    void resetLatency();
+
+Q_SIGNALS:
+    void strokeCaptured(const CapturedStroke & stroke);
+
+protected:
+    virtual void run();
+
+private:
+    struct Sample
+    {
+        QPoint pos;
+        qint64 time;
+    };
+
+    bool connectTouch();
+    bool connectScreen();
+    void readSamples();
+    void processSample(const OnyxTouchPoint & point, qint64 time);
+    void addPoint(const QPoint & global_pos, qint64 time);
+    void endStroke();
+    void flushLines();
+    QPoint toScreen(const QPoint & global_pos);
+
+private:
+    QMutex mutex_;
+    QRect  area_;
+    QRect  screen_;
+    int    rotation_;
+    int    color_;
+    int    width_;
+    int    deadline_;
+    int    min_distance_;
+    bool   enabled_;
+    bool   stop_;
+    InkLatency latency_;
+
+    // Owned by the capture thread.
+    int  touch_fd_;
+    int  screen_fd_;
+    int  last_pressure_;
+    bool in_stroke_;
+    QPoint last_point_;
+    QPoint last_drawn_;
+    bool has_last_drawn_;
+    QVector<Sample> pending_;
+    CapturedStroke stroke_;
+};
+
+#endif
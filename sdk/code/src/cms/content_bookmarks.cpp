@@ -1,4 +1,5 @@
 #include "onyx/cms/content_bookmarks.h"
+#include "onyx/cms/sql_storage.h"
 
 namespace cms
 {
@@ -25,22 +26,25 @@ bool ContentBookmarks::getBookmarks(QSqlDatabase &database,
                                     const cms_long id,
                                     cms_blob & data)
 {
-    QSqlQuery query(database);
-    query.prepare( "select bookmarks from content_bookmarks where id = ? ");
-    query.addBindValue(id);
+    QSqlQuery & query = SqlStorage::query(database,
+        "select bookmarks from content_bookmarks where id = ? ");
+    query.bindValue(0, id);
 
-    if (query.exec() && query.next())
+    bool ret = false;
+    if (SqlStorage::exec(query) && query.next())
     {
         data = query.value(0).toByteArray();
-        return true;
+        ret = true;
     }
-    return false;
+    query.finish();
+    return ret;
 }
 
 bool ContentBookmarks::createBookmarks(QSqlDatabase &database,
                                        const cms_long id,
                                        const cms_blob & bookmarks)
 {
+    SqlStorage::wait(database.databaseName());
     QSqlQuery query(database);
 
     // Check the option is already exist or not.
@@ -60,6 +64,7 @@ bool ContentBookmarks::createBookmarks(QSqlDatabase &database,
 bool ContentBookmarks::removeBookmarks(QSqlDatabase &database,
                                        const cms_long id)
 {
+    SqlStorage::wait(database.databaseName());
     QSqlQuery query(database);
     query.prepare( "delete from content_bookmarks where id = ?");
     query.addBindValue(id);
@@ -70,15 +75,18 @@ bool ContentBookmarks::updateBookmarks(QSqlDatabase &database,
                                        const cms_long id,
                                        const cms_blob & bookmarks)
 {
-    QSqlQuery query(database);
-    query.exec("INSERT OR REPLACE into content_bookmarks (id, bookmarks) values(?, ?)");
-    query.addBindValue(id);
-    query.addBindValue(bookmarks);
-    return query.exec();
+    // Bookmarks and notes are saved while reading, let the background
+    // writer batch them.
+    QVariantList values;
+    values << id << bookmarks;
+    return SqlStorage::write(database,
+                             "INSERT OR REPLACE into content_bookmarks (id, bookmarks) values(?, ?)",
+                             values);
 }
 
 bool ContentBookmarks::removeTable(QSqlDatabase &database)
 {
+    SqlStorage::wait(database.databaseName());
     QSqlQuery query(database);
     return query.exec( "drop table content_bookmarks" );
 }
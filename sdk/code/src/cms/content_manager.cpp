@@ -7,6 +7,7 @@
 #include "onyx/cms/content_bookmarks.h"
 #include "onyx/cms/content_shortcut.h"
 #include "onyx/cms/notes_manager.h"
+#include "onyx/cms/sql_storage.h"
 
 
 namespace cms
@@ -56,9 +57,8 @@ bool ContentManager::open(const QString & database_name)
             getDatabasePath("", db_path);
         }
         database_->setDatabaseName(db_path);
-        if (!database_->open())
+        if (!SqlStorage::open(*database_))
         {
-            qDebug() << database_->lastError().text();
             return false;
         }
         initializeTables();
@@ -80,6 +80,7 @@ void ContentManager::close()
 {
     if (database_)
     {
+        SqlStorage::close(*database_);
         database_->close();
         database_.reset(0);
         QSqlDatabase::removeDatabase("cms");
@@ -218,6 +219,15 @@ bool ContentManager::getContentNodeByUrl(ContentNode & info,
     return ContentNode::getContentNodeByUrl(*database_, url, info);
 }
 
+/// Retrieve the content information of all files in the directory
+/// location with one query. Much cheaper than calling getContentNode
+/// for every file when listing a directory.
+bool ContentManager::getContentNodes(const QString & location,
+                                     ContentNodes & nodes)
+{
+    return ContentNode::getContentNodes(*database_, location, nodes);
+}
+
 bool ContentManager::allNodes(cms_ids & nodes)
 {
     return ContentNode::allNodes(*database_, nodes);
@@ -2,6 +2,7 @@
 
 #include "onyx/cms/cms_utils.h"
 #include "onyx/cms/content_node.h"
+#include "onyx/cms/sql_storage.h"
 
 namespace cms
 {
@@ -183,7 +184,8 @@ bool ContentNode::makeSureTableExist(QSqlDatabase &database)
                         ")");
     if (ok)
     {
-        return query.exec("create index if not exists name_index on content (name) ");
+        return query.exec("create index if not exists name_index on content (name) ") &&
+               query.exec("create index if not exists location_index on content (location) ");
     }
     return false;
 }
@@ -221,17 +223,17 @@ ContentNode::getContentNode(QSqlDatabase &database,
     node.mutable_name() = info.fileName();
 
     // Query by name, location and size.
-    QSqlQuery query(database);
-    query.prepare( "select id, title, authors, description, "
-                   "last_access, publisher, md5, "
-                   "rating, read_time, read_count, progress, attributes "
-                   "from content where name = :name and location = :location "
-                   "and size = :size" );
+    QSqlQuery & query = SqlStorage::query(database,
+        "select id, title, authors, description, "
+        "last_access, publisher, md5, "
+        "rating, read_time, read_count, progress, attributes "
+        "from content where name = :name and location = :location "
+        "and size = :size");
     query.bindValue(":name", node.name());
     query.bindValue(":location", node.location());
     query.bindValue(":size", node.size());
 
-    if (query.exec() && query.next())
+    if (SqlStorage::exec(query) && query.next())
     {
         int index = 0;
         node.id_ = query.value(index++).toInt();
@@ -246,8 +248,10 @@ ContentNode::getContentNode(QSqlDatabase &database,
         node.mutable_read_count() = query.value(index++).toInt();
         node.mutable_progress() = query.value(index++).toString();
         node.mutable_attributes() = query.value(index++).toByteArray();
+        query.finish();
         return true;
     }
+    query.finish();
 
     // File has been moved, check the name and size.
     /*
@@ -319,17 +323,17 @@ ContentNode::getContentNode(QSqlDatabase &database,
 bool ContentNode::getContentNode(QSqlDatabase & database,
                                  ContentNode &node)
 {
-    QSqlQuery query(database);
-    query.prepare( "select id, title, authors, description, "
-                   "last_access, publisher, md5, "
-                   "rating, read_time, read_count, progress, attributes "
-                   "from content where name = :name and location = :location "
-                   "and size = :size" );
+    QSqlQuery & query = SqlStorage::query(database,
+        "select id, title, authors, description, "
+        "last_access, publisher, md5, "
+        "rating, read_time, read_count, progress, attributes "
+        "from content where name = :name and location = :location "
+        "and size = :size");
     query.bindValue(":name", node.name());
     query.bindValue(":location", node.location());
     query.bindValue(":size", node.size());
 
-    if (query.exec() && query.next())
+    if (SqlStorage::exec(query) && query.next())
     {
         int index = 0;
         node.id_ = query.value(index++).toInt();
@@ -344,8 +348,10 @@ bool ContentNode::getContentNode(QSqlDatabase & database,
         node.mutable_read_count() = query.value(index++).toInt();
         node.mutable_progress() = query.value(index++).toString();
         node.mutable_attributes() = query.value(index++).toByteArray();
+        query.finish();
         return true;
     }
+    query.finish();
     return false;
 }
 
@@ -353,14 +359,14 @@ bool ContentNode::getContentNode(QSqlDatabase & database,
                                  const cms_long id,
                                  ContentNode & node)
 {
-    QSqlQuery query(database);
-    query.prepare( "select name, location, title, authors, description, "
-                   "last_access, publisher, md5, "
-                   "rating, read_time, read_count, progress, attributes "
-                   "from content where id = :id" );
+    QSqlQuery & query = SqlStorage::query(database,
+        "select name, location, title, authors, description, "
+        "last_access, publisher, md5, "
+        "rating, read_time, read_count, progress, attributes "
+        "from content where id = :id");
     query.bindValue(":id", id);
 
-    if (query.exec() && query.next())
+    if (SqlStorage::exec(query) && query.next())
     {
         int index = 0;
         node.id_ = id;
@@ -377,8 +383,10 @@ bool ContentNode::getContentNode(QSqlDatabase & database,
         node.mutable_read_count() = query.value(index++).toInt();
         node.mutable_progress() = query.value(index++).toString();
         node.mutable_attributes() = query.value(index++).toByteArray();
+        query.finish();
         return true;
     }
+    query.finish();
     return false;
 }
 
@@ -386,14 +394,14 @@ bool ContentNode::getContentNodeByUrl(QSqlDatabase& database,
                                       const QString & url,
                                       ContentNode & node)
 {
-    QSqlQuery query(database);
-    query.prepare( "select id, name, location, title, authors, description, "
-                   "last_access, publisher,  "
-                   "rating, read_time, read_count, progress, attributes "
-                   "from content where md5 = :md5" );
+    QSqlQuery & query = SqlStorage::query(database,
+        "select id, name, location, title, authors, description, "
+        "last_access, publisher,  "
+        "rating, read_time, read_count, progress, attributes "
+        "from content where md5 = :md5");
     query.bindValue(":md5", url);
 
-    if (query.exec() && query.next())
+    if (SqlStorage::exec(query) && query.next())
     {
         int index = 0;
         node.id_ = query.value(index++).toInt();
@@ -410,8 +418,10 @@ bool ContentNode::getContentNodeByUrl(QSqlDatabase& database,
         node.mutable_read_count() = query.value(index++).toInt();
         node.mutable_progress() = query.value(index++).toString();
         node.mutable_attributes() = query.value(index++).toByteArray();
+        query.finish();
         return true;
     }
+    query.finish();
     return false;
 }
 
@@ -492,6 +502,47 @@ bool ContentNode::updateContentNodeByUrl(QSqlDatabase& database,
     return true;
 }
 
+bool ContentNode::getContentNodes(QSqlDatabase & database,
+                                  const QString & location,
+                                  std::vector<ContentNode> & nodes)
+{
+    QSqlQuery & query = SqlStorage::query(database,
+        "select id, name, size, title, authors, description, "
+        "last_access, publisher, md5, "
+        "rating, read_time, read_count, progress, attributes "
+        "from content where location = :location");
+    query.bindValue(":location", location);
+
+    if (!SqlStorage::exec(query))
+    {
+        return false;
+    }
+
+    ContentNode node;
+    node.location_ = location;
+    while (query.next())
+    {
+        int index = 0;
+        node.id_ = query.value(index++).toInt();
+        node.name_ = query.value(index++).toString();
+        node.mutable_size() = query.value(index++).toLongLong();
+        node.title_ = query.value(index++).toString();
+        node.mutable_authors() = query.value(index++).toString();
+        node.mutable_description() = query.value(index++).toString();
+        node.mutable_last_access() = query.value(index++).toString();
+        node.mutable_publisher() = query.value(index++).toString();
+        node.mutable_md5() = query.value(index++).toString();
+        node.mutable_rating() = query.value(index++).toInt();
+        node.mutable_read_time() = query.value(index++).toInt();
+        node.mutable_read_count() = query.value(index++).toInt();
+        node.mutable_progress() = query.value(index++).toString();
+        node.mutable_attributes() = query.value(index++).toByteArray();
+        nodes.push_back(node);
+    }
+    query.finish();
+    return true;
+}
+
 bool ContentNode::allNodes(QSqlDatabase& database, cms_ids & list)
 {
     QSqlQuery query(database);
@@ -545,39 +596,28 @@ bool ContentNode::createContentNode(QSqlDatabase& database,
 bool ContentNode::updateContentNode(QSqlDatabase& database,
                                     const ContentNode & node)
 {
-    QSqlQuery query(database);
-    query.prepare ("update content set "
-                   " name = ?, location = ?, title = ?, authors = ?, "
-                   " description = ?, last_access = ?, publisher = ?, md5 = ?, "
-                   " size = ?, rating = ?, read_time = ?, read_count = ?, "
-                   " progress = ?, attributes = ? "
-                   " where id = ?");
-
-    query.addBindValue(node.name());
-    query.addBindValue(node.location());
-    query.addBindValue(node.title());
-    query.addBindValue(node.authors());
-    query.addBindValue(node.description());
-    query.addBindValue(node.last_access());
-    query.addBindValue(node.publisher());
-
-    query.addBindValue(node.md5());
-    query.addBindValue(node.size());
-    query.addBindValue(node.rating());
-    query.addBindValue(node.read_time());
-    query.addBindValue(node.read_count());
-
-    query.addBindValue(node.progress());
-    query.addBindValue(node.attributes());
-
-    query.addBindValue(node.id());
-
-    return query.exec();
+    // Reading progress, rating and last access are updated whenever a
+    // document is opened or closed, let the background writer batch them.
+    QVariantList values;
+    values << node.name() << node.location() << node.title()
+           << node.authors() << node.description() << node.last_access()
+           << node.publisher() << node.md5() << node.size()
+           << node.rating() << node.read_time() << node.read_count()
+           << node.progress() << node.attributes() << node.id();
+    return SqlStorage::write(database,
+                             "update content set "
+                             " name = ?, location = ?, title = ?, authors = ?, "
+                             " description = ?, last_access = ?, publisher = ?, md5 = ?, "
+                             " size = ?, rating = ?, read_time = ?, read_count = ?, "
+                             " progress = ?, attributes = ? "
+                             " where id = ?",
+                             values);
 }
 
 bool ContentNode::removeContentNode(QSqlDatabase& database,
                                     ContentNode& node)
 {
+    SqlStorage::wait(database.databaseName());
     QSqlQuery query(database);
     query.prepare( "delete from content where id = ?");
     query.addBindValue(node.id());
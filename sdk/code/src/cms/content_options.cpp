@@ -1,5 +1,6 @@
 
 #include "onyx/cms/content_options.h"
+#include "onyx/cms/sql_storage.h"
 
 namespace cms
 {
@@ -24,22 +25,25 @@ bool ContentOptions::getOptions(QSqlDatabase &database,
                                 const cms_long id,
                                 cms_blob & data)
 {
-    QSqlQuery query(database);
-    query.prepare( "select options from content_options where id = ? ");
-    query.addBindValue(id);
+    QSqlQuery & query = SqlStorage::query(database,
+        "select options from content_options where id = ? ");
+    query.bindValue(0, id);
 
-    if (query.exec() && query.next())
+    bool ret = false;
+    if (SqlStorage::exec(query) && query.next())
     {
         data = query.value(0).toByteArray();
-        return true;
+        ret = true;
     }
-    return false;
+    query.finish();
+    return ret;
 }
 
 bool ContentOptions::createOptions(QSqlDatabase &database,
                                    const cms_long id,
                                    const cms_blob & options)
 {
+    SqlStorage::wait(database.databaseName());
     QSqlQuery query(database);
 
     // Check the option is already exist or not.
@@ -59,6 +63,7 @@ bool ContentOptions::createOptions(QSqlDatabase &database,
 bool ContentOptions::removeOptions(QSqlDatabase &database,
                                    const cms_long id)
 {
+    SqlStorage::wait(database.databaseName());
     QSqlQuery query(database);
     query.prepare( "delete from content_options where id = ?");
     query.addBindValue(id);
@@ -69,15 +74,18 @@ bool ContentOptions::updateOptions(QSqlDatabase &database,
                                    const cms_long id,
                                    const cms_blob & options)
 {
-    QSqlQuery query(database);
-    query.prepare( "INSERT OR REPLACE into content_options (id, options) values(?, ?)");
-    query.addBindValue(id);
-    query.addBindValue(options);
-    return query.exec();
+    // Options are written on every page turn, let the background
+    // writer batch them.
+    QVariantList values;
+    values << id << options;
+    return SqlStorage::write(database,
+                             "INSERT OR REPLACE into content_options (id, options) values(?, ?)",
+                             values);
 }
 
 bool ContentOptions::removeTable(QSqlDatabase &database)
 {
+    SqlStorage::wait(database.databaseName());
     QSqlQuery query(database);
     return query.exec( "drop table content_options" );
 }
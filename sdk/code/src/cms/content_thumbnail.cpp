@@ -8,6 +8,7 @@
 #include "onyx/sys/sys_utils.h"
 #include "onyx/cms/content_thumbnail.h"
 #include "onyx/cms/cms_utils.h"
+#include "onyx/cms/sql_storage.h"
 
 
 
@@ -41,9 +42,10 @@ bool ContentThumbnail::open()
 
     if (!database_->isOpen())
     {
-        if (!database_->open())
+        // The thumbnail database is stored in the content folder, which
+        // can be on removable storage, so keep the rollback journal.
+        if (!SqlStorage::open(*database_, false))
         {
-            qDebug() << database_->lastError().text();
             return false;
         }
         makeSureTableExist(*database_);
@@ -57,6 +59,7 @@ bool ContentThumbnail::close()
 {
     if (database_)
     {
+        SqlStorage::close(*database_);
         database_->close();
         database_.reset(0);
         QSqlDatabase::removeDatabase(dir_.absolutePath());
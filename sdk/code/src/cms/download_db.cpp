@@ -2,6 +2,7 @@
 
 #include "onyx/cms/download_db.h"
 #include "onyx/cms/cms_utils.h"
+#include "onyx/cms/sql_storage.h"
 
 namespace cms
 {
@@ -139,9 +140,8 @@ bool DownloadDB::open()
     {
         QDir home = QDir::home();
         database_->setDatabaseName(home.filePath(database_name_));
-        if (!database_->open())
+        if (!SqlStorage::open(*database_))
         {
-            qDebug() << database_->lastError().text();
             return false;
         }
         makeSureTableExist(*database_);
@@ -153,6 +153,7 @@ bool DownloadDB::close()
 {
     if (database_)
     {
+        SqlStorage::close(*database_);
         database_->close();
         database_.reset(0);
         QSqlDatabase::removeDatabase(database_name_);
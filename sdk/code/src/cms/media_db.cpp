@@ -2,6 +2,7 @@
 
 #include "onyx/cms/media_db.h"
 #include "onyx/data/data_tags.h"
+#include "onyx/cms/sql_storage.h"
 
 namespace cms
 {
@@ -51,9 +52,8 @@ bool MediaDB::open()
     {
         QDir home = QDir::home();
         database_->setDatabaseName(home.filePath(database_name_));
-        if (!database_->open())
+        if (!SqlStorage::open(*database_))
         {
-            qDebug() << "not open" << database_->lastError().text();
             return false;
         }
         makeSureTableExist(*database_);
@@ -65,6 +65,7 @@ bool MediaDB::close()
 {
     if (database_)
     {
+        SqlStorage::close(*database_);
         database_->close();
         database_.reset(0);
         QSqlDatabase::removeDatabase(database_name_);
@@ -119,12 +120,112 @@ bool MediaDB::remove(MediaType type)
     return query.exec();
 }
 
+bool MediaDB::seekIndex(const QString & path, QByteArray & data)
+{
+    QSqlQuery query(db());
+    query.prepare( "select value from seek_index where path = ?");
+    query.addBindValue(path);
+    if (!query.exec() || !query.next())
+    {
+        return false;
+    }
+    data = query.value(0).toByteArray();
+    return true;
+}
+
+bool MediaDB::updateSeekIndex(const QString & path, const QByteArray & data)
+{
+    QSqlQuery query(db());
+    query.prepare( "INSERT OR REPLACE into seek_index (path, value) values(?, ?)");
+    query.addBindValue(path);
+    query.addBindValue(data);
+    return query.exec();
+}
+
+MediaTracks MediaDB::tracks()
+{
+    MediaTracks tracks;
+
+    QSqlQuery query(db());
+    query.prepare( "select tracks.path, size, modified, duration, tags, "
+                   "seek_index.path is not null from tracks "
+                   "left join seek_index on seek_index.path = tracks.path");
+    if (!query.exec())
+    {
+        return tracks;
+    }
+
+    while (query.next())
+    {
+        MediaTrack track;
+        track.path = query.value(0).toString();
+        track.size = query.value(1).toLongLong();
+        track.modified = QDateTime::fromTime_t(query.value(2).toUInt());
+        track.duration = query.value(3).toLongLong();
+        track.tags = query.value(4).toByteArray();
+        track.has_seek_index = query.value(5).toBool();
+        tracks.insert(track.path, track);
+    }
+    return tracks;
+}
+
+bool MediaDB::updateTracks(const QList<MediaTrack> & tracks)
+{
+    db().transaction();
+    QSqlQuery query(db());
+    query.prepare( "INSERT OR REPLACE into tracks (path, size, modified, duration, tags) "
+                   "values(?, ?, ?, ?, ?)");
+    foreach(const MediaTrack & track, tracks)
+    {
+        query.addBindValue(track.path);
+        query.addBindValue(track.size);
+        query.addBindValue(track.modified.toTime_t());
+        query.addBindValue(track.duration);
+        query.addBindValue(track.tags);
+        if (!query.exec())
+        {
+            db().rollback();
+            return false;
+        }
+    }
+    return db().commit();
+}
+
+bool MediaDB::removeTracks(const QStringList & paths)
+{
+    db().transaction();
+    QSqlQuery tracks(db());
+    tracks.prepare( "delete from tracks where path = ?");
+    QSqlQuery seek_index(db());
+    seek_index.prepare( "delete from seek_index where path = ?");
+    foreach(const QString & path, paths)
+    {
+        tracks.addBindValue(path);
+        seek_index.addBindValue(path);
+        if (!tracks.exec() || !seek_index.exec())
+        {
+            db().rollback();
+            return false;
+        }
+    }
+    return db().commit();
+}
+
 bool MediaDB::makeSureTableExist(QSqlDatabase &db)
 {
     QSqlQuery query(db);
     query.exec("create table if not exists media ("
                "type text primary key,"
                "value blob) ");
+    query.exec("create table if not exists seek_index ("
+               "path text primary key,"
+               "value blob) ");
+    query.exec("create table if not exists tracks ("
+               "path text primary key,"
+               "size integer,"
+               "modified integer,"
+               "duration integer,"
+               "tags blob) ");
     return true;
 }
 
@@ -0,0 +1,535 @@
+#include "onyx/cms/sql_storage.h"
+#include "onyx/sys/trace.h"
+
+namespace cms
+{
+
+/// How long the writer waits for more statements before it commits.
+static const int WRITE_DELAY = 500;
+static const int SLOW_QUERY = 50;
+/// A locked database is tried this often, waiting twice as long before
+/// each attempt, starting with RETRY_DELAY ms.
+static const int WRITE_ATTEMPTS = 6;
+static const int RETRY_DELAY = 50;
+static const int BUSY_TIMEOUT = 200;
+static const int MMAP_SIZE = 4 * 1024 * 1024;
+static const QString WRITER_PREFIX = "sql_writer:";
+
+SqlStatistics::SqlStatistics()
+    : queries(0)
+    , query_time(0)
+    , slow_queries(0)
+    , cached_statements(0)
+    , queued_writes(0)
+    , commits(0)
+    , failed_writes(0)
+{
+}
+
+struct PendingWrite
+{
+    QString      database_name;
+    QString      sql;
+    QVariantList values;
+};
+
+/// Background thread that owns a private connection for every database
+/// it writes to. Queued statements are collected for WRITE_DELAY ms and
+/// committed as one transaction per database.
+class SqlWriter : public QThread
+{
+public:
+    SqlWriter();
+    ~SqlWriter();
+
+    bool enqueue(const PendingWrite & write);
+    bool hasPending(const QString & database_name);
+    void flush();
+    bool takeFailures(const QString & database_name);
+
+    QMutex & mutex() { return mutex_; }
+    SqlStatistics & statistics() { return statistics_; }
+
+protected:
+    virtual void run();
+
+private:
+    void writeBatch(const QList<PendingWrite> & batch);
+    bool commit(const QString & database_name, QList<PendingWrite> & writes, int & failed);
+    QSqlDatabase connection(const QString & database_name);
+
+private:
+    QMutex              mutex_;
+    QWaitCondition      wake_;
+    QWaitCondition      done_;
+    QList<PendingWrite> queue_;
+    QStringList         connections_;
+    QSet<QString>       failed_;            ///< Databases that lost writes.
+    bool                running_;
+    bool                writing_;
+    bool                flush_requested_;
+    bool                hooked_;
+    SqlStatistics       statistics_;
+};
+
+static SqlWriter & writer()
+{
+    static SqlWriter instance;
+    return instance;
+}
+
+/// Runs when the application object is destroyed, while the sql
+/// drivers are still usable. The static writer itself is destroyed
+/// much later and must not touch the database any more.
+static void flushOnQuit()
+{
+    writer().flush();
+}
+
+/// Statements are kept per connection name. A QSqlQuery may only be
+/// used from the thread of its connection, but the table itself is
+/// also read by statistics(), so access to it is locked.
+typedef QHash<QString, QSqlQuery *> Statements;
+static QHash<QString, Statements> & statementCache()
+{
+    static QHash<QString, Statements> cache;
+    return cache;
+}
+
+static QMutex & statementMutex()
+{
+    static QMutex mutex;
+    return mutex;
+}
+
+/// Apply the common pragmas and check that they took effect. Older
+/// sqlite versions, such as the one bundled with Qt 4.5, accept the
+/// journal_mode and mmap_size pragmas without doing anything.
+static void applyPragmas(QSqlDatabase & database, bool wal)
+{
+    static QAtomicInt wal_warned;
+    static QAtomicInt mmap_warned;
+
+    // journal_mode returns the mode in effect. The mode is stored in
+    // the database file, so the writer connections inherit it.
+    QSqlQuery query(database);
+    bool wal_on = query.exec(wal ? "PRAGMA journal_mode=WAL" : "PRAGMA journal_mode") &&
+                  query.next() &&
+                  query.value(0).toString().compare("wal", Qt::CaseInsensitive) == 0;
+    query.finish();
+    if (wal && !wal_on && wal_warned.testAndSetRelaxed(0, 1))
+    {
+        qWarning("SqlStorage: write ahead logging not supported, using the rollback journal");
+    }
+
+    // Without the log, NORMAL can corrupt the database on power loss.
+    if (wal_on)
+    {
+        query.exec("PRAGMA synchronous=NORMAL");
+    }
+    query.exec("PRAGMA temp_store=MEMORY");
+
+    // mmap_size returns the new limit, or nothing before sqlite 3.7.17.
+    bool mmap_on = query.exec(QString("PRAGMA mmap_size=%1").arg(MMAP_SIZE)) && query.next();
+    query.finish();
+    if (!mmap_on && mmap_warned.testAndSetRelaxed(0, 1))
+    {
+        qWarning("SqlStorage: memory mapped I/O not supported");
+    }
+}
+
+SqlWriter::SqlWriter()
+    : running_(false)
+    , writing_(false)
+    , flush_requested_(false)
+    , hooked_(false)
+{
+}
+
+/// The queue is flushed by flushOnQuit() or SqlStorage::close(). Here
+/// the application and the sql drivers may already be gone, so only
+/// wait for a batch that is still being written.
+SqlWriter::~SqlWriter()
+{
+    wait();
+}
+
+/// Returns false if earlier writes of the database were lost and not
+/// yet reported by flush().
+bool SqlWriter::enqueue(const PendingWrite & write)
+{
+    QMutexLocker locker(&mutex_);
+    if (!hooked_)
+    {
+        qAddPostRoutine(flushOnQuit);
+        hooked_ = true;
+    }
+    queue_.append(write);
+    statistics_.queued_writes++;
+    if (!running_)
+    {
+        // The previous run may still be returning.
+        running_ = true;
+        wait();
+        start(QThread::LowPriority);
+    }
+    return !failed_.contains(write.database_name);
+}
+
+bool SqlWriter::hasPending(const QString & database_name)
+{
+    QMutexLocker locker(&mutex_);
+    if (writing_)
+    {
+        return true;
+    }
+    foreach (const PendingWrite & write, queue_)
+    {
+        if (write.database_name == database_name)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// Block until everything queued so far is committed.
+void SqlWriter::flush()
+{
+    QMutexLocker locker(&mutex_);
+    while (!queue_.isEmpty() || writing_)
+    {
+        flush_requested_ = true;
+        wake_.wakeAll();
+        done_.wait(&mutex_);
+    }
+}
+
+/// Returns false if writes of the database, or of any database when the
+/// name is empty, were lost since the last call, and forgets about them.
+bool SqlWriter::takeFailures(const QString & database_name)
+{
+    QMutexLocker locker(&mutex_);
+    if (database_name.isEmpty())
+    {
+        bool ok = failed_.isEmpty();
+        failed_.clear();
+        return ok;
+    }
+    return !failed_.remove(database_name);
+}
+
+void SqlWriter::run()
+{
+    QMutexLocker locker(&mutex_);
+    while (!queue_.isEmpty())
+    {
+        // Give the caller some time to queue more statements, so they
+        // end up in the same transaction.
+        if (!flush_requested_)
+        {
+            wake_.wait(&mutex_, WRITE_DELAY);
+        }
+        QList<PendingWrite> batch = queue_;
+        queue_.clear();
+        flush_requested_ = false;
+        writing_ = true;
+
+        locker.unlock();
+        writeBatch(batch);
+        locker.relock();
+
+        writing_ = false;
+        done_.wakeAll();
+    }
+
+    foreach (const QString & name, connections_)
+    {
+        QSqlDatabase::database(name, false).close();
+        QSqlDatabase::removeDatabase(name);
+    }
+    connections_.clear();
+    running_ = false;
+}
+
+QSqlDatabase SqlWriter::connection(const QString & database_name)
+{
+    QString name = WRITER_PREFIX + database_name;
+    QSqlDatabase database;
+    if (QSqlDatabase::contains(name))
+    {
+        // A database that failed to open is tried again.
+        database = QSqlDatabase::database(name, false);
+    }
+    else
+    {
+        // Do not wait long for a lock, writeBatch() backs off and retries.
+        database = QSqlDatabase::addDatabase("QSQLITE", name);
+        database.setDatabaseName(database_name);
+        database.setConnectOptions(QString("QSQLITE_BUSY_TIMEOUT=%1").arg(BUSY_TIMEOUT));
+        connections_.append(name);
+    }
+
+    if (!database.isOpen())
+    {
+        if (database.open())
+        {
+            applyPragmas(database, false);
+        }
+        else
+        {
+            qWarning() << "SqlWriter:" << database.lastError().text();
+        }
+    }
+    return database;
+}
+
+void SqlWriter::writeBatch(const QList<PendingWrite> & batch)
+{
+    QStringList names;
+    QHash<QString, QList<PendingWrite> > writes;
+    foreach (const PendingWrite & write, batch)
+    {
+        if (!names.contains(write.database_name))
+        {
+            names.append(write.database_name);
+        }
+        writes[write.database_name].append(write);
+    }
+
+    foreach (const QString & name, names)
+    {
+        ONYX_TRACE_SPAN("db_commit");
+        QList<PendingWrite> & pending = writes[name];
+        int failed = 0;
+        bool committed = false;
+        for (int attempt = 0; !committed && attempt < WRITE_ATTEMPTS; ++attempt)
+        {
+            if (attempt > 0)
+            {
+                msleep(RETRY_DELAY << (attempt - 1));
+            }
+            committed = commit(name, pending, failed);
+        }
+        if (!committed)
+        {
+            qWarning() << "SqlWriter: giving up" << pending.size() << "writes to" << name;
+            failed += pending.size();
+        }
+
+        QMutexLocker locker(&mutex_);
+        if (committed)
+        {
+            statistics_.commits++;
+        }
+        if (failed > 0)
+        {
+            statistics_.failed_writes += failed;
+            failed_.insert(name);
+        }
+    }
+}
+
+/// sqlite reports a lock held by another connection as SQLITE_BUSY (5)
+/// or SQLITE_LOCKED (6). The driver of older Qt versions does not pass
+/// the code on, the message still tells.
+static bool isLocked(const QSqlError & error)
+{
+    return error.number() == 5 || error.number() == 6 ||
+           error.databaseText().contains("locked", Qt::CaseInsensitive);
+}
+
+/// Write the statements in one transaction. A statement sqlite rejects
+/// for any reason but a lock is dropped and counted in failed, and the
+/// others are written again. Returns false if the database could not be
+/// opened or was locked; the transaction is rolled back then.
+bool SqlWriter::commit(const QString & database_name,
+                       QList<PendingWrite> & writes,
+                       int & failed)
+{
+    QSqlDatabase database = connection(database_name);
+    if (!database.isOpen())
+    {
+        return false;
+    }
+
+    while (!writes.isEmpty())
+    {
+        if (!database.transaction())
+        {
+            qWarning() << "SqlWriter:" << database.lastError().text();
+            return false;
+        }
+
+        QSqlQuery query(database);
+        int i = 0;
+        for (; i < writes.size(); ++i)
+        {
+            const PendingWrite & write = writes.at(i);
+            query.prepare(write.sql);
+            for (int j = 0; j < write.values.size(); ++j)
+            {
+                query.bindValue(j, write.values.at(j));
+            }
+            if (!query.exec())
+            {
+                break;
+            }
+        }
+        QSqlError error = query.lastError();
+        query.finish();
+
+        if (i < writes.size())
+        {
+            database.rollback();
+            if (isLocked(error))
+            {
+                return false;
+            }
+            qWarning() << "SqlWriter:" << error.text() << writes.at(i).sql;
+            writes.removeAt(i);
+            ++failed;
+            continue;
+        }
+
+        if (!database.commit())
+        {
+            qWarning() << "SqlWriter:" << database.lastError().text();
+            database.rollback();
+            return false;
+        }
+        break;
+    }
+    return true;
+}
+
+/// Open the database and apply the common settings. Write ahead logging
+/// should be disabled for databases that live on removable storage shared
+/// with other systems, as they can not deal with the extra log files.
+bool SqlStorage::open(QSqlDatabase & database, bool wal)
+{
+    if (database.isOpen())
+    {
+        return true;
+    }
+    if (!database.open())
+    {
+        qDebug() << database.lastError().text();
+        return false;
+    }
+    applyPragmas(database, wal);
+    return true;
+}
+
+/// Drop the cached statements of the connection and make sure all
+/// queued modifications are written. Call it before closing the database.
+void SqlStorage::close(QSqlDatabase & database)
+{
+    if (!flush(database.databaseName()))
+    {
+        qWarning() << "SqlStorage: writes lost before closing" << database.databaseName();
+    }
+
+    QMutexLocker locker(&statementMutex());
+    Statements statements = statementCache().take(database.connectionName());
+    qDeleteAll(statements);
+}
+
+/// Return the prepared statement for sql. The statement is prepared only
+/// once per connection; the caller binds the values by position and runs
+/// it with exec().
+QSqlQuery & SqlStorage::query(QSqlDatabase & database, const QString & sql)
+{
+    wait(database.databaseName());
+
+    QMutexLocker locker(&statementMutex());
+    Statements & statements = statementCache()[database.connectionName()];
+    QSqlQuery *query = statements.value(sql, 0);
+    if (query == 0)
+    {
+        query = new QSqlQuery(database);
+        query->setForwardOnly(true);
+        query->prepare(sql);
+        statements.insert(sql, query);
+    }
+    query->finish();
+    return *query;
+}
+
+bool SqlStorage::exec(QSqlQuery & query)
+{
+    QTime t;
+    t.start();
+    bool ret = query.exec();
+    int elapsed = t.elapsed();
+
+    QMutexLocker locker(&writer().mutex());
+    SqlStatistics & statistics = writer().statistics();
+    statistics.queries++;
+    statistics.query_time += elapsed;
+    if (elapsed > SLOW_QUERY)
+    {
+        statistics.slow_queries++;
+        qDebug("Slow query %d ms: %s", elapsed, qPrintable(query.lastQuery()));
+    }
+    return ret;
+}
+
+/// Queue a modification for the background writer. The call returns
+/// immediately; use it only for data the caller does not need to be
+/// durable at once, such as reading position or options. Returns false
+/// if earlier writes of the database were lost.
+bool SqlStorage::write(QSqlDatabase & database,
+                       const QString & sql,
+                       const QVariantList & values)
+{
+    PendingWrite write;
+    write.database_name = database.databaseName();
+    write.sql = sql;
+    write.values = values;
+    return writer().enqueue(write);
+}
+
+/// Write all pending modifications. Called before suspend and shutdown.
+/// Returns false if any queued write was lost since the last flush.
+bool SqlStorage::flush()
+{
+    writer().flush();
+    return writer().takeFailures(QString());
+}
+
+bool SqlStorage::flush(const QString & database_name)
+{
+    wait(database_name);
+    return writer().takeFailures(database_name);
+}
+
+/// Write the pending modifications of the database before it is read
+/// directly. Lost writes are left for flush() to report.
+void SqlStorage::wait(const QString & database_name)
+{
+    if (writer().hasPending(database_name))
+    {
+        writer().flush();
+    }
+}
+
+SqlStatistics SqlStorage::statistics()
+{
+    SqlStatistics result;
+    {
+        QMutexLocker locker(&writer().mutex());
+        result = writer().statistics();
+    }
+
+    QMutexLocker locker(&statementMutex());
+    int count = 0;
+    foreach (const Statements & statements, statementCache())
+    {
+        count += statements.size();
+    }
+    result.cached_statements = count;
+    return result;
+}
+
+}  // namespace cms
@@ -1,4 +1,5 @@
 #include "onyx/cms/cms_utils.h"
+#include "onyx/cms/sql_storage.h"
 #include "onyx/data/database.h"
 
 using namespace cms;
@@ -36,10 +37,9 @@ void DataBase::open()
     if (database_ != 0)
     {
         database_->setDatabaseName(db_name_);
-        if (!database_->open())
-        {
-            qDebug() << database_->lastError().text();
-        }
+
+        // Sketch databases are stored next to the document.
+        SqlStorage::open(*database_, false);
     }
 }
 
@@ -47,6 +47,7 @@ void DataBase::close()
 {
     if (database_)
     {
+        SqlStorage::close(*database_);
         database_->close();
         database_.reset(0);
         QSqlDatabase::removeDatabase(db_name_);
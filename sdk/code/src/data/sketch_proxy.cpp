@@ -102,10 +102,12 @@ void resetPoint(QPoint & p)
 // Implementation of sketch agent
 SketchProxy::SketchProxy()
     : attached_widget_(0)
+    , widget_active_(false)
     , need_update_once_(false)
     , mode_(MODE_SKETCHING)
     , status_(SKETCH_READY)
     , pressure_of_last_point_(0)
+    , replaying_(false)
 {
     resetLastPosition();
 
@@ -124,6 +126,8 @@ SketchProxy::SketchProxy()
 
     // raw touch event handler
     connect(&raw_event_listener_, SIGNAL(touchData(TouchData &)), this, SLOT(onReceivedTouchData(TouchData &)));
+    connect(&stroke_capture_, SIGNAL(strokeCaptured(const CapturedStroke &)),
+            this, SLOT(onStrokeCaptured(const CapturedStroke &)), Qt::QueuedConnection);
 
 
 #ifdef ENABLE_EINK_SCREEN
@@ -447,6 +451,33 @@ void SketchProxy::sketchPenUp(QMouseEvent *e)
 
 bool SketchProxy::eventFilter(QObject *obj, QEvent *event)
 {
+    // Stop drawing ink as soon as a dialog or menu covers the widget,
+    // the capture thread would draw over it otherwise.
+    if (obj == attached_widget_)
+    {
+        switch (event->type())
+        {
+        case QEvent::Show:
+        case QEvent::FocusIn:
+        case QEvent::WindowActivate:
+            widget_active_ = true;
+            updateStrokeCapture();
+            break;
+        case QEvent::Hide:
+        case QEvent::FocusOut:
+        case QEvent::WindowDeactivate:
+            widget_active_ = false;
+            updateStrokeCapture();
+            break;
+        case QEvent::Move:
+        case QEvent::Resize:
+            updateStrokeCapture();
+            break;
+        default:
+            break;
+        }
+    }
+
     if (obj == attached_widget_ &&
         (event->type() == QEvent::MouseButtonPress ||
          event->type() == QEvent::MouseMove ||
@@ -499,6 +530,13 @@ void SketchProxy::onReceivedTouchData(TouchData & data)
 
     // get widget pos
     OnyxTouchPoint & touch_point = data.points[0];
+    if (mode_ == MODE_SKETCHING && stroke_capture_.isEnabled())
+    {
+        // the stroke capture thread draws it, see onStrokeCaptured
+        pressure_of_last_point_ = touch_point.pressure;
+        return;
+    }
+
     QPoint global_pos(touch_point.x, touch_point.y);
     QPoint widget_pos = attached_widget_->mapFromGlobal(global_pos);
 
@@ -554,9 +592,95 @@ void SketchProxy::onReceivedTouchData(TouchData & data)
     }
 }
 
+/// Add a stroke drawn by the capture thread to the document. The ink is
+/// already on screen, so the points are replayed without driver drawing.
+void SketchProxy::onStrokeCaptured(const CapturedStroke & stroke)
+{
+    if (attached_widget_ == 0 || mode_ != MODE_SKETCHING || stroke.points.isEmpty())
+    {
+        return;
+    }
+
+    replaying_ = true;
+    const QVector<QPoint> & points = stroke.points;
+    for (int i = 0; i < points.size(); ++i)
+    {
+        QEvent::Type type = QEvent::MouseMove;
+        if (i == 0)
+        {
+            type = QEvent::MouseButtonPress;
+        }
+        else if (i == points.size() - 1)
+        {
+            type = QEvent::MouseButtonRelease;
+        }
+
+        QPoint widget_pos = attached_widget_->mapFromGlobal(points.at(i));
+        QMouseEvent me(type, widget_pos, points.at(i), Qt::LeftButton, Qt::LeftButton, Qt::NoModifier);
+        switch (type)
+        {
+        case QEvent::MouseButtonPress:
+            sketchPenDown(&me);
+            if (points.size() == 1)
+            {
+                sketchPenUp(&me);
+            }
+            break;
+        case QEvent::MouseMove:
+            sketchPenMove(&me);
+            break;
+        case QEvent::MouseButtonRelease:
+            sketchPenUp(&me);
+            break;
+        default:
+            break;
+        }
+    }
+    replaying_ = false;
+}
+
+/// Keep the capture thread in sync with the widget geometry and pen.
+/// Erasing still goes through the touch listener.
+void SketchProxy::updateStrokeCapture()
+{
+    if (!sys::isImx508())
+    {
+        return;
+    }
+
+    if (attached_widget_ == 0 || !attached_widget_->isVisible() || !widget_active_)
+    {
+        if (stroke_capture_.isEnabled())
+        {
+            stroke_capture_.setEnabled(false);
+            reportInkLatency();
+        }
+        return;
+    }
+
+    QRect area(attached_widget_->mapToGlobal(QPoint(0, 0)), attached_widget_->size());
+    stroke_capture_.setDrawingArea(area, gc_.getScreenRect(), gc_.widgetOrient());
+    stroke_capture_.setPen(getPenColor(sketch_ctx_.color_),
+                           getPointSize(sketch_ctx_.shape_, 1.0f));
+    stroke_capture_.setEnabled(mode_ == MODE_SKETCHING);
+}
+
+/// Log the ink latency of the capture session that just ended.
+void SketchProxy::reportInkLatency()
+{
+    InkLatency latency = stroke_capture_.latency();
+    if (latency.samples > 0)
+    {
+        qDebug("Ink latency: %d samples, average %lld us, max %lld us",
+               latency.samples, latency.total / latency.samples, latency.max);
+    }
+    stroke_capture_.resetLatency();
+}
+
 void SketchProxy::attachWidget(QWidget * w)
 {
     w->installEventFilter(this);
+    widget_active_ = w->isVisible();
     if (sys::isImx508())
     {
         if (w->isVisible())
@@ -576,16 +700,19 @@ void SketchProxy::deattachWidget(QWidget * w)
         raw_event_listener_.removeWatcherWidget(w);
     }
     attached_widget_ = 0;
+    updateStrokeCapture();
 }
 
 void SketchProxy::setDrawingArea(QWidget *w)
 {
     gc_.setDrawingArea(w);
+    updateStrokeCapture();
 }
 
 void SketchProxy::setMode(SketchMode mode)
 {
     mode_ = mode;
+    updateStrokeCapture();
 }
 
 void SketchProxy::setContentOrient(const RotateDegree r)
@@ -596,16 +723,19 @@ void SketchProxy::setContentOrient(const RotateDegree r)
 void SketchProxy::setWidgetOrient(const RotateDegree r)
 {
     gc_.setWidgetOrient(r);
+    updateStrokeCapture();
 }
 
 void SketchProxy::setShape(const SketchShape s)
 {
     sketch_ctx_.shape_ = s;
+    updateStrokeCapture();
 }
 
 void SketchProxy::setColor(const SketchColor c)
 {
     sketch_ctx_.color_ = c;
+    updateStrokeCapture();
 }
 
 void SketchProxy::setZoom(const ZoomFactor z)
@@ -936,7 +1066,11 @@ void SketchProxy::addPoint(SketchPagePtr page, const SketchPosition & pos, bool
     SketchContext ctx = sketch_ctx_;
     ctx.zoom_ = 1.0f;
     // draw the new point by driver
-    if (isLastPositionValid())
+    if (replaying_)
+    {
+        // already drawn by the stroke capture thread
+    }
+    else if (isLastPositionValid())
     {
         driverDrawLine(
 #ifdef ENABLE_EINK_SCREEN
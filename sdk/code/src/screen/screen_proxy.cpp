@@ -1,6 +1,7 @@
 // -*- mode: c++; c-basic-offset: 4; -*-
 
 #include "onyx/screen/screen_proxy.h"
+#include "onyx/sys/trace.h"
 
 #include <QtGui/QtGui>
 #ifdef BUILD_FOR_ARM
@@ -46,6 +47,7 @@ inline static void sendCommand(
         ScreenCommand::WaitMode wait = ScreenCommand::WAIT_BEFORE_UPDATE)
 {
     // qDebug("sendCommand at %s", qPrintable(QTime::currentTime().toString("mm:ss.zzz")));
+    ONYX_TRACE_SPAN("screen_update");
     command.wait_flags = wait;
     socket().write(reinterpret_cast<const char *>(&command), sizeof(command));
     if (wait & ScreenCommand::WAIT_COMMAND_FINISH)
@@ -0,0 +1,316 @@
+// -*- mode: c++; c-basic-offset: 4; -*-
+
+#include "onyx/sys/memory_broker.h"
+#include "onyx/sys/sys_utils.h"
+
+namespace sys
+{
+
+/// Posted to the thread of a client that has to drop memory.
+static const QEvent::Type RELEASE_EVENT = static_cast<QEvent::Type>(QEvent::registerEventType());
+
+/// Created on the thread that registers a client, so the release requests
+/// of the broker are handled by the event loop of that thread.
+class MemoryReleaser : public QObject
+{
+public:
+    explicit MemoryReleaser(MemoryClient *client)
+        : client_(client)
+    {
+    }
+
+    bool event(QEvent *e)
+    {
+        if (e->type() == RELEASE_EVENT)
+        {
+            MemoryBroker::instance().releasePending(client_);
+            return true;
+        }
+        return QObject::event(e);
+    }
+
+private:
+    MemoryClient *client_;
+};
+
+MemoryBroker::MemoryBroker()
+{
+}
+
+MemoryBroker::~MemoryBroker()
+{
+}
+
+MemoryBroker::Client * MemoryBroker::find(MemoryClient *client)
+{
+    for (int i = 0; i < clients_.size(); ++i)
+    {
+        if (clients_[i].client == client)
+        {
+            return &clients_[i];
+        }
+    }
+    return 0;
+}
+
+void MemoryBroker::registerClient(MemoryClient *client, const QString & name, int priority)
+{
+    QMutexLocker locker(&mutex_);
+    Client *existing = find(client);
+    if (existing)
+    {
+        existing->stats.name = name;
+        existing->stats.priority = qMax(priority, 1);
+        return;
+    }
+
+    Client entry;
+    entry.client = client;
+    entry.releaser = new MemoryReleaser(client);
+    entry.pending = 0;
+    entry.stats.name = name;
+    entry.stats.priority = qMax(priority, 1);
+    entry.stats.usage = 0;
+    entry.stats.budget = 0;
+    entry.stats.released = 0;
+    entry.stats.hits = 0;
+    entry.stats.misses = 0;
+    clients_.push_back(entry);
+}
+
+void MemoryBroker::unregisterClient(MemoryClient *client)
+{
+    MemoryReleaser *releaser = 0;
+    {
+        QMutexLocker locker(&mutex_);
+        for (int i = 0; i < clients_.size(); ++i)
+        {
+            if (clients_[i].client == client)
+            {
+                releaser = clients_[i].releaser;
+                clients_.remove(i);
+                break;
+            }
+        }
+    }
+
+    // Deleting it drops the release requests still queued.
+    if (releaser && releaser->thread() == QThread::currentThread())
+    {
+        delete releaser;
+    }
+    else if (releaser)
+    {
+        releaser->deleteLater();
+    }
+}
+
+/// Share the memory used by all clients and the memory still available
+/// between the clients by their priority. The usage of a client is the
+/// one it last reported from its own thread.
+void MemoryBroker::updateBudgets(unsigned long available)
+{
+    unsigned long long pool = available;
+    int priorities = 0;
+    for (int i = 0; i < clients_.size(); ++i)
+    {
+        pool += clients_[i].stats.usage;
+        priorities += clients_[i].stats.priority;
+    }
+    for (int i = 0; i < clients_.size(); ++i)
+    {
+        clients_[i].stats.budget = pool * clients_[i].stats.priority / priorities;
+    }
+}
+
+/// Drop entries of client, lowest cost first, until bytes are freed or
+/// nothing is left to drop. Runs on the thread of client without the lock.
+unsigned long MemoryBroker::release(MemoryClient *client, unsigned long bytes)
+{
+    unsigned long freed = 0;
+    while (freed < bytes && client->releaseCost() >= 0)
+    {
+        unsigned long size = client->releaseMemory();
+        if (size == 0)
+        {
+            break;
+        }
+        freed += size;
+    }
+    return freed;
+}
+
+/// Handle the release request of client on its own thread.
+void MemoryBroker::releasePending(MemoryClient *client)
+{
+    unsigned long bytes = 0;
+    {
+        QMutexLocker locker(&mutex_);
+        Client *entry = find(client);
+        if (entry == 0 || entry->pending == 0)
+        {
+            return;
+        }
+        bytes = entry->pending;
+        entry->pending = 0;
+    }
+
+    unsigned long freed = release(client, bytes);
+    unsigned long usage = client->memoryUsage();
+
+    QMutexLocker locker(&mutex_);
+    Client *entry = find(client);
+    if (entry)
+    {
+        entry->stats.usage = usage;
+        entry->stats.released += freed;
+    }
+}
+
+bool MemoryBroker::reserve(MemoryClient *client, unsigned long bytes)
+{
+    // The client is on its own thread here. Ask it before locking, it may
+    // have locked its cache already.
+    unsigned long usage = client->memoryUsage();
+
+    // Keep twice the usual reserve while tasks already stall on memory.
+    unsigned long floor = safeMemoryLimit();
+    if (underMemoryPressure())
+    {
+        floor *= 2;
+    }
+    unsigned long long needed = static_cast<unsigned long long>(floor) + bytes;
+    unsigned long long available = systemAvailableMemory();
+
+    unsigned long long missing = 0;
+    unsigned long long requested = 0;
+    unsigned long pending = 0;
+    {
+        QMutexLocker locker(&mutex_);
+        Client *requester = find(client);
+        if (requester)
+        {
+            // A request the event loop has not handled yet is done now.
+            requester->stats.usage = usage + bytes;
+            pending = requester->pending;
+            requester->pending = 0;
+        }
+        updateBudgets(available > floor ? available - floor : 0);
+        if (available < needed)
+        {
+            missing = needed - available;
+        }
+
+        // The other caches above their budget drop the excess on their
+        // own thread. Their entries must not be touched from this one.
+        for (int i = 0; i < clients_.size() && requested < missing; ++i)
+        {
+            Client & other = clients_[i];
+            if (other.client == client || other.stats.usage <= other.stats.budget)
+            {
+                continue;
+            }
+            unsigned long excess = other.stats.usage - other.stats.budget;
+            if (other.pending < excess)
+            {
+                // Posted under the lock: unregisterClient() deletes the
+                // releaser only after the client left the table. Posting
+                // does not call back into any client.
+                if (other.pending == 0)
+                {
+                    QCoreApplication::postEvent(other.releaser, new QEvent(RELEASE_EVENT));
+                }
+                other.pending = excess;
+            }
+            requested += excess;
+        }
+    }
+
+    // Memory freed by the caches is not always given back to the system at
+    // once, so the freed bytes are counted instead of reading the available
+    // memory again. The bytes the other caches were asked for are counted
+    // as freed, the requester drops its own entries for the rest.
+    unsigned long own = 0;
+    if (requested < missing)
+    {
+        own = static_cast<unsigned long>(missing - requested);
+    }
+    if (own == 0 && pending == 0)
+    {
+        return true;
+    }
+    unsigned long freed = release(client, qMax(own, pending));
+    usage = client->memoryUsage();
+
+    QMutexLocker locker(&mutex_);
+    Client *requester = find(client);
+    if (requester)
+    {
+        requester->stats.usage = usage + bytes;
+        requester->stats.released += freed;
+    }
+    return freed >= own;
+}
+
+unsigned long MemoryBroker::budget(MemoryClient *client)
+{
+    unsigned long usage = client->memoryUsage();
+    unsigned long floor = safeMemoryLimit();
+    unsigned long available = systemAvailableMemory();
+
+    QMutexLocker locker(&mutex_);
+    Client *entry = find(client);
+    if (entry)
+    {
+        entry->stats.usage = usage;
+    }
+    updateBudgets(available > floor ? available - floor : 0);
+    return entry ? entry->stats.budget : 0;
+}
+
+void MemoryBroker::recordHit(MemoryClient *client)
+{
+    QMutexLocker locker(&mutex_);
+    Client *entry = find(client);
+    if (entry)
+    {
+        ++entry->stats.hits;
+    }
+}
+
+void MemoryBroker::recordMiss(MemoryClient *client)
+{
+    QMutexLocker locker(&mutex_);
+    Client *entry = find(client);
+    if (entry)
+    {
+        ++entry->stats.misses;
+    }
+}
+
+QVector<MemoryClientStats> MemoryBroker::stats()
+{
+    QMutexLocker locker(&mutex_);
+    QVector<MemoryClientStats> result;
+    for (int i = 0; i < clients_.size(); ++i)
+    {
+        result.push_back(clients_[i].stats);
+    }
+    return result;
+}
+
+void MemoryBroker::dump()
+{
+    QVector<MemoryClientStats> all = stats();
+    qDebug("Available memory %lu KB", systemAvailableMemory() >> 10);
+    for (int i = 0; i < all.size(); ++i)
+    {
+        const MemoryClientStats & s = all[i];
+        unsigned int lookups = s.hits + s.misses;
+        qDebug("%s: priority %d, used %lu KB, budget %lu KB, released %lu KB, hit rate %d%% of %u",
+               qPrintable(s.name), s.priority, s.usage >> 10, s.budget >> 10, s.released >> 10,
+               lookups ? static_cast<int>(s.hits * 100ULL / lookups) : 0, lookups);
+    }
+}
+
+}
@@ -1,4 +1,5 @@
 #include "onyx/sys/sys_conf.h"
+#include "onyx/cms/sql_storage.h"
 
 #include <stdlib.h>
 #ifndef _WINDOWS
@@ -178,7 +179,7 @@ bool SystemConfig::open()
         }
         database_->setDatabaseName(QDir::home().filePath("system_config.db"));
     }
-    return database_->open();
+    return cms::SqlStorage::open(*database_);
 }
 
 bool SystemConfig::close()
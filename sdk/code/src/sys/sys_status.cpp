@@ -143,6 +143,18 @@ SysStatus::SysStatus()
     , sd_mounted_(false)
     , flash_mounted_(false)
     , system_busy_(true)
+    , mirror_connected_(false)
+    , snapshot_valid_(false)
+    , battery_left_(0)
+    , battery_status_(0)
+    , volume_(0)
+    , mute_(false)
+    , suspend_interval_(0)
+    , shutdown_interval_(0)
+    , music_player_running_(-1)
+    , sync_calls_(0)
+    , sync_call_time_(0)
+    , slowest_call_(0)
 {
     installSlots();
 }
@@ -155,7 +167,20 @@ SysStatus::SysStatus(SysStatus & ref)
 #endif
 , usb_mounted_(false)
 , sd_mounted_(false)
+, flash_mounted_(false)
 , system_busy_(true)
+, mirror_connected_(false)
+, snapshot_valid_(false)
+, battery_left_(0)
+, battery_status_(0)
+, volume_(0)
+, mute_(false)
+, suspend_interval_(0)
+, shutdown_interval_(0)
+, music_player_running_(-1)
+, sync_calls_(0)
+, sync_call_time_(0)
+, slowest_call_(0)
 {
 }
 
@@ -199,12 +224,34 @@ void SysStatus::installSlots()
         qDebug("\nCan not connect the sdioChangedSignal!\n");
     }
 
+    // The state mirror is only used when all signals that keep it
+    // up to date are connected.
+    mirror_connected_ = true;
     if (!connection_.connect(service, object, iface,
                              "batterySignal",
                              this,
                              SLOT(onBatteryChanged(int,int))))
     {
         qDebug("\nCan not connect the batterySignal\n");
+        mirror_connected_ = false;
+    }
+
+    if (!connection_.connect(service, object, iface,
+                             "suspendIntervalChanged",
+                             this,
+                             SLOT(onSuspendIntervalChanged(int))))
+    {
+        qDebug("\nCan not connect the suspendIntervalChanged\n");
+        mirror_connected_ = false;
+    }
+
+    if (!connection_.connect(service, object, iface,
+                             "shutdownIntervalChanged",
+                             this,
+                             SLOT(onShutdownIntervalChanged(int))))
+    {
+        qDebug("\nCan not connect the shutdownIntervalChanged\n");
+        mirror_connected_ = false;
     }
 
     if (!connection_.connect(service, object, iface,
@@ -285,6 +332,7 @@ void SysStatus::installSlots()
                              SLOT(onVolumeChanged(int, bool))))
     {
         qDebug("\nCan not connect the volume changed\n");
+        mirror_connected_ = false;
     }
 
     if (!connection_.connect(service, object, iface,
@@ -473,9 +521,85 @@ void SysStatus::installSlots()
     }
 }
 
+/// Blocking call to the system manager. All synchronous calls go
+/// through this function, so they can be counted and timed.
+QDBusMessage SysStatus::call(const QDBusMessage & message) const
+{
+    QTime t;
+    t.start();
+    QDBusMessage reply = connection_.call(message);
+    int elapsed = t.elapsed();
+
+    ++sync_calls_;
+    sync_call_time_ += elapsed;
+    if (elapsed > slowest_call_)
+    {
+        slowest_call_ = elapsed;
+    }
+    if (elapsed > 100)
+    {
+        qDebug("Slow call to system manager %s: %d ms",
+               qPrintable(message.member()), elapsed);
+    }
+    return reply;
+}
+
+/// Fetch the mirrored state in one call. Returns false when the mirror
+/// can not be used, e.g. with an older system manager, in which case the
+/// caller falls back to the individual calls.
+bool SysStatus::fetchSnapshot()
+{
+    if (snapshot_valid_)
+    {
+        return true;
+    }
+    if (!mirror_connected_)
+    {
+        return false;
+    }
+
+    QDBusMessage message = QDBusMessage::createMethodCall(
+        service,            // destination
+        object,             // path
+        iface,              // interface
+        "statusSnapshot"      // method.
+    );
+
+    QDBusMessage reply = call(message);
+    if (reply.type() != QDBusMessage::ReplyMessage || reply.arguments().isEmpty())
+    {
+        mirror_connected_ = false;
+        return false;
+    }
+
+    QVariantMap snapshot = qdbus_cast<QVariantMap>(reply.arguments().at(0));
+    battery_left_ = snapshot.value("battery_left").toInt();
+    battery_status_ = snapshot.value("battery_status").toInt();
+    volume_ = snapshot.value("volume").toInt();
+    mute_ = snapshot.value("mute").toBool();
+    suspend_interval_ = snapshot.value("suspend_interval").toInt();
+    shutdown_interval_ = snapshot.value("shutdown_interval").toInt();
+    snapshot_valid_ = true;
+    return true;
+}
+
+void SysStatus::callStatistics(int & calls, int & total_ms, int & max_ms) const
+{
+    calls = sync_calls_;
+    total_ms = sync_call_time_;
+    max_ms = slowest_call_;
+}
+
 bool SysStatus::batteryStatus(int& current,
                               int& status)
 {
+    if (fetchSnapshot())
+    {
+        current = battery_left_;
+        status = battery_status_;
+        return true;
+    }
+
     QDBusMessage message = QDBusMessage::createMethodCall(
         service,            // destination
         object,             // path
@@ -484,7 +608,7 @@ bool SysStatus::batteryStatus(int& current,
     );
 
     // Call.
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
 
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
@@ -511,7 +635,7 @@ bool SysStatus::updateBatteryStatus()
     );
 
     // Call.
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
         return true;
@@ -561,9 +685,17 @@ bool SysStatus::isFlashMountedDynamic()
     return flash_mounted_;
 }
 
+/// A stopped player is known from its state reports, so the query is
+/// skipped then. The player does not report every way it can exit,
+/// e.g. when the card is removed, so a running state is confirmed by
+/// the system manager.
 bool SysStatus::isMusicPlayerRunning()
 {
-    return isProcessRunning("music_player");
+    if (music_player_running_ != 0)
+    {
+        music_player_running_ = isProcessRunning("music_player") ? 1 : 0;
+    }
+    return music_player_running_ > 0;
 }
 
 bool SysStatus::isProcessRunning(const QString & proc_name)
@@ -575,7 +707,7 @@ bool SysStatus::isProcessRunning(const QString & proc_name)
         "isProcessRunning"      // method.
     );
     message << proc_name;
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
 
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
@@ -597,7 +729,7 @@ bool SysStatus::umountUSB()
         "umountUSB"      // method.
     );
 
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
 
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
@@ -619,7 +751,7 @@ bool SysStatus::umountSD()
         "umountSD"      // method.
     );
 
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
 
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
@@ -648,7 +780,7 @@ bool SysStatus::workInUSBSlaveMode()
         "workInUSBSlaveMode"      // method.
     );
 
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
 
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
@@ -675,7 +807,7 @@ bool SysStatus::enableSdio(bool enable) const
     );
 
     message << enable;
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
 
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
@@ -701,7 +833,7 @@ bool SysStatus::sdioState() const
         "sdioState"      // method.
     );
 
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
 
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
@@ -727,7 +859,7 @@ bool SysStatus::enableSdio(bool enable)
     );
 
     message << enable;
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
 
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
@@ -840,7 +972,7 @@ bool SysStatus::clearCalibration()
         "clearCalibration"      // method.
     );
 
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
 
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
@@ -878,7 +1010,7 @@ bool SysStatus::calibrate(QWSPointerCalibrationData & data)
         message << data.devPoints[i].y();
     }
 
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
 
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
@@ -902,11 +1034,16 @@ bool SysStatus::setSuspendInterval(int ms)
     );
     message << ms;
 
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
 
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
-        return checkAndReturnBool(reply.arguments());
+        bool ret = checkAndReturnBool(reply.arguments());
+        if (ret)
+        {
+            suspend_interval_ = ms;
+        }
+        return ret;
     }
     else if (reply.type() == QDBusMessage::ErrorMessage)
     {
@@ -917,6 +1054,11 @@ bool SysStatus::setSuspendInterval(int ms)
 
 int  SysStatus::suspendInterval()
 {
+    if (fetchSnapshot())
+    {
+        return suspend_interval_;
+    }
+
     QDBusMessage message = QDBusMessage::createMethodCall(
         service,            // destination
         object,             // path
@@ -924,7 +1066,7 @@ int  SysStatus::suspendInterval()
         "suspendInterval"      // method.
     );
 
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
 
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
@@ -947,7 +1089,7 @@ bool SysStatus::suspend()
         "suspend"      // method.
     );
 
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
 
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
@@ -970,11 +1112,16 @@ bool SysStatus::setShutdownInterval(int ms)
     );
     message << ms;
 
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
 
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
-        return checkAndReturnBool(reply.arguments());
+        bool ret = checkAndReturnBool(reply.arguments());
+        if (ret)
+        {
+            shutdown_interval_ = ms;
+        }
+        return ret;
     }
     else if (reply.type() == QDBusMessage::ErrorMessage)
     {
@@ -985,6 +1132,11 @@ bool SysStatus::setShutdownInterval(int ms)
 
 int  SysStatus::shutdownInterval()
 {
+    if (fetchSnapshot())
+    {
+        return shutdown_interval_;
+    }
+
     QDBusMessage message = QDBusMessage::createMethodCall(
         service,            // destination
         object,             // path
@@ -992,7 +1144,7 @@ int  SysStatus::shutdownInterval()
         "shutdownInterval"      // method.
     );
 
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
 
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
@@ -1027,7 +1179,7 @@ void SysStatus::resetIdle()
         iface,              // interface
         "resetIdle"      // method.
     );
-    connection_.call(message);
+    call(message);
 }
 
 void SysStatus::enableIdle(bool enable)
@@ -1040,7 +1192,7 @@ void SysStatus::enableIdle(bool enable)
     );
 
     message << enable;
-    connection_.call(message);
+    call(message);
 }
 
 bool SysStatus::isIdleEnabled()
@@ -1052,7 +1204,7 @@ bool SysStatus::isIdleEnabled()
         "isIdleEnabled"      // method.
     );
 
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
 
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
@@ -1097,6 +1249,11 @@ void SysStatus::reportMusicPlayerState(int state)
 
 int SysStatus::volume()
 {
+    if (fetchSnapshot())
+    {
+        return volume_;
+    }
+
     QDBusMessage message = QDBusMessage::createMethodCall(
         service,            // destination
         object,             // path
@@ -1104,7 +1261,7 @@ int SysStatus::volume()
         "volume"      // method.
     );
 
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
 
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
@@ -1128,11 +1285,16 @@ bool SysStatus::setVolume(int volume)
     );
     message << volume;
 
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
 
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
-        return checkAndReturnBool(reply.arguments());
+        bool ret = checkAndReturnBool(reply.arguments());
+        if (ret)
+        {
+            volume_ = volume;
+        }
+        return ret;
     }
     else if (reply.type() == QDBusMessage::ErrorMessage)
     {
@@ -1151,11 +1313,16 @@ bool SysStatus::mute(bool m)
     );
     message << m;
 
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
 
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
-        return checkAndReturnBool(reply.arguments());
+        bool ret = checkAndReturnBool(reply.arguments());
+        if (ret)
+        {
+            mute_ = m;
+        }
+        return ret;
     }
     else if (reply.type() == QDBusMessage::ErrorMessage)
     {
@@ -1166,6 +1333,11 @@ bool SysStatus::mute(bool m)
 
 bool SysStatus::isMute()
 {
+    if (fetchSnapshot())
+    {
+        return mute_;
+    }
+
     QDBusMessage message = QDBusMessage::createMethodCall(
         service,            // destination
         object,             // path
@@ -1173,7 +1345,7 @@ bool SysStatus::isMute()
         "isMute"      // method.
     );
 
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
 
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
@@ -1199,7 +1371,7 @@ bool SysStatus::isWpaSupplicantRunning()
         "isWpaSupplicantRunning"      // method.
     );
 
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
         return checkAndReturnBool(reply.arguments());
@@ -1221,7 +1393,7 @@ bool SysStatus::startWpaSupplicant(const QString & conf_file_path)
     );
     message << conf_file_path;
 
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
         return checkAndReturnBool(reply.arguments());
@@ -1242,7 +1414,7 @@ bool SysStatus::stopWpaSupplicant()
         "stopWpaSupplicant"      // method.
     );
 
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
         return checkAndReturnBool(reply.arguments());;
@@ -1269,7 +1441,7 @@ bool SysStatus::connect3g(const QString & chat_file,
     message << username;
     message << password;
 
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
         return checkAndReturnBool(reply.arguments());;
@@ -1290,7 +1462,7 @@ void SysStatus::disconnect3g()
         "disconnect3g"      // method.
     );
 
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
         return;
@@ -1310,7 +1482,7 @@ bool SysStatus::isPowerSwitchOn()
         "isPowerSwitchOn"      // method.
     );
 
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
         return checkAndReturnBool(reply.arguments());;
@@ -1392,7 +1564,7 @@ void SysStatus::setSystemBusy(bool busy,
     );
     message << busy;
     message << show_indicator;
-    connection_.call(message);
+    call(message);
 }
 
 void SysStatus::reportDownloadState(const QString &path,
@@ -1408,7 +1580,7 @@ void SysStatus::reportDownloadState(const QString &path,
     message << path;
     message << percentage;
     message << open;
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
     if (reply.type() == QDBusMessage::ErrorMessage)
     {
         qWarning("%s", qPrintable(reply.errorMessage()));
@@ -1423,7 +1595,7 @@ void SysStatus::triggerOnlineService()
         iface,              // interface
         "triggerOnlineService"      // method.
     );
-    connection_.call(message);
+    call(message);
 }
 
 bool SysStatus::setGrayScale(int colors)
@@ -1435,7 +1607,7 @@ bool SysStatus::setGrayScale(int colors)
         "setGrayScale"      // method.
     );
     message << colors;
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
     if (reply.type() == QDBusMessage::ErrorMessage)
     {
         qWarning("%s", qPrintable(reply.errorMessage()));
@@ -1453,7 +1625,7 @@ int SysStatus::grayScale()
         "grayScale"      // method.
     );
 
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
         if (reply.arguments().size() > 0)
@@ -1478,7 +1650,7 @@ bool SysStatus::startDRMService(const QStringList &strings)
     );
     message << strings;
 
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
         if (reply.arguments().size() > 0)
@@ -1502,7 +1674,7 @@ bool SysStatus::stopDRMService()
         "stopDRMService"      // method.
     );
 
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
         if (reply.arguments().size() > 0)
@@ -1526,7 +1698,7 @@ bool SysStatus::startMessenger()
         "startMessenger"      // method.
     );
 
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
         if (reply.arguments().size() > 0)
@@ -1550,7 +1722,7 @@ bool SysStatus::stopMessenger()
         "stopMessenger"      // method.
     );
 
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
         if (reply.arguments().size() > 0)
@@ -1591,7 +1763,7 @@ void SysStatus::initDRMService()
         iface,              // interface
         "initDRMService"      // method.
     );
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
     if (reply.type() == QDBusMessage::ErrorMessage)
     {
         qWarning("%s", qPrintable(reply.errorMessage()));
@@ -1621,13 +1793,53 @@ void SysStatus::snapshot(const QString &path)
         "snapshot"      // method.
     );
     message << path;
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
     if (reply.type() == QDBusMessage::ErrorMessage)
     {
         qWarning("%s", qPrintable(reply.errorMessage()));
     }
 }
 
+/// Start or stop the process sampling of the system manager telemetry.
+void SysStatus::enableTelemetry(bool enable)
+{
+    QDBusMessage message = QDBusMessage::createMethodCall(
+        service,            // destination
+        object,             // path
+        iface,              // interface
+        "enableTelemetry"   // method.
+    );
+    message << enable;
+    QDBusMessage reply = call(message);
+    if (reply.type() == QDBusMessage::ErrorMessage)
+    {
+        qWarning("%s", qPrintable(reply.errorMessage()));
+    }
+}
+
+/// Ask the system manager to write the collected samples and trace
+/// spans as Chrome trace json.
+bool SysStatus::exportChromeTrace(const QString &path)
+{
+    QDBusMessage message = QDBusMessage::createMethodCall(
+        service,            // destination
+        object,             // path
+        iface,              // interface
+        "exportChromeTrace" // method.
+    );
+    message << path;
+    QDBusMessage reply = call(message);
+    if (reply.type() == QDBusMessage::ReplyMessage)
+    {
+        return checkAndReturnBool(reply.arguments());
+    }
+    else if (reply.type() == QDBusMessage::ErrorMessage)
+    {
+        qWarning("%s", qPrintable(reply.errorMessage()));
+    }
+    return false;
+}
+
 bool SysStatus::hasTouchScreen()
 {
 #ifdef _WINDOWS
@@ -1641,7 +1853,7 @@ bool SysStatus::hasTouchScreen()
         "hasTouchScreen"      // method.
     );
 
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
         if (reply.arguments().size() > 0)
@@ -1682,7 +1894,7 @@ void SysStatus::dbgUpdateBattery(int left, int status)
     );
     message << left;
     message << status;
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
     if (reply.type() == QDBusMessage::ErrorMessage)
     {
         qWarning("%s", qPrintable(reply.errorMessage()));
@@ -1698,7 +1910,7 @@ void SysStatus::startSingleShotHardwareTimer(const int seconds)
         "startSingleShotHardwareTimer"      // method.
     );
     message << seconds;
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
     if (reply.type() == QDBusMessage::ErrorMessage)
     {
         qWarning("%s", qPrintable(reply.errorMessage()));
@@ -1713,7 +1925,7 @@ void SysStatus::setDefaultHardwareTimerInterval()
         iface,              // interface
         "setDefaultHardwareTimerInterval"      // method.
     );
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
     if (reply.type() == QDBusMessage::ErrorMessage)
     {
         qWarning("%s", qPrintable(reply.errorMessage()));
@@ -1729,7 +1941,7 @@ void SysStatus::configKeyboard(unsigned int keys)
         "configKeyboard"      // method.
     );
     message << keys;
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
     if (reply.type() == QDBusMessage::ErrorMessage)
     {
         qWarning("%s", qPrintable(reply.errorMessage()));
@@ -1744,7 +1956,7 @@ unsigned int SysStatus::keyboardConfiguration()
         iface,              // interface
         "keyboardConfiguration"      // method.
     );
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
         if (reply.arguments().size() > 0)
@@ -1771,7 +1983,7 @@ void SysStatus::setOfnThreshold(const int x,
     );
     message << x;
     message << y;
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
     if (reply.type() == QDBusMessage::ErrorMessage)
     {
         qWarning("%s", qPrintable(reply.errorMessage()));
@@ -1787,7 +1999,7 @@ bool SysStatus::ofnThreshold(int & x,
         iface,              // interface
         "ofnThreshold"      // method.
     );
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
         if (reply.arguments().size() >= 2)
@@ -1814,7 +2026,7 @@ bool SysStatus::setBrightness(const unsigned char brightness)
     );
 
     message << brightness;
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
         return true;
@@ -1834,7 +2046,7 @@ unsigned char SysStatus::brightness()
         iface,              // interface
         "backlightBrightness"      // method.
     );
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
         if (reply.arguments().size() > 0)
@@ -1860,7 +2072,7 @@ void SysStatus::turnGlowLightOn(bool on, bool save)
 
     message << on;
     message << save;
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
     if (reply.type() == QDBusMessage::ErrorMessage)
     {
         qWarning("%s", qPrintable(reply.errorMessage()));
@@ -1875,7 +2087,7 @@ bool SysStatus::glowLightOn()
         iface,              // interface
         "glowLightOn"       // method.
     );
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
     if (reply.type() == QDBusMessage::ReplyMessage)
     {
         if (reply.arguments().size() > 0)
@@ -1905,7 +2117,7 @@ void SysStatus::reportUserBehavior(const onyx::data::UserBehavior &behavior)
     );
 
     message << data;
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
     if (reply.type() == QDBusMessage::ErrorMessage)
     {
         qWarning("%s", qPrintable(reply.errorMessage()));
@@ -1928,7 +2140,7 @@ bool SysStatus::enableMultiTouch(bool enable)
     );
 
     message << enable;
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
     if (reply.type() == QDBusMessage::ErrorMessage)
     {
         qWarning("%s", qPrintable(reply.errorMessage()));
@@ -1952,7 +2164,7 @@ bool SysStatus::requestMultiTouch()
         "requestMultiTouch"      // method.
     );
 
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
     if (reply.type() == QDBusMessage::ErrorMessage)
     {
         qWarning("%s", qPrintable(reply.errorMessage()));
@@ -1976,7 +2188,7 @@ bool SysStatus::queryLedSignal()
         "queryLedSignal"      // method.
     );
 
-    QDBusMessage reply = connection_.call(message);
+    QDBusMessage reply = call(message);
     if (reply.type() == QDBusMessage::ErrorMessage)
     {
         qWarning("%s", qPrintable(reply.errorMessage()));
@@ -1991,6 +2203,8 @@ void SysStatus::dump()
     int status;
     batteryStatus(left, status);
     qDebug("Bettery %d %d", left, status);
+    qDebug("System manager calls %d, total %d ms, slowest %d ms",
+           sync_calls_, sync_call_time_, slowest_call_);
 }
 
 /// Handle mount tree signal.
@@ -2043,9 +2257,21 @@ void SysStatus::onSdioChanged(bool on)
 void SysStatus::onBatteryChanged(int current,
                                  int status)
 {
+    battery_left_ = current;
+    battery_status_ = status;
     emit batterySignal(current, status);
 }
 
+void SysStatus::onSuspendIntervalChanged(int ms)
+{
+    suspend_interval_ = ms;
+}
+
+void SysStatus::onShutdownIntervalChanged(int ms)
+{
+    shutdown_interval_ = ms;
+}
+
 void SysStatus::onConnectToPC(bool connected)
 {
     emit connectToPC(connected);
@@ -2103,6 +2329,14 @@ void SysStatus::onStylusChanged(bool inserted)
 
 void SysStatus::onMusicPlayerStateChanged(int state)
 {
+    if (state == MUSIC_PLAYING || state == MUSIC_PAUSED || state == MUSIC_STOPPED)
+    {
+        music_player_running_ = 1;
+    }
+    else if (state == MUSIC_QUIT || state == STOP_PLAYER)
+    {
+        music_player_running_ = 0;
+    }
     emit musicPlayerStateChanged(state);
 }
 
@@ -2115,6 +2349,8 @@ void SysStatus::onDownloadStateChanged(const QString &url,
 
 void SysStatus::onVolumeChanged(int new_volume, bool is_mute)
 {
+    volume_ = new_volume;
+    mute_ = is_mute;
     emit volumeChanged(new_volume, is_mute);
 }
 
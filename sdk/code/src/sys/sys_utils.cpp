@@ -13,6 +13,7 @@
 #include <sys/ioctl.h>
 #include <assert.h>
 #include <stdio.h>
+#include <string.h>
 #include <linux/rtc.h>
 #include <sys/time.h>
 #include <time.h>
@@ -21,6 +22,7 @@
 #include <QImageReader>
 
 #include "onyx/sys/sys_utils.h"
+#include "onyx/sys/zip_directory.h"
 
 namespace sys
 {
@@ -115,6 +117,78 @@ unsigned long systemFreeMemory()
 #endif
 }
 
+#ifndef _WINDOWS
+// Read the value in kB of the given fields of /proc/meminfo.
+static void readMemInfo(const char **names, unsigned long *values, int count)
+{
+    FILE *fp = fopen("/proc/meminfo", "r");
+    if (fp == 0)
+    {
+        return;
+    }
+
+    char line[128];
+    while (fgets(line, sizeof(line), fp))
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            size_t length = strlen(names[i]);
+            if (strncmp(line, names[i], length) == 0 && line[length] == ':')
+            {
+                values[i] = strtoul(line + length + 1, 0, 10);
+            }
+        }
+    }
+    fclose(fp);
+}
+#endif
+
+unsigned long systemAvailableMemory()
+{
+#ifdef _WINDOWS
+    return systemFreeMemory();
+#else
+    static const char *names[] = { "MemAvailable", "MemFree", "Buffers", "Cached", "Shmem" };
+    static const unsigned long UNKNOWN = static_cast<unsigned long>(-1);
+    unsigned long values[] = { UNKNOWN, UNKNOWN, 0, 0, 0 };
+    readMemInfo(names, values, sizeof(values) / sizeof(values[0]));
+
+    if (values[0] != UNKNOWN)
+    {
+        return values[0] * 1024;
+    }
+    if (values[1] == UNKNOWN)
+    {
+        return systemFreeMemory();
+    }
+
+    // Kernels before 3.14 do not report MemAvailable. Count half of the
+    // page cache as available, as the kernel's own estimate does at most.
+    unsigned long cache = values[2] + values[3];
+    cache -= qMin(cache, values[4]);
+    return (values[1] + cache / 2) * 1024;
+#endif
+}
+
+bool underMemoryPressure()
+{
+#ifdef _WINDOWS
+    return false;
+#else
+    // Pressure stall information, available since Linux 4.20.
+    static const double PRESSURE_LIMIT = 10.0;
+    FILE *fp = fopen("/proc/pressure/memory", "r");
+    if (fp == 0)
+    {
+        return false;
+    }
+    double avg10 = 0.0;
+    bool pressure = fscanf(fp, "some avg10=%lf", &avg10) == 1 && avg10 >= PRESSURE_LIMIT;
+    fclose(fp);
+    return pressure;
+#endif
+}
+
 unsigned long safeMemoryLimit()
 {
 #ifdef _WINDOWS
@@ -126,51 +200,21 @@ unsigned long safeMemoryLimit()
 
 bool needReleaseMemory()
 {
-    return systemFreeMemory() <= safeMemoryLimit();
+    return systemAvailableMemory() <= safeMemoryLimit() || underMemoryPressure();
 }
 
+/// The archive is read in process, ms is kept for compatibility.
 QStringList zipFileList(const QString &path, const int ms)
 {
-    QProcess script;
-    script.setEnvironment(QProcess::systemEnvironment());
-
+    Q_UNUSED(ms);
     QStringList ret;
-    QString command("unzip");
-    QStringList parameters;
-    parameters << "-l";
-    parameters << path;
-    script.start(command, parameters);
-    if (!script.waitForStarted())
-    {
-        qDebug("Could not start %s", qPrintable(command));
-        return ret;
-    }
-
-    if (!script.waitForFinished(ms))
-    {
-        qDebug("Failed");
-    }
-
-    QByteArray data = script.readAllStandardOutput();
-    QTextStream stream(&data);
-
-    // Ignore the first three title lines.
-    stream.readLine();
-    QString tmp = stream.readLine();
-    stream.readLine();
-
-    int pos = tmp.lastIndexOf("Name", -1, Qt::CaseInsensitive);
-    QString name;
-    while (!stream.atEnd())
-    {
-        tmp = stream.readLine();
-        name = tmp.mid(pos);
-        ret << name;
-    }
-    if (ret.size() > 2)
+    ZipEntries entries;
+    if (ZipDirectory::instance().entries(path, entries))
     {
-        ret.removeLast();
-        ret.removeLast();
+        for (ZipEntries::const_iterator it = entries.begin(); it != entries.end(); ++it)
+        {
+            ret << it->name;
+        }
     }
     return ret;
 }
@@ -196,19 +240,26 @@ bool isImage(const QString& suffix)
 
 bool isImageZip(const QString &path, const int threshold)
 {
-    QStringList lst = zipFileList(path, 10 * 1000);
-    if (lst.size() <= 0)
+    ZipEntries entries;
+    if (!ZipDirectory::instance().entries(path, entries))
     {
         return false;
     }
 
+    // Folders are not counted.
+    int files = 0;
     int count = 0;
-    foreach(QString i, lst)
+    for (ZipEntries::const_iterator it = entries.begin(); it != entries.end(); ++it)
     {
-        int pos = i.lastIndexOf(".");
+        if (it->isDir())
+        {
+            continue;
+        }
+        ++files;
+        int pos = it->name.lastIndexOf(".");
         if (pos > 0)
         {
-            QString suffix = i.mid(pos);
+            QString suffix = it->name.mid(pos + 1);
             if (isImage(suffix))
             {
                 ++count;
@@ -216,7 +267,7 @@ bool isImageZip(const QString &path, const int threshold)
         }
     }
 
-    if (count * 100 / lst.size() >= threshold)
+    if (files > 0 && count * 100 / files >= threshold)
     {
         return true;
     }
@@ -0,0 +1,113 @@
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include <QtDBus/QtDBus>
+
+#include "onyx/sys/trace.h"
+#include "onyx/sys/service.h"
+
+namespace sys
+{
+
+/// Spans are sent when the buffer is full or the last batch is older
+/// than FLUSH_INTERVAL ms, whichever comes first.
+static const int FLUSH_SIZE = 64;
+static const qint64 FLUSH_INTERVAL = 1000 * 1000;
+
+struct SpanRecord
+{
+    const char *name;
+    qint64 begin;
+    qint64 duration;
+    int tid;
+};
+
+struct TraceBuffer
+{
+    TraceBuffer() : last_flush(0) { spans.reserve(FLUSH_SIZE); }
+
+    QMutex mutex;
+    QVector<SpanRecord> spans;
+    qint64 last_flush;
+};
+
+static TraceBuffer & buffer()
+{
+    static TraceBuffer instance;
+    return instance;
+}
+
+bool Trace::isEnabled()
+{
+    static const bool enabled = (qgetenv("ONYX_TRACE").toInt() > 0);
+    return enabled;
+}
+
+qint64 Trace::now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<qint64>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+void Trace::addSpan(const char *name, qint64 begin, qint64 end)
+{
+    SpanRecord record;
+    record.name = name;
+    record.begin = begin;
+    record.duration = end - begin;
+    record.tid = static_cast<int>(syscall(SYS_gettid));
+
+    TraceBuffer & b = buffer();
+    QMutexLocker locker(&b.mutex);
+    b.spans.push_back(record);
+    if (b.spans.size() < FLUSH_SIZE && end - b.last_flush < FLUSH_INTERVAL)
+    {
+        return;
+    }
+    locker.unlock();
+    flush();
+}
+
+/// Send the recorded spans to the system manager. The call does not wait
+/// for a reply, so it is safe to use on the gui thread.
+void Trace::flush()
+{
+    QVector<SpanRecord> spans;
+    {
+        TraceBuffer & b = buffer();
+        QMutexLocker locker(&b.mutex);
+        spans.swap(b.spans);
+        b.spans.reserve(FLUSH_SIZE);
+        b.last_flush = now();
+    }
+    if (spans.isEmpty())
+    {
+        return;
+    }
+
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << static_cast<qint32>(spans.size());
+    foreach (const SpanRecord & span, spans)
+    {
+        stream << QByteArray(span.name) << span.begin << span.duration
+               << static_cast<qint32>(span.tid);
+    }
+
+    QDBusMessage message = QDBusMessage::createMethodCall(
+        service,            // destination
+        object,             // path
+        iface,              // interface
+        "addTraceEvents"    // method
+    );
+    message << static_cast<int>(getpid()) << data;
+#ifndef _WINDOWS
+    QDBusConnection::systemBus().send(message);
+#else
+    QDBusConnection::sessionBus().send(message);
+#endif
+}
+
+}  // namespace sys
@@ -0,0 +1,291 @@
+// -*- mode: c++; c-basic-offset: 4; -*-
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "onyx/sys/zip_directory.h"
+
+namespace sys
+{
+
+static const quint32 END_OF_DIRECTORY = 0x06054b50;
+static const quint32 ZIP64_END_OF_DIRECTORY = 0x06064b50;
+static const quint32 ZIP64_LOCATOR = 0x07064b50;
+static const quint32 DIRECTORY_HEADER = 0x02014b50;
+
+static const int END_OF_DIRECTORY_SIZE = 22;
+static const int ZIP64_END_OF_DIRECTORY_SIZE = 56;
+static const int ZIP64_LOCATOR_SIZE = 20;
+static const int DIRECTORY_HEADER_SIZE = 46;
+static const int MAX_COMMENT_SIZE = 0xffff;
+
+static const quint16 ZIP64_EXTRA = 0x0001;
+static const quint16 UTF8_NAME_FLAG = 0x0800;
+
+static const int MAX_CACHED_ARCHIVES = 32;
+
+// Fields are read byte by byte, they are not aligned.
+static inline quint16 read16(const uchar *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static inline quint32 read32(const uchar *p)
+{
+    return read16(p) | (static_cast<quint32>(read16(p + 2)) << 16);
+}
+
+static inline quint64 read64(const uchar *p)
+{
+    return read32(p) | (static_cast<quint64>(read32(p + 4)) << 32);
+}
+
+/// A read only mapping of a part of a file.
+class MappedRange
+{
+public:
+    MappedRange(int fd, quint64 offset, quint64 size)
+        : base_(MAP_FAILED)
+        , length_(0)
+        , data_(0)
+    {
+        long page = sysconf(_SC_PAGESIZE);
+        quint64 start = offset - offset % page;
+        length_ = static_cast<size_t>(size + (offset - start));
+        base_ = mmap(0, length_, PROT_READ, MAP_SHARED, fd, static_cast<off_t>(start));
+        if (base_ != MAP_FAILED)
+        {
+            data_ = static_cast<const uchar *>(base_) + (offset - start);
+        }
+    }
+
+    ~MappedRange()
+    {
+        if (base_ != MAP_FAILED)
+        {
+            munmap(base_, length_);
+        }
+    }
+
+    const uchar * data() const { return data_; }
+
+private:
+    void *base_;
+    size_t length_;
+    const uchar *data_;
+};
+
+ZipDirectory::ZipDirectory()
+    : cache_(MAX_CACHED_ARCHIVES)
+{
+}
+
+ZipDirectory::~ZipDirectory()
+{
+}
+
+bool ZipDirectory::entries(const QString & path, ZipEntries & result)
+{
+    QFileInfo info(path);
+    QString key = info.absoluteFilePath();
+    QDateTime modified = info.lastModified();
+    qint64 size = info.size();
+
+    {
+        QMutexLocker locker(&mutex_);
+        Cached *cached = cache_.object(key);
+        if (cached && cached->modified == modified && cached->size == size)
+        {
+            result = cached->entries;
+            return true;
+        }
+    }
+
+    ZipEntries entries;
+    if (!read(key, entries))
+    {
+        return false;
+    }
+
+    QMutexLocker locker(&mutex_);
+    Cached *cached = new Cached;
+    cached->modified = modified;
+    cached->size = size;
+    cached->entries = entries;
+    cache_.insert(key, cached);
+    result = entries;
+    return true;
+}
+
+void ZipDirectory::clear()
+{
+    QMutexLocker locker(&mutex_);
+    cache_.clear();
+}
+
+/// Locate the end of central directory record in the last bytes of the
+/// file, follow it to the zip64 record if there is one, then map and
+/// parse the central directory.
+bool ZipDirectory::read(const QString & path, ZipEntries & result)
+{
+    int fd = open(QFile::encodeName(path).constData(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    bool ok = false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < END_OF_DIRECTORY_SIZE)
+    {
+        close(fd);
+        return false;
+    }
+
+    quint64 file_size = st.st_size;
+    quint64 tail_size = qMin(file_size,
+                             static_cast<quint64>(END_OF_DIRECTORY_SIZE + MAX_COMMENT_SIZE + ZIP64_LOCATOR_SIZE));
+    quint64 tail_offset = file_size - tail_size;
+    MappedRange tail(fd, tail_offset, tail_size);
+    const uchar *end = tail.data();
+    if (end == 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    // The record is followed by a comment, search backwards.
+    qint64 eocd = -1;
+    for (qint64 i = tail_size - END_OF_DIRECTORY_SIZE; i >= 0; --i)
+    {
+        if (read32(end + i) == END_OF_DIRECTORY &&
+            i + END_OF_DIRECTORY_SIZE + read16(end + i + 20) <= static_cast<qint64>(tail_size))
+        {
+            eocd = i;
+            break;
+        }
+    }
+    if (eocd < 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    quint64 count = read16(end + eocd + 10);
+    quint64 directory_size = read32(end + eocd + 12);
+    quint64 directory_offset = read32(end + eocd + 16);
+
+    if (eocd >= ZIP64_LOCATOR_SIZE &&
+        read32(end + eocd - ZIP64_LOCATOR_SIZE) == ZIP64_LOCATOR)
+    {
+        quint64 record = read64(end + eocd - ZIP64_LOCATOR_SIZE + 8);
+        if (record + ZIP64_END_OF_DIRECTORY_SIZE <= file_size)
+        {
+            MappedRange zip64(fd, record, ZIP64_END_OF_DIRECTORY_SIZE);
+            const uchar *p = zip64.data();
+            if (p && read32(p) == ZIP64_END_OF_DIRECTORY)
+            {
+                count = read64(p + 32);
+                directory_size = read64(p + 40);
+                directory_offset = read64(p + 48);
+            }
+        }
+    }
+
+    if (directory_size == 0 ||
+        directory_offset + directory_size > file_size ||
+        count > directory_size / DIRECTORY_HEADER_SIZE)
+    {
+        // Empty archive or a damaged record.
+        close(fd);
+        result.clear();
+        return count == 0 && directory_size == 0;
+    }
+
+    MappedRange directory(fd, directory_offset, directory_size);
+    const uchar *p = directory.data();
+    const uchar *limit = p + directory_size;
+    close(fd);
+    if (p == 0)
+    {
+        return false;
+    }
+
+    result.clear();
+    result.reserve(static_cast<int>(count));
+    ok = true;
+    for (quint64 i = 0; i < count; ++i)
+    {
+        if (p + DIRECTORY_HEADER_SIZE > limit || read32(p) != DIRECTORY_HEADER)
+        {
+            ok = false;
+            break;
+        }
+
+        quint16 flags = read16(p + 8);
+        int name_size = read16(p + 28);
+        int extra_size = read16(p + 30);
+        int comment_size = read16(p + 32);
+        const uchar *name = p + DIRECTORY_HEADER_SIZE;
+        const uchar *extra = name + name_size;
+        const uchar *next = extra + extra_size + comment_size;
+        if (next > limit)
+        {
+            ok = false;
+            break;
+        }
+
+        ZipEntry entry;
+        const char *raw = reinterpret_cast<const char *>(name);
+        entry.name = (flags & UTF8_NAME_FLAG) ? QString::fromUtf8(raw, name_size) :
+                                                QString::fromLocal8Bit(raw, name_size);
+        entry.method = read16(p + 10);
+        entry.crc = read32(p + 16);
+        entry.compressed_size = read32(p + 20);
+        entry.uncompressed_size = read32(p + 24);
+        entry.local_header_offset = read32(p + 42);
+
+        // Values that do not fit are stored in the zip64 extra field, in
+        // this order and only when they do not fit.
+        const uchar *field = extra;
+        while (field + 4 <= extra + extra_size)
+        {
+            quint16 id = read16(field);
+            quint16 size = read16(field + 2);
+            const uchar *value = field + 4;
+            const uchar *value_end = value + size;
+            if (value_end > extra + extra_size)
+            {
+                break;
+            }
+            if (id == ZIP64_EXTRA)
+            {
+                if (entry.uncompressed_size == 0xffffffff && value + 8 <= value_end)
+                {
+                    entry.uncompressed_size = read64(value);
+                    value += 8;
+                }
+                if (entry.compressed_size == 0xffffffff && value + 8 <= value_end)
+                {
+                    entry.compressed_size = read64(value);
+                    value += 8;
+                }
+                if (entry.local_header_offset == 0xffffffff && value + 8 <= value_end)
+                {
+                    entry.local_header_offset = read64(value);
+                }
+                break;
+            }
+            field = value_end;
+        }
+
+        result.push_back(entry);
+        p = next;
+    }
+    return ok;
+}
+
+}
@@ -0,0 +1,447 @@
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "onyx/touch/stroke_capture.h"
+#include "onyx/screen/screen_proxy.h"
+
+using namespace onyx::screen;
+
+/// Default time a sample may wait before its line is sent.
+static const int DEFAULT_DEADLINE = 10;
+static const int DEFAULT_MIN_DISTANCE = 2;
+
+/// How often the idle thread checks whether it should stop.
+static const int IDLE_TIMEOUT = 200;
+
+static qint64 now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<qint64>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int connectLocal(const QByteArray & address)
+{
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, address.constData(), sizeof(addr.sun_path) - 1);
+    if (::connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) < 0)
+    {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+StrokeCapture::StrokeCapture()
+    : rotation_(0)
+    , color_(0)
+    , width_(1)
+    , deadline_(DEFAULT_DEADLINE)
+    , min_distance_(DEFAULT_MIN_DISTANCE)
+    , enabled_(false)
+    , stop_(false)
+    , touch_fd_(-1)
+    , screen_fd_(-1)
+    , last_pressure_(0)
+    , in_stroke_(false)
+    , has_last_drawn_(false)
+{
+    qRegisterMetaType<CapturedStroke>("CapturedStroke");
+}
+
+StrokeCapture::~StrokeCapture()
+{
+    stop();
+}
+
+void StrokeCapture::setDrawingArea(const QRect & area, const QRect & screen, int rotation)
+{
+    QMutexLocker locker(&mutex_);
+    area_ = area;
+    screen_ = screen;
+    rotation_ = rotation;
+}
+
+/// \param color The pen color in grey level.
+/// \param width The pen width in pixels.
+void StrokeCapture::setPen(int color, int width)
+{
+    QMutexLocker locker(&mutex_);
+    color_ = color;
+    width_ = width;
+}
+
+void StrokeCapture::setDeadline(int ms)
+{
+    QMutexLocker locker(&mutex_);
+    deadline_ = ms;
+}
+
+/// Samples closer than pixels to the previous point are dropped. The
+/// digitizer reports far more samples than the panel can show.
+void StrokeCapture::setMinDistance(int pixels)
+{
+    QMutexLocker locker(&mutex_);
+    min_distance_ = pixels;
+}
+
+/// Start or pause the capture. While paused the samples are dropped and
+/// only the regular touch listener handles them.
+void StrokeCapture::setEnabled(bool enable)
+{
+    {
+        QMutexLocker locker(&mutex_);
+        enabled_ = enable;
+        stop_ = false;
+    }
+    if (enable && !isRunning())
+    {
+        start(QThread::HighestPriority);
+    }
+}
+
+/// True while the thread draws the ink. The thread disables itself when
+/// it loses a connection, so the touch listener takes over then.
+bool StrokeCapture::isEnabled()
+{
+    QMutexLocker locker(&mutex_);
+    return enabled_ && isRunning();
+}
+
+void StrokeCapture::stop()
+{
+    {
+        QMutexLocker locker(&mutex_);
+        enabled_ = false;
+        stop_ = true;
+    }
+    wait();
+}
+
+InkLatency StrokeCapture::latency()
+{
+    QMutexLocker locker(&mutex_);
+    return latency_;
+}
+
+void StrokeCapture::resetLatency()
+{
+    QMutexLocker locker(&mutex_);
+    latency_ = InkLatency();
+}
+
+bool StrokeCapture::connectTouch()
+{
+    if (touch_fd_ < 0)
+    {
+        touch_fd_ = connectLocal(TOUCH_SERVER_ADDRESS.toLocal8Bit());
+        if (touch_fd_ < 0)
+        {
+            qWarning("StrokeCapture: can not connect to touch server %s", strerror(errno));
+        }
+    }
+    return touch_fd_ >= 0;
+}
+
+/// Use the same transport as ScreenProxy, but a socket of our own, so
+/// the gui thread never has to be involved.
+bool StrokeCapture::connectScreen()
+{
+    if (screen_fd_ >= 0)
+    {
+        return true;
+    }
+
+    if (qgetenv("USE_UNIX_SOCKET").toInt() > 0)
+    {
+        screen_fd_ = connectLocal(qgetenv("SCREEN_SERVER_ADDRESS"));
+    }
+    else
+    {
+        screen_fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(PORT);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (screen_fd_ >= 0 &&
+            ::connect(screen_fd_, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) < 0)
+        {
+            ::close(screen_fd_);
+            screen_fd_ = -1;
+        }
+    }
+
+    if (screen_fd_ < 0)
+    {
+        qWarning("StrokeCapture: can not connect to screen server %s", strerror(errno));
+    }
+    return screen_fd_ >= 0;
+}
+
+void StrokeCapture::run()
+{
+    if (connectTouch() && connectScreen())
+    {
+        readSamples();
+    }
+
+    if (in_stroke_)
+    {
+        endStroke();
+    }
+    if (touch_fd_ >= 0)
+    {
+        ::close(touch_fd_);
+    }
+    if (screen_fd_ >= 0)
+    {
+        ::close(screen_fd_);
+    }
+    touch_fd_ = screen_fd_ = -1;
+    last_pressure_ = 0;
+
+    QMutexLocker locker(&mutex_);
+    enabled_ = false;
+}
+
+/// Read and draw the samples until stop() is called or the touch server
+/// can not be read any more.
+void StrokeCapture::readSamples()
+{
+    TouchData data;
+    int received = 0;
+    while (true)
+    {
+        int timeout = IDLE_TIMEOUT;
+        bool enabled = false;
+        {
+            QMutexLocker locker(&mutex_);
+            if (stop_)
+            {
+                break;
+            }
+            enabled = enabled_;
+            if (!pending_.isEmpty())
+            {
+                qint64 left = pending_.front().time + deadline_ * 1000 - now();
+                timeout = qMax(0, static_cast<int>(left / 1000));
+            }
+        }
+
+        struct pollfd pfd;
+        pfd.fd = touch_fd_;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        int ret = poll(&pfd, 1, timeout);
+        if (ret < 0 && errno != EINTR)
+        {
+            qWarning("StrokeCapture: poll failed %s", strerror(errno));
+            break;
+        }
+
+        if (ret > 0 && (pfd.revents & POLLIN))
+        {
+            char *dst = reinterpret_cast<char *>(&data) + received;
+            int bytes = read(touch_fd_, dst, sizeof(data) - received);
+            if (bytes <= 0)
+            {
+                qWarning("StrokeCapture: touch server closed the connection");
+                break;
+            }
+            received += bytes;
+            if (received == static_cast<int>(sizeof(data)))
+            {
+                received = 0;
+                if (enabled)
+                {
+                    processSample(data.points[0], now());
+                }
+                else
+                {
+                    last_pressure_ = data.points[0].pressure;
+                }
+            }
+        }
+
+        if (!pending_.isEmpty() &&
+            now() >= pending_.front().time + deadline_ * 1000)
+        {
+            flushLines();
+        }
+        if (!enabled && in_stroke_)
+        {
+            endStroke();
+        }
+    }
+}
+
+/// Follow the same pen state rules as the touch listener path in the
+/// sketch proxy: a stroke starts when the pressure rises inside the
+/// drawing area and ends when it drops or the pen leaves the area.
+void StrokeCapture::processSample(const OnyxTouchPoint & point, qint64 time)
+{
+    QPoint pos(point.x, point.y);
+    bool inside = false;
+    {
+        QMutexLocker locker(&mutex_);
+        inside = area_.contains(pos);
+    }
+
+    bool pen_down = (last_pressure_ == 0 && point.pressure > 0);
+    bool pen_up = (last_pressure_ > 0 && point.pressure <= 0);
+    last_pressure_ = point.pressure;
+
+    if (!inside)
+    {
+        if (in_stroke_)
+        {
+            endStroke();
+        }
+        return;
+    }
+
+    if (pen_down)
+    {
+        in_stroke_ = true;
+        addPoint(pos, time);
+    }
+    else if (pen_up)
+    {
+        if (in_stroke_)
+        {
+            addPoint(pos, time);
+            endStroke();
+        }
+    }
+    else if (in_stroke_ && point.pressure > 0)
+    {
+        int dx = pos.x() - last_point_.x();
+        int dy = pos.y() - last_point_.y();
+        QMutexLocker locker(&mutex_);
+        if (dx * dx + dy * dy < min_distance_ * min_distance_)
+        {
+            return;
+        }
+        locker.unlock();
+        addPoint(pos, time);
+    }
+}
+
+void StrokeCapture::addPoint(const QPoint & global_pos, qint64 time)
+{
+    Sample sample;
+    sample.pos = toScreen(global_pos);
+    sample.time = time;
+    pending_.push_back(sample);
+    stroke_.points.push_back(global_pos);
+    last_point_ = global_pos;
+
+    int count = pending_.size() + (has_last_drawn_ ? 1 : 0);
+    if (count >= ScreenCommand::MAX_POINTS)
+    {
+        flushLines();
+    }
+}
+
+void StrokeCapture::endStroke()
+{
+    flushLines();
+    has_last_drawn_ = false;
+    in_stroke_ = false;
+    if (!stroke_.points.isEmpty())
+    {
+        emit strokeCaptured(stroke_);
+    }
+    stroke_.points.clear();
+}
+
+/// Send the pending points as one polyline. It starts at the last
+/// point already drawn, so consecutive batches form a continuous line.
+void StrokeCapture::flushLines()
+{
+    if (pending_.isEmpty())
+    {
+        return;
+    }
+
+    ScreenCommand command;
+    memset(&command, 0, sizeof(command));
+    command.type = ScreenCommand::DRAW_LINES;
+    command.wait_flags = ScreenCommand::WAIT_NONE;
+    int count = 0;
+    if (has_last_drawn_)
+    {
+        command.points[count++] = last_drawn_;
+    }
+    for (int i = 0; i < pending_.size(); ++i)
+    {
+        command.points[count++] = pending_.at(i).pos;
+    }
+    if (count == 1)
+    {
+        // Draw a dot for a stroke that has only one point so far.
+        command.points[count++] = pending_.front().pos;
+    }
+    command.point_count = count;
+    {
+        QMutexLocker locker(&mutex_);
+        command.color = color_;
+        command.size = width_;
+    }
+
+    if (write(screen_fd_, &command, sizeof(command)) < 0)
+    {
+        qWarning("StrokeCapture: can not send command %s", strerror(errno));
+    }
+
+    qint64 sent = now();
+    QMutexLocker locker(&mutex_);
+    for (int i = 0; i < pending_.size(); ++i)
+    {
+        qint64 elapsed = sent - pending_.at(i).time;
+        latency_.samples++;
+        latency_.total += elapsed;
+        latency_.max = qMax(latency_.max, elapsed);
+    }
+    locker.unlock();
+
+    last_drawn_ = pending_.back().pos;
+    has_last_drawn_ = true;
+    pending_.clear();
+}
+
+/// Map the global position to the unrotated panel coordinates the
+/// screen daemon draws in. Same as transformCoordinate in sketch proxy.
+QPoint StrokeCapture::toScreen(const QPoint & global_pos)
+{
+    QMutexLocker locker(&mutex_);
+    int x = global_pos.x();
+    int y = global_pos.y();
+    switch (rotation_)
+    {
+    case 1:
+        return QPoint(y, screen_.width() - x);
+    case 2:
+        return QPoint(screen_.width() - x, screen_.height() - y);
+    case 3:
+        return QPoint(screen_.height() - y, x);
+    default:
+        break;
+    }
+    return global_pos;
+}
@@ -2,6 +2,7 @@
 #include "onyx/screen/screen_proxy.h"
 #include "onyx/screen/screen_update_watcher.h"
 #include "onyx/data/network_types.h"
+#include "onyx/cms/sql_storage.h"
 
 #include "onyx/ui/status_bar.h"
 #include "onyx/ui/status_bar_item_menu.h"
@@ -623,6 +624,10 @@ void StatusBar::onLowBatterySignal()
 void StatusBar::onAboutToSuspend()
 {
     qDebug("Status Bar handles about to suspend signal");
+    if (!cms::SqlStorage::flush())
+    {
+        qWarning("Status Bar: database writes were lost before suspend");
+    }
 }
 
 void StatusBar::onWakeup()
@@ -633,6 +638,10 @@ void StatusBar::onWakeup()
 void StatusBar::onAboutToShutdown()
 {
     qDebug("Status Bar handles about to shutdown signal");
+    if (!cms::SqlStorage::flush())
+    {
+        qWarning("Status Bar: database writes were lost before shutdown");
+    }
     if (legacy_pm_dialog_.get())
     {
         legacyPMDialog(false)->reject();
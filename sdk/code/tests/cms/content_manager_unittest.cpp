@@ -7,6 +7,7 @@
 #include "onyx/cms/content_manager.h"
 #include "onyx/cms/user_db.h"
 #include "onyx/cms/download_db.h"
+#include "onyx/cms/sql_storage.h"
 
 namespace
 {
@@ -226,6 +227,222 @@ TEST(ContentManagerTest, GetOption)
     current.remove(db);
 }
 
+/// Options are written by the background writer. Several updates should
+/// end up in one transaction and survive closing the database.
+TEST(ContentManagerTest, BatchedOptions)
+{
+    QDir current = QDir::current();
+    QString db = current.filePath("temp.db");
+    current.remove(db);
+
+    ContentManager mgr;
+    EXPECT_TRUE(mgr.open(db));
+
+    static const int COUNT = 20;
+    int commits = SqlStorage::statistics().commits;
+    for(int i = 0; i < COUNT; ++i)
+    {
+        cms_blob options(QByteArray::number(i));
+        mgr.updateOptions(i + 1, options);
+    }
+    SqlStorage::flush();
+    EXPECT_EQ(SqlStorage::statistics().commits, commits + 1);
+    mgr.close();
+
+    EXPECT_TRUE(mgr.open(db));
+    for(int i = 0; i < COUNT; ++i)
+    {
+        cms_blob result;
+        EXPECT_TRUE(mgr.getContentOptions(i + 1, result));
+        EXPECT_TRUE(result == QByteArray::number(i));
+    }
+    mgr.close();
+    current.remove(db);
+}
+
+/// Node updates and bookmarks also go through the background writer.
+/// A read of the same database must see the queued modification.
+TEST(ContentManagerTest, BatchedNodeAndBookmarks)
+{
+    QDir current = QDir::current();
+    QString db = current.filePath("temp.db");
+    current.remove(db);
+
+    ContentManager mgr;
+    EXPECT_TRUE(mgr.open(db));
+
+    ContentNode node;
+    node.mutable_name() = "batched.pdf";
+    node.mutable_location() = current.absolutePath();
+    EXPECT_TRUE(mgr.createContentNode(node));
+
+    int queued = SqlStorage::statistics().queued_writes;
+    node.mutable_progress() = "12:345";
+    node.mutable_rating() = 4;
+    EXPECT_TRUE(mgr.updateContentNode(node));
+    EXPECT_TRUE(mgr.updateBookmarks(node.id(), cms_blob("bookmarks")));
+    EXPECT_EQ(SqlStorage::statistics().queued_writes, queued + 2);
+
+    ContentNode result;
+    EXPECT_TRUE(mgr.getContentNode(node.id(), result));
+    EXPECT_TRUE(result.progress() == "12:345");
+    EXPECT_EQ(result.rating(), 4);
+
+    cms_blob bookmarks;
+    EXPECT_TRUE(mgr.getBookmarks(node.id(), bookmarks));
+    EXPECT_TRUE(bookmarks == "bookmarks");
+    mgr.close();
+    current.remove(db);
+}
+
+/// Holds an exclusive lock on a database from its own connection and
+/// thread for a while, like another process writing to it.
+class DatabaseLocker : public QThread
+{
+public:
+    DatabaseLocker(const QString & path, int msecs)
+        : path_(path)
+        , msecs_(msecs)
+    {
+    }
+
+    void lock()
+    {
+        QMutexLocker locker(&mutex_);
+        start();
+        locked_.wait(&mutex_);
+    }
+
+    static void pause(int msecs) { msleep(msecs); }
+
+protected:
+    virtual void run()
+    {
+        {
+            QSqlDatabase database = QSqlDatabase::addDatabase("QSQLITE", "locker");
+            database.setDatabaseName(path_);
+            database.open();
+            QSqlQuery query(database);
+            query.exec("BEGIN EXCLUSIVE");
+            {
+                QMutexLocker locker(&mutex_);
+                locked_.wakeAll();
+            }
+            msleep(msecs_);
+            query.exec("COMMIT");
+            query.finish();
+            database.close();
+        }
+        QSqlDatabase::removeDatabase("locker");
+    }
+
+private:
+    QString        path_;
+    int            msecs_;
+    QMutex         mutex_;
+    QWaitCondition locked_;
+};
+
+/// A batch that meets a locked database is tried again until the lock
+/// is released.
+TEST(ContentManagerTest, LockedDatabaseIsRetried)
+{
+    QDir current = QDir::current();
+    QString db = current.filePath("temp.db");
+    current.remove(db);
+
+    ContentManager mgr;
+    EXPECT_TRUE(mgr.open(db));
+    EXPECT_TRUE(mgr.updateOptions(1, cms_blob("before")));
+    EXPECT_TRUE(SqlStorage::flush());
+
+    DatabaseLocker locker(db, 300);
+    locker.lock();
+    int failed = SqlStorage::statistics().failed_writes;
+    EXPECT_TRUE(mgr.updateOptions(1, cms_blob("after")));
+    EXPECT_TRUE(SqlStorage::flush());
+    EXPECT_EQ(failed, SqlStorage::statistics().failed_writes);
+    locker.wait();
+
+    cms_blob result;
+    EXPECT_TRUE(mgr.getContentOptions(1, result));
+    EXPECT_TRUE(result == "after");
+    mgr.close();
+    current.remove(db);
+}
+
+/// Writes lost to a lock that is held too long are reported by flush()
+/// and by the next update, the later writes succeed again.
+TEST(ContentManagerTest, LostWritesAreReported)
+{
+    QDir current = QDir::current();
+    QString db = current.filePath("temp.db");
+    current.remove(db);
+
+    ContentManager mgr;
+    EXPECT_TRUE(mgr.open(db));
+    EXPECT_TRUE(mgr.updateOptions(1, cms_blob("before")));
+    EXPECT_TRUE(SqlStorage::flush());
+
+    // The writer gives up after about three seconds.
+    DatabaseLocker locker(db, 6000);
+    locker.lock();
+    int failed = SqlStorage::statistics().failed_writes;
+    EXPECT_TRUE(mgr.updateOptions(1, cms_blob("lost")));
+    QTime timer;
+    timer.start();
+    while (SqlStorage::statistics().failed_writes == failed && timer.elapsed() < 6000)
+    {
+        DatabaseLocker::pause(50);
+    }
+    EXPECT_EQ(failed + 1, SqlStorage::statistics().failed_writes);
+    EXPECT_FALSE(mgr.updateBookmarks(1, cms_blob("kept")));
+    locker.wait();
+
+    EXPECT_FALSE(SqlStorage::flush(db));
+    EXPECT_TRUE(mgr.updateOptions(1, cms_blob("after")));
+    EXPECT_TRUE(SqlStorage::flush(db));
+
+    cms_blob result;
+    EXPECT_TRUE(mgr.getContentOptions(1, result));
+    EXPECT_TRUE(result == "after");
+    mgr.close();
+    current.remove(db);
+}
+
+/// A statement sqlite rejects is dropped, the rest of its batch is
+/// still written.
+TEST(ContentManagerTest, FailedStatementIsDropped)
+{
+    QDir current = QDir::current();
+    QString db = current.filePath("temp.db");
+    current.remove(db);
+
+    ContentManager mgr;
+    EXPECT_TRUE(mgr.open(db));
+
+    QSqlDatabase database = QSqlDatabase::addDatabase("QSQLITE", "failing");
+    database.setDatabaseName(db);
+    EXPECT_TRUE(SqlStorage::open(database));
+    EXPECT_TRUE(SqlStorage::write(database,
+                                  "insert into missing_table (id) values(?)",
+                                  QVariantList() << 1));
+    EXPECT_TRUE(mgr.updateOptions(2, cms_blob("kept")));
+    EXPECT_FALSE(SqlStorage::flush());
+    EXPECT_TRUE(SqlStorage::flush());
+
+    cms_blob result;
+    EXPECT_TRUE(mgr.getContentOptions(2, result));
+    EXPECT_TRUE(result == "kept");
+
+    SqlStorage::close(database);
+    database.close();
+    database = QSqlDatabase();
+    QSqlDatabase::removeDatabase("failing");
+    mgr.close();
+    current.remove(db);
+}
+
 /// Test the bookmarks blob object.
 TEST(ContentManagerTest, GetBookmark)
 {
@@ -0,0 +1,239 @@
+#include <QtCore/QtCore>
+
+#include "onyx/sys/memory_broker.h"
+#include "onyx/sys/sys_utils.h"
+#include "gtest/gtest.h"
+
+using namespace sys;
+
+namespace
+{
+
+/// A cache of fake entries. It checks that the broker only calls it on the
+/// thread it was registered on, and locks its own mutex in every call like
+/// the page caches do. The mutex is recursive, the broker calls back while
+/// add() holds it.
+class FakeClient : public MemoryClient
+{
+public:
+    FakeClient(int entries, unsigned long entry_size)
+        : owner_(QThread::currentThread())
+        , mutex_(QMutex::Recursive)
+        , entries_(entries)
+        , entry_size_(entry_size)
+        , foreign_calls_(0)
+        , released_(0)
+    {
+    }
+
+    unsigned long memoryUsage()
+    {
+        QMutexLocker locker(&mutex_);
+        check();
+        return entries_ * entry_size_;
+    }
+
+    int releaseCost()
+    {
+        QMutexLocker locker(&mutex_);
+        check();
+        return entries_ > 0 ? entries_ : -1;
+    }
+
+    unsigned long releaseMemory()
+    {
+        QMutexLocker locker(&mutex_);
+        check();
+        if (entries_ <= 0)
+        {
+            return 0;
+        }
+        --entries_;
+        released_.ref();
+        return entry_size_;
+    }
+
+    /// Reserve with the cache locked, as a cache does when it adds an entry.
+    bool add(unsigned long bytes)
+    {
+        QMutexLocker locker(&mutex_);
+        return MemoryBroker::instance().reserve(this, bytes);
+    }
+
+    int foreignCalls() { return foreign_calls_; }
+    int released() { return released_; }
+
+private:
+    void check()
+    {
+        if (QThread::currentThread() != owner_)
+        {
+            foreign_calls_.ref();
+        }
+    }
+
+private:
+    QThread *owner_;
+    QMutex mutex_;
+    int entries_;
+    unsigned long entry_size_;
+    QAtomicInt foreign_calls_;
+    QAtomicInt released_;
+};
+
+/// Registers a client on its own thread and runs an event loop there.
+class ClientThread : public QThread
+{
+public:
+    ClientThread(int entries, unsigned long entry_size, int reserves = 0)
+        : entries_(entries)
+        , entry_size_(entry_size)
+        , reserves_(reserves)
+        , client_(0)
+        , foreign_calls_(-1)
+    {
+    }
+
+    /// Calls from other threads, known once the thread finished.
+    int foreignCalls() { return foreign_calls_; }
+
+    FakeClient * client()
+    {
+        QMutexLocker locker(&mutex_);
+        while (client_ == 0)
+        {
+            ready_.wait(&mutex_);
+        }
+        return client_;
+    }
+
+protected:
+    void run()
+    {
+        FakeClient client(entries_, entry_size_);
+        MemoryBroker::instance().registerClient(&client, "thread client", 1);
+
+        // Report the usage, the broker does not ask for it from elsewhere.
+        MemoryBroker::instance().budget(&client);
+        {
+            QMutexLocker locker(&mutex_);
+            client_ = &client;
+            ready_.wakeAll();
+        }
+
+        // Reserve more than there is, so every call has to release memory.
+        for (int i = 0; i < reserves_; ++i)
+        {
+            client.add(systemAvailableMemory());
+        }
+        if (reserves_ == 0)
+        {
+            exec();
+        }
+        MemoryBroker::instance().unregisterClient(&client);
+        foreign_calls_ = client.foreignCalls();
+    }
+
+private:
+    int entries_;
+    unsigned long entry_size_;
+    int reserves_;
+    QMutex mutex_;
+    QWaitCondition ready_;
+    FakeClient *client_;
+    int foreign_calls_;
+};
+
+/// Wait until the condition holds or timeout ms passed.
+template <class Condition>
+bool waitFor(Condition condition, int timeout)
+{
+    QTime timer;
+    timer.start();
+    while (!condition())
+    {
+        if (timer.elapsed() > timeout)
+        {
+            return false;
+        }
+        QCoreApplication::processEvents();
+        QThread::yieldCurrentThread();
+    }
+    return true;
+}
+
+struct HasReleased
+{
+    explicit HasReleased(FakeClient *c) : client(c) {}
+    bool operator()() const { return client->released() > 0; }
+    FakeClient *client;
+};
+
+class MemoryBrokerTest : public ::testing::Test
+{
+protected:
+    static void SetUpTestCase()
+    {
+        static int argc = 1;
+        static char name[] = "memory_broker_test";
+        static char *argv[] = { name, 0 };
+        if (QCoreApplication::instance() == 0)
+        {
+            new QCoreApplication(argc, argv);
+        }
+    }
+};
+
+}
+
+/// A cache far above its budget is asked to drop memory. The request
+/// reaches it through the event loop of its own thread, not through the
+/// reserving call.
+TEST_F(MemoryBrokerTest, ReleaseRequestIsQueued)
+{
+    // Usage of four times the available memory exceeds the budget of
+    // the other cache whatever the system has.
+    const unsigned long entry_size = systemAvailableMemory() / 4 + 1;
+    ClientThread other(16, entry_size);
+    other.start();
+    FakeClient *remote = other.client();
+
+    FakeClient local(0, 1024);
+    MemoryBroker::instance().registerClient(&local, "empty client", 1);
+    EXPECT_TRUE(local.add(systemAvailableMemory()));
+
+    EXPECT_TRUE(waitFor(HasReleased(remote), 5000));
+    EXPECT_EQ(0, local.foreignCalls());
+
+    MemoryBroker::instance().unregisterClient(&local);
+    other.quit();
+    other.wait();
+    EXPECT_EQ(0, other.foreignCalls());
+}
+
+/// Without other caches the reserving one drops its own entries, on the
+/// reserving thread.
+TEST_F(MemoryBrokerTest, RequesterReleasesOwnEntries)
+{
+    FakeClient local(64, 1024 * 1024);
+    MemoryBroker::instance().registerClient(&local, "local client", 1);
+    local.add(systemAvailableMemory());
+    EXPECT_TRUE(local.released() > 0);
+    EXPECT_EQ(0, local.foreignCalls());
+    MemoryBroker::instance().unregisterClient(&local);
+}
+
+/// Two caches reserving at the same time with their own lock held must not
+/// deadlock, and neither is called from the thread of the other.
+TEST_F(MemoryBrokerTest, ConcurrentReserveDoesNotDeadlock)
+{
+    ClientThread first(1000, 4096, 200);
+    ClientThread second(1000, 4096, 200);
+    first.start();
+    second.start();
+
+    ASSERT_TRUE(first.wait(20000));
+    ASSERT_TRUE(second.wait(20000));
+    EXPECT_EQ(0, first.foreignCalls());
+    EXPECT_EQ(0, second.foreignCalls());
+}
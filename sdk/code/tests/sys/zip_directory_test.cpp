@@ -0,0 +1,288 @@
+#include <QtCore/QtCore>
+
+#include "onyx/sys/zip_directory.h"
+#include "gtest/gtest.h"
+
+using namespace sys;
+
+namespace
+{
+
+static const quint32 END_OF_DIRECTORY = 0x06054b50;
+static const quint32 ZIP64_END_OF_DIRECTORY = 0x06064b50;
+static const quint32 ZIP64_LOCATOR = 0x07064b50;
+static const quint32 DIRECTORY_HEADER = 0x02014b50;
+static const int DIRECTORY_HEADER_SIZE = 46;
+
+void put16(QByteArray & out, quint16 value)
+{
+    out.append(static_cast<char>(value & 0xff));
+    out.append(static_cast<char>(value >> 8));
+}
+
+void put32(QByteArray & out, quint32 value)
+{
+    put16(out, static_cast<quint16>(value & 0xffff));
+    put16(out, static_cast<quint16>(value >> 16));
+}
+
+void put64(QByteArray & out, quint64 value)
+{
+    put32(out, static_cast<quint32>(value & 0xffffffff));
+    put32(out, static_cast<quint32>(value >> 32));
+}
+
+/// A central directory file header.
+QByteArray directoryHeader(const QByteArray & name,
+                           quint32 compressed_size,
+                           quint32 uncompressed_size,
+                           quint32 offset,
+                           quint16 flags = 0,
+                           const QByteArray & extra = QByteArray())
+{
+    QByteArray header;
+    put32(header, DIRECTORY_HEADER);
+    put16(header, 20);                  // version made by
+    put16(header, 20);                  // version needed
+    put16(header, flags);
+    put16(header, 8);                   // deflated
+    put16(header, 0);                   // time
+    put16(header, 0);                   // date
+    put32(header, 0x12345678);          // crc
+    put32(header, compressed_size);
+    put32(header, uncompressed_size);
+    put16(header, static_cast<quint16>(name.size()));
+    put16(header, static_cast<quint16>(extra.size()));
+    put16(header, 0);                   // comment
+    put16(header, 0);                   // disk
+    put16(header, 0);                   // internal attributes
+    put32(header, 0);                   // external attributes
+    put32(header, offset);
+    header.append(name);
+    header.append(extra);
+    return header;
+}
+
+QByteArray endOfDirectory(quint16 count,
+                          quint32 directory_size,
+                          quint32 directory_offset,
+                          const QByteArray & comment = QByteArray())
+{
+    QByteArray record;
+    put32(record, END_OF_DIRECTORY);
+    put16(record, 0);
+    put16(record, 0);
+    put16(record, count);
+    put16(record, count);
+    put32(record, directory_size);
+    put32(record, directory_offset);
+    put16(record, static_cast<quint16>(comment.size()));
+    record.append(comment);
+    return record;
+}
+
+/// An archive of local data followed by the directory and its end record.
+QByteArray archive(const QByteArray & directory,
+                   int count,
+                   const QByteArray & comment = QByteArray())
+{
+    QByteArray data(64, 'x');
+    QByteArray result = data;
+    result.append(directory);
+    result.append(endOfDirectory(count, directory.size(), data.size(), comment));
+    return result;
+}
+
+bool readArchive(const QByteArray & data, ZipEntries & entries)
+{
+    QTemporaryFile file;
+    if (!file.open() || file.write(data) != data.size() || !file.flush())
+    {
+        return false;
+    }
+    ZipDirectory::instance().clear();
+    return ZipDirectory::instance().entries(file.fileName(), entries);
+}
+
+TEST(ZipDirectoryTest, Entries)
+{
+    QByteArray directory;
+    directory.append(directoryHeader("docs/", 0, 0, 0));
+    directory.append(directoryHeader("docs/book.txt", 100, 250, 30));
+    directory.append(directoryHeader("\xc3\xa4.txt", 7, 9, 160, 0x0800));
+
+    ZipEntries entries;
+    ASSERT_TRUE(readArchive(archive(directory, 3), entries));
+    ASSERT_EQ(3, entries.size());
+    EXPECT_TRUE(entries[0].isDir());
+    EXPECT_TRUE(entries[1].name == "docs/book.txt");
+    EXPECT_FALSE(entries[1].isDir());
+    EXPECT_EQ(8, entries[1].method);
+    EXPECT_EQ(0x12345678u, entries[1].crc);
+    EXPECT_EQ(100u, entries[1].compressed_size);
+    EXPECT_EQ(250u, entries[1].uncompressed_size);
+    EXPECT_EQ(30u, entries[1].local_header_offset);
+    EXPECT_TRUE(entries[2].name == QString::fromUtf8("\xc3\xa4.txt"));
+}
+
+TEST(ZipDirectoryTest, EmptyArchive)
+{
+    ZipEntries entries;
+    entries.push_back(ZipEntry());
+    EXPECT_TRUE(readArchive(endOfDirectory(0, 0, 0), entries));
+    EXPECT_TRUE(entries.isEmpty());
+}
+
+TEST(ZipDirectoryTest, ArchiveComment)
+{
+    QByteArray directory = directoryHeader("a.txt", 1, 1, 0);
+
+    // The comment contains an end record signature whose comment would
+    // run past the end of the file, it must be skipped.
+    QByteArray comment(1000, 'c');
+    QByteArray fake = endOfDirectory(5, 1, 1);
+    fake[20] = '\xff';
+    fake[21] = '\xff';
+    comment.replace(500, fake.size(), fake);
+
+    ZipEntries entries;
+    ASSERT_TRUE(readArchive(archive(directory, 1, comment), entries));
+    ASSERT_EQ(1, entries.size());
+    EXPECT_TRUE(entries[0].name == "a.txt");
+}
+
+TEST(ZipDirectoryTest, LongestComment)
+{
+    QByteArray directory = directoryHeader("a.txt", 1, 1, 0);
+    ZipEntries entries;
+    ASSERT_TRUE(readArchive(archive(directory, 1, QByteArray(0xffff, 'c')), entries));
+    EXPECT_EQ(1, entries.size());
+}
+
+TEST(ZipDirectoryTest, Zip64)
+{
+    const quint64 BIG = Q_UINT64_C(0x123456789);
+
+    QByteArray extra;
+    put16(extra, 0x0001);
+    put16(extra, 24);
+    put64(extra, BIG + 2);              // uncompressed size
+    put64(extra, BIG + 1);              // compressed size
+    put64(extra, BIG);                  // local header offset
+
+    QByteArray data(64, 'x');
+    QByteArray directory;
+    directory.append(directoryHeader("a.txt", 1, 2, 3));
+    directory.append(directoryHeader("big.bin", 0xffffffff, 0xffffffff, 0xffffffff, 0, extra));
+
+    QByteArray result = data;
+    result.append(directory);
+
+    quint64 record_offset = result.size();
+    put32(result, ZIP64_END_OF_DIRECTORY);
+    put64(result, 44);
+    put16(result, 45);
+    put16(result, 45);
+    put32(result, 0);
+    put32(result, 0);
+    put64(result, 2);
+    put64(result, 2);
+    put64(result, directory.size());
+    put64(result, data.size());
+
+    put32(result, ZIP64_LOCATOR);
+    put32(result, 0);
+    put64(result, record_offset);
+    put32(result, 1);
+
+    result.append(endOfDirectory(0xffff, 0xffffffff, 0xffffffff));
+
+    ZipEntries entries;
+    ASSERT_TRUE(readArchive(result, entries));
+    ASSERT_EQ(2, entries.size());
+    EXPECT_EQ(1u, entries[0].compressed_size);
+    EXPECT_EQ(2u, entries[0].uncompressed_size);
+    EXPECT_EQ(3u, entries[0].local_header_offset);
+    EXPECT_EQ(BIG + 1, entries[1].compressed_size);
+    EXPECT_EQ(BIG + 2, entries[1].uncompressed_size);
+    EXPECT_EQ(BIG, entries[1].local_header_offset);
+}
+
+TEST(ZipDirectoryTest, NotAnArchive)
+{
+    ZipEntries entries;
+    EXPECT_FALSE(readArchive(QByteArray(), entries));
+    EXPECT_FALSE(readArchive(QByteArray(21, 'x'), entries));
+    EXPECT_FALSE(readArchive(QByteArray(4096, 'x'), entries));
+    EXPECT_FALSE(ZipDirectory::instance().entries("/nonexistent/archive.zip", entries));
+}
+
+TEST(ZipDirectoryTest, TruncatedDirectory)
+{
+    QByteArray directory;
+    directory.append(directoryHeader("a.txt", 1, 1, 0));
+    directory.append(directoryHeader("b.txt", 1, 1, 0));
+
+    // The directory is cut, the end record still gives its full size.
+    QByteArray data = archive(directory, 2);
+    QByteArray truncated = data.left(64 + DIRECTORY_HEADER_SIZE + 5);
+    truncated.append(endOfDirectory(2, directory.size(), 64));
+
+    ZipEntries entries;
+    EXPECT_FALSE(readArchive(truncated, entries));
+
+    // The directory is cut in the file, everything after it is lost.
+    EXPECT_FALSE(readArchive(data.left(data.size() - 10), entries));
+}
+
+TEST(ZipDirectoryTest, MalformedDirectory)
+{
+    QByteArray first = directoryHeader("a.txt", 1, 1, 0);
+    QByteArray second = directoryHeader("b.txt", 1, 1, 0);
+    ZipEntries entries;
+
+    // Bad signature of the second header.
+    QByteArray bad_signature = first + second;
+    bad_signature[first.size()] = 'X';
+    EXPECT_FALSE(readArchive(archive(bad_signature, 2), entries));
+
+    // A name running past the end of the directory.
+    QByteArray long_name = first + second;
+    long_name[first.size() + 28] = '\xff';
+    EXPECT_FALSE(readArchive(archive(long_name, 2), entries));
+
+    // More entries than the directory can hold.
+    EXPECT_FALSE(readArchive(archive(first + second, 3), entries));
+
+    // A directory beyond the end of the file.
+    QByteArray beyond(64, 'x');
+    beyond.append(first);
+    beyond.append(endOfDirectory(1, first.size(), 0x7fffffff));
+    EXPECT_FALSE(readArchive(beyond, entries));
+}
+
+TEST(ZipDirectoryTest, CachedByModification)
+{
+    QTemporaryFile file;
+    ASSERT_TRUE(file.open());
+    QByteArray one = archive(directoryHeader("a.txt", 1, 1, 0), 1);
+    ASSERT_EQ(one.size(), file.write(one));
+    ASSERT_TRUE(file.flush());
+
+    ZipDirectory::instance().clear();
+    ZipEntries entries;
+    ASSERT_TRUE(ZipDirectory::instance().entries(file.fileName(), entries));
+    ASSERT_EQ(1, entries.size());
+
+    // A different size is noticed even within the same second.
+    QByteArray two = archive(directoryHeader("a.txt", 1, 1, 0) +
+                             directoryHeader("b.txt", 1, 1, 0), 2);
+    ASSERT_TRUE(file.resize(0));
+    ASSERT_TRUE(file.seek(0));
+    ASSERT_EQ(two.size(), file.write(two));
+    ASSERT_TRUE(file.flush());
+    ASSERT_TRUE(ZipDirectory::instance().entries(file.fileName(), entries));
+    EXPECT_EQ(2, entries.size());
+}
+
+}
@@ -27,7 +27,7 @@ private:
     bool isAudioBusy();
 
 private:
-    FILE* proc_fd_;
+    int proc_fd_;   ///< /proc/stat, kept open between samples.
     int prev_user_;
     int prev_nice_;
     int prev_system_;
@@ -17,6 +17,7 @@
 #include "screen_manager_interface.h"
 #include "drm_manager.h"
 #include "messenger_manager.h"
+#include "telemetry.h"
 
 /// Device manager which reports device states.
 class SystemManagerAdaptor : QDBusAbstractAdaptor
@@ -30,6 +31,7 @@ public:
 
 public Q_SLOTS:
     bool isProcessRunning(const QString & proc_name);
+    QVariantMap statusSnapshot();
     bool batteryStatus(int& left, int& status);
     bool updateBatteryStatus();
 
@@ -132,6 +134,12 @@ public Q_SLOTS:
 
     void reportUSBConnectionChanged(bool connected);
 
+    // Telemetry
+    void enableTelemetry(bool enable);
+    void addTraceEvents(int pid, const QByteArray & data);
+    QByteArray chromeTrace();
+    bool exportChromeTrace(const QString & path);
+
 public Q_SLOTS:
     void dbgUpdateBattery(int left, int status);
     void dbgChangeUSBCable(bool);
@@ -142,6 +150,8 @@ Q_SIGNALS:
     void sdioChangedSignal(bool on);
 
     void batterySignal(int left, int status);
+    void suspendIntervalChanged(int ms);
+    void shutdownIntervalChanged(int ms);
     void systemIdleSignal();
     void screenRotated(const int);
 
@@ -280,6 +290,7 @@ private:
     scoped_ptr<DRMManager> drm_manager_;
 
     scoped_ptr<QTimer> led_timer_;
+    Telemetry telemetry_;
 
     // UdevWatcher udev_watcher_;
     Context context_;
@@ -322,7 +333,9 @@ inline bool SystemManagerAdaptor::isConnectedToPC()
 
 inline bool SystemManagerAdaptor::setSuspendInterval(int ms)
 {
-    return power_manager_.setSuspendInterval(ms);
+    bool ret = power_manager_.setSuspendInterval(ms);
+    emit suspendIntervalChanged(power_manager_.suspendInterval());
+    return ret;
 }
 
 inline int  SystemManagerAdaptor::suspendInterval()
@@ -332,7 +345,9 @@ inline int  SystemManagerAdaptor::suspendInterval()
 
 inline bool SystemManagerAdaptor::setShutdownInterval(int ms)
 {
-    return power_manager_.setShutdownInterval(ms);
+    bool ret = power_manager_.setShutdownInterval(ms);
+    emit shutdownIntervalChanged(power_manager_.shutdownInterval());
+    return ret;
 }
 
 inline int  SystemManagerAdaptor::shutdownInterval()
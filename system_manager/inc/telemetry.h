@@ -0,0 +1,111 @@
+#ifndef ONYX_SYSTEM_TELEMETRY_H_
+#define ONYX_SYSTEM_TELEMETRY_H_
+
+#include <QtCore/QtCore>
+
+/// Fixed size buffer that overwrites the oldest entry when it is full.
+template <class T>
+class RingBuffer
+{
+public:
+    explicit RingBuffer(int capacity)
+        : data_(capacity)
+        , head_(0)
+        , size_(0)
+    {
+    }
+
+    void push(const T & value)
+    {
+        data_[(head_ + size_) % data_.size()] = value;
+        if (size_ < data_.size())
+        {
+            ++size_;
+        }
+        else
+        {
+            head_ = (head_ + 1) % data_.size();
+        }
+    }
+
+    int size() const { return size_; }
+    const T & at(int i) const { return data_.at((head_ + i) % data_.size()); }
+    void clear() { head_ = size_ = 0; }
+
+private:
+    QVector<T> data_;
+    int head_;
+    int size_;
+};
+
+/// Resource usage of one process at one point in time.
+struct ProcessSample
+{
+    qint64 time;            ///< Monotonic time in microseconds.
+    int    pid;
+    int    cpu;             ///< Cpu usage since the last sample in permille.
+    int    rss;             ///< Resident set in KB.
+    int    minor_faults;    ///< Since the last sample.
+    int    major_faults;
+    qint64 read_bytes;      ///< Storage I/O since the last sample.
+    qint64 write_bytes;
+};
+
+/// Span reported by an application through ONYX_TRACE_SPAN.
+struct SpanEvent
+{
+    QByteArray name;
+    qint64     begin;
+    qint64     duration;
+    int        pid;
+    int        tid;
+};
+
+/// Samples cpu, memory, page faults and I/O of all user processes from
+/// /proc and keeps them together with the application trace spans in
+/// ring buffers. The content can be exported as Chrome trace json, which
+/// can be loaded by chrome://tracing.
+class Telemetry : public QObject
+{
+    Q_OBJECT
+
+public:
+    Telemetry();
+    ~Telemetry();
+
+    void start(int interval);
+    void stop();
+    bool isActive() { return timer_.isActive(); }
+
+    void addTraceEvents(int pid, const QByteArray & data);
+    QByteArray chromeTrace();
+    bool exportChromeTrace(const QString & path);
+
+private Q_SLOTS:
+    void sample();
+
+private:
+    struct Counters
+    {
+        qint64 ticks;
+        qint64 time;
+        int    minor_faults;
+        int    major_faults;
+        qint64 read_bytes;
+        qint64 write_bytes;
+    };
+
+    bool readStat(int pid, Counters & counters, int & rss, QByteArray & name);
+    void readIO(int pid, Counters & counters);
+
+private:
+    QTimer timer_;
+    RingBuffer<ProcessSample> samples_;
+    RingBuffer<SpanEvent> spans_;
+    QHash<int, Counters> previous_;
+    QHash<int, QByteArray> names_;
+    long ticks_per_second_;
+    long page_size_;
+};
+
+#endif  // ONYX_SYSTEM_TELEMETRY_H_
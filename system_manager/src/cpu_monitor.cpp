@@ -1,16 +1,40 @@
 
 
 #include "cpu_monitor.h"
+#include <unistd.h>
 #include <QtCore/QtCore>
 
 
 CPUMonitor::CPUMonitor()
-: proc_fd_(0)
+: proc_fd_(-1)
+, prev_user_(0)
+, prev_nice_(0)
+, prev_system_(0)
+, prev_idle_(0)
 {
 }
 
 CPUMonitor::~CPUMonitor()
 {
+    close();
+}
+
+bool CPUMonitor::open()
+{
+    if (proc_fd_ < 0)
+    {
+        proc_fd_ = ::open("/proc/stat", O_RDONLY);
+    }
+    return proc_fd_ >= 0;
+}
+
+void CPUMonitor::close()
+{
+    if (proc_fd_ >= 0)
+    {
+        ::close(proc_fd_);
+        proc_fd_ = -1;
+    }
 }
 
 /// Record current state.
@@ -33,7 +57,7 @@ bool CPUMonitor::isIdle()
 
     int usage = (user - prev_user_) + (system - prev_system_) + (nice - prev_nice_);
     int total = usage + (idle - prev_idle_);
-    int percentage = usage * 100 / total;
+    int percentage = (total > 0) ? usage * 100 / total : 0;
 
     // qDebug("usage %d", percentage);
     prev_user_ = user;
@@ -50,18 +74,23 @@ bool CPUMonitor::isIdle()
 
 bool CPUMonitor::state(int & user, int & nice, int & system, int & idle)
 {
-    proc_fd_ = fopen("/proc/stat", "r");
-    if (proc_fd_ == 0)
+    if (!open())
     {
         qWarning("Can't open /proc/stat!");
         return false;
     }
 
-    rewind(proc_fd_);
-    fscanf(proc_fd_, "%*s %d %d %d %d", &user, &nice, &system, &idle);
-    fclose(proc_fd_);
-    proc_fd_ = 0;
-    return true;
+    // Only the first line is needed. Reading from offset 0 makes the
+    // kernel generate fresh values, no need to reopen the file.
+    char buf[256];
+    int length = pread(proc_fd_, buf, sizeof(buf) - 1, 0);
+    if (length <= 0)
+    {
+        close();
+        return false;
+    }
+    buf[length] = 0;
+    return sscanf(buf, "%*s %d %d %d %d", &user, &nice, &system, &idle) == 4;
 }
 
 bool CPUMonitor::isAudioBusy()
@@ -15,6 +15,7 @@ static const QString USB_STATE_DISCONNECT = "disconnect";
 static const QString USB_3G_HOST = "3G-host";
 static const QString USB_CLEANUP = "cleanup";
 static const int TIMEOUT = 1000;
+static const int TELEMETRY_INTERVAL = 2000;
 
 // Given a list of commandline arguments, find the path of GUI shell specified
 // by -shell=...
@@ -66,6 +67,11 @@ SystemManagerAdaptor::SystemManagerAdaptor(QApplication &app)
 
     s_vdd_fixed = (qgetenv("FIXED_VDD").toInt() > 0);
 
+    if (qgetenv("ONYX_TRACE").toInt() > 0)
+    {
+        enableTelemetry(true);
+    }
+
     // Battery.
     connect(&power_manager_,
         SIGNAL(batteryChangedSignal(int,int)),
@@ -199,6 +205,52 @@ bool SystemManagerAdaptor::batteryStatus(int& left,
     return power_manager_.batteryStatus(left, status);
 }
 
+/// Return the state that clients mirror locally in one reply, so they
+/// do not need a round trip for each value. Later changes are broadcast
+/// by batterySignal, volumeChanged and the interval changed signals.
+QVariantMap SystemManagerAdaptor::statusSnapshot()
+{
+    QVariantMap snapshot;
+    int left = 0, status = BATTERY_STATUS_NORMAL;
+    power_manager_.batteryStatus(left, status);
+    snapshot["battery_left"] = left;
+    snapshot["battery_status"] = status;
+    snapshot["volume"] = volume();
+    snapshot["mute"] = isMute();
+    snapshot["suspend_interval"] = suspendInterval();
+    snapshot["shutdown_interval"] = shutdownInterval();
+    return snapshot;
+}
+
+/// Start or stop sampling the processes. Trace spans are recorded
+/// either way, as long as the applications send them.
+void SystemManagerAdaptor::enableTelemetry(bool enable)
+{
+    if (enable)
+    {
+        telemetry_.start(TELEMETRY_INTERVAL);
+    }
+    else
+    {
+        telemetry_.stop();
+    }
+}
+
+void SystemManagerAdaptor::addTraceEvents(int pid, const QByteArray & data)
+{
+    telemetry_.addTraceEvents(pid, data);
+}
+
+QByteArray SystemManagerAdaptor::chromeTrace()
+{
+    return telemetry_.chromeTrace();
+}
+
+bool SystemManagerAdaptor::exportChromeTrace(const QString & path)
+{
+    return telemetry_.exportChromeTrace(path);
+}
+
 bool SystemManagerAdaptor::updateBatteryStatus()
 {
     power_manager_.updateBattery();
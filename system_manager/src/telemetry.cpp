@@ -0,0 +1,291 @@
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "telemetry.h"
+
+/// About half an hour of samples for 30 processes at the default rate.
+static const int SAMPLE_CAPACITY = 16 * 1024;
+static const int SPAN_CAPACITY = 8 * 1024;
+
+static qint64 now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<qint64>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+/// Read a small /proc file without going through stdio.
+static int readProcFile(const char *path, char *buf, int size)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    int length = read(fd, buf, size - 1);
+    close(fd);
+    if (length < 0)
+    {
+        return -1;
+    }
+    buf[length] = 0;
+    return length;
+}
+
+static void appendEscaped(QByteArray & out, const QByteArray & text)
+{
+    for (int i = 0; i < text.size(); ++i)
+    {
+        char c = text.at(i);
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+        }
+        if (static_cast<unsigned char>(c) >= 0x20)
+        {
+            out += c;
+        }
+    }
+}
+
+Telemetry::Telemetry()
+    : samples_(SAMPLE_CAPACITY)
+    , spans_(SPAN_CAPACITY)
+    , ticks_per_second_(sysconf(_SC_CLK_TCK))
+    , page_size_(sysconf(_SC_PAGESIZE))
+{
+    connect(&timer_, SIGNAL(timeout()), this, SLOT(sample()));
+}
+
+Telemetry::~Telemetry()
+{
+}
+
+/// \param interval Sampling interval in ms.
+void Telemetry::start(int interval)
+{
+    previous_.clear();
+    timer_.start(interval);
+}
+
+void Telemetry::stop()
+{
+    timer_.stop();
+}
+
+/// Parse /proc/<pid>/stat. The command name may contain spaces, so the
+/// fields are counted from the closing parenthesis.
+bool Telemetry::readStat(int pid, Counters & counters, int & rss, QByteArray & name)
+{
+    char path[32];
+    char buf[1024];
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    if (readProcFile(path, buf, sizeof(buf)) <= 0)
+    {
+        return false;
+    }
+
+    char *begin = strchr(buf, '(');
+    char *end = strrchr(buf, ')');
+    if (begin == 0 || end == 0)
+    {
+        return false;
+    }
+    name = QByteArray(begin + 1, end - begin - 1);
+
+    // Fields after the name: state(3) ppid pgrp session tty tpgid flags
+    // minflt(10) cminflt majflt(12) cmajflt utime(14) stime(15) cutime
+    // cstime priority nice threads itrealvalue starttime vsize rss(24)
+    unsigned long minflt = 0, majflt = 0, utime = 0, stime = 0;
+    long pages = 0;
+    int count = sscanf(end + 2,
+                       "%*c %*d %*d %*d %*d %*d %*u %lu %*u %lu %*u %lu %lu "
+                       "%*d %*d %*d %*d %*d %*d %*u %*u %ld",
+                       &minflt, &majflt, &utime, &stime, &pages);
+    if (count != 5)
+    {
+        return false;
+    }
+
+    counters.ticks = utime + stime;
+    counters.minor_faults = minflt;
+    counters.major_faults = majflt;
+    rss = pages * page_size_ / 1024;
+    return true;
+}
+
+void Telemetry::readIO(int pid, Counters & counters)
+{
+    char path[32];
+    char buf[512];
+    counters.read_bytes = counters.write_bytes = 0;
+    snprintf(path, sizeof(path), "/proc/%d/io", pid);
+    if (readProcFile(path, buf, sizeof(buf)) <= 0)
+    {
+        return;
+    }
+
+    char *p = strstr(buf, "\nread_bytes:");
+    if (p)
+    {
+        counters.read_bytes = strtoll(p + 12, 0, 10);
+    }
+    p = strstr(buf, "\nwrite_bytes:");
+    if (p)
+    {
+        counters.write_bytes = strtoll(p + 13, 0, 10);
+    }
+}
+
+/// Record one sample of every process that has memory mapped, kernel
+/// threads are skipped. The first sample of a process only records the
+/// counters, the deltas start with the second one.
+void Telemetry::sample()
+{
+    DIR *dir = opendir("/proc");
+    if (dir == 0)
+    {
+        return;
+    }
+
+    QHash<int, Counters> current;
+    qint64 time = now();
+    struct dirent *entry = 0;
+    while ((entry = readdir(dir)) != 0)
+    {
+        int pid = atoi(entry->d_name);
+        if (pid <= 0)
+        {
+            continue;
+        }
+
+        Counters counters;
+        int rss = 0;
+        QByteArray name;
+        if (!readStat(pid, counters, rss, name) || rss <= 0)
+        {
+            continue;
+        }
+        readIO(pid, counters);
+        counters.time = time;
+        current.insert(pid, counters);
+        if (names_.value(pid) != name)
+        {
+            names_.insert(pid, name);
+        }
+
+        QHash<int, Counters>::const_iterator prev = previous_.find(pid);
+        if (prev == previous_.end())
+        {
+            continue;
+        }
+
+        ProcessSample s;
+        s.time = time;
+        s.pid = pid;
+        qint64 elapsed = time - prev->time;
+        qint64 busy = (counters.ticks - prev->ticks) * 1000000 / ticks_per_second_;
+        s.cpu = elapsed > 0 ? static_cast<int>(busy * 1000 / elapsed) : 0;
+        s.rss = rss;
+        s.minor_faults = counters.minor_faults - prev->minor_faults;
+        s.major_faults = counters.major_faults - prev->major_faults;
+        s.read_bytes = counters.read_bytes - prev->read_bytes;
+        s.write_bytes = counters.write_bytes - prev->write_bytes;
+        samples_.push(s);
+    }
+    closedir(dir);
+    previous_ = current;
+}
+
+/// Decode a batch sent by sys::Trace::flush.
+void Telemetry::addTraceEvents(int pid, const QByteArray & data)
+{
+    QDataStream stream(data);
+    qint32 count = 0;
+    stream >> count;
+    for (int i = 0; i < count && stream.status() == QDataStream::Ok; ++i)
+    {
+        SpanEvent span;
+        qint32 tid = 0;
+        stream >> span.name >> span.begin >> span.duration >> tid;
+        span.pid = pid;
+        span.tid = tid;
+        spans_.push(span);
+    }
+}
+
+/// Spans become complete events, the samples become counter events of
+/// their process.
+QByteArray Telemetry::chromeTrace()
+{
+    QByteArray out;
+    out.reserve((samples_.size() + spans_.size()) * 128);
+    out += "{\"traceEvents\":[";
+    bool first = true;
+
+    QHash<int, QByteArray>::const_iterator iter = names_.begin();
+    for (; iter != names_.end(); ++iter)
+    {
+        out += first ? "\n" : ",\n";
+        first = false;
+        out += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":";
+        out += QByteArray::number(iter.key());
+        out += ",\"args\":{\"name\":\"";
+        appendEscaped(out, iter.value());
+        out += "\"}}";
+    }
+
+    for (int i = 0; i < spans_.size(); ++i)
+    {
+        const SpanEvent & span = spans_.at(i);
+        out += first ? "\n" : ",\n";
+        first = false;
+        out += "{\"name\":\"";
+        appendEscaped(out, span.name);
+        out += "\",\"ph\":\"X\",\"ts\":" + QByteArray::number(span.begin);
+        out += ",\"dur\":" + QByteArray::number(span.duration);
+        out += ",\"pid\":" + QByteArray::number(span.pid);
+        out += ",\"tid\":" + QByteArray::number(span.tid) + "}";
+    }
+
+    for (int i = 0; i < samples_.size(); ++i)
+    {
+        const ProcessSample & s = samples_.at(i);
+        QByteArray common = ",\"ph\":\"C\",\"ts\":" + QByteArray::number(s.time) +
+                            ",\"pid\":" + QByteArray::number(s.pid);
+        out += first ? "\n" : ",\n";
+        first = false;
+        out += "{\"name\":\"cpu\"" + common;
+        out += ",\"args\":{\"permille\":" + QByteArray::number(s.cpu) + "}},\n";
+        out += "{\"name\":\"memory\"" + common;
+        out += ",\"args\":{\"rss_kb\":" + QByteArray::number(s.rss) + "}},\n";
+        out += "{\"name\":\"faults\"" + common;
+        out += ",\"args\":{\"minor\":" + QByteArray::number(s.minor_faults);
+        out += ",\"major\":" + QByteArray::number(s.major_faults) + "}},\n";
+        out += "{\"name\":\"io\"" + common;
+        out += ",\"args\":{\"read\":" + QByteArray::number(s.read_bytes);
+        out += ",\"write\":" + QByteArray::number(s.write_bytes) + "}}";
+    }
+
+    out += "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return out;
+}
+
+bool Telemetry::exportChromeTrace(const QString & path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        qWarning("Could not open %s", qPrintable(path));
+        return false;
+    }
+    QByteArray data = chromeTrace();
+    bool ok = (file.write(data) == data.size());
+    file.close();
+    return ok;
+}